@@ -7,6 +7,8 @@
 #include<cmath>
 #include<complex>
 #include<set>
+#include<map>
+#include<utility>
 #include<iostream>
 #include<algorithm>
 #include<numeric>
@@ -14,6 +16,8 @@
 
 #include "istlexception.hh"
 #include "bvector.hh"
+#include "threading.hh"
+#include "blockkernels.hh"
 #include <dune/common/shared_ptr.hh>
 #include <dune/common/stdstreams.hh>
 #include <dune/common/iteratorfacades.hh>
@@ -68,6 +72,33 @@ namespace Dune {
   template<typename M>
   struct MatrixDimension;
 
+  /**
+   * @brief Statistics about compressing a BCRSMatrix built in implicit mode.
+   */
+  template<typename size_type>
+  struct CompressionStatistics
+  {
+    //! average number of nonzeros per row
+    double avg;
+    //! maximum number of nonzeros per row
+    size_type maximum;
+    //! number of entries that went into the overflow area
+    size_type overflow_total;
+    /**
+     * @brief fraction of the allocated memory that is used after compression
+     *
+     * Small values indicate that the average row size passed to the
+     * constructor was chosen too large.
+     */
+    double mem_ratio;
+  };
+
+  /**
+   * @brief Thrown when the overflow area of a BCRSMatrix in implicit mode
+   * is too small to compress the matrix.
+   */
+  class ImplicitModeOverflowExhausted : public ISTLError {};
+
   /**
      \brief A sparse block matrix with compressed row storage
 
@@ -79,6 +110,7 @@ namespace Dune {
 
      1. Row-wise scheme
      2. Random scheme
+     3. Implicit scheme
 
      Error checking: no error checking is provided normally.
      Setting the compile time switch DUNE_ISTL_WITH_CHECKING
@@ -174,6 +206,32 @@ namespace Dune {
      B[3][0] = 7;
      B[3][3] = 8;
      \endcode
+
+     3. Implicit scheme
+
+     The pattern and the values are set up in a single pass in any order
+     without knowing the sizes of the rows in advance. Only an estimate of
+     the average number of nonzeros per row is needed. Each row gets room
+     for that many entries in one array, further entries go into an
+     overflow area. compress() finally moves everything into the usual
+     compressed row storage without allocating memory again.
+
+     \code
+     #include<dune/common/fmatrix.hh>
+     #include<dune/istl/bcrsmatrix.hh>
+
+     ...
+
+     typedef FieldMatrix<double,2,2> M;
+     // room for 3 entries per row plus 10% overflow
+     BCRSMatrix<M> B(4,4,3,0.1,BCRSMatrix<M>::implicit);
+
+     B.entry(0,0) = 1;
+     B.entry(3,1) = 5;
+     B.entry(3,1) += 2;
+     ...
+     CompressionStatistics<BCRSMatrix<M>::size_type> stats = B.compress();
+     \endcode
   */
     template<class B, class A=std::allocator<B> >
   class BCRSMatrix
@@ -190,7 +248,12 @@ namespace Dune {
        */
       rowSizesBuilt=1, 
       /** @brief The matrix structure is built fully.*/
-      built=2
+      built=2,
+      /** @brief Entries are being inserted.
+       *
+       * Only used in implicit mode.
+       */
+      building=3
     };
 
   public:
@@ -240,6 +303,14 @@ namespace Dune {
 	   * can not be defined in sequential order.
 	   */
 	  random,
+	  /**
+	   * @brief Build entries in any order in a single pass.
+	   *
+	   * Entries are created by entry() using an estimate of the average
+	   * row size. compress() turns the matrix into the usual compressed
+	   * row storage in place.
+	   */
+	  implicit,
 	  /**
 	   * @brief Build mode not set!
 	   */
@@ -445,48 +516,57 @@ namespace Dune {
 
 	//! an empty matrix
 	BCRSMatrix () 
-	  : build_mode(unknown), ready(notbuilt), n(0), m(0), nnz(0),
-        r(0), a(0)
+	  : build_mode(unknown), ready(notbuilt), n(0), m(0), nnz(0), allocationSize(0),
+        r(0), a(0), avg(0), overflowsize(-1.0)
 	{}
 
 	//! matrix with known number of nonzeroes
 	BCRSMatrix (size_type _n, size_type _m, size_type _nnz, BuildMode bm)
-	  : build_mode(bm), ready(notbuilt)
+	  : build_mode(bm), ready(notbuilt), avg(0), overflowsize(-1.0)
 	{
 	  allocate(_n, _m, _nnz);
 	}
 
 	//! matrix with unknown number of nonzeroes
 	BCRSMatrix (size_type _n, size_type _m, BuildMode bm)
-	  : build_mode(bm), ready(notbuilt)
+	  : build_mode(bm), ready(notbuilt), avg(0), overflowsize(-1.0)
 	{
 	  allocate(_n, _m);
 	}
 
+    /**
+     * @brief matrix to be built in implicit mode
+     *
+     * @param _n The number of rows.
+     * @param _m The number of columns.
+     * @param _avg The expected average number of nonzeros per row.
+     * @param _overflow The size of the overflow area as a fraction of
+     * the _n*_avg entries reserved for the rows.
+     * @param bm Has to be implicit.
+     */
+	BCRSMatrix (size_type _n, size_type _m, size_type _avg, double _overflow, BuildMode bm)
+	  : build_mode(bm), ready(notbuilt), n(0), m(0), nnz(0), allocationSize(0), r(0), a(0),
+        avg(_avg), overflowsize(_overflow)
+	{
+	  if (bm!=implicit)
+		DUNE_THROW(ISTLError,"only the implicit build mode takes an average row size");
+	  implicit_allocate(_n, _m);
+	}
+
     /** 
 	 * @brief copy constructor
 	 *
 	 * Does a deep copy as expected.
 	 */
 	BCRSMatrix (const BCRSMatrix& Mat)
-	  : n(Mat.n), nnz(0)
+	  : n(0), nnz(0), allocationSize(0), avg(Mat.avg), overflowsize(Mat.overflowsize)
 	{
-	  // deep copy in global array
-	  size_type _nnz = Mat.nnz;
-
-	  // in case of row-wise allocation
-	  if (_nnz<=0)
-		{
-		  _nnz = 0;
-		  for (size_type i=0; i<n; i++)
-			_nnz += Mat.r[i].getsize();
-		}
+	  if (Mat.ready==building)
+		DUNE_THROW(InvalidStateException,"cannot copy a matrix in the implicit building stage, call compress() first");
 
-      j = Mat.j; // enable column index sharing, release array in case of row-wise allocation
-	  allocate(Mat.n, Mat.m, _nnz);
-
-	  // build window structure
-	  copyWindowStructure(Mat);
+	  // share j and allocate a
+	  setupPatternOf(Mat, true);
+	  copyValues(Mat);
 	}
 
 	//! destructor 
@@ -528,7 +608,30 @@ namespace Dune {
       deallocate();
       
       // allocate matrix memory
-      allocate(rows, columns, nnz);
+      if (build_mode==implicit)
+        implicit_allocate(rows, columns);
+      else
+        allocate(rows, columns, nnz);
+    }
+
+    /**
+     * @brief Set the parameters of the implicit build mode.
+     *
+     * Has to be called before the matrix is allocated, e.g. after
+     * setBuildMode(implicit) and before setSize().
+     *
+     * @param _avg The expected average number of nonzeros per row.
+     * @param _overflow The size of the overflow area as a fraction of
+     * the reserved row storage.
+     */
+    void setImplicitBuildModeParameters(size_type _avg, double _overflow)
+    {
+      if (build_mode!=implicit)
+        DUNE_THROW(InvalidStateException,"requires implicit build mode");
+      if (ready!=notbuilt)
+        DUNE_THROW(InvalidStateException,"implicit build mode parameters have to be set before the matrix is allocated");
+      avg = _avg;
+      overflowsize = _overflow;
     }
     
     /** 
@@ -536,39 +639,77 @@ namespace Dune {
      *
      * Frees and reallocates space.
      * Both sparsity pattern and values are set from Mat.
+     * If both matrices share their pattern (see sharePattern()),
+     * only the values are copied.
      */
     BCRSMatrix& operator= (const BCRSMatrix& Mat)
     {
       // return immediately when self-assignment
       if (&Mat==this) return *this;
+      if (Mat.ready==building)
+        DUNE_THROW(InvalidStateException,"cannot copy a matrix in the implicit building stage, call compress() first");
       
-      // make it simple: ALWAYS throw away memory for a and j
-      deallocate(false);
-      
-      // reallocate the rows if required
-      if (n>0 && n!=Mat.n) {
-          // free rows
-          for(row_type *riter=r+(n-1), *rend=r-1; riter!=rend; --riter)
-            rowAllocator_.destroy(riter);
-          rowAllocator_.deallocate(r,n);
-      }
-
-      nnz=Mat.nnz;
-      if (nnz<=0)
-	{
-	  for (size_type i=0; i<Mat.n; i++)
-	    nnz += Mat.r[i].getsize();
-	}
+      // same pattern (e.g. the matrix of the last time step): only copy the values
+      if (sharesPatternWith(Mat))
+        {
+          copyValues(Mat);
+          return *this;
+        }
 
-      // allocate a, share j
-      j = Mat.j;
-      allocate(Mat.n, Mat.m, nnz, n!=Mat.n);
-      
-      // build window structure
-      copyWindowStructure(Mat);
+      reallocatePattern(Mat);
+      copyValues(Mat);
       return *this;
     }
 
+    /**
+     * @brief Set up the matrix with the sparsity pattern of another matrix.
+     *
+     * The column index array of Mat is shared and only the memory for the
+     * values is allocated. All entries are set to zero. Subsequent
+     * assignments between matrices sharing a pattern only copy the values.
+     *
+     * \code
+     * BCRSMatrix<B> A(...);  // assembled once
+     * BCRSMatrix<B> M;
+     * M.sharePattern(A);     // allocates the values only
+     * ...
+     * M = A;                 // copies the values only
+     * \endcode
+     *
+     * If the rows of Mat were allocated individually, a new contiguous
+     * copy of the pattern is set up instead.
+     */
+    void sharePattern (const BCRSMatrix& Mat)
+    {
+      if (&Mat==this) return;
+      if (Mat.ready!=built)
+        DUNE_THROW(InvalidStateException,"the pattern to share is not built");
+
+      if (!sharesPatternWith(Mat))
+        reallocatePattern(Mat);
+      for (size_type i=0; i<n; i++) r[i] = 0;
+    }
+
+    /**
+     * @brief Whether this matrix and Mat share their sparsity pattern.
+     *
+     * True if the column index array is the same and the values are laid
+     * out identically, i.e. assigning Mat to this matrix only copies the
+     * values.
+     */
+    bool sharesPatternWith (const BCRSMatrix& Mat) const
+    {
+      if (ready!=built || Mat.ready!=built || nnz<=0 || nnz!=Mat.nnz
+          || j.get()!=Mat.j.get() || n!=Mat.n || m!=Mat.m)
+        return false;
+      for (size_type i=0; i<n; i++)
+        if (r[i].getsize()!=Mat.r[i].getsize()
+            || r[i].getindexptr()!=Mat.r[i].getindexptr()
+            || (r[i].getsize()>0 && r[i].getptr()-a!=Mat.r[i].getptr()-Mat.a))
+          return false;
+      return true;
+    }
+
       //! Assignment from a scalar
 	BCRSMatrix& operator= (const field_type& k)
 	{
@@ -874,7 +1015,142 @@ namespace Dune {
 	  }
 
 	  // if not, set matrix to built
+	  partitions_.clear();
+	  columns_.start.clear();
+	  ready = built;
+	}
+
+	//===== implicit creation interface
+
+    /**
+     * @brief Get the entry (row,col), creating it if necessary.
+     *
+     * Only available in implicit mode before compress() is called. New
+     * entries are initialized with zero. Entries beyond the average row
+     * size go into the overflow area, which is slower.
+     */
+	B& entry (size_type row, size_type col)
+	{
+	  if (build_mode!=implicit)
+		DUNE_THROW(ISTLError,"requires implicit build mode");
+	  if (ready==built)
+		DUNE_THROW(ISTLError,"matrix already built up, use operator[] for entry access");
+	  if (ready!=building)
+		DUNE_THROW(InvalidStateException,"matrix not allocated yet");
+#ifdef DUNE_ISTL_WITH_CHECKING
+	  if (row>=n) DUNE_THROW(ISTLError,"row index exceeds matrix size");
+	  if (col>=m) DUNE_THROW(ISTLError,"column index exceeds matrix size");
+#endif
+
+	  size_type* const first = r[row].getindexptr();
+	  size_type* const last = first + r[row].getsize();
+
+	  // entries of a row are unsorted until compress() is called
+	  size_type* pos = std::find(first,last,col);
+	  if (pos!=last)
+		return r[row].getptr()[pos-first];
+
+	  if (r[row].getsize()<avg)
+		{
+		  B* block = r[row].getptr()+r[row].getsize();
+		  *last = col;
+		  *block = 0;
+		  r[row].setsize(r[row].getsize()+1);
+		  return *block;
+		}
+
+	  std::pair<typename OverflowType::iterator,bool> res =
+		overflow.insert(std::make_pair(std::make_pair(row,col),B()));
+	  if (res.second)
+		res.first->second = 0;
+	  return res.first->second;
+	}
+
+    /**
+     * @brief Finish the implicit build.
+     *
+     * Sorts the entries of each row, merges them with the overflow area
+     * and moves them into a contiguous compressed row storage at the
+     * beginning of the already allocated arrays. Afterwards the matrix is
+     * built and entries are accessed with operator[].
+     *
+     * @throw ImplicitModeOverflowExhausted If more entries went into the
+     * overflow area than it can hold.
+     */
+	CompressionStatistics<size_type> compress ()
+	{
+	  if (build_mode!=implicit)
+		DUNE_THROW(ISTLError,"requires implicit build mode");
+	  if (ready!=building)
+		DUNE_THROW(InvalidStateException,"matrix is not in the building stage");
+	  if (overflow.size()>overflowEntries)
+		DUNE_THROW(ImplicitModeOverflowExhausted,
+				   "overflow area of size "<<overflowEntries<<" exhausted by "
+				   <<overflow.size()<<" entries, increase the average row size or overflow fraction");
+
+	  CompressionStatistics<size_type> stats;
+	  stats.maximum = 0;
+	  stats.overflow_total = overflow.size();
+
+	  // The compressed rows are written to the beginning of a and j. The
+	  // write position never passes the start of the next unprocessed row
+	  // because the overflow area is in front of the rows.
+	  size_type* jpos = j.get();
+	  B* apos = a;
+	  typename OverflowType::const_iterator oit = overflow.begin();
+	  std::vector<std::pair<size_type,size_type> > order;
+	  std::vector<B> values;
+
+	  for (size_type i=0; i<n; ++i)
+		{
+		  const size_type s = r[i].getsize();
+		  const size_type* rj = r[i].getindexptr();
+		  const B* ra = r[i].getptr();
+
+		  order.resize(s);
+		  values.assign(ra,ra+s);
+		  for (size_type k=0; k<s; ++k)
+			order[k] = std::make_pair(rj[k],k);
+		  std::sort(order.begin(),order.end());
+
+		  size_type* jstart = jpos;
+		  B* astart = apos;
+		  typename std::vector<std::pair<size_type,size_type> >::const_iterator
+			it = order.begin(), endit = order.end();
+		  while (it!=endit || (oit!=overflow.end() && oit->first.first==i))
+			{
+			  if (oit!=overflow.end() && oit->first.first==i
+				  && (it==endit || oit->first.second<it->first))
+				{
+				  *jpos++ = oit->first.second;
+				  *apos++ = oit->second;
+				  ++oit;
+				}
+			  else
+				{
+				  *jpos++ = it->first;
+				  *apos++ = values[it->second];
+				  ++it;
+				}
+			}
+
+		  const size_type size = jpos-jstart;
+		  if (size>0)
+			r[i].set(size,astart,jstart);
+		  else
+			r[i].set(0,0,0);
+		  stats.maximum = std::max(stats.maximum,size);
+		}
+
+	  stats.mem_ratio = double(jpos-j.get())/double(nnz);
+	  nnz = jpos-j.get();
+	  stats.avg = n>0 ? double(nnz)/double(n) : 0.0;
+
+	  overflow.clear();
+	  partitions_.clear();
+	  columns_.start.clear();
 	  ready = built;
+	  return stats;
 	}
 
 	//===== vector space arithmetic
@@ -990,7 +1266,14 @@ namespace Dune {
 
 	//===== linear maps
    
-	//! y = A x
+	/*! \brief y = A x
+	 *
+	 * If ISTL was configured with a threading backend the rows are
+	 * processed by ISTLThreading::threadsFor(nonzeroes()) threads.
+	 * Each row is computed by exactly one thread in the same order as
+	 * in the serial loop, thus the result does not depend on the
+	 * number of threads.
+	 */
 	template<class X, class Y>
 	void mv (const X& x, Y& y) const
 	{
@@ -1000,17 +1283,19 @@ namespace Dune {
 	  if (y.N()!=N()) DUNE_THROW(ISTLError,
         "Size mismatch: M: " << N() << "x" << M() << " y: " << y.N());
 #endif
-	  ConstRowIterator endi=end();
-	  for (ConstRowIterator i=begin(); i!=endi; ++i)
+	  const int threads = ISTLThreading::threadsFor(nnz>0 ? nnz : n);
+	  if (threads>1)
 		{
-		  y[i.index()]=0;
-		  ConstColIterator endj = (*i).end();
-		  for (ConstColIterator j=(*i).begin(); j!=endj; ++j)
-			(*j).umv(x[j.index()],y[i.index()]);
+		  const RowPartition& partition = rowPartition(threads);
+		  RowRangeKernel<X,Y> kernel(*this, partition,
+									 RowRangeKernel<X,Y>::assign, 1, x, y);
+		  parallelFor(threads, kernel);
 		}
+	  else
+		mvRows(x,y,0,n);
 	}
 
-	//! y += A x
+	//! y += A x, threaded like mv()
 	template<class X, class Y>
 	void umv (const X& x, Y& y) const
 	{
@@ -1018,13 +1303,16 @@ namespace Dune {
 	  if (x.N()!=M()) DUNE_THROW(ISTLError,"index out of range");
 	  if (y.N()!=N()) DUNE_THROW(ISTLError,"index out of range");
 #endif
-	  ConstRowIterator endi=end();
-	  for (ConstRowIterator i=begin(); i!=endi; ++i)
+	  const int threads = ISTLThreading::threadsFor(nnz>0 ? nnz : n);
+	  if (threads>1)
 		{
-		  ConstColIterator endj = (*i).end();
-		  for (ConstColIterator j=(*i).begin(); j!=endj; ++j)
-			(*j).umv(x[j.index()],y[i.index()]);
+		  const RowPartition& partition = rowPartition(threads);
+		  RowRangeKernel<X,Y> kernel(*this, partition,
+									 RowRangeKernel<X,Y>::add, 1, x, y);
+		  parallelFor(threads, kernel);
 		}
+	  else
+		umvRows(x,y,0,n);
 	}
 
 	//! y -= A x
@@ -1044,7 +1332,7 @@ namespace Dune {
 		}
 	}
 
-	//! y += alpha A x
+	//! y += alpha A x, threaded like mv()
 	template<class X, class Y>
 	void usmv (const field_type& alpha, const X& x, Y& y) const
 	{
@@ -1052,13 +1340,16 @@ namespace Dune {
 	  if (x.N()!=M()) DUNE_THROW(ISTLError,"index out of range");
 	  if (y.N()!=N()) DUNE_THROW(ISTLError,"index out of range");
 #endif
-	  ConstRowIterator endi=end();
-	  for (ConstRowIterator i=begin(); i!=endi; ++i)
+	  const int threads = ISTLThreading::threadsFor(nnz>0 ? nnz : n);
+	  if (threads>1)
 		{
-		  ConstColIterator endj = (*i).end();
-		  for (ConstColIterator j=(*i).begin(); j!=endj; ++j)
-			(*j).usmv(alpha,x[j.index()],y[i.index()]);
+		  const RowPartition& partition = rowPartition(threads);
+		  RowRangeKernel<X,Y> kernel(*this, partition,
+									 RowRangeKernel<X,Y>::scaledAdd, alpha, x, y);
+		  parallelFor(threads, kernel);
 		}
+	  else
+		usmvRows(alpha,x,y,0,n);
 	}
 
     //! y = A^T x
@@ -1074,7 +1365,16 @@ namespace Dune {
       umtv(x,y);
     }
 
-	//! y += A^T x
+	/*! \brief y += A^T x
+	 *
+	 * With a threading backend the transposed products (umtv, mmtv,
+	 * usmtv, umhv, mmhv, usmhv and thus mtv) work on a column-wise
+	 * index of the pattern that is built on first use and cached. Each
+	 * thread owns a range of entries of y and no atomics are needed.
+	 * Every entry of y receives its contributions in ascending row order
+	 * as in the serial loop, so the result does not depend on the number
+	 * of threads.
+	 */
 	template<class X, class Y>
 	void umtv (const X& x, Y& y) const
 	{
@@ -1082,6 +1382,16 @@ namespace Dune {
 	  if (x.N()!=N()) DUNE_THROW(ISTLError,"index out of range");
 	  if (y.N()!=M()) DUNE_THROW(ISTLError,"index out of range");
 #endif
+	  const int threads = ISTLThreading::threadsFor(nnz>0 ? nnz : n);
+	  if (threads>1)
+		{
+		  const RowPartition* partition;
+		  const ColumnIndex& columns = columnIndex(threads, partition);
+		  ColumnKernel<X,Y> kernel(columns, *partition, ColumnKernel<X,Y>::add,
+								   1, x, y);
+		  parallelFor(threads, kernel);
+		  return;
+		}
 	  ConstRowIterator endi=end();
 	  for (ConstRowIterator i=begin(); i!=endi; ++i)
 		{
@@ -1099,6 +1409,16 @@ namespace Dune {
 	  if (x.N()!=N()) DUNE_THROW(ISTLError,"index out of range");
 	  if (y.N()!=M()) DUNE_THROW(ISTLError,"index out of range");
 #endif
+	  const int threads = ISTLThreading::threadsFor(nnz>0 ? nnz : n);
+	  if (threads>1)
+		{
+		  const RowPartition* partition;
+		  const ColumnIndex& columns = columnIndex(threads, partition);
+		  ColumnKernel<X,Y> kernel(columns, *partition, ColumnKernel<X,Y>::subtract,
+								   1, x, y);
+		  parallelFor(threads, kernel);
+		  return;
+		}
 	  ConstRowIterator endi=end();
 	  for (ConstRowIterator i=begin(); i!=endi; ++i)
 		{
@@ -1116,6 +1436,16 @@ namespace Dune {
 	  if (x.N()!=N()) DUNE_THROW(ISTLError,"index out of range");
 	  if (y.N()!=M()) DUNE_THROW(ISTLError,"index out of range");
 #endif
+	  const int threads = ISTLThreading::threadsFor(nnz>0 ? nnz : n);
+	  if (threads>1)
+		{
+		  const RowPartition* partition;
+		  const ColumnIndex& columns = columnIndex(threads, partition);
+		  ColumnKernel<X,Y> kernel(columns, *partition, ColumnKernel<X,Y>::scaledAdd,
+								   alpha, x, y);
+		  parallelFor(threads, kernel);
+		  return;
+		}
 	  ConstRowIterator endi=end();
 	  for (ConstRowIterator i=begin(); i!=endi; ++i)
 		{
@@ -1133,6 +1463,16 @@ namespace Dune {
 	  if (x.N()!=N()) DUNE_THROW(ISTLError,"index out of range");
 	  if (y.N()!=M()) DUNE_THROW(ISTLError,"index out of range");
 #endif
+	  const int threads = ISTLThreading::threadsFor(nnz>0 ? nnz : n);
+	  if (threads>1)
+		{
+		  const RowPartition* partition;
+		  const ColumnIndex& columns = columnIndex(threads, partition);
+		  ColumnKernel<X,Y> kernel(columns, *partition, ColumnKernel<X,Y>::hermitianAdd,
+								   1, x, y);
+		  parallelFor(threads, kernel);
+		  return;
+		}
 	  ConstRowIterator endi=end();
 	  for (ConstRowIterator i=begin(); i!=endi; ++i)
 		{
@@ -1150,6 +1490,16 @@ namespace Dune {
 	  if (x.N()!=N()) DUNE_THROW(ISTLError,"index out of range");
 	  if (y.N()!=M()) DUNE_THROW(ISTLError,"index out of range");
 #endif
+	  const int threads = ISTLThreading::threadsFor(nnz>0 ? nnz : n);
+	  if (threads>1)
+		{
+		  const RowPartition* partition;
+		  const ColumnIndex& columns = columnIndex(threads, partition);
+		  ColumnKernel<X,Y> kernel(columns, *partition, ColumnKernel<X,Y>::hermitianSubtract,
+								   1, x, y);
+		  parallelFor(threads, kernel);
+		  return;
+		}
 	  ConstRowIterator endi=end();
 	  for (ConstRowIterator i=begin(); i!=endi; ++i)
 		{
@@ -1167,6 +1517,16 @@ namespace Dune {
 	  if (x.N()!=N()) DUNE_THROW(ISTLError,"index out of range");
 	  if (y.N()!=M()) DUNE_THROW(ISTLError,"index out of range");
 #endif
+	  const int threads = ISTLThreading::threadsFor(nnz>0 ? nnz : n);
+	  if (threads>1)
+		{
+		  const RowPartition* partition;
+		  const ColumnIndex& columns = columnIndex(threads, partition);
+		  ColumnKernel<X,Y> kernel(columns, *partition, ColumnKernel<X,Y>::hermitianScaledAdd,
+								   alpha, x, y);
+		  parallelFor(threads, kernel);
+		  return;
+		}
 	  ConstRowIterator endi=end();
 	  for (ConstRowIterator i=begin(); i!=endi; ++i)
 		{
@@ -1288,6 +1648,8 @@ namespace Dune {
 	size_type  m;  // number of columns
 	size_type nnz; // number of nonzeros allocated in the a and j array below
              // zero means that memory is allocated separately for each row.
+    size_type allocationSize; // size of the a and j arrays, may exceed nnz after
+             // the row-wise build and compress(), zero if there are none
 
 	// the rows are dynamically allocated
 	row_type* r; // [n] the individual rows having pointers into a,j arrays
@@ -1298,6 +1660,217 @@ namespace Dune {
     // between different matrices with the same sparsity pattern
     Dune::shared_ptr<size_type> j;  // [nnz] column indices of entries
 
+    // parameters and overflow area of the implicit build mode
+    size_type avg;
+    double overflowsize;
+    size_type overflowEntries;
+    typedef std::map<std::pair<size_type,size_type>,B> OverflowType;
+    OverflowType overflow;
+
+    // row partitions used by the threaded kernels by number of parts,
+    // computed on demand
+    mutable std::map<int,RowPartition> partitions_;
+
+    // protects partitions_ and columns_ against concurrent const products
+    mutable ISTLMutex cacheMutex_;
+
+    /**
+     * @brief Get the partition of the rows into parts with equal number of blocks.
+     *
+     * Each partition is built once. It stays valid until the pattern
+     * changes, such that concurrent calls with different numbers of
+     * parts do not interfere.
+     */
+    const RowPartition& rowPartition(int parts) const
+    {
+      ISTLScopedLock lock(cacheMutex_);
+      RowPartition& partition = partitions_[parts];
+      if (partition.parts()!=parts)
+        partition.build(*this, parts);
+      return partition;
+    }
+
+    /**
+     * @brief Column-wise index of the pattern used by the threaded
+     * transposed kernels.
+     *
+     * The entries of column c are block[start[c]],...,block[start[c+1]-1]
+     * located in the rows row[start[c]],... in ascending order.
+     */
+    struct ColumnIndex
+    {
+      std::vector<size_type> start;
+      std::vector<size_type> row;
+      std::vector<const B*> block;
+      std::map<int,RowPartition> partitions;
+    };
+
+    // column-wise index of the pattern, computed on demand
+    mutable ColumnIndex columns_;
+
+    /**
+     * @brief Get the column-wise index and split the columns into parts.
+     *
+     * The index and the partitions of the columns are built once and
+     * do not change until the pattern does.
+     */
+    const ColumnIndex& columnIndex(int parts, const RowPartition*& partition) const
+    {
+      ISTLScopedLock lock(cacheMutex_);
+      if (columns_.start.size()!=m+1)
+        {
+          columns_.start.assign(m+1, 0);
+          for (size_type i=0; i<n; ++i)
+            {
+              ConstColIterator endj = r[i].end();
+              for (ConstColIterator j=r[i].begin(); j!=endj; ++j)
+                ++columns_.start[j.index()+1];
+            }
+          for (size_type c=0; c<m; ++c)
+            columns_.start[c+1] += columns_.start[c];
+
+          columns_.row.resize(columns_.start[m]);
+          columns_.block.resize(columns_.start[m]);
+          std::vector<size_type> fill(columns_.start.begin(), columns_.start.end()-1);
+          for (size_type i=0; i<n; ++i)
+            {
+              ConstColIterator endj = r[i].end();
+              for (ConstColIterator j=r[i].begin(); j!=endj; ++j)
+                {
+                  size_type k = fill[j.index()]++;
+                  columns_.row[k] = i;
+                  columns_.block[k] = &(*j);
+                }
+            }
+          columns_.partitions.clear();
+        }
+      RowPartition& columnPartition = columns_.partitions[parts];
+      if (columnPartition.parts()!=parts)
+        columnPartition.buildFromOffsets(columns_.start, parts);
+      partition = &columnPartition;
+      return columns_;
+    }
+
+    /**
+     * @brief Functor applying the transposed matrix to the entries of y
+     * in one part of the column partition, used with parallelFor().
+     */
+    template<class X, class Y>
+    class ColumnKernel
+    {
+    public:
+      enum Operation { add, subtract, scaledAdd,
+                       hermitianAdd, hermitianSubtract, hermitianScaledAdd };
+
+      ColumnKernel(const ColumnIndex& columns, const RowPartition& partition,
+                   Operation op, const field_type& alpha, const X& x, Y& y)
+        : columns_(columns), partition_(partition), op_(op), alpha_(alpha), x_(x), y_(y)
+      {}
+
+      void operator()(int p) const
+      {
+        const size_type last = partition_.last(p);
+        for (size_type c=partition_.first(p); c<last; ++c)
+          for (size_type k=columns_.start[c]; k<columns_.start[c+1]; ++k)
+            {
+              const B& block = *columns_.block[k];
+              const size_type i = columns_.row[k];
+              switch(op_){
+              case add:
+                block.umtv(x_[i], y_[c]);
+                break;
+              case subtract:
+                block.mmtv(x_[i], y_[c]);
+                break;
+              case scaledAdd:
+                block.usmtv(alpha_, x_[i], y_[c]);
+                break;
+              case hermitianAdd:
+                block.umhv(x_[i], y_[c]);
+                break;
+              case hermitianSubtract:
+                block.mmhv(x_[i], y_[c]);
+                break;
+              case hermitianScaledAdd:
+                block.usmhv(alpha_, x_[i], y_[c]);
+                break;
+              }
+            }
+      }
+
+    private:
+      const ColumnIndex& columns_;
+      const RowPartition& partition_;
+      Operation op_;
+      field_type alpha_;
+      const X& x_;
+      Y& y_;
+    };
+
+    //! y = A x for the rows [first,last)
+    template<class X, class Y>
+    void mvRows (const X& x, Y& y, size_type first, size_type last) const
+    {
+      typedef BlockRowKernel<B,typename X::block_type,typename Y::block_type> Kernel;
+      Kernel::mvRows(r,first,last,x,y);
+    }
+
+    //! y += A x for the rows [first,last)
+    template<class X, class Y>
+    void umvRows (const X& x, Y& y, size_type first, size_type last) const
+    {
+      typedef BlockRowKernel<B,typename X::block_type,typename Y::block_type> Kernel;
+      Kernel::umvRows(r,first,last,x,y);
+    }
+
+    //! y += alpha A x for the rows [first,last)
+    template<class X, class Y>
+    void usmvRows (const field_type& alpha, const X& x, Y& y,
+                   size_type first, size_type last) const
+    {
+      typedef BlockRowKernel<B,typename X::block_type,typename Y::block_type> Kernel;
+      Kernel::usmvRows(alpha,r,first,last,x,y);
+    }
+
+    /**
+     * @brief Functor applying the matrix to the rows of one part of a
+     * RowPartition, used with parallelFor().
+     */
+    template<class X, class Y>
+    class RowRangeKernel
+    {
+    public:
+      enum Operation { assign, add, scaledAdd };
+
+      RowRangeKernel(const BCRSMatrix& mat, const RowPartition& partition,
+                     Operation op, const field_type& alpha, const X& x, Y& y)
+        : A_(mat), partition_(partition), op_(op), alpha_(alpha), x_(x), y_(y)
+      {}
+
+      void operator()(int p) const
+      {
+        switch(op_){
+        case assign:
+          A_.mvRows(x_, y_, partition_.first(p), partition_.last(p));
+          break;
+        case add:
+          A_.umvRows(x_, y_, partition_.first(p), partition_.last(p));
+          break;
+        case scaledAdd:
+          A_.usmvRows(alpha_, x_, y_, partition_.first(p), partition_.last(p));
+          break;
+        }
+      }
+
+    private:
+      const BCRSMatrix& A_;
+      const RowPartition& partition_;
+      Operation op_;
+      field_type alpha_;
+      const X& x_;
+      Y& y_;
+    };
+
 
     void setWindowPointers(ConstRowIterator row)
     {
@@ -1319,19 +1892,71 @@ namespace Dune {
       }
     }
     
-    //! \brief Copy the window structure from another matrix
-    void copyWindowStructure(const BCRSMatrix& Mat)
+    /**
+     * @brief Set up the pattern of Mat in this matrix, whose memory for a and j
+     * has to be released already.
+     *
+     * If Mat stores its entries in one global array the column indices are
+     * shared and the values get the same offsets as in Mat. Otherwise a new
+     * contiguous pattern is built. The values are not initialized.
+     */
+    void setupPatternOf(const BCRSMatrix& Mat, bool allocateRows)
     {
-      setWindowPointers(Mat.begin());
-            
-      // copy data
-      for (size_type i=0; i<n; i++) r[i] = Mat.r[i];
+      if (Mat.nnz>0)
+        {
+          j = Mat.j;
+          allocate(Mat.n, Mat.m, Mat.nnz, allocateRows);
+          for (size_type i=0; i<n; i++)
+            if (Mat.r[i].getsize()>0)
+              r[i].set(Mat.r[i].getsize(), a+(Mat.r[i].getptr()-Mat.a),
+                       Mat.r[i].getindexptr());
+            else
+              r[i].set(0,0,0);
+        }
+      else
+        {
+          // rows have been allocated individually
+          size_type _nnz = 0;
+          for (size_type i=0; i<Mat.n; i++)
+            _nnz += Mat.r[i].getsize();
+
+          j.reset();
+          allocate(Mat.n, Mat.m, _nnz, allocateRows);
+          setWindowPointers(Mat.begin());
+          for (size_type i=0; i<n; i++)
+            std::copy(Mat.r[i].getindexptr(), Mat.r[i].getindexptr()+Mat.r[i].getsize(),
+                      r[i].getindexptr());
+        }
 
       // finish off
       build_mode = row_wise; // dummy
       ready = built;
     }
-  
+
+    //! \brief Release a and j and set up the pattern of Mat
+    void reallocatePattern(const BCRSMatrix& Mat)
+    {
+      deallocate(false);
+
+      // reallocate the rows if required
+      if (n>0 && n!=Mat.n) {
+          // free rows
+          for(row_type *riter=r+(n-1), *rend=r-1; riter!=rend; --riter)
+            rowAllocator_.destroy(riter);
+          rowAllocator_.deallocate(r,n);
+      }
+
+      setupPatternOf(Mat, n!=Mat.n);
+    }
+
+    //! \brief Copy the values of a matrix with the same window structure
+    void copyValues(const BCRSMatrix& Mat)
+    {
+      for (size_type i=0; i<n; i++)
+        std::copy(Mat.r[i].getptr(), Mat.r[i].getptr()+Mat.r[i].getsize(),
+                  r[i].getptr());
+    }
+
     /**
      * @brief deallocate memory of the matrix.
      * @param deallocateRows Whether we have to deallocate the row pointers, too.
@@ -1340,13 +1965,14 @@ namespace Dune {
     void deallocate(bool deallocateRows=true)
     {
       
-      if (nnz>0)
+      if (allocationSize>0)
 	{
 	  // a,j have been allocated as one long vector
       j.reset(); 
-      for(B *aiter=a+(nnz-1), *aend=a-1; aiter!=aend; --aiter)
+      for(B *aiter=a+(allocationSize-1), *aend=a-1; aiter!=aend; --aiter)
         allocator_.destroy(aiter);
-      allocator_.deallocate(a,n); 
+      allocator_.deallocate(a,allocationSize);
+      allocationSize = 0;
 	}
       else
 	{
@@ -1379,13 +2005,14 @@ namespace Dune {
     class Deallocator
     {
         typename A::template rebind<size_type>::other& sizeAllocator_;
+        size_type size_;
 
     public:
-        Deallocator(typename A::template rebind<size_type>::other& sizeAllocator)
-            : sizeAllocator_(sizeAllocator)
+        Deallocator(typename A::template rebind<size_type>::other& sizeAllocator, size_type size)
+            : sizeAllocator_(sizeAllocator), size_(size)
         {}
 
-        void operator()(size_type* p) { sizeAllocator_.deallocate(p,1); }
+        void operator()(size_type* p) { sizeAllocator_.deallocate(p,size_); }
     };
 
     
@@ -1412,6 +2039,9 @@ namespace Dune {
       n = rows;
       m = columns;
       nnz = nnz_;
+      allocationSize = nnz_;
+      partitions_.clear();
+      columns_.start.clear();
 
       // allocate rows
       if(allocateRows){
@@ -1429,7 +2059,7 @@ namespace Dune {
         a = allocator_.allocate(nnz);
         // allocate column indices only if not yet present (enable sharing)
         if (!j.get())
-            j.reset(sizeAllocator_.allocate(nnz),Deallocator(sizeAllocator_));
+            j.reset(sizeAllocator_.allocate(nnz),Deallocator(sizeAllocator_,nnz));
       }else{
         a = 0;
         j.reset();        
@@ -1440,6 +2070,27 @@ namespace Dune {
       // Mark the matrix as not built.
       ready = notbuilt;
     }
+
+    /**
+     * @brief Allocate the memory for building the matrix in implicit mode.
+     *
+     * a and j are allocated once with room for avg entries per row
+     * preceded by the overflow area.
+     */
+    void implicit_allocate(size_type rows, size_type columns)
+    {
+      if (overflowsize<0)
+        DUNE_THROW(InvalidStateException,"implicit build mode parameters not set");
+      // a few extra entries keep tiny matrices from exhausting the overflow area
+      overflowEntries = static_cast<size_type>(rows*avg*overflowsize)+4;
+      allocate(rows, columns, rows*avg+overflowEntries);
+
+      for (size_type i=0; i<n; ++i)
+        r[i].set(0, a+overflowEntries+i*avg, j.get()+overflowEntries+i*avg);
+
+      overflow.clear();
+      ready = building;
+    }
     
   };
 
@@ -0,0 +1,384 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_BLOCKKERNELS_HH
+#define DUNE_ISTL_BLOCKKERNELS_HH
+
+#include<cstddef>
+#include<cstring>
+
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/static_assert.hh>
+#include<dune/common/typetraits.hh>
+
+/** \file
+ * \brief Kernels computing the product of one block row of a sparse
+ * matrix with a vector.
+ *
+ * For square blocks FieldMatrix<double,n,n> with n in {2,4,8} the
+ * kernels are vectorized explicitly using the vector extensions of GCC
+ * and Clang. On x86 the instruction set (SSE2, AVX2+FMA or AVX-512) is
+ * chosen at runtime from the features of the CPU, once for each range of
+ * rows. Other block sizes would need partial vector loads, which made
+ * them several times slower than the generic kernel, so they use the
+ * generic kernel that calls umv of each block, as does the code compiled
+ * with DUNE_ISTL_NO_SIMD_KERNELS.
+ *
+ * The vectorized kernels sum in a different order than the generic one
+ * and the AVX2 and AVX-512 versions may be compiled to fused multiply-adds
+ * (GCC does so by default in GNU mode, -ffp-contract=fast). The last bits
+ * of the result may therefore depend on the CPU the code runs on. Define
+ * DUNE_ISTL_NO_SIMD_KERNELS if the results have to be reproducible across
+ * machines.
+ */
+
+#if !defined(DUNE_ISTL_NO_SIMD_KERNELS) && (defined(__clang__) || \
+  (defined(__GNUC__) && __GNUC__>=5))
+#define DUNE_ISTL_SIMD_KERNELS 1
+#if defined(__x86_64__) || defined(__i386__)
+#define DUNE_ISTL_SIMD_KERNELS_X86 1
+#endif
+#endif
+
+namespace Dune {
+  /**
+   * @addtogroup ISTL_SPMV
+   * @{
+   */
+
+  /**
+   * @brief Computes y += sum_k A_k x_{j_k} for one block row by calling
+   * umv of each block.
+   */
+  template<class B, class YB>
+  struct GenericBlockRowKernel
+  {
+    /**
+     * @brief y += row * x
+     * @param row The compressed row of the matrix.
+     * @param x The vector to multiply with.
+     * @param y The block of the result corresponding to the row.
+     */
+    template<class Row, class X>
+    static void umv(const Row& row, const X& x, YB& y)
+    {
+      typedef typename Row::ConstIterator ColIterator;
+      ColIterator endj = row.end();
+      for (ColIterator j=row.begin(); j!=endj; ++j)
+        (*j).umv(x[j.index()],y);
+    }
+
+    //! y += alpha * row * x
+    template<class Row, class X, class K>
+    static void usmv(const K& alpha, const Row& row, const X& x, YB& y)
+    {
+      typedef typename Row::ConstIterator ColIterator;
+      ColIterator endj = row.end();
+      for (ColIterator j=row.begin(); j!=endj; ++j)
+        (*j).usmv(alpha,x[j.index()],y);
+    }
+
+    //! y_i = rows_i * x for the rows [first,last)
+    template<class Row, class X, class Y>
+    static void mvRows(const Row* rows, std::size_t first, std::size_t last,
+                       const X& x, Y& y)
+    {
+      for (std::size_t i=first; i<last; ++i)
+        {
+          y[i]=0;
+          umv(rows[i],x,y[i]);
+        }
+    }
+
+    //! y_i += rows_i * x for the rows [first,last)
+    template<class Row, class X, class Y>
+    static void umvRows(const Row* rows, std::size_t first, std::size_t last,
+                        const X& x, Y& y)
+    {
+      for (std::size_t i=first; i<last; ++i)
+        umv(rows[i],x,y[i]);
+    }
+
+    //! y_i += alpha * rows_i * x for the rows [first,last)
+    template<class Row, class X, class Y, class K>
+    static void usmvRows(const K& alpha, const Row* rows, std::size_t first,
+                         std::size_t last, const X& x, Y& y)
+    {
+      for (std::size_t i=first; i<last; ++i)
+        usmv(alpha,rows[i],x,y[i]);
+    }
+  };
+
+  /**
+   * @brief Computes y += sum_k A_k x_{j_k} for one block row of a sparse matrix.
+   *
+   * Specialized for block types for which a vectorized kernel exists.
+   *
+   * @tparam B The type of the matrix blocks.
+   * @tparam XB The type of the blocks of x.
+   * @tparam YB The type of the blocks of y.
+   */
+  template<class B, class XB, class YB>
+  struct BlockRowKernel
+    : public GenericBlockRowKernel<B,YB>
+  {};
+
+#if DUNE_ISTL_SIMD_KERNELS
+
+  /**
+   * @brief The block sizes with a vectorized row kernel.
+   *
+   * Only multiples of the vector widths are vectorized, see above.
+   */
+  template<int n>
+  struct HasSimdBlockRowKernel
+  {
+    enum { value = (n==2 || n==4 || n==8) };
+  };
+
+  /** @internal @brief A vector of W doubles. */
+  template<int W>
+  struct SimdDoubleVector;
+
+  template<>
+  struct SimdDoubleVector<2>
+  {
+    typedef double type __attribute__((vector_size(16)));
+  };
+
+  template<>
+  struct SimdDoubleVector<4>
+  {
+    typedef double type __attribute__((vector_size(32)));
+  };
+
+  template<>
+  struct SimdDoubleVector<8>
+  {
+    typedef double type __attribute__((vector_size(64)));
+  };
+
+  /** @internal @brief The operations of the vectorized kernels on a range of rows. */
+  enum SimdBlockRowOperation { simdAssign, simdAdd, simdScaledAdd };
+
+  /**
+   * @internal
+   * @brief Vectorized body of the block row product using W lanes.
+   *
+   * Instead of computing a dot product per block and row, the products
+   * of row r of all blocks with the corresponding blocks of x are summed
+   * lane-wise and reduced horizontally only once per matrix row. Lane l
+   * of chunk c sums the products of column c*W+l of all blocks, and the
+   * reduction adds the columns in ascending order, so apart from fused
+   * multiply-adds the order of the summation does not depend on W.
+   */
+  template<int n, int W, class X, class S>
+  inline __attribute__((always_inline))
+  void simdBlockRowUmv(const FieldMatrix<double,n,n>* a, const S* j, S s,
+                       const X& x, FieldVector<double,n>& y)
+  {
+    typedef typename SimdDoubleVector<W>::type vec;
+    dune_static_assert(n%W==0, "the block size has to be a multiple of the vector width");
+    enum { chunks = n/W };
+
+    const vec zero = vec() - vec();
+    vec acc[n][chunks];
+    for (int r=0; r<n; ++r)
+      for (int c=0; c<chunks; ++c)
+        acc[r][c] = zero;
+
+    for (S k=0; k<s; ++k)
+      {
+        const double* xk = &x[j[k]][0];
+        vec xv[chunks];
+        for (int c=0; c<chunks; ++c)
+          std::memcpy(&xv[c], xk+c*W, sizeof(vec));
+        for (int r=0; r<n; ++r)
+          {
+            const double* ar = &a[k][r][0];
+            for (int c=0; c<chunks; ++c)
+              {
+                vec av;
+                std::memcpy(&av, ar+c*W, sizeof(vec));
+                acc[r][c] += av*xv[c];
+              }
+          }
+      }
+
+    for (int r=0; r<n; ++r)
+      {
+        double sum = 0;
+        for (int c=0; c<chunks; ++c)
+          for (int l=0; l<W; ++l)
+            sum += acc[r][c][l];
+        y[r] += sum;
+      }
+  }
+
+  /**
+   * @internal
+   * @brief The vectorized product for the rows [first,last).
+   *
+   * Always inlined into the instruction set specific wrappers below,
+   * which lets the compiler use their register width for the whole loop.
+   */
+  template<int n, int W, int op, class Row, class X, class Y>
+  inline __attribute__((always_inline))
+  void simdBlockRows(double alpha, const Row* rows, std::size_t first, std::size_t last,
+                     const X& x, Y& y)
+  {
+    for (std::size_t i=first; i<last; ++i)
+      {
+        const Row& row = rows[i];
+        if (op==simdScaledAdd)
+          {
+            FieldVector<double,n> tmp(0.0);
+            simdBlockRowUmv<n,W>(row.getptr(), row.getindexptr(), row.getsize(), x, tmp);
+            y[i].axpy(alpha, tmp);
+          }
+        else
+          {
+            if (op==simdAssign)
+              y[i] = 0;
+            simdBlockRowUmv<n,W>(row.getptr(), row.getindexptr(), row.getsize(), x, y[i]);
+          }
+      }
+  }
+
+  /**
+   * @internal
+   * @brief The instruction set specific versions of the product of a range of rows.
+   *
+   * Blocks narrower than a register use the widest vectors they fill.
+   */
+  template<int n, int op, class Row, class X, class Y>
+  void simdBlockRows128(double alpha, const Row* rows, std::size_t first, std::size_t last,
+                        const X& x, Y& y)
+  {
+    simdBlockRows<n,2,op>(alpha,rows,first,last,x,y);
+  }
+
+#if DUNE_ISTL_SIMD_KERNELS_X86
+  template<int n, int op, class Row, class X, class Y>
+  __attribute__((target("avx2,fma")))
+  void simdBlockRowsAVX2(double alpha, const Row* rows, std::size_t first, std::size_t last,
+                         const X& x, Y& y)
+  {
+    simdBlockRows<n,(n>=4 ? 4 : 2),op>(alpha,rows,first,last,x,y);
+  }
+
+  template<int n, int op, class Row, class X, class Y>
+  __attribute__((target("avx512f")))
+  void simdBlockRowsAVX512(double alpha, const Row* rows, std::size_t first, std::size_t last,
+                           const X& x, Y& y)
+  {
+    simdBlockRows<n,(n>=8 ? 8 : n>=4 ? 4 : 2),op>(alpha,rows,first,last,x,y);
+  }
+
+  /**
+   * @brief The widest instruction set supported by the CPU we are running on.
+   */
+  struct SimdInstructionSet
+  {
+    enum Type { sse2, avx2, avx512 };
+
+    static Type detect()
+    {
+      static const Type type = query();
+      return type;
+    }
+
+  private:
+    static Type query()
+    {
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f"))
+        return avx512;
+      if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return avx2;
+      return sse2;
+    }
+  };
+#endif
+
+  /**
+   * @internal
+   * @brief Vectorized block row kernel for FieldMatrix<double,n,n>.
+   *
+   * The single row products are those of the generic kernel, the
+   * products of ranges of rows are vectorized.
+   */
+  template<int n>
+  struct SimdBlockRowKernel
+    : public GenericBlockRowKernel<FieldMatrix<double,n,n>,FieldVector<double,n> >
+  {
+    //! y_i = rows_i * x for the rows [first,last)
+    template<class Row, class X, class Y>
+    static void mvRows(const Row* rows, std::size_t first, std::size_t last,
+                       const X& x, Y& y)
+    {
+      apply<simdAssign>(1.0,rows,first,last,x,y);
+    }
+
+    //! y_i += rows_i * x for the rows [first,last)
+    template<class Row, class X, class Y>
+    static void umvRows(const Row* rows, std::size_t first, std::size_t last,
+                        const X& x, Y& y)
+    {
+      apply<simdAdd>(1.0,rows,first,last,x,y);
+    }
+
+    //! y_i += alpha * rows_i * x for the rows [first,last)
+    template<class Row, class X, class Y, class K>
+    static void usmvRows(const K& alpha, const Row* rows, std::size_t first,
+                         std::size_t last, const X& x, Y& y)
+    {
+      apply<simdScaledAdd>(alpha,rows,first,last,x,y);
+    }
+
+  private:
+    template<int op, class Row, class X, class Y>
+    static void apply(double alpha, const Row* rows, std::size_t first, std::size_t last,
+                      const X& x, Y& y)
+    {
+#if DUNE_ISTL_SIMD_KERNELS_X86
+      switch (SimdInstructionSet::detect()){
+      case SimdInstructionSet::avx512:
+        // an AVX-512 register only pays off if a block row fills it
+        if (n==8)
+          {
+            simdBlockRowsAVX512<n,op>(alpha,rows,first,last,x,y);
+            return;
+          }
+        // fall through
+      case SimdInstructionSet::avx2:
+        if (n>=4)
+          {
+            simdBlockRowsAVX2<n,op>(alpha,rows,first,last,x,y);
+            return;
+          }
+        // fall through
+      default:
+        simdBlockRows128<n,op>(alpha,rows,first,last,x,y);
+      }
+#else
+      simdBlockRows128<n,op>(alpha,rows,first,last,x,y);
+#endif
+    }
+  };
+
+  template<int n>
+  struct BlockRowKernel<FieldMatrix<double,n,n>, FieldVector<double,n>, FieldVector<double,n> >
+    : public SelectType<HasSimdBlockRowKernel<n>::value,
+                        SimdBlockRowKernel<n>,
+                        GenericBlockRowKernel<FieldMatrix<double,n,n>,
+                                              FieldVector<double,n> > >::Type
+  {};
+
+#endif // DUNE_ISTL_SIMD_KERNELS
+
+  /** @} end documentation */
+
+} // end namespace Dune
+
+#endif
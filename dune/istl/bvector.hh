@@ -115,6 +115,62 @@ namespace Dune {
 	  return *this;
 	}
 
+	//! *this = a*(*this) + y in a single pass
+	block_vector_unmanaged& aypx (const field_type& a, const block_vector_unmanaged& y)
+	{
+#ifdef DUNE_ISTL_WITH_CHECKING
+	  if (this->n!=y.N()) DUNE_THROW(ISTLError,"vector size mismatch");
+#endif
+	  for (size_type i=0; i<this->n; ++i)
+		{
+		  (*this)[i] *= a;
+		  (*this)[i] += y[i];
+		}
+	  return *this;
+	}
+
+	//===== fused kernels for the Krylov solvers
+
+	/** \brief axpy followed by two_norm2() in a single pass
+
+	  Computes *this += a*y and returns the squared two norm of the result.
+	  The result is the same as of the two separate operations.
+	*/
+	double axpy_two_norm2 (const field_type& a, const block_vector_unmanaged& y)
+	{
+#ifdef DUNE_ISTL_WITH_CHECKING
+	  if (this->n!=y.N()) DUNE_THROW(ISTLError,"vector size mismatch");
+#endif
+	  double sum=0;
+	  for (size_type i=0; i<this->n; ++i)
+		{
+		  (*this)[i].axpy(a,y[i]);
+		  sum += (*this)[i].two_norm2();
+		}
+	  return sum;
+	}
+
+	/** \brief axpy followed by a scalar product in a single pass
+
+	  Computes *this += a*y and returns (*this)*z.
+	  The result is the same as of the two separate operations.
+	*/
+	field_type axpy_dot (const field_type& a, const block_vector_unmanaged& y,
+						 const block_vector_unmanaged& z)
+	{
+#ifdef DUNE_ISTL_WITH_CHECKING
+	  if (this->n!=y.N()) DUNE_THROW(ISTLError,"vector size mismatch");
+	  if (this->n!=z.N()) DUNE_THROW(ISTLError,"vector size mismatch");
+#endif
+	  field_type sum=0;
+	  for (size_type i=0; i<this->n; ++i)
+		{
+		  (*this)[i].axpy(a,y[i]);
+		  sum += (*this)[i]*z[i];
+		}
+	  return sum;
+	}
+
 
 	//===== Euclidean scalar product
 
@@ -504,6 +560,63 @@ namespace Dune {
 
   };
 
+  /**
+   * @brief Vector operations of the Krylov solvers that can be fused into
+   * a single pass over the vectors.
+   *
+   * The general version calls the separate operations. BlockVector uses
+   * the fused kernels of block_vector_unmanaged, which read and write
+   * each vector only once.
+   */
+  template<class X>
+  struct FusedVectorOps
+  {
+    typedef typename X::field_type field_type;
+
+    //! y += a*x, returns the two norm of y
+    static double axpyTwoNorm (X& y, const field_type& a, const X& x)
+    {
+      y.axpy(a,x);
+      return y.two_norm();
+    }
+
+    //! y += a*x, returns y*z
+    static field_type axpyDot (X& y, const field_type& a, const X& x, const X& z)
+    {
+      y.axpy(a,x);
+      return y*z;
+    }
+
+    //! y = a*y + x
+    static void aypx (X& y, const field_type& a, const X& x)
+    {
+      y *= a;
+      y += x;
+    }
+  };
+
+  template<class B, class A>
+  struct FusedVectorOps<BlockVector<B,A> >
+  {
+    typedef BlockVector<B,A> X;
+    typedef typename X::field_type field_type;
+
+    static double axpyTwoNorm (X& y, const field_type& a, const X& x)
+    {
+      return std::sqrt(y.axpy_two_norm2(a,x));
+    }
+
+    static field_type axpyDot (X& y, const field_type& a, const X& x, const X& z)
+    {
+      return y.axpy_dot(a,x,z);
+    }
+
+    static void aypx (X& y, const field_type& a, const X& x)
+    {
+      y.aypx(a,x);
+    }
+  };
+
   /** @} */
   //! Send BlockVector to an output stream
     template<class K, class A>
@@ -8,9 +8,16 @@
 #include<string>
 #include<set>
 #include<map>
+#include<vector>
+#include<algorithm>
+#include<functional>
+#include<utility>
+
+#include<dune/common/ftraits.hh>
 
 #include "istlexception.hh"
 #include "io.hh"
+#include "threading.hh"
 
 /** \file
  * \brief  ???
@@ -123,6 +130,235 @@ namespace Dune {
   }
 
 
+  /**
+   * @brief Level schedule of the triangular solves of an ILU decomposition.
+   *
+   * In the lower triangular solve row i depends on the rows j<i with an
+   * entry in row i, in the upper one on the rows j>i. The level of a row
+   * is one more than the maximum level of the rows it depends on, thus all
+   * rows of a level can be solved concurrently. The schedule only depends
+   * on the sparsity pattern and is computed once after the decomposition.
+   */
+  class ILULevelSchedule
+  {
+  public:
+    typedef std::size_t size_type;
+
+    ILULevelSchedule()
+      : work_(0)
+    {}
+
+    //! compute the levels of the pattern of the decomposition A
+    template<class M>
+    void build (const M& A)
+    {
+      typedef typename M::ConstRowIterator rowiterator;
+      typedef typename M::ConstColIterator coliterator;
+      const size_type n = A.N();
+      std::vector<size_type> level(n), work(n);
+
+      work_ = 0;
+      for (rowiterator i=A.begin(); i!=A.end(); ++i)
+        {
+          size_type l = 0;
+          for (coliterator j=(*i).begin(); j!=(*i).end() && j.index()<i.index(); ++j)
+            l = std::max(l, level[j.index()]+1);
+          level[i.index()] = l;
+          work[i.index()] = (*i).size();
+          work_ += (*i).size();
+        }
+      sortByLevel(level, work, lowerOffsets_, lowerRows_, lowerWork_);
+
+      for (rowiterator i=A.beforeEnd(); i!=A.beforeBegin(); --i)
+        {
+          size_type l = 0;
+          for (coliterator j=(*i).begin(); j!=(*i).end(); ++j)
+            if (j.index()>i.index())
+              l = std::max(l, level[j.index()]+1);
+          level[i.index()] = l;
+        }
+      sortByLevel(level, work, upperOffsets_, upperRows_, upperWork_);
+    }
+
+    //! forget the schedule
+    void clear ()
+    {
+      work_ = 0;
+      lowerOffsets_.clear(); lowerRows_.clear(); lowerWork_.clear();
+      upperOffsets_.clear(); upperRows_.clear(); upperWork_.clear();
+    }
+
+    //! the number of levels of the lower triangular solve
+    size_type lowerLevels () const
+    {
+      return lowerWork_.size();
+    }
+
+    //! the number of levels of the upper triangular solve
+    size_type upperLevels () const
+    {
+      return upperWork_.size();
+    }
+
+    //! the number of blocks of the decomposition
+    size_type work () const
+    {
+      return work_;
+    }
+
+  private:
+    template<class M, class X, class Y>
+    friend void bilu_backsolve (const M& A, X& v, const Y& d, const ILULevelSchedule& schedule);
+    template<class M, class X, class Y>
+    friend class ILULevelKernel;
+
+    // sort the rows by level, keeping them ascending within each level
+    static void sortByLevel (const std::vector<size_type>& level, const std::vector<size_type>& work,
+                             std::vector<size_type>& offsets, std::vector<size_type>& rows,
+                             std::vector<size_type>& levelWork)
+    {
+      size_type levels = 0;
+      for (size_type i=0; i<level.size(); ++i)
+        levels = std::max(levels, level[i]+1);
+      offsets.assign(levels+1, 0);
+      levelWork.assign(levels, 0);
+      for (size_type i=0; i<level.size(); ++i)
+        {
+          ++offsets[level[i]+1];
+          levelWork[level[i]] += work[i];
+        }
+      for (size_type l=0; l<levels; ++l)
+        offsets[l+1] += offsets[l];
+      rows.resize(level.size());
+      std::vector<size_type> next(offsets.begin(), offsets.end()-1);
+      for (size_type i=0; i<level.size(); ++i)
+        rows[next[level[i]]++] = i;
+    }
+
+    size_type work_;
+    std::vector<size_type> lowerOffsets_, lowerRows_, lowerWork_;
+    std::vector<size_type> upperOffsets_, upperRows_, upperWork_;
+  };
+
+  //! solve row i of the lower triangular system, as in bilu_backsolve
+  template<class M, class X, class Y>
+  void bilu_lower_row (const M& A, X& v, const Y& d, std::size_t i)
+  {
+	typedef typename M::ConstColIterator coliterator;
+	typename Y::block_type rhs(d[i]);
+	for (coliterator j=A[i].begin(); j.index()<i; ++j)
+	  (*j).mmv(v[j.index()],rhs);
+	v[i] = rhs; // Lii = I
+  }
+
+  //! solve row i of the upper triangular system, as in bilu_backsolve
+  template<class M, class X>
+  void bilu_upper_row (const M& A, X& v, std::size_t i)
+  {
+	typedef typename M::ConstColIterator coliterator;
+	typename X::block_type rhs(v[i]);
+	coliterator j;
+	for (j=A[i].beforeEnd(); j.index()>i; --j)
+	  (*j).mmv(v[j.index()],rhs);
+	v[i] = 0;
+	(*j).umv(rhs,v[i]); // diagonal stores inverse!
+  }
+
+  /**
+   * @internal
+   * @brief Solves the triangular systems level by level on a team of threads.
+   *
+   * The rows of a level with enough work are distributed to the threads,
+   * the other levels are solved by the first thread. The threads only
+   * wait for each other before and after a distributed level.
+   */
+  template<class M, class X, class Y>
+  class ILULevelKernel
+  {
+  public:
+    typedef std::size_t size_type;
+
+    ILULevelKernel (const M& A, X& v, const Y& d, const ILULevelSchedule& schedule)
+      : A_(A), v_(v), d_(d), schedule_(schedule)
+    {}
+
+    void operator() (int p, int threads, TeamBarrier& barrier) const
+    {
+      bool synchronized = true;
+      solve(p, threads, barrier, synchronized, true);
+      solve(p, threads, barrier, synchronized, false);
+    }
+
+  private:
+    void solve (int p, int threads, TeamBarrier& barrier, bool& synchronized, bool lower) const
+    {
+      const std::vector<size_type>& offsets = lower ? schedule_.lowerOffsets_ : schedule_.upperOffsets_;
+      const std::vector<size_type>& rows = lower ? schedule_.lowerRows_ : schedule_.upperRows_;
+      const std::vector<size_type>& work = lower ? schedule_.lowerWork_ : schedule_.upperWork_;
+      for (size_type l=0; l<work.size(); ++l)
+        {
+          const int parts = std::min(ISTLThreading::threadsFor(work[l]), threads);
+          size_type first = offsets[l], last = offsets[l+1];
+          if (parts>1)
+            {
+              if (!synchronized)
+                barrier.wait();
+              const size_type count = last-first;
+              last = first+(count*(p+1))/parts;
+              first += (count*p)/parts;
+              if (p>=parts)
+                first = last;
+            }
+          else if (p!=0)
+            first = last;
+          for (size_type i=first; i<last; ++i)
+            if (lower)
+              bilu_lower_row(A_, v_, d_, rows[i]);
+            else
+              bilu_upper_row(A_, v_, rows[i]);
+          if (parts>1)
+            barrier.wait();
+          synchronized = parts>1;
+        }
+    }
+
+    const M& A_;
+    X& v_;
+    const Y& d_;
+    const ILULevelSchedule& schedule_;
+  };
+
+  /**
+   * @brief LU backsolve with stored inverse, threaded by a level schedule.
+   *
+   * The rows of each level of the schedule are distributed to
+   * ISTLThreading::threadsFor(work of the level) threads, levels with
+   * little work are solved by one thread. The threads are started once
+   * for both solves. Every row is computed as in bilu_backsolve(), thus
+   * the result does not depend on the number of threads.
+   * @param A The decomposition.
+   * @param v The solution.
+   * @param d The right hand side.
+   * @param schedule The level schedule built for A.
+   */
+  template<class M, class X, class Y>
+  void bilu_backsolve (const M& A, X& v, const Y& d, const ILULevelSchedule& schedule)
+  {
+	int threads = 1;
+	for (std::size_t l=0; l<schedule.lowerWork_.size(); ++l)
+	  threads = std::max(threads, ISTLThreading::threadsFor(schedule.lowerWork_[l]));
+	for (std::size_t l=0; l<schedule.upperWork_.size(); ++l)
+	  threads = std::max(threads, ISTLThreading::threadsFor(schedule.upperWork_[l]));
+
+	if (threads>1)
+	  {
+		ILULevelKernel<M,X,Y> kernel(A, v, d, schedule);
+		parallelTeam(threads, kernel);
+	  }
+	else
+	  bilu_backsolve(A,v,d);
+  }
+
 
   // recursive function template to access first entry of a matrix
   template<class M>
@@ -144,6 +380,121 @@ namespace Dune {
   }
 
 
+  //! copy row i of A into the pattern of row i of B, the other entries are zero
+  template<class M>
+  void bilu_copy_row (const M& A, M& B, std::size_t i)
+  {
+	typedef typename M::ColIterator coliterator;
+	typedef typename M::ConstColIterator ccoliterator;
+
+	coliterator Bij=B[i].begin();
+	coliterator endBij=B[i].end();
+	ccoliterator endAij=A[i].end();
+	for (ccoliterator Aij=A[i].begin(); Bij!=endBij; ++Bij)
+	  {
+		while (Aij!=endAij && Aij.index()<Bij.index())
+		  ++Aij;
+		if (Aij!=endAij && Aij.index()==Bij.index())
+		  *Bij = *Aij;
+		else
+		  *Bij = 0;
+	  }
+  }
+
+  /*! Symbolic ILU decomposition of order n
+	  Computes the sparsity pattern of the ILU decomposition of order n
+	  without any entries. The pattern of a row is kept in a sorted linked
+	  list over dense arrays indexed by the column, the rows of the U
+	  factor that eliminate are merged into it. Only the pattern and the
+	  fill levels of the U factor of the finished rows are stored. The
+	  matrix ILU should be an empty matrix in row_wise creation mode.
+	  Its entries may be set for new values of A with bilu_copy_row()
+	  before bilu0_decomposition() is called, thus the symbolic phase is
+	  only needed once for matrices with the same pattern.
+   */
+  template<class M>
+  void bilu_symbolic (const M& A, int n, M& ILU)
+  {
+	// iterator types
+	typedef typename M::ConstRowIterator crowiterator;
+	typedef typename M::ConstColIterator ccoliterator;
+	typedef typename M::CreateIterator createiterator;
+	typedef std::size_t size_type;
+
+	// the list of row i starts at next[m] and ends with m
+	const size_type m=A.M();
+	std::vector<size_type> next(m+1,m);
+	std::vector<int> level(m,0);
+
+	// columns and fill levels right of the diagonal of the finished rows
+	std::vector<size_type> upperStart(1,0);
+	std::vector<size_type> upperCols;
+	std::vector<int> upperLevels;
+
+	createiterator ci=ILU.createbegin();
+	crowiterator endi=A.end();
+	for (crowiterator i=A.begin(); i!=endi; ++i)
+	  {
+		// initialize pattern with row of A
+		size_type last=m;
+		for (ccoliterator j=(*i).begin(); j!=(*i).end(); ++j)
+		  {
+			next[last]=j.index();
+			level[j.index()]=0;
+			last=j.index();
+		  }
+		next[last]=m;
+
+		// eliminate entries in row which are to the left of the diagonal
+		for (size_type k=next[m]; k!=m && k<i.index(); k=next[k])
+		  if (level[k]<n)
+			{
+			  // the columns of row k ascend, merge them into the list behind k
+			  size_type pos=k;
+			  for (size_type kj=upperStart[k]; kj<upperStart[k+1]; ++kj)
+				if (upperLevels[kj]<n)
+				  {
+					const size_type j=upperCols[kj];
+					while (next[pos]<j)
+					  pos=next[pos];
+					if (next[pos]!=j)
+					  {
+						next[j]=next[pos];
+						next[pos]=j;
+						level[j]=upperLevels[kj]+1;
+					  }
+					pos=j;
+				  }
+			}
+
+		// create row
+		for (size_type j=next[m]; j!=m; j=next[j])
+		  {
+			ci.insert(j);
+			if (j>i.index())
+			  {
+				upperCols.push_back(j);
+				upperLevels.push_back(level[j]);
+			  }
+		  }
+		upperStart.push_back(upperCols.size());
+		++ci; // now row i exist
+	  }
+  }
+
+  /*! Pattern of the ILU decomposition of order n
+	  Computes the sparsity pattern of the ILU decomposition of order n
+	  and copies the entries of A into it, the other entries are zero.
+	  The matrix ILU should be an empty matrix in row_wise creation mode.
+   */
+  template<class M>
+  void bilu_pattern (const M& A, int n, M& ILU)
+  {
+	bilu_symbolic(A,n,ILU);
+	for (std::size_t i=0; i<A.N(); ++i)
+	  bilu_copy_row(A,ILU,i);
+  }
+
   /*! ILU decomposition of order n
 	  Computes ILU decomposition of order n. The matrix ILU should
       be an empty matrix in row_wise creation mode. This allows the user
@@ -152,102 +503,465 @@ namespace Dune {
    */
   template<class M>
   void bilu_decomposition (const M& A, int n, M& ILU)
+  {
+	bilu_pattern(A,n,ILU);
+
+	// call decomposition on pattern
+	bilu0_decomposition(ILU);
+  }
+
+
+  /*! ILU decomposition with threshold
+	  Computes the ILUT(tau,p) decomposition of Saad. In the elimination
+	  of row i the entries whose Frobenius norm is below tau times the
+	  norm of row i of A are dropped. Of the remaining entries only the
+	  p largest of the L part and of the U part are kept besides the
+	  diagonal, thus the decomposition has at most 2p+1 blocks per row
+	  independent of the fill. The decomposition is stored like by
+	  bilu0_decomposition(). The matrix ILU should be an empty matrix in
+	  row_wise creation mode.
+   */
+  template<class M>
+  void bilut_decomposition (const M& A, double tau, int p, M& ILU)
   {
 	// iterator types
-	typedef typename M::RowIterator rowiterator;
 	typedef typename M::ColIterator coliterator;
 	typedef typename M::ConstRowIterator crowiterator;
 	typedef typename M::ConstColIterator ccoliterator;
 	typedef typename M::CreateIterator createiterator;
 	typedef typename M::block_type block;
-	typedef typename M::field_type K;
-	typedef std::map<size_t, int> map;
-	typedef typename map::iterator mapiterator;
+	typedef typename FieldTraits<typename M::field_type>::real_type real_type;
+	typedef std::size_t size_type;
+	typedef std::pair<real_type,size_type> candidate;
+
+	if (p<0)
+	  DUNE_THROW(ISTLError,"the fill per row of ILUT must not be negative");
+
+	// the row is a sorted linked list starting at next[m] and ending
+	// with m, its entries are stored densely in w
+	const size_type m=A.M();
+	std::vector<size_type> next(m+1,m);
+	std::vector<block> w(m);
+	std::vector<candidate> lower, upper;
 
-	// symbolic factorization phase, store generation number in first matrix element
-	crowiterator endi=A.end();
 	createiterator ci=ILU.createbegin();
+	crowiterator endi=A.end();
 	for (crowiterator i=A.begin(); i!=endi; ++i)
 	  {
-		//		std::cout << "in row " << i.index() << std::endl;
-		map rowpattern; // maps column index to generation
-
-		// initialize pattern with row of A
+		// initialize with row of A
+		real_type norm2=0;
+		size_type last=m;
 		for (ccoliterator j=(*i).begin(); j!=(*i).end(); ++j)
-		  rowpattern[j.index()] = 0;
+		  {
+			next[last]=j.index();
+			w[j.index()]=*j;
+			norm2+=(*j).frobenius_norm2();
+			last=j.index();
+		  }
+		next[last]=m;
+		const real_type threshold=tau*std::sqrt(norm2);
 
 		// eliminate entries in row which are to the left of the diagonal
-		for (mapiterator ik=rowpattern.begin(); (*ik).first<i.index(); ++ik)
+		for (size_type k=next[m]; k!=m && k<i.index(); k=next[k])
 		  {
-			if ((*ik).second<n)
+			coliterator kj=ILU[k].find(k);
+			w[k].rightmultiply(*kj); // L_ik = A_ik * U_kk^-1
+			if (w[k].frobenius_norm()<threshold)
+			  continue;
+
+			// the columns of row k ascend, merge them into the list behind k
+			size_type pos=k;
+			coliterator endkj=ILU[k].end();
+			for (++kj; kj!=endkj; ++kj)
 			  {
-// 				std::cout << "  eliminating " << i.index() << "," << (*ik).first
-// 						  << " level " << (*ik).second << std::endl;
-
-				coliterator endk = ILU[(*ik).first].end(); // end of row k
-				coliterator kj = ILU[(*ik).first].find((*ik).first); // diagonal in k
-				for (++kj; kj!=endk; ++kj) // row k eliminates in row i
+				const size_type j=kj.index();
+				while (next[pos]<j)
+				  pos=next[pos];
+				if (next[pos]!=j)
 				  {
-					int generation = (int) firstmatrixelement(*kj);
-					if (generation<n)
-					  {
-						mapiterator ij = rowpattern.find(kj.index());
-						if (ij==rowpattern.end())
-						  {
-							//std::cout << "    new entry " << i.index() << "," << kj.index()
-// 						  << " level " << (*ik).second+1 << std::endl;
-
-							rowpattern[kj.index()] = generation+1;
-						  }
-					  }
+					next[j]=next[pos];
+					next[pos]=j;
+					w[j]=0;
 				  }
+				block B(*kj);
+				B.leftmultiply(w[k]);
+				w[j]-=B;
+				pos=j;
 			  }
 		  }
 
-		// create row
-		for (mapiterator ik=rowpattern.begin(); ik!=rowpattern.end(); ++ik)
-		  ci.insert((*ik).first);
+		// drop small entries and keep the p largest of L and of U
+		bool diagonal=false;
+		lower.clear();
+		upper.clear();
+		for (size_type j=next[m]; j!=m; j=next[j])
+		  if (j==i.index())
+			diagonal=true;
+		  else
+			{
+			  const real_type norm=w[j].frobenius_norm();
+			  if (norm>=threshold)
+				(j<i.index() ? lower : upper).push_back(candidate(norm,j));
+			}
+		if (!diagonal)
+		  DUNE_THROW(ISTLError,"diagonal entry missing");
+		for (int part=0; part<2; ++part)
+		  {
+			std::vector<candidate>& candidates = part==0 ? lower : upper;
+			if (candidates.size()>size_type(p))
+			  {
+				std::nth_element(candidates.begin(), candidates.begin()+p, candidates.end(),
+								 std::greater<candidate>());
+				candidates.resize(p);
+			  }
+			for (size_type c=0; c<candidates.size(); ++c)
+			  ci.insert(candidates[c].second);
+		  }
+		ci.insert(i.index());
 		++ci; // now row i exist
 
-		// write generation index into entries
-		coliterator endILUij = ILU[i.index()].end();;
-		for (coliterator ILUij=ILU[i.index()].begin(); ILUij!=endILUij; ++ILUij)
-		  firstmatrixelement(*ILUij) = (K) rowpattern[ILUij.index()]; 
+		// store row and invert pivot
+		coliterator endij=ILU[i.index()].end();
+		for (coliterator ij=ILU[i.index()].begin(); ij!=endij; ++ij)
+		  {
+			*ij=w[ij.index()];
+			if (ij.index()==i.index())
+			  try {
+				(*ij).invert();
+			  }
+			  catch (Dune::FMatrixError & e) {
+				DUNE_THROW(MatrixBlockError, "ILUT failed to invert matrix block A["
+						   << i.index() << "][" << ij.index() << "]" << e.what();
+						   th__ex.r=i.index(); th__ex.c=ij.index(););
+			  }
+		  }
 	  }
+  }
 
-	//	printmatrix(std::cout,ILU,"ilu pattern","row",10,2);
 
-	// copy entries of A
-	for (crowiterator i=A.begin(); i!=endi; ++i)
+  /*! One sweep of the iterative ILU decomposition for the rows [first,last)
+	  Computes the rows like bilu0_decomposition, but the rows before
+	  first that eliminate are taken from the previous iterate prev. Thus
+	  the rows of different ranges can be computed concurrently. The L
+	  factor of prev is not used.
+   */
+  template<class M>
+  void bilu_iterative_rows (const M& A, const M& prev, M& next,
+							std::size_t first, std::size_t last)
+  {
+	typedef typename M::ColIterator coliterator;
+	typedef typename M::ConstColIterator ccoliterator;
+	typedef typename M::block_type block;
+
+	for (std::size_t i=first; i<last; ++i)
 	  {
-		coliterator ILUij;
-		coliterator endILUij = ILU[i.index()].end();;
-		for (ILUij=ILU[i.index()].begin(); ILUij!=endILUij; ++ILUij)
-		  (*ILUij) = 0; // clear row
-		ccoliterator Aij = (*i).begin();
-		ccoliterator endAij = (*i).end();
-		ILUij = ILU[i.index()].begin();
-		while (Aij!=endAij && ILUij!=endILUij)
+		bilu_copy_row(A,next,i);
+
+		coliterator endij=next[i].end();
+		coliterator ij;
+		for (ij=next[i].begin(); ij.index()<i; ++ij)
 		  {
-			if (Aij.index()==ILUij.index())
-			  {
-				*ILUij = *Aij;
-				++Aij; ++ILUij;
-			  }
-			else
-			  {
-				if (Aij.index()<ILUij.index())
-				  ++Aij;
-				else
-				  ++ILUij;
-			  }
+			const M& row = ij.index()<first ? prev : next;
+			ccoliterator jj = row[ij.index()].find(ij.index());
+
+			// compute L_ij = A_jj^-1 * A_ij
+			(*ij).rightmultiply(*jj);
+
+			// modify row
+			ccoliterator endjk=row[ij.index()].end();
+			ccoliterator jk=jj; ++jk;
+			coliterator ik=ij; ++ik;
+			while (ik!=endij && jk!=endjk)
+			  if (ik.index()==jk.index())
+				{
+				  block B(*jk);
+				  B.leftmultiply(*ij);
+				  *ik -= B;
+				  ++ik; ++jk;
+				}
+			  else
+				{
+				  if (ik.index()<jk.index())
+					++ik;
+				  else
+					++jk;
+				}
 		  }
+
+		if (ij.index()!=i)
+		  DUNE_THROW(ISTLError,"diagonal entry missing");
+		try {
+		  (*ij).invert();
+		}
+		catch (Dune::FMatrixError & e) {
+		  DUNE_THROW(MatrixBlockError, "ILU failed to invert matrix block A["
+					 << i << "][" << ij.index() << "]" << e.what();
+					 th__ex.r=i; th__ex.c=ij.index(););
+		}
 	  }
+  }
 
-	// call decomposition on pattern
-	bilu0_decomposition(ILU);
+  /*! Initial iterate of the iterative ILU decomposition for the rows [first,last)
+	  The U factor is the upper triangle of A.
+   */
+  template<class M>
+  void bilu_iterative_init_rows (const M& A, M& next, std::size_t first, std::size_t last)
+  {
+	for (std::size_t i=first; i<last; ++i)
+	  {
+		bilu_copy_row(A,next,i);
+		typename M::ColIterator ii=next[i].find(i);
+		if (ii==next[i].end())
+		  DUNE_THROW(ISTLError,"diagonal entry missing");
+		try {
+		  (*ii).invert();
+		}
+		catch (Dune::FMatrixError & e) {
+		  DUNE_THROW(MatrixBlockError, "ILU failed to invert matrix block A["
+					 << i << "][" << i << "]" << e.what();
+					 th__ex.r=i; th__ex.c=i;);
+		}
+	  }
   }
 
+  /**
+   * @internal
+   * @brief Computes the rows of one part in a sweep of the iterative
+   * ILU decomposition, used with parallelFor().
+   *
+   * Exceptions are stored and have to be rethrown by the caller.
+   */
+  template<class M>
+  class ILUSweepKernel
+  {
+  public:
+    ILUSweepKernel (const M& A, const RowPartition& partition)
+      : A_(A), prev_(0), next_(0), partition_(partition),
+        failed_(partition.parts(), none), blockErrors_(partition.parts()),
+        errors_(partition.parts())
+    {}
+
+    //! compute the initial iterate in next if prev is 0, a sweep otherwise
+    void setIterates (const M* prev, M* next)
+    {
+      prev_ = prev;
+      next_ = next;
+    }
+
+    void operator() (int p)
+    {
+      try {
+        if (prev_)
+          bilu_iterative_rows(A_, *prev_, *next_, partition_.first(p), partition_.last(p));
+        else
+          bilu_iterative_init_rows(A_, *next_, partition_.first(p), partition_.last(p));
+      }
+      catch (MatrixBlockError & e) {
+        failed_[p] = blockError;
+        blockErrors_[p] = e;
+      }
+      catch (ISTLError & e) {
+        failed_[p] = patternError;
+        errors_[p] = e;
+      }
+    }
+
+    //! rethrow the exception of the first part that failed
+    void rethrow () const
+    {
+      for (std::size_t p=0; p<failed_.size(); ++p)
+        if (failed_[p]==blockError)
+          throw blockErrors_[p];
+        else if (failed_[p]==patternError)
+          throw errors_[p];
+    }
+
+  private:
+    const M& A_;
+    const M* prev_;
+    M* next_;
+    const RowPartition& partition_;
+    enum Failure { none, blockError, patternError };
+    std::vector<Failure> failed_;
+    std::vector<MatrixBlockError> blockErrors_;
+    std::vector<ISTLError> errors_;
+  };
+
+  /*! Iterative ILU decomposition
+	  Computes the ILU decomposition with a block-row fixed point
+	  iteration: the parts of the partition are processed concurrently,
+	  each computes its own rows exactly and in order like the exact
+	  decomposition, but takes the entries of the rows of the preceding
+	  parts from the previous sweep. Hence the rows of part p are exact
+	  from sweep p+1 on and the whole decomposition after as many sweeps
+	  as there are parts. Before that the result depends on the
+	  partition, i.e. on the number of threads it was built for.
+
+	  \param A The matrix to decompose. Its pattern has to be contained
+	  in the pattern of ILU.
+	  \param ILU The decomposition in the format of bilu0_decomposition.
+	  It has to have the pattern of the decomposition, e.g. from bilu_pattern.
+	  \param tmp A matrix with the pattern of ILU for the previous sweep.
+	  \param sweeps The number of sweeps, at least one.
+	  \param partition The partition of the rows of ILU.
+   */
+  template<class M>
+  void bilu_iterative_decomposition (const M& A, M& ILU, M& tmp, int sweeps,
+									 const RowPartition& partition)
+  {
+	if (sweeps<1)
+	  DUNE_THROW(ISTLError,"the iterative ILU needs at least one sweep");
+	if (partition.parts()<=1)
+	  {
+		bilu_iterative_rows(A,tmp,ILU,0,A.N());
+		return;
+	  }
+
+	// the last sweep writes into ILU
+	M* next = (sweeps%2==1) ? &ILU : &tmp;
+	M* prev = (sweeps%2==1) ? &tmp : &ILU;
+	ILUSweepKernel<M> kernel(A, partition);
+	kernel.setIterates(0, prev);
+	parallelFor(partition.parts(), kernel);
+	kernel.rethrow();
+	for (int s=0; s<sweeps; ++s)
+	  {
+		kernel.setIterates(prev, next);
+		parallelFor(partition.parts(), kernel);
+		kernel.rethrow();
+		std::swap(prev, next);
+	  }
+  }
+
+  /*! One Jacobi sweep of the lower triangular solve for the rows [first,last)
+	  The entries before first are taken from the previous iterate prev.
+   */
+  template<class M, class X, class Y>
+  void bilu_jacobi_lower_rows (const M& A, const X& prev, X& next, const Y& d,
+							   std::size_t first, std::size_t last)
+  {
+	typedef typename M::ConstColIterator coliterator;
+	typedef typename Y::block_type dblock;
+
+	for (std::size_t i=first; i<last; ++i)
+	  {
+		dblock rhs(d[i]);
+		for (coliterator j=A[i].begin(); j.index()<i; ++j)
+		  (*j).mmv(j.index()<first ? prev[j.index()] : next[j.index()],rhs);
+		next[i] = rhs; // Lii = I
+	  }
+  }
+
+  /*! One Jacobi sweep of the upper triangular solve for the rows [first,last)
+	  The entries from last on are taken from the previous iterate prev.
+   */
+  template<class M, class X>
+  void bilu_jacobi_upper_rows (const M& A, const X& y, const X& prev, X& next,
+							   std::size_t first, std::size_t last)
+  {
+	typedef typename M::ConstColIterator coliterator;
+	typedef typename X::block_type vblock;
+
+	for (std::size_t i=last; i>first; --i)
+	  {
+		vblock rhs(y[i-1]);
+		coliterator j;
+		for (j=A[i-1].beforeEnd(); j.index()>i-1; --j)
+		  (*j).mmv(j.index()<last ? next[j.index()] : prev[j.index()],rhs);
+		next[i-1] = 0;
+		(*j).umv(rhs,next[i-1]); // diagonal stores inverse!
+	  }
+  }
+
+  /**
+   * @internal
+   * @brief Computes the rows of one part in a Jacobi sweep of a
+   * triangular solve, used with parallelFor().
+   */
+  template<class M, class X, class Y>
+  class ILUJacobiKernel
+  {
+  public:
+    ILUJacobiKernel (const M& A, const Y& d, const RowPartition& partition)
+      : A_(A), d_(d), y_(0), prev_(0), next_(0), partition_(partition)
+    {}
+
+    //! sweep of the lower solve if y is 0, of the upper solve for the right hand side y otherwise
+    void setIterates (const X* y, const X* prev, X* next)
+    {
+      y_ = y;
+      prev_ = prev;
+      next_ = next;
+    }
+
+    void operator() (int p) const
+    {
+      if (y_)
+        bilu_jacobi_upper_rows(A_, *y_, *prev_, *next_, partition_.first(p), partition_.last(p));
+      else
+        bilu_jacobi_lower_rows(A_, *prev_, *next_, d_, partition_.first(p), partition_.last(p));
+    }
+
+  private:
+    const M& A_;
+    const Y& d_;
+    const X* y_;
+    const X* prev_;
+    X* next_;
+    const RowPartition& partition_;
+  };
+
+  /*! LU backsolve with stored inverse by Jacobi sweeps
+	  Approximates both triangular solves of bilu_backsolve by sweeps
+	  that start from zero and compute the rows of different parts of
+	  the partition concurrently. Within a part the rows are solved
+	  exactly, thus the solves are exact after as many sweeps as there
+	  are parts. v and d may be the same vector.
+
+	  \param A The decomposition.
+	  \param v The solution.
+	  \param d The right hand side.
+	  \param w1 Storage of the size of v.
+	  \param w2 Storage of the size of v.
+	  \param sweeps The number of sweeps of each solve, at least one.
+	  \param partition The partition of the rows of A.
+   */
+  template<class M, class X, class Y>
+  void bilu_jacobi_backsolve (const M& A, X& v, const Y& d, X& w1, X& w2, int sweeps,
+							  const RowPartition& partition)
+  {
+	if (sweeps<1)
+	  DUNE_THROW(ISTLError,"the Jacobi triangular solves need at least one sweep");
+	if (partition.parts()<=1)
+	  {
+		bilu_backsolve(A,v,d);
+		return;
+	  }
+
+	ILUJacobiKernel<M,X,Y> kernel(A, d, partition);
+
+	// lower solve, the last sweep writes into w1
+	X* next = (sweeps%2==1) ? &w1 : &w2;
+	X* prev = (sweeps%2==1) ? &w2 : &w1;
+	*prev = 0;
+	for (int s=0; s<sweeps; ++s)
+	  {
+		kernel.setIterates(0, prev, next);
+		parallelFor(partition.parts(), kernel);
+		std::swap(prev, next);
+	  }
+
+	// upper solve, the last sweep writes into v
+	next = (sweeps%2==1) ? &v : &w2;
+	prev = (sweeps%2==1) ? &w2 : &v;
+	*prev = 0;
+	for (int s=0; s<sweeps; ++s)
+	  {
+		kernel.setIterates(&w1, prev, next);
+		parallelFor(partition.parts(), kernel);
+		std::swap(prev, next);
+	  }
+  }
 
   /** @} end documentation */
 
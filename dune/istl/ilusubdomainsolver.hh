@@ -6,6 +6,7 @@
 #include<map>
 #include<dune/common/typetraits.hh>
 #include"matrix.hh"
+#include"ilu.hh"
 #include<cmath>
 #include<cstdlib>
 
@@ -22,8 +23,8 @@ namespace Dune{
    * @{
    */
   /**
-   * @brief base class encapsulating common algorithms of ILU0SubdomainSolver
-   * and ILUNSubdomainSolver.
+   * @brief base class encapsulating common algorithms of ILU0SubdomainSolver,
+   * ILUNSubdomainSolver and ILUTSubdomainSolver.
    * @tparam M The type of the matrix.
    * @tparam X The type of the vector for the domain.
    * @tparam X The type of the vector for the range.
@@ -62,6 +63,8 @@ namespace Dune{
     //! \brief The ILU0 decomposition of the matrix, or the local matrix
     // for ILUN
     matrix_type ILU;
+    //! \brief The level schedule of the triangular solves of the decomposition.
+    ILULevelSchedule schedule;
   };
 
   /**
@@ -89,7 +92,7 @@ namespace Dune{
      */
     void apply (X& v, const Y& d)
     {
-      bilu_backsolve(this->ILU,v,d);
+      bilu_backsolve(this->ILU,v,d,this->schedule);
     }
     /**
      * @brief Set the data of the local problem.
@@ -121,7 +124,7 @@ namespace Dune{
      */
     void apply (X& v, const Y& d)
     {
-      bilu_backsolve(RILU,v,d);
+      bilu_backsolve(RILU,v,d,this->schedule);
     }
     
     /**
@@ -143,6 +146,68 @@ private:
 
 
 
+  /**
+   * @brief Inexact subdomain solver using ILUT.
+   *
+   * The solvers of SeqOverlappingSchwarz are default constructed, thus
+   * they use the default drop tolerance and fill.
+   * @tparam M The type of the matrix.
+   * @tparam X The type of the vector for the domain.
+   * @tparam X The type of the vector for the range.
+   */
+  template<class M, class X, class Y>
+  class ILUTSubdomainSolver 
+    : public ILUSubdomainSolver<M,X,Y>{
+  public:
+    //! \brief The matrix type the preconditioner is for.
+    typedef typename Dune::remove_const<M>::type matrix_type;
+    typedef typename Dune::remove_const<M>::type rilu_type;
+    //! \brief The domain type of the preconditioner.
+    typedef X domain_type;
+    //! \brief The range type of the preconditioner.
+    typedef Y range_type;
+
+    /**
+     * @brief Constructor.
+     * @param tau The drop tolerance relative to the norm of the row.
+     * @param p The maximum number of entries of L and of U per row.
+     */
+    explicit ILUTSubdomainSolver(double tau=1e-3, int p=10)
+      : tau_(tau), p_(p)
+    {}
+    
+    /** 
+     * @brief Apply the subdomain solver.
+     * @copydoc ILUSubdomainSolver::apply
+     */
+    void apply (X& v, const Y& d)
+    {
+      bilu_backsolve(RILU,v,d,this->schedule);
+    }
+    
+    /**
+     * @brief Set the data of the local problem.
+     * 
+     * @param A The global matrix.
+     * @param rowset The global indices of the local problem.
+     * @tparam S The type of the set with the indices.
+     */
+    template<class S>
+    void setSubMatrix(const M& A, S& rowset);
+
+private:
+    /**
+     * @brief Storage for the ILUT decomposition.
+     */
+    rilu_type RILU;
+    //! \brief The drop tolerance.
+    double tau_;
+    //! \brief The maximum fill per row.
+    int p_;
+  };
+
+
+
   template<class M, class X, class Y>
   template<class S>
   std::size_t ILUSubdomainSolver<M,X,Y>::copyToLocalMatrix(const M& A, S& rowSet)
@@ -220,6 +285,7 @@ private:
   {
     this->copyToLocalMatrix(A,rowSet);
     bilu0_decomposition(this->ILU);
+    this->schedule.build(this->ILU);
   }
 
   template<class M, class X, class Y>
@@ -230,6 +296,18 @@ private:
     RILU.setSize(rowSet.size(),rowSet.size(), (1+2*offset)*rowSet.size());
     RILU.setBuildMode(matrix_type::row_wise);
     bilu_decomposition(this->ILU, (offset+1)/2, RILU);
+    this->schedule.build(RILU);
+  }
+
+  template<class M, class X, class Y>
+  template<class S>
+  void ILUTSubdomainSolver<M,X,Y>::setSubMatrix(const M& A, S& rowSet)
+  {
+    this->copyToLocalMatrix(A,rowSet);
+    RILU.setSize(rowSet.size(),rowSet.size());
+    RILU.setBuildMode(matrix_type::row_wise);
+    bilut_decomposition(this->ILU, tau_, p_, RILU);
+    this->schedule.build(RILU);
   }
 
   /** @} */
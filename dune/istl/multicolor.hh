@@ -0,0 +1,476 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_MULTICOLOR_HH
+#define DUNE_ISTL_MULTICOLOR_HH
+
+#include<algorithm>
+#include<cstddef>
+#include<vector>
+#include"gsetc.hh"
+#include"istlexception.hh"
+#include"preconditioners.hh"
+#include"solvercategory.hh"
+#include"threading.hh"
+#include"paamg/graph.hh"
+
+namespace Dune
+{
+  /**
+   * @file
+   * @brief Gauss-Seidel and SOR preconditioners sweeping the rows by colors.
+   */
+  /**
+   * @addtogroup ISTL_Prec
+   * @{
+   */
+
+  /**
+   * @brief A coloring of the rows of a matrix such that rows of the same
+   * color are not coupled.
+   *
+   * The coloring is computed greedily in the order of the rows on the
+   * symmetrized sparsity pattern, i.e. rows i and j get different colors
+   * if the block (i,j) or the block (j,i) is stored. For the five point
+   * stencil in lexicographic order it is the red-black ordering. Within
+   * a color the rows ascend.
+   */
+  class MulticolorOrdering
+  {
+  public:
+    typedef std::size_t size_type;
+
+    MulticolorOrdering()
+    {}
+
+    //! color the rows of A
+    template<class M>
+    void build (const M& A)
+    {
+      typedef Amg::MatrixGraph<const M> Graph;
+      typedef typename Graph::ConstVertexIterator VertexIterator;
+      typedef typename Graph::ConstEdgeIterator EdgeIterator;
+      typedef typename M::ConstRowIterator RowIterator;
+      typedef typename M::ConstColIterator ColIterator;
+
+      Graph graph(A);
+      const size_type n = A.N();
+      const size_type uncolored = n;
+
+      // the rows with a block in each column, the edges missing in the
+      // graph of a nonsymmetric pattern
+      std::vector<size_type> columnOffsets(n+1, 0);
+      for (RowIterator row=A.begin(); row!=A.end(); ++row)
+        for (ColIterator col=row->begin(); col!=row->end(); ++col)
+          ++columnOffsets[col.index()+1];
+      for (size_type i=0; i<n; ++i)
+        columnOffsets[i+1] += columnOffsets[i];
+      std::vector<size_type> columnRows(columnOffsets[n]);
+      {
+        std::vector<size_type> next(columnOffsets.begin(), columnOffsets.end()-1);
+        for (RowIterator row=A.begin(); row!=A.end(); ++row)
+          for (ColIterator col=row->begin(); col!=row->end(); ++col)
+            columnRows[next[col.index()]++] = row.index();
+      }
+
+      color_.assign(n, uncolored);
+      std::vector<size_type> work(n);
+      // the last vertex a color was forbidden for
+      std::vector<size_type> forbidden;
+
+      size_type colors = 0;
+      VertexIterator end = graph.end();
+      for (VertexIterator vertex=graph.begin(); vertex!=end; ++vertex)
+        {
+          const size_type i = *vertex;
+          for (EdgeIterator edge=vertex.begin(); edge!=vertex.end(); ++edge)
+            if (color_[edge.target()]!=uncolored)
+              forbidden[color_[edge.target()]] = i;
+          for (size_type k=columnOffsets[i]; k<columnOffsets[i+1]; ++k)
+            if (columnRows[k]!=i && color_[columnRows[k]]!=uncolored)
+              forbidden[color_[columnRows[k]]] = i;
+          size_type c = 0;
+          while (c<colors && forbidden[c]==i)
+            ++c;
+          if (c==colors)
+            {
+              ++colors;
+              forbidden.push_back(uncolored);
+            }
+          color_[i] = c;
+          work[i] = A[i].size();
+        }
+
+      // sort the rows by color
+      offsets_.assign(colors+1, 0);
+      work_.assign(colors, 0);
+      for (size_type i=0; i<n; ++i)
+        {
+          ++offsets_[color_[i]+1];
+          work_[color_[i]] += work[i];
+        }
+      for (size_type c=0; c<colors; ++c)
+        offsets_[c+1] += offsets_[c];
+      rows_.resize(n);
+      std::vector<size_type> next(offsets_.begin(), offsets_.end()-1);
+      for (size_type i=0; i<n; ++i)
+        rows_[next[color_[i]]++] = i;
+    }
+
+    //! the number of colors
+    size_type colors () const
+    {
+      return work_.size();
+    }
+
+    //! the color of row i
+    size_type color (size_type i) const
+    {
+      return color_[i];
+    }
+
+    //! the number of rows of color c
+    size_type size (size_type c) const
+    {
+      return offsets_[c+1]-offsets_[c];
+    }
+
+    //! the k-th row of color c
+    size_type row (size_type c, size_type k) const
+    {
+      return rows_[offsets_[c]+k];
+    }
+
+    //! the number of matrix blocks in the rows of color c
+    size_type work (size_type c) const
+    {
+      return work_[c];
+    }
+
+  private:
+    std::vector<size_type> color_;
+    std::vector<size_type> offsets_;
+    std::vector<size_type> rows_;
+    std::vector<size_type> work_;
+  };
+
+  //! one SOR step for row i, as in bsorf
+  template<class M, class X, class Y, class K, int l>
+  void multicolor_sor_row (const M& A, X& x, const Y& b, const K& w, std::size_t i, BL<l>)
+  {
+    typedef typename M::ConstColIterator coliterator;
+    typename Y::block_type rhs(b[i]);
+    typename X::block_type v(x[i]);
+    coliterator diag=A[i].end();
+    coliterator endj=A[i].end();
+    for (coliterator j=A[i].begin(); j!=endj; ++j)
+      {
+        if (j.index()==i)
+          diag=j;
+        (*j).mmv(x[j.index()],rhs); // rhs -= sum_j a_ij * x_j
+      }
+    algmeta_itsteps<l-1>::bsorf(*diag,v,rhs,w); // if blocksize l==1: v = rhs/a_ii
+    x[i].axpy(w,v);
+  }
+
+  /**
+   * @internal
+   * @brief Sweeps the colors on a team of threads.
+   *
+   * The rows of a color with enough work are distributed to the threads,
+   * the other colors are swept by the first thread. The threads only
+   * wait for each other before and after a distributed color. All
+   * sweeps of the steps are done by the same team.
+   */
+  template<class M, class X, class Y, class K, int l>
+  class MulticolorSORKernel
+  {
+  public:
+    typedef std::size_t size_type;
+
+    MulticolorSORKernel (const M& A, X& x, const Y& b, const K& w,
+                         const MulticolorOrdering& ordering, bool forward,
+                         int steps, bool symmetric)
+      : A_(A), x_(x), b_(b), w_(w), ordering_(ordering), forward_(forward),
+        sweeps_(symmetric ? 2*steps : steps), symmetric_(symmetric)
+    {}
+
+    void operator() (int p, int threads, TeamBarrier& barrier) const
+    {
+      bool synchronized = true;
+      const size_type colors = ordering_.colors();
+      for (size_type k=0; k<sweeps_*colors; ++k)
+        {
+          // symmetric steps sweep back after each forward sweep
+          const bool forward = symmetric_ && (k/colors)%2==1 ? !forward_ : forward_;
+          const size_type c = forward ? k%colors : colors-1-k%colors;
+          const int parts = std::min(ISTLThreading::threadsFor(ordering_.work(c)), threads);
+          size_type first = 0, last = ordering_.size(c);
+          if (parts>1)
+            {
+              if (!synchronized)
+                barrier.wait();
+              const size_type count = last;
+              last = (count*(p+1))/parts;
+              first = (count*p)/parts;
+              if (p>=parts)
+                first = last;
+            }
+          else if (p!=0)
+            first = last;
+          for (size_type r=first; r<last; ++r)
+            multicolor_sor_row(A_, x_, b_, w_, ordering_.row(c, r), BL<l>());
+          if (parts>1)
+            barrier.wait();
+          synchronized = parts>1;
+        }
+    }
+
+  private:
+    const M& A_;
+    X& x_;
+    const Y& b_;
+    const K& w_;
+    const MulticolorOrdering& ordering_;
+    bool forward_;
+    size_type sweeps_;
+    bool symmetric_;
+  };
+
+  /**
+   * @brief Several SOR or SSOR steps sweeping the colors of an ordering.
+   *
+   * Like multicolor_bsor() called steps times, but all sweeps are done
+   * by a single team of threads.
+   * @param A The matrix.
+   * @param x The iterate.
+   * @param b The right hand side.
+   * @param w The relaxation factor.
+   * @param ordering The coloring of the rows of A.
+   * @param steps The number of steps.
+   * @param forward Whether the colors are swept in ascending order first.
+   * @param symmetric Whether each step sweeps back in the opposite order.
+   */
+  template<class M, class X, class Y, class K, int l>
+  void multicolor_bsor_steps (const M& A, X& x, const Y& b, const K& w,
+                              const MulticolorOrdering& ordering, int steps,
+                              bool forward, bool symmetric, BL<l>)
+  {
+    typedef std::size_t size_type;
+    int threads = 1;
+    for (size_type c=0; c<ordering.colors(); ++c)
+      threads = std::max(threads, ISTLThreading::threadsFor(ordering.work(c)));
+
+    MulticolorSORKernel<M,X,Y,K,l> kernel(A, x, b, w, ordering, forward,
+                                          steps, symmetric);
+    if (threads>1)
+      parallelTeam(threads, kernel);
+    else
+      {
+        TeamBarrier barrier(1);
+        kernel(0, 1, barrier);
+      }
+  }
+
+  /**
+   * @brief SOR step sweeping the colors of an ordering.
+   *
+   * The rows of each color are updated by
+   * ISTLThreading::threadsFor(work of the color) threads. As the rows of
+   * a color are not coupled, the result does not depend on the number
+   * of threads.
+   * @param A The matrix.
+   * @param x The iterate.
+   * @param b The right hand side.
+   * @param w The relaxation factor.
+   * @param ordering The coloring of the rows of A.
+   * @param forward Whether the colors are swept in ascending order.
+   */
+  template<class M, class X, class Y, class K, int l>
+  void multicolor_bsor (const M& A, X& x, const Y& b, const K& w,
+                        const MulticolorOrdering& ordering, bool forward, BL<l>)
+  {
+    multicolor_bsor_steps(A, x, b, w, ordering, 1, forward, false, BL<l>());
+  }
+
+  /*!
+    \brief Sequential multicolor SOR preconditioner.
+
+    Like SeqSOR, but the rows are swept color by color of a
+    MulticolorOrdering, and the rows of each color in parallel. With
+    the relaxation factor one this is a multicolor Gauss-Seidel method.
+    The ordering only depends on the sparsity pattern and is computed
+    in the constructor.
+
+    \tparam M The matrix type to operate on
+    \tparam X Type of the update
+    \tparam Y Type of the defect
+    \tparam l The block level to invert. Default is 1
+  */
+  template<class M, class X, class Y, int l=1>
+  class SeqMulticolorSOR : public Preconditioner<X,Y> {
+  public:
+    //! \brief The matrix type the preconditioner is for.
+    typedef M matrix_type;
+    //! \brief The domain type of the preconditioner.
+    typedef X domain_type;
+    //! \brief The range type of the preconditioner.
+    typedef Y range_type;
+    //! \brief The field type of the preconditioner.
+    typedef typename X::field_type field_type;
+
+    // define the category
+    enum {
+      //! \brief The category the preconditioner is part of.
+      category=SolverCategory::sequential
+    };
+
+   /*! \brief Constructor.
+
+    constructor gets all parameters to operate the prec.
+    \param A The matrix to operate on.
+    \param n The number of iterations to perform.
+    \param w The relaxation factor.
+    */
+    SeqMulticolorSOR (const M& A, int n, field_type w)
+      : _A_(A), _n(n), _w(w)
+    {
+      CheckIfDiagonalPresent<M,l>::check(_A_);
+      _ordering.build(_A_);
+    }
+
+    /*!
+      \brief Prepare the preconditioner.
+
+      \copydoc Preconditioner::pre(X&,Y&)
+    */
+    virtual void pre (X& x, Y& b) {}
+
+    /*!
+      \brief Apply the preconditioner.
+
+      \copydoc Preconditioner::apply(X&,const Y&)
+    */
+    virtual void apply (X& v, const Y& d)
+    {
+      this->template apply<true>(v,d);
+    }
+
+    /*!
+      \brief Apply the preconditioner in a special direction.
+
+      The template parameter forward indications the direction
+      the smoother is applied. If true the colors are swept in
+      ascending order, if false in descending order.
+    */
+    template<bool forward>
+    void apply(X& v, const Y& d)
+    {
+      multicolor_bsor_steps(_A_,v,d,_w,_ordering,_n,forward,false,BL<l>());
+    }
+
+    /*!
+      \brief Clean up.
+
+      \copydoc Preconditioner::post(X&)
+    */
+    virtual void post (X& x) {}
+
+    //! \brief The coloring of the rows.
+    const MulticolorOrdering& ordering () const
+    {
+      return _ordering;
+    }
+
+  private:
+    //! \brief the matrix we operate on.
+    const M& _A_;
+    //! \brief The coloring of the rows.
+    MulticolorOrdering _ordering;
+    //! \brief The number of steps to perform in apply.
+    int _n;
+    //! \brief The relaxation factor to use.
+    field_type _w;
+  };
+
+  /*!
+    \brief Sequential multicolor SSOR preconditioner.
+
+    A forward and a backward sweep of SeqMulticolorSOR, thus the
+    preconditioner is symmetric for symmetric matrices.
+
+    \tparam M The matrix type to operate on
+    \tparam X Type of the update
+    \tparam Y Type of the defect
+    \tparam l The block level to invert. Default is 1
+   */
+  template<class M, class X, class Y, int l=1>
+  class SeqMulticolorSSOR : public Preconditioner<X,Y> {
+  public:
+    //! \brief The matrix type the preconditioner is for.
+    typedef M matrix_type;
+    //! \brief The domain type of the preconditioner.
+    typedef X domain_type;
+    //! \brief The range type of the preconditioner.
+    typedef Y range_type;
+    //! \brief The field type of the preconditioner.
+    typedef typename X::field_type field_type;
+
+    // define the category
+    enum {
+      //! \brief The category the preconditioner is part of.
+      category=SolverCategory::sequential};
+
+    /*! \brief Constructor.
+
+    constructor gets all parameters to operate the prec.
+    \param A The matrix to operate on.
+    \param n The number of iterations to perform.
+    \param w The relaxation factor.
+    */
+    SeqMulticolorSSOR (const M& A, int n, field_type w)
+      : _A_(A), _n(n), _w(w)
+    {
+      CheckIfDiagonalPresent<M,l>::check(_A_);
+      _ordering.build(_A_);
+    }
+
+    /*!
+      \brief Prepare the preconditioner.
+
+      \copydoc Preconditioner::pre(X&,Y&)
+    */
+    virtual void pre (X& x, Y& b) {}
+
+    /*!
+      \brief Apply the preconditioner
+
+      \copydoc Preconditioner::apply(X&,const Y&)
+    */
+    virtual void apply (X& v, const Y& d)
+    {
+      multicolor_bsor_steps(_A_,v,d,_w,_ordering,_n,true,true,BL<l>());
+    }
+
+    /*!
+      \brief Clean up.
+
+      \copydoc Preconditioner::post(X&)
+    */
+    virtual void post (X& x) {}
+
+  private:
+    //! \brief The matrix we operate on.
+    const M& _A_;
+    //! \brief The coloring of the rows.
+    MulticolorOrdering _ordering;
+    //! \brief The number of steps to do in apply
+    int _n;
+    //! \brief The relaxation factor to use
+    field_type _w;
+  };
+
+  /** @} end documentation */
+
+} // end namespace
+
+#endif
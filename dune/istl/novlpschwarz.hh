@@ -290,6 +290,20 @@ namespace Dune {
     {
       return communication.norm(x);
     }
+
+    /*! \brief Start computing several dot products with one
+      non-blocking global reduction.
+    */
+    virtual void startDots (const X* const* x, const X* const* y, int n, field_type* result)
+    {
+      communication.startDots(x,y,n,result);
+    }
+
+    //! \brief Wait for the reduction started by startDots()
+    virtual void finishDots ()
+    {
+      communication.finishDots();
+    }
     
     /*! \brief make additive vector consistent
      */
@@ -0,0 +1,279 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_NUMAALLOCATOR_HH
+#define DUNE_ISTL_NUMAALLOCATOR_HH
+
+#include<cstddef>
+#include<cstdlib>
+#include<cstring>
+#include<new>
+#include<limits>
+
+#if HAVE_SYS_MMAN_H
+#include<sys/mman.h>
+#endif
+
+#include "threading.hh"
+
+/** \file
+ * \brief An allocator placing large arrays for the threaded kernels.
+ */
+
+namespace Dune {
+  /**
+   * @addtogroup ISTL_SPMV
+   * @{
+   */
+
+  /**
+   * @brief Runtime settings of the NumaAllocator.
+   *
+   * Huge pages default to the value of the environment variable
+   * DUNE_ISTL_HUGE_PAGES ("1" enables them) and are off otherwise.
+   */
+  struct NumaAllocation
+  {
+    /** @brief The size of a transparent huge page, 2 MiB on x86-64. */
+    enum { hugePageSize = 2*1024*1024 };
+
+    /** @brief The alignment of all other allocations, one cache line. */
+    enum { alignment = 64 };
+
+    /** @brief Whether large arrays are advised to use transparent huge pages. */
+    static bool hugePages()
+    {
+      return hugePages_();
+    }
+
+    /** @brief Enable or disable transparent huge pages. */
+    static void setHugePages(bool enable)
+    {
+      hugePages_() = enable;
+    }
+
+    /** @brief Whether new arrays are touched first by the threads using them. */
+    static bool firstTouch()
+    {
+      return firstTouch_();
+    }
+
+    /** @brief Enable or disable the parallel first touch. */
+    static void setFirstTouch(bool enable)
+    {
+      firstTouch_() = enable;
+    }
+
+  private:
+    static bool& hugePages_()
+    {
+      static bool h = initialHugePages();
+      return h;
+    }
+
+    static bool& firstTouch_()
+    {
+      static bool t = true;
+      return t;
+    }
+
+    static bool initialHugePages()
+    {
+      const char* env = std::getenv("DUNE_ISTL_HUGE_PAGES");
+      return env!=0 && std::atoi(env)!=0;
+    }
+  };
+
+  /**
+   * @internal
+   * @brief Zeroes the part of an array owned by one thread, used with
+   * parallelFor().
+   */
+  class FirstTouchKernel
+  {
+  public:
+    FirstTouchKernel(char* p, std::size_t size, const RowPartition& partition)
+      : p_(p), size_(size), partition_(partition)
+    {}
+
+    void operator()(int part) const
+    {
+      std::memset(p_+partition_.first(part)*size_, 0,
+                  (partition_.last(part)-partition_.first(part))*size_);
+    }
+
+  private:
+    char* p_;
+    std::size_t size_;
+    const RowPartition& partition_;
+  };
+
+  /**
+   * @brief An allocator for the large arrays of BCRSMatrix and BlockVector
+   * on NUMA machines.
+   *
+   * Operating systems place a page on the NUMA node of the thread writing
+   * it first. With std::allocator this is the thread setting up the
+   * matrix, so the threaded kernels read most of the matrix from a remote
+   * node. This allocator writes each new array in parallel right after
+   * allocating it, splitting it into ISTLThreading::threadsFor(n) equal
+   * parts. For a BlockVector this is the row partition of the kernels,
+   * for the values and column indices of a BCRSMatrix it is close to it as
+   * the kernels balance the rows by their number of nonzeros.
+   *
+   * The placement only holds if the thread touching a part is the one
+   * later running the kernels on it on the same node. This is guaranteed
+   * only for the OpenMP backend with bound threads, e.g. OMP_PROC_BIND=true
+   * (or close/spread) and OMP_PLACES=cores. The std::thread backend does
+   * not pin its threads: the same persistent worker of ISTLThreadPool
+   * touches and later processes a part, but the operating system may
+   * migrate it to another node. Likewise, an allocation made while the
+   * pool is busy is touched serially by the calling thread.
+   *
+   * Arrays of at least NumaAllocation::hugePageSize bytes are aligned to
+   * huge pages and, if enabled, advised via madvise(MADV_HUGEPAGE) to use
+   * transparent huge pages, which reduces TLB misses for large matrices.
+   * All other arrays are aligned to cache lines.
+   *
+   * \code
+   * typedef FieldMatrix<double,3,3> MatrixBlock;
+   * typedef FieldVector<double,3> VectorBlock;
+   * BCRSMatrix<MatrixBlock,NumaAllocator<MatrixBlock> > A;
+   * BlockVector<VectorBlock,NumaAllocator<VectorBlock> > x;
+   * \endcode
+   *
+   * The first touch zeroes the memory before the containers construct
+   * their objects. The memory comes from posix_memalign or, where it is
+   * not available, from an over-allocating std::malloc. Either way it is
+   * returned with std::free, so the size passed to deallocate() is not used.
+   */
+  template<class T>
+  class NumaAllocator
+  {
+  public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template<class U>
+    struct rebind
+    {
+      typedef NumaAllocator<U> other;
+    };
+
+    NumaAllocator() throw()
+    {}
+
+    NumaAllocator(const NumaAllocator&) throw()
+    {}
+
+    template<class U>
+    NumaAllocator(const NumaAllocator<U>&) throw()
+    {}
+
+    pointer address(reference x) const
+    {
+      return &x;
+    }
+
+    const_pointer address(const_reference x) const
+    {
+      return &x;
+    }
+
+    /**
+     * @brief Allocate and first touch memory for n objects.
+     * @throw std::bad_alloc If no memory is available.
+     */
+    pointer allocate(size_type n, const void* =0)
+    {
+      if (n>max_size())
+        throw std::bad_alloc();
+      const std::size_t bytes = n*sizeof(T);
+      const std::size_t align = bytes>=std::size_t(NumaAllocation::hugePageSize)
+        ? std::size_t(NumaAllocation::hugePageSize) : std::size_t(NumaAllocation::alignment);
+
+      void* p = 0;
+#if HAVE_POSIX_MEMALIGN
+      if (posix_memalign(&p, align, bytes>0 ? bytes : 1)!=0)
+        p = 0;
+#else
+      // over-allocate and keep the pointer returned by malloc in front of the aligned block
+      if (bytes>std::numeric_limits<std::size_t>::max()-align-sizeof(void*))
+        throw std::bad_alloc();
+      void* raw = std::malloc(bytes+align+sizeof(void*));
+      if (raw!=0)
+        {
+          const std::size_t address = reinterpret_cast<std::size_t>(raw)+sizeof(void*);
+          p = reinterpret_cast<void*>((address+align-1)/align*align);
+          static_cast<void**>(p)[-1] = raw;
+        }
+#endif
+      if (p==0)
+        throw std::bad_alloc();
+
+#if HAVE_MADVISE && defined(MADV_HUGEPAGE)
+      const bool huge = align==std::size_t(NumaAllocation::hugePageSize);
+      if (huge && NumaAllocation::hugePages())
+        // only a hint, the kernel may not support transparent huge pages
+        madvise(p, bytes-bytes%NumaAllocation::hugePageSize, MADV_HUGEPAGE);
+#endif
+
+      const int threads = ISTLThreading::threadsFor(n);
+      if (NumaAllocation::firstTouch() && threads>1)
+        {
+          RowPartition partition;
+          partition.buildUniform(n, threads);
+          FirstTouchKernel kernel(static_cast<char*>(p), sizeof(T), partition);
+          parallelFor(threads, kernel);
+        }
+      return static_cast<pointer>(p);
+    }
+
+    void deallocate(pointer p, size_type)
+    {
+#if HAVE_POSIX_MEMALIGN
+      std::free(p);
+#else
+      if (p!=0)
+        std::free(static_cast<void**>(static_cast<void*>(p))[-1]);
+#endif
+    }
+
+    size_type max_size() const throw()
+    {
+      return std::numeric_limits<size_type>::max()/sizeof(T);
+    }
+
+    void construct(pointer p, const T& val)
+    {
+      new(p) T(val);
+    }
+
+    void destroy(pointer p)
+    {
+      p->~T();
+    }
+  };
+
+  //! all NumaAllocators are interchangeable
+  template<class T, class U>
+  bool operator==(const NumaAllocator<T>&, const NumaAllocator<U>&)
+  {
+    return true;
+  }
+
+  template<class T, class U>
+  bool operator!=(const NumaAllocator<T>&, const NumaAllocator<U>&)
+  {
+    return false;
+  }
+
+  /** @} end documentation */
+
+} // end namespace Dune
+
+#endif
@@ -133,7 +133,11 @@ namespace Dune {
 	//! constructor: just store a reference to a matrix
 	MatrixAdapter (const M& A) : _A_(A) {}
 
-	//! apply operator to x:  \f$ y = A(x) \f$
+	/*! \brief apply operator to x:  \f$ y = A(x) \f$
+
+	  For a BCRSMatrix this uses the threaded kernels if ISTL was
+	  configured with a threading backend (see ISTLThreading).
+	 */
 	virtual void apply (const X& x, Y& y) const
 	{
 	  _A_.mv(x,y);
@@ -11,6 +11,7 @@
 #include<dune/common/sllist.hh>
 #include"preconditioners.hh"
 #include"superlu.hh"
+#include"sparselu.hh"
 #include"bvector.hh"
 #include"bcrsmatrix.hh"
 #include"ilusubdomainsolver.hh"
@@ -504,6 +505,49 @@ namespace Dune
     {}
   };
 
+  // specialization for ILUT
+  template<class M, class X, class Y>
+  class OverlappingAssigner<ILUTSubdomainSolver<M,X,Y> >
+    : public OverlappingAssignerILUBase<M,X,Y>
+  {
+  public:
+    /**
+     * @brief Constructor.
+     * @param maxlength The maximum entries over all subdomains.
+     * @param mat The global matrix.
+     * @param b the global right hand side.
+     * @param x the global left hand side.
+     */
+    OverlappingAssigner(std::size_t maxlength, const M& mat, 
+                        const Y& b, X& x)
+      : OverlappingAssignerILUBase<M,X,Y>(maxlength, mat,b,x)
+    {}
+  };
+
+  // specialization for SparseLU
+  template<class K, int n, class A>
+  class OverlappingAssigner<SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> > >
+    : public OverlappingAssignerILUBase<BCRSMatrix<FieldMatrix<K,n,n>,A>,
+                                        typename SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> >::domain_type,
+                                        typename SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> >::range_type>
+  {
+    typedef BCRSMatrix<FieldMatrix<K,n,n>,A> M;
+    typedef typename SparseLU<M>::domain_type X;
+    typedef typename SparseLU<M>::range_type Y;
+  public:
+    /**
+     * @brief Constructor.
+     * @param maxlength The maximum entries over all subdomains.
+     * @param mat The global matrix.
+     * @param b the global right hand side.
+     * @param x the global left hand side.
+     */
+    OverlappingAssigner(std::size_t maxlength, const M& mat, 
+                        const Y& b, X& x)
+      : OverlappingAssignerILUBase<M,X,Y>(maxlength, mat,b,x)
+    {}
+  };
+
     template<typename S, typename T>
     struct AdditiveAdder
     {
@@ -722,6 +766,18 @@ namespace Dune
   struct SeqOverlappingSchwarzAssembler<ILUNSubdomainSolver<M,X,Y> >
     : public SeqOverlappingSchwarzAssemblerILUBase<M,X,Y>
   {};
+
+  template<class M,class X, class Y>
+  struct SeqOverlappingSchwarzAssembler<ILUTSubdomainSolver<M,X,Y> >
+    : public SeqOverlappingSchwarzAssemblerILUBase<M,X,Y>
+  {};
+
+  template<class K, int n, class A>
+  struct SeqOverlappingSchwarzAssembler<SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> > >
+    : public SeqOverlappingSchwarzAssemblerILUBase<BCRSMatrix<FieldMatrix<K,n,n>,A>,
+                                                   typename SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> >::domain_type,
+                                                   typename SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> >::range_type>
+  {};
   
   /**
    * @brief Sequential overlapping Schwarz preconditioner
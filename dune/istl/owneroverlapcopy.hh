@@ -10,6 +10,7 @@
 #include<list>
 #include<map>
 #include<set>
+#include<functional>
 
 #include"cmath"
 
@@ -27,6 +28,7 @@
 #include <dune/common/parallel/communicator.hh>
 #include <dune/common/parallel/remoteindices.hh>
 #include<dune/common/mpicollectivecommunication.hh>
+#include<dune/common/mpitraits.hh>
 #endif
 
 #include"solvercategory.hh"
@@ -161,6 +163,40 @@ namespace Dune {
 
 #if HAVE_MPI
 
+  /**
+   * @internal
+   * @brief The operation summing the dot products of startDots().
+   *
+   * MPI reduces the built-in types with MPI_SUM itself, only other
+   * types need the operation calling std::plus.
+   */
+  template<class T>
+  struct DotsSumOp
+  {
+    static MPI_Op get()
+    {
+      return Generic_MPI_Op<T,std::plus<T> >::get();
+    }
+  };
+
+  template<>
+  struct DotsSumOp<double>
+  {
+    static MPI_Op get()
+    {
+      return MPI_SUM;
+    }
+  };
+
+  template<>
+  struct DotsSumOp<float>
+  {
+    static MPI_Op get()
+    {
+      return MPI_SUM;
+    }
+  };
+
   /**
    * @brief A class setting up standard communication for a two-valued
    * attribute set with owner/overlap/copy semantics.
@@ -404,15 +440,7 @@ namespace Dune {
 	void dot (const T1& x, const T1& y, T2& result) const
 	{
 	  // set up mask vector
-	  if (mask.size()!=static_cast<typename std::vector<double>::size_type>(x.size()))
-		{
-		  mask.resize(x.size());
-		  for (typename std::vector<double>::size_type i=0; i<mask.size(); i++) 
-		    mask[i] = 1;
-		  for (typename PIS::const_iterator i=pis.begin(); i!=pis.end(); ++i)
-			if (i->local().attribute()!=OwnerOverlapCopyAttributeSet::owner)
-			  mask[i->local().local()] = 0;
-		}
+	  setupMask(x.size());
 	  result = 0;
 
 	  for (typename T1::size_type i=0; i<x.size(); i++)
@@ -431,21 +459,49 @@ namespace Dune {
 	double norm (const T1& x) const
 	{
 	  // set up mask vector
-	  if (mask.size()!=static_cast<typename std::vector<double>::size_type>(x.size()))
-		{
-		  mask.resize(x.size());
-		  for (typename std::vector<double>::size_type i=0; i<mask.size(); i++) 
-		    mask[i] = 1;
-		  for (typename PIS::const_iterator i=pis.begin(); i!=pis.end(); ++i)
-			if (i->local().attribute()!=OwnerOverlapCopyAttributeSet::owner)
-			  mask[i->local().local()] = 0;
-		}
+	  setupMask(x.size());
 	  double result = 0;
 	  for (typename T1::size_type i=0; i<x.size(); i++)
 		result += x[i].two_norm2()*mask[i];
 	  return sqrt(cc.sum(result));
 	}
 
+    /**
+     * @brief Start computing several global dot products with a single
+     * non-blocking reduction.
+     *
+     * Computes result[k] = (*x[k])*(*y[k]) for k<n. The local products are
+     * computed immediately, the global sum is only available after
+     * finishDots(). The array result must stay valid until then. Without
+     * MPI-3 the reduction blocks.
+     */
+	template<class T1, class T2>
+	void startDots (const T1* const* x, const T1* const* y, int n, T2* result) const
+	{
+	  if (n<=0) return;
+	  setupMask(x[0]->size());
+	  for (int k=0; k<n; k++)
+		{
+		  result[k] = 0;
+		  for (typename T1::size_type i=0; i<x[k]->size(); i++)
+			result[k] += (*x[k])[i]*((*y[k])[i])*mask[i];
+		}
+#if MPI_VERSION >= 3
+	  MPI_Iallreduce(MPI_IN_PLACE, result, n, MPITraits<T2>::getType(),
+					 DotsSumOp<T2>::get(), comm, &pendingDots);
+#else
+	  cc.sum(result,n);
+#endif
+	}
+
+    //! @brief Wait for the dot products started by startDots().
+	void finishDots () const
+	{
+#if MPI_VERSION >= 3
+	  MPI_Wait(&pendingDots, MPI_STATUS_IGNORE);
+#endif
+	}
+
     typedef Dune::EnumItem<AttributeSet,OwnerOverlapCopyAttributeSet::copy> CopyFlags;
     
     /** @brief The type of the parallel index set. */
@@ -560,8 +616,8 @@ namespace Dune {
       : comm(comm_), cc(comm_), pis(), ri(pis,pis,comm_), 
         OwnerToAllInterfaceBuilt(false), OwnerOverlapToAllInterfaceBuilt(false), 
         OwnerCopyToAllInterfaceBuilt(false), OwnerCopyToOwnerCopyInterfaceBuilt(false), 
-        CopyToAllInterfaceBuilt(false), globalLookup_(0), category(cat_),
-        freecomm(freecomm_)
+        CopyToAllInterfaceBuilt(false), pendingDots(MPI_REQUEST_NULL),
+        globalLookup_(0), category(cat_), freecomm(freecomm_)
     {}
     
     /**
@@ -576,7 +632,8 @@ namespace Dune {
       : comm(MPI_COMM_WORLD), cc(MPI_COMM_WORLD), pis(), ri(pis,pis,MPI_COMM_WORLD), 
         OwnerToAllInterfaceBuilt(false), OwnerOverlapToAllInterfaceBuilt(false), 
         OwnerCopyToAllInterfaceBuilt(false), OwnerCopyToOwnerCopyInterfaceBuilt(false), 
-        CopyToAllInterfaceBuilt(false), globalLookup_(0), category(cat_), freecomm(false)
+        CopyToAllInterfaceBuilt(false), pendingDots(MPI_REQUEST_NULL),
+        globalLookup_(0), category(cat_), freecomm(false)
     {}
 
     /**
@@ -593,7 +650,7 @@ namespace Dune {
 	  : comm(comm_), cc(comm_), OwnerToAllInterfaceBuilt(false),
         OwnerOverlapToAllInterfaceBuilt(false), OwnerCopyToAllInterfaceBuilt(false),
         OwnerCopyToOwnerCopyInterfaceBuilt(false), CopyToAllInterfaceBuilt(false),
-        globalLookup_(0), category(cat_), freecomm(freecomm_)
+        pendingDots(MPI_REQUEST_NULL), globalLookup_(0), category(cat_), freecomm(freecomm_)
 	{
 	  // set up an ISTL index set
 	  pis.beginResize();
@@ -667,6 +724,21 @@ namespace Dune {
   private:
     OwnerOverlapCopyCommunication (const OwnerOverlapCopyCommunication&)
     {}
+
+    //! set up the mask vector excluding non-owned entries from dot products
+    void setupMask (std::size_t size) const
+    {
+	  if (mask.size()!=static_cast<typename std::vector<double>::size_type>(size))
+		{
+		  mask.resize(size);
+		  for (typename std::vector<double>::size_type i=0; i<mask.size(); i++) 
+		    mask[i] = 1;
+		  for (typename PIS::const_iterator i=pis.begin(); i!=pis.end(); ++i)
+			if (i->local().attribute()!=OwnerOverlapCopyAttributeSet::owner)
+			  mask[i->local().local()] = 0;
+		}
+    }
+
     MPI_Comm comm;
 	CollectiveCommunication<MPI_Comm> cc;
 	PIS pis;
@@ -682,6 +754,7 @@ namespace Dune {
     mutable IF CopyToAllInterface;
 	mutable bool CopyToAllInterfaceBuilt;
 	mutable std::vector<double> mask;
+    mutable MPI_Request pendingDots;
     int oldseqNo;
     GlobalLookupIndexSet* globalLookup_;
     SolverCategory::Category category;
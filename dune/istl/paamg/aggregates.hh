@@ -15,9 +15,11 @@
 #include<dune/common/stdstreams.hh>
 #include<dune/common/poolallocator.hh>
 #include<dune/common/sllist.hh>
+#include<dune/istl/threading.hh>
 
 #include<utility>
 #include<set>
+#include<vector>
 #include<algorithm>
 #include<limits>
 #include<ostream>
@@ -1231,6 +1233,148 @@ namespace Dune
       void growIsolatedAggregate(const Vertex& vertex, const AggregatesMap<Vertex>& aggregates, const C& c);
     };
 
+    /**
+     * @brief Class for building the aggregates with several threads.
+     *
+     * The roots of the aggregates form a maximal independent set of
+     * distance two in the graph of the strong connections. It is
+     * computed in rounds as in the MIS(k) algorithm of Bell, Dalton and
+     * Olson: each undecided vertex compares a pseudo random priority with
+     * all vertices at distance of at most two and becomes a root if its
+     * priority is the highest. Afterwards the neighbours of the roots join
+     * their aggregate. This is repeated once for the vertices not yet
+     * aggregated, where roots without unaggregated strong neighbours join
+     * a neighbouring aggregate instead of staying alone. The vertices left
+     * then join the aggregate of a neighbour. Each step only changes the
+     * vertices processed, which makes the aggregates independent of the
+     * number of threads.
+     *
+     * The aggregates have a diameter of up to four and their size is not
+     * limited. For the isotropic 2D Laplacian they have about 4.6 vertices
+     * on average instead of the 4 of Aggregator, with up to 10 vertices,
+     * and AMG needs about half again as many iterations. For strongly
+     * anisotropic problems they have about 3 vertices instead of 4 and AMG
+     * needs about as many iterations. The size and distance limits of the
+     * criterion are only used for the vertices left unaggregated, which
+     * are aggregated serially at the end.
+     */
+    template<class G>
+    class ParallelAggregator
+    {
+    public:
+      /**
+       * @brief The matrix graph type used.
+       */
+      typedef G MatrixGraph;
+
+      /**
+       * @brief The vertex identifier
+       */
+      typedef typename MatrixGraph::VertexDescriptor Vertex;
+      
+      /** @brief The type of the aggregate descriptor. */
+      typedef typename MatrixGraph::VertexDescriptor AggregateDescriptor;
+
+      /**
+       * @brief Build the aggregates.
+       *
+       * Same as Aggregator::build().
+       * @param m The matrix to build the aggregates accordingly.
+       * @param graph A (sub) graph of the matrix.
+       * @param aggregates Aggregate map we will build. All entries should be initialized
+       * to UNAGGREGATED!
+       * @param c The coarsening criterion to use.
+       * @param finestLevel Whether this the finest level. In that case rows representing 
+       * Dirichlet boundaries will be detected and ignored during aggregation.
+       * @return A tuple of the total number of aggregates, the number of isolated aggregates,
+       *         the number of aggregates consisting only of one vertex, and 
+       *         the number of skipped aggregates built.
+       */
+      template<class M, class C>
+      tuple<int,int,int,int> build(const M& m, G& graph, 
+                                   AggregatesMap<Vertex>& aggregates, const C& c,
+                                   bool finestLevel);
+
+    private:
+      /** @brief The states of the vertices, a root has the highest. */
+      enum State{ excluded=0, out=1, undecided=2, root=3 };
+
+      /** @brief The priority of a vertex when choosing the roots. */
+      struct Priority
+      {
+        char state;
+        unsigned int random;
+        Vertex vertex;
+
+        bool operator<(const Priority& other) const
+        {
+          if(state!=other.state)
+            return state<other.state;
+          if(random!=other.random)
+            return random<other.random;
+          return vertex<other.vertex;
+        }
+      };
+
+      /** @brief The steps executed by all threads. */
+      enum Step{ prepare, propagate, decide, dissolveRoots, countRoots, numberRoots, joinRoots,
+                  markAggregated, joinNeighbours };
+
+      /** @brief Calls step() for one part of the vertices, used with parallelFor(). */
+      class Kernel
+      {
+      public:
+        Kernel(ParallelAggregator<G>& aggregator, Step step)
+          : aggregator_(aggregator), step_(step)
+        {}
+
+        void operator()(int part) const
+        {
+          aggregator_.step(step_, part);
+        }
+
+      private:
+        ParallelAggregator<G>& aggregator_;
+        Step step_;
+      };
+
+      /** @brief Execute one step for the vertices of one part. */
+      void step(Step s, int part);
+
+      /** @brief Execute one step for all vertices. */
+      void run(Step s);
+
+      /** @brief The current priority of a vertex. */
+      Priority priority(const Vertex& v) const;
+
+      /** @brief A hash of the vertex number used as its random priority. */
+      static unsigned int hash(const Vertex& v);
+
+      /** @brief The graph we aggregate. */
+      const MatrixGraph* graph_;
+
+      /** @brief The aggregates we build. */
+      AggregatesMap<Vertex>* aggregates_;
+
+      /** @brief The vertices of the graph in ascending order. */
+      std::vector<Vertex> vertices_;
+
+      /** @brief The partition of vertices_ into the parts of the threads. */
+      RowPartition partition_;
+
+      /** @brief The state of each vertex. */
+      std::vector<char> state_;
+
+      /** @brief The highest priority at distance at most one of each vertex. */
+      std::vector<Priority> neighbourhood_;
+
+      /** @brief Whether a vertex was aggregated by a previous step. */
+      std::vector<char> joined_;
+
+      /** @brief Counters and offsets of the parts. */
+      std::vector<std::size_t> counts_;
+    };
+
 #ifndef DOXYGEN
 
     template<class M, class N>
@@ -2164,6 +2308,10 @@ namespace Dune
     tuple<int,int,int,int> AggregatesMap<V>::buildAggregates(const M& matrix, G& graph, const C& criterion,
                                                              bool finestLevel)
     {
+      if(criterion.aggregationAlgorithm()==parallelAggregation){
+        ParallelAggregator<G> aggregator;
+        return aggregator.build(matrix, graph, *this, criterion, finestLevel);
+      }
       Aggregator<G> aggregator;
       return aggregator.build(matrix, graph, *this, criterion, finestLevel);
     }
@@ -2438,6 +2586,286 @@ namespace Dune
       return NullEntry;
     }
 
+    template<class G>
+    inline unsigned int ParallelAggregator<G>::hash(const Vertex& v)
+    {
+      // integer hash of Thomas Wang
+      unsigned int h = static_cast<unsigned int>(v);
+      h = (h ^ 61u) ^ (h >> 16);
+      h *= 9u;
+      h ^= h >> 4;
+      h *= 0x27d4eb2du;
+      h ^= h >> 15;
+      return h;
+    }
+
+    template<class G>
+    inline typename ParallelAggregator<G>::Priority
+    ParallelAggregator<G>::priority(const Vertex& v) const
+    {
+      Priority p;
+      p.state = state_[v];
+      p.random = hash(v);
+      p.vertex = v;
+      return p;
+    }
+
+    template<class G>
+    void ParallelAggregator<G>::run(Step s)
+    {
+      Kernel kernel(*this, s);
+      parallelFor(partition_.parts(), kernel);
+    }
+
+    template<class G>
+    void ParallelAggregator<G>::step(Step s, int part)
+    {
+      typedef typename MatrixGraph::ConstEdgeIterator EdgeIterator;
+      const std::size_t first = partition_.first(part), last = partition_.last(part);
+      AggregatesMap<Vertex>& aggregates = *aggregates_;
+
+      switch(s){
+      case prepare:
+        // only the unaggregated vertices take part in the next independent set
+        for(std::size_t i=first; i < last; ++i){
+          const Vertex v = vertices_[i];
+          const typename MatrixGraph::VertexProperties& properties = graph_->getVertexProperties(v);
+          if(properties.excludedBorder() || properties.isolated() || joined_[v])
+            state_[v]=excluded;
+          else
+            state_[v]=undecided;
+        }
+        break;
+      case propagate:
+        // highest priority among the vertex and its strong neighbours
+        for(std::size_t i=first; i < last; ++i){
+          const Vertex v = vertices_[i];
+          if(state_[v]==excluded)
+            continue;
+          Priority max = priority(v);
+          const EdgeIterator end = graph_->endEdges(v);
+          for(EdgeIterator edge = graph_->beginEdges(v); edge != end; ++edge)
+            if(edge.properties().isStrong() && state_[edge.target()]!=excluded)
+              max = std::max(max, priority(edge.target()));
+          neighbourhood_[v] = max;
+        }
+        break;
+      case decide:
+        {
+          // highest priority at distance two decides undecided vertices
+          std::size_t left=0;
+          for(std::size_t i=first; i < last; ++i){
+            const Vertex v = vertices_[i];
+            if(state_[v]!=undecided)
+              continue;
+            Priority max = neighbourhood_[v];
+            const EdgeIterator end = graph_->endEdges(v);
+            for(EdgeIterator edge = graph_->beginEdges(v); edge != end; ++edge)
+              if(edge.properties().isStrong() && state_[edge.target()]!=excluded)
+                max = std::max(max, neighbourhood_[edge.target()]);
+            if(max.vertex==v)
+              state_[v]=root;
+            else if(max.state==root)
+              state_[v]=out;
+            else
+              ++left;
+          }
+          counts_[part]=left;
+        }
+        break;
+      case dissolveRoots:
+        // a root whose strong neighbours are all aggregated would stay alone,
+        // it joins the aggregate of a neighbour instead
+        for(std::size_t i=first; i < last; ++i){
+          const Vertex v = vertices_[i];
+          if(state_[v]!=root)
+            continue;
+          bool alone=true, joinable=false;
+          const EdgeIterator end = graph_->endEdges(v);
+          for(EdgeIterator edge = graph_->beginEdges(v); edge != end; ++edge)
+            if(edge.properties().isStrong()){
+              alone = alone && state_[edge.target()]==excluded;
+              joinable = joinable || joined_[edge.target()];
+            }
+          if(alone && joinable)
+            state_[v]=out;
+        }
+        break;
+      case countRoots:
+        {
+          std::size_t roots=0;
+          for(std::size_t i=first; i < last; ++i)
+            if(state_[vertices_[i]]==root)
+              ++roots;
+          counts_[part]=roots;
+        }
+        break;
+      case numberRoots:
+        {
+          // the roots are numbered in ascending order for any number of parts
+          AggregateDescriptor id = counts_[part];
+          for(std::size_t i=first; i < last; ++i)
+            if(state_[vertices_[i]]==root)
+              aggregates[vertices_[i]]=id++;
+        }
+        break;
+      case joinRoots:
+        for(std::size_t i=first; i < last; ++i){
+          const Vertex v = vertices_[i];
+          if(state_[v]!=out)
+            continue;
+          Priority max = priority(v);
+          const EdgeIterator end = graph_->endEdges(v);
+          for(EdgeIterator edge = graph_->beginEdges(v); edge != end; ++edge)
+            if(edge.properties().isStrong() && state_[edge.target()]==root)
+              max = std::max(max, priority(edge.target()));
+          if(max.state==root)
+            aggregates[v]=aggregates[max.vertex];
+        }
+        break;
+      case markAggregated:
+        for(std::size_t i=first; i < last; ++i)
+          if(aggregates[vertices_[i]]!=AggregatesMap<Vertex>::UNAGGREGATED)
+            joined_[vertices_[i]]=1;
+        break;
+      case joinNeighbours:
+        for(std::size_t i=first; i < last; ++i){
+          const Vertex v = vertices_[i];
+          if(state_[v]!=out || joined_[v])
+            continue;
+          // join the neighbour with the highest priority
+          bool found=false;
+          Priority max = priority(v);
+          const EdgeIterator end = graph_->endEdges(v);
+          for(EdgeIterator edge = graph_->beginEdges(v); edge != end; ++edge)
+            if(edge.properties().isStrong() && joined_[edge.target()]){
+              Priority p = priority(edge.target());
+              if(!found || max < p){
+                max = p;
+                found = true;
+              }
+            }
+          if(found)
+            aggregates[v]=aggregates[max.vertex];
+        }
+        break;
+      }
+    }
+
+    template<class G>
+    template<class M, class C>
+    tuple<int,int,int,int> ParallelAggregator<G>::build(const M& m, G& graph, AggregatesMap<Vertex>& aggregates,
+                                                        const C& c, bool finestLevel)
+    {
+      typedef typename MatrixGraph::VertexIterator VertexIterator;
+      typedef typename MatrixGraph::ConstEdgeIterator EdgeIterator;
+      
+      Timer watch;
+      watch.reset();
+
+      buildDependency(graph, m, c, finestLevel);
+
+      dverb<<"Build dependency took "<< watch.elapsed()<<" seconds."<<std::endl;
+      watch.reset();
+
+      graph_ = &graph;
+      aggregates_ = &aggregates;
+      vertices_.clear();
+      vertices_.reserve(graph.noVertices());
+      state_.assign(graph.maxVertex()+1, static_cast<char>(excluded));
+      for(VertexIterator vertex = graph.begin(); vertex != graph.end(); ++vertex){
+        vertices_.push_back(*vertex);
+        if(!vertex.properties().excludedBorder() && !vertex.properties().isolated())
+          state_[*vertex]=undecided;
+      }
+      neighbourhood_.resize(state_.size());
+      joined_.assign(state_.size(), 0);
+
+      const int parts = ISTLThreading::threadsFor(vertices_.size());
+      partition_.buildUniform(vertices_.size(), parts);
+      counts_.assign(parts+1, 0);
+
+      int rounds=0;
+      std::size_t noAggregates=0;
+      for(int pass=0; pass < 2; ++pass){
+        run(prepare);
+        for(std::size_t left=vertices_.size(); left>0; ++rounds){
+          run(propagate);
+          run(decide);
+          left = 0;
+          for(int p=0; p < parts; ++p)
+            left += counts_[p];
+        }
+
+        run(dissolveRoots);
+        run(countRoots);
+        for(int p=0; p < parts; ++p){
+          std::size_t roots=counts_[p];
+          counts_[p]=noAggregates;
+          noAggregates+=roots;
+        }
+        run(numberRoots);
+        run(joinRoots);
+        run(markAggregated);
+      }
+      run(joinNeighbours);
+
+      dverb<<"Choosing "<<noAggregates<<" roots in "<<rounds<<" rounds and aggregating took "
+           <<watch.elapsed()<<" seconds."<<std::endl;
+
+      // The remaining vertices are isolated, excluded, or were not
+      // reached through strong connections, e.g. for unsymmetric criteria.
+      int isoAggregates=0, skippedAggregates=0;
+      for(typename std::vector<Vertex>::const_iterator vertex = vertices_.begin();
+          vertex != vertices_.end(); ++vertex){
+        const Vertex v=*vertex;
+        if(aggregates[v]!=AggregatesMap<Vertex>::UNAGGREGATED)
+          continue;
+        if(graph.getVertexProperties(v).excludedBorder() || 
+           (c.skipIsolated() && graph.getVertexProperties(v).isolated())){
+          aggregates[v]=AggregatesMap<Vertex>::ISOLATED;
+          ++skippedAggregates;
+          continue;
+        }
+        if(graph.getVertexProperties(v).isolated())
+          ++isoAggregates;
+        // aggregate with the unaggregated neighbours
+        aggregates[v]=noAggregates;
+        std::size_t size=1;
+        const EdgeIterator end = graph.endEdges(v);
+        for(EdgeIterator edge = graph.beginEdges(v); edge != end && size < c.maxAggregateSize(); ++edge)
+          if(aggregates[edge.target()]==AggregatesMap<Vertex>::UNAGGREGATED &&
+             !graph.getVertexProperties(edge.target()).excludedBorder() &&
+             graph.getVertexProperties(edge.target()).isolated()==graph.getVertexProperties(v).isolated()){
+            aggregates[edge.target()]=noAggregates;
+            ++size;
+          }
+        ++noAggregates;
+      }
+
+      std::vector<std::size_t> sizes(noAggregates, 0);
+      for(typename std::vector<Vertex>::const_iterator vertex = vertices_.begin();
+          vertex != vertices_.end(); ++vertex)
+        if(aggregates[*vertex]!=AggregatesMap<Vertex>::ISOLATED)
+          ++sizes[aggregates[*vertex]];
+      int oneAggregates = std::count(sizes.begin(), sizes.end(), std::size_t(1));
+
+      Dune::dinfo<<"connected aggregates: "<<noAggregates-isoAggregates;
+      Dune::dinfo<<" isolated aggregates: "<<isoAggregates;
+      if(noAggregates>0)
+        Dune::dinfo<<" one node aggregates: "<<oneAggregates<<" min size="
+                   <<*std::min_element(sizes.begin(), sizes.end())<<" max size="
+                   <<*std::max_element(sizes.begin(), sizes.end())
+                   <<" avg="<<(vertices_.size()-skippedAggregates)/noAggregates<<std::endl;
+
+      state_.clear();
+      neighbourhood_.clear();
+      joined_.clear();
+      vertices_.clear();
+      return make_tuple(static_cast<int>(noAggregates),isoAggregates,
+			oneAggregates,skippedAggregates);
+    }
+
 #endif // DOXYGEN
 
     template<class V>
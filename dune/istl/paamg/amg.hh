@@ -3,6 +3,8 @@
 #define DUNE_AMG_AMG_HH
 
 #include<memory>
+#include<ostream>
+#include<vector>
 #include<dune/common/exceptions.hh>
 #include<dune/istl/paamg/smoother.hh>
 #include<dune/istl/paamg/transfer.hh>
@@ -10,6 +12,7 @@
 #include<dune/istl/solvers.hh>
 #include<dune/istl/scalarproducts.hh>
 #include<dune/istl/superlu.hh>
+#include<dune/istl/sparselu.hh>
 #include<dune/istl/solvertype.hh>
 #include<dune/common/typetraits.hh>
 #include<dune/common/exceptions.hh>
@@ -155,8 +158,10 @@ namespace Dune
       /**
        * @brief Construct an AMG with an inexact coarse solver based on the smoother.
        *
-       * As coarse solver a preconditioned CG method with the smoother as preconditioner
-       * will be used. The matrix hierarchy is built automatically.
+       * If the coarsest level is on one process it is solved directly by
+       * SuperLU or, if that is not available, by SparseLU. Otherwise a
+       * BiCGSTAB method with the smoother as preconditioner will be used.
+       * The matrix hierarchy is built automatically.
        * @param fineOperator The operator on the fine level.
        * @param criterion The criterion describing the coarsening strategy. E. g. SymmetricCriterion
        * or UnsymmetricCriterion, and providing the parameters.
@@ -176,9 +181,129 @@ namespace Dune
       /** \copydoc Preconditioner::apply */
       void apply(Domain& v, const Range& d);
       
-      /** \copydoc Preconditioner::post */
+      /**
+       * @brief Finish a solve.
+       *
+       * The work vectors of all levels and the coarse solver are kept
+       * for the next call of pre() and only freed by the destructor.
+       */
       void post(Domain& x);
 
+      /**
+       * @brief Print the memory used by each level of the hierarchy.
+       *
+       * Lists the number of unknowns and the bytes used by the matrix and
+       * by the work vectors (right hand side, left hand side and update)
+       * of every level. The work vectors are allocated by the first call
+       * of pre().
+       * @param os The stream to print to.
+       */
+      void printMemoryFootprint(std::ostream& os) const;
+
+      /**
+       * @brief The operations performed on one level of the hierarchy.
+       *
+       * Counted and timed by apply() since the construction or the last
+       * call of resetLevelWork(). The transfers are accounted to the finer
+       * of the two levels involved.
+       */
+      struct LevelWork
+      {
+        LevelWork()
+          : visits(0), smoothingSteps(0), operatorApplications(0), coarseSolves(0),
+            smoothingTime(0), restrictionTime(0), prolongationTime(0), coarseSolveTime(0)
+        {}
+        /** @brief How often a cycle was started on the level. */
+        std::size_t visits;
+        /** @brief The number of applications of the smoother. */
+        std::size_t smoothingSteps;
+        /** @brief The number of applications of the matrix outside the smoother. */
+        std::size_t operatorApplications;
+        /** @brief The number of calls of the coarse solver. */
+        std::size_t coarseSolves;
+        /** @brief The seconds spent in pre- and postsmoothing including the defect updates. */
+        double smoothingTime;
+        /** @brief The seconds spent restricting the defect to the next coarser level. */
+        double restrictionTime;
+        /** @brief The seconds spent prolongating the correction of the next coarser level. */
+        double prolongationTime;
+        /** @brief The seconds spent in the coarse solver. */
+        double coarseSolveTime;
+      };
+
+      /**
+       * @brief Everything known about the setup, the work and the memory of a level.
+       *
+       * All values refer to the data of this process.
+       */
+      struct LevelStatistics
+      {
+        /** @brief The number of unknowns (block rows) of the matrix. */
+        std::size_t unknowns;
+        /** @brief The number of nonzero blocks of the matrix. */
+        std::size_t nonzeros;
+        /** @brief The seconds spent on aggregating the level. */
+        double aggregationTime;
+        /** @brief The seconds spent on computing the next coarser matrix. */
+        double galerkinTime;
+        /** @brief The seconds spent on constructing the smoother. */
+        double smootherSetupTime;
+        /** @brief The seconds spent on the last setup or refactorization of the coarse solver. */
+        double coarseSolverSetupTime;
+        /** @brief How often the coarse solver was set up or refactorized. */
+        std::size_t coarseSolverSetups;
+        /** @brief The operations performed by apply() and their times. */
+        LevelWork work;
+        /** @brief The bytes used by the matrix. */
+        std::size_t matrixMemory;
+        /** @brief The bytes used by the smoothed aggregation transfer to the next coarser level. */
+        std::size_t transferMemory;
+        /** @brief The bytes used by the work vectors. */
+        std::size_t vectorMemory;
+      };
+
+      /**
+       * @brief Get the operations performed on each level, the finest being the first.
+       */
+      const std::vector<LevelWork>& levelWork() const
+      {
+        return work_;
+      }
+
+      /** @brief Reset the operation counters of all levels. */
+      void resetLevelWork();
+
+      /**
+       * @brief Get the statistics of each level, the finest being the first.
+       *
+       * Collects the setup times recorded by the matrix hierarchy, the
+       * work done by apply() and the memory used.
+       */
+      std::vector<LevelStatistics> levelStatistics() const;
+
+      /**
+       * @brief Print the statistics of all levels as a JSON object.
+       *
+       * The object has a member "levels" holding an array with one object
+       * per level with the members "unknowns", "nonzeros", "setup" (times
+       * in seconds), "apply" (counters and times in seconds) and "memory"
+       * (bytes), and a member "total" summing up the setup and apply times
+       * and the memory of all levels.
+       * @param os The stream to print to.
+       */
+      void printStatistics(std::ostream& os) const;
+
+      /**
+       * @brief Print the operations performed on each level.
+       *
+       * Besides the counters the work of each level is printed in units
+       * of fine level matrix sweeps: the smoothing steps and operator
+       * applications weighted with the number of nonzeros of the level
+       * relative to the finest level.
+       * @param os The stream to print to.
+       */
+      void printLevelWork(std::ostream& os) const;
+
       /**
        * @brief Get the aggregate number of each unknown on the coarsest level.
        * @param cont The random access container to store the numbers in.
@@ -197,11 +322,18 @@ namespace Dune
        * matrix would yield the same aggregates. In this case it suffices
        * to recalculate all the Galerkin products for the matrices of the 
        * coarser levels.
+       *
+       * This is the setup for a sequence of systems with the same
+       * sparsity pattern, e.g. in a Newton method: after changing the
+       * values of the fine matrix in place the aggregates and the
+       * sparsity patterns of all levels are kept, only the values of
+       * the coarse matrices are recomputed and the smoothers are set up
+       * again for them (e.g. ILU smoothers factorize the new matrices).
+       * A direct coarse solver keeps its ordering and only factorizes the
+       * new coarsest matrix.
+       * It must not be called between pre() and post().
        */
-      void recalculateHierarchy()
-      {
-        matrices_->recalculateGalerkin(NegateSet<typename PI::OwnerSet>());
-      }
+      void recalculateHierarchy();
 
       /**
        * @brief Check whether the coarse solver used is a direct solver.
@@ -211,7 +343,25 @@ namespace Dune
       
     private:
       /** @brief Multigrid cycle on a level. */
-      void mgc();
+      void mgc(CycleType cycle);
+
+      /**
+       * @brief Compute the coarse grid correction on the current (coarse) level.
+       * @param cycle The cycle type of the finer level.
+       */
+      void coarseGridCorrection(CycleType cycle);
+
+      /**
+       * @brief Compute the coarse grid correction with two steps of flexible CG.
+       *
+       * The preconditioner is a K-cycle on the current level.
+       */
+      void krylovCorrection();
+
+      /**
+       * @brief Update the defect with the last correction before repeating a cycle.
+       */
+      void updateDefect();
 
       typename Hierarchy<Smoother,A>::Iterator smoother;
       typename OperatorHierarchy::ParallelMatrixHierarchy::ConstIterator matrix;
@@ -241,14 +391,65 @@ namespace Dune
       /** @brief Initialize iterators over levels with fine level */
       void initIteratorsWithFineLevel();
 
+      /** @brief Allocate the work vectors of all levels. */
+      void allocateVectors(const Domain& x, const Range& b);
+
+      /** @brief Free the work vectors of all levels. */
+      void deleteVectors();
+
+      /**
+       * @brief Whether the work vectors exist and have the sizes of all
+       * levels of the current matrix hierarchy and of b.
+       */
+      bool vectorsFitHierarchy(const Range& b) const;
+
+      /**
+       * @brief Reinitialize the work vectors of the last solve.
+       *
+       * The finest level gets the values of fine and all coarser levels
+       * are set to zero.
+       */
+      template<class V>
+      static void resetVectors(Hierarchy<V,A>& vectors, const V& fine);
+
+      /**
+       * @brief Set up the solver of the coarsest level.
+       *
+       * Constructs the direct solver, or the coarse smoother, scalar
+       * product and BiCGSTAB solver if the coarsest level is distributed.
+       */
+      void createCoarseSolver();
+
+      /**
+       * @brief Set up the coarse solver for the recalculated coarsest matrix.
+       *
+       * A direct solver only computes the factors again, the others are
+       * constructed anew.
+       */
+      void refactorCoarseSolver();
+
+      /** @brief Free the coarse solver, smoother and scalar product. */
+      void deleteCoarseSolver();
+
+      /** @brief The memory used by a work vector in bytes. */
+      template<class V>
+      static std::size_t memory(const Hierarchy<V,A>& vectors, std::size_t level);
+
       /**  @brief The matrix we solve. */
       OperatorHierarchy* matrices_;
       /** @brief The arguments to construct the smoother */
       SmootherArgs smootherArgs_;
       /** @brief The hierarchy of the smoothers. */
       Hierarchy<Smoother,A> smoothers_;
+#if HAVE_SUPERLU
+      typedef SuperLU<typename M::matrix_type> DirectSolver;
+#else
+      typedef SparseLU<typename M::matrix_type> DirectSolver;
+#endif
       /** @brief The solver of the coarsest level. */
       CoarseSolver* solver_;
+      /** @brief The coarse solver if it is a direct solver built by us, otherwise 0. */
+      DirectSolver* directSolver_;
       /** @brief The right hand side of our problem. */
       Hierarchy<Range,A>* rhs_;
       /** @brief The left approximate solution of our problem. */
@@ -261,8 +462,42 @@ namespace Dune
       typedef typename ScalarProductChooser::ScalarProduct ScalarProduct;
       /** @brief Scalar product on the coarse level. */
       ScalarProduct* scalarProduct_;
+      /** @brief Work vectors and scalar product of the K-cycle on a level. */
+      struct KrylovLevel
+      {
+        KrylovLevel(std::size_t n, const ParallelInformation& pinfo)
+          : defect(n), correction(n), product(n),
+            scalarProduct(ScalarProductChooser::construct(pinfo))
+        {}
+        ~KrylovLevel()
+        {
+          delete scalarProduct;
+        }
+        /** @brief The defect to reduce. */
+        Domain defect;
+        /** @brief The correction of the first step. */
+        Domain correction;
+        /** @brief The product of the matrix with a correction. */
+        Range product;
+        /** @brief The scalar product of the level. */
+        ScalarProduct* scalarProduct;
+      };
       /** @brief Gamma, 1 for V-cycle and 2 for W-cycle. */
       std::size_t gamma_;
+      /** @brief The type of the cycle. */
+      CycleType cycle_;
+      /** @brief Every kCycleInterval_-th level uses Krylov acceleration in the K-cycle. */
+      std::size_t kCycleInterval_;
+      /** @brief The defect reduction making a second Krylov step unnecessary. */
+      double kCycleTolerance_;
+      /** @brief The work vectors of the K-cycle, one per coarse level. */
+      std::vector<KrylovLevel*> krylovLevels_;
+      /** @brief The operation counters of the levels. */
+      std::vector<LevelWork> work_;
+      /** @brief The seconds spent on the last setup of the coarse solver. */
+      double coarseSolverSetupTime_;
+      /** @brief How often the coarse solver was set up. */
+      std::size_t coarseSolverSetups_;
       /** @brief The number of pre and postsmoothing steps. */
       std::size_t preSteps_;
       /** @brief The number of postsmoothing steps. */
@@ -282,8 +517,10 @@ namespace Dune
 			std::size_t gamma, std::size_t preSmoothingSteps,
 			std::size_t postSmoothingSteps, bool additive_)
       : matrices_(&matrices), smootherArgs_(smootherArgs),
-	smoothers_(), solver_(&coarseSolver), scalarProduct_(0),
-	gamma_(gamma), preSteps_(preSmoothingSteps), postSteps_(postSmoothingSteps), buildHierarchy_(false),
+	smoothers_(), solver_(&coarseSolver), directSolver_(0), rhs_(0), lhs_(0), update_(0), scalarProduct_(0),
+	gamma_(gamma), cycle_(gamma>1 ? wCycle : vCycle), kCycleInterval_(1), kCycleTolerance_(0.25), coarseSolverSetupTime_(0),
+        coarseSolverSetups_(0),
+	preSteps_(preSmoothingSteps), postSteps_(postSmoothingSteps), buildHierarchy_(false),
 	additive(additive_), coarsesolverconverged(true),
 	coarseSmoother_(), verbosity_(2)
     {
@@ -298,8 +535,10 @@ namespace Dune
                          const SmootherArgs& smootherArgs,
                          const Parameters& parms)
       : matrices_(&matrices), smootherArgs_(smootherArgs),
-	smoothers_(), solver_(&coarseSolver), scalarProduct_(0),
-	gamma_(parms.getGamma()), preSteps_(parms.getNoPreSmoothSteps()), 
+	smoothers_(), solver_(&coarseSolver), directSolver_(0), rhs_(0), lhs_(0), update_(0), scalarProduct_(0),
+	gamma_(parms.getGamma()), cycle_(parms.getCycleType()), kCycleInterval_(parms.getKCycleInterval()),
+	kCycleTolerance_(parms.getKCycleTolerance()), coarseSolverSetupTime_(0), coarseSolverSetups_(0),
+        preSteps_(parms.getNoPreSmoothSteps()), 
         postSteps_(parms.getNoPostSmoothSteps()), buildHierarchy_(false),
 	additive(parms.getAdditive()), coarsesolverconverged(true),
 	coarseSmoother_(), verbosity_(parms.debugLevel())
@@ -320,7 +559,9 @@ namespace Dune
 			bool additive_,
 			const PI& pinfo)
       : smootherArgs_(smootherArgs),
-	smoothers_(), solver_(), scalarProduct_(0), gamma_(gamma),
+	smoothers_(), solver_(), directSolver_(0), rhs_(0), lhs_(0), update_(0), scalarProduct_(0), gamma_(gamma),
+	cycle_(gamma>1 ? wCycle : vCycle), kCycleInterval_(1), kCycleTolerance_(0.25), coarseSolverSetupTime_(0),
+        coarseSolverSetups_(0),
 	preSteps_(preSmoothingSteps), postSteps_(postSmoothingSteps), buildHierarchy_(true),
 	additive(additive_), coarsesolverconverged(true),
 	coarseSmoother_(), verbosity_(criterion.debugLevel())
@@ -337,6 +578,7 @@ namespace Dune
       
       // build the necessary smoother hierarchies
       matrices_->coarsenSmoother(smoothers_, smootherArgs_);
+      createCoarseSolver();
 
       if(verbosity_>0 && matrices_->parallelInformation().finest()->communicator().rank()==0)
 	std::cout<<"Building Hierarchy of "<<matrices_->maxlevels()<<" levels took "<<watch.elapsed()<<" seconds."<<std::endl;
@@ -349,8 +591,11 @@ namespace Dune
                          const SmootherArgs& smootherArgs,
 			const PI& pinfo)
       : smootherArgs_(smootherArgs),
-	smoothers_(), solver_(), scalarProduct_(0), 
-        gamma_(criterion.getGamma()), preSteps_(criterion.getNoPreSmoothSteps()), 
+	smoothers_(), solver_(), directSolver_(0), rhs_(0), lhs_(0), update_(0), scalarProduct_(0),
+        gamma_(criterion.getGamma()), cycle_(criterion.getCycleType()),
+        kCycleInterval_(criterion.getKCycleInterval()), kCycleTolerance_(criterion.getKCycleTolerance()),
+        coarseSolverSetupTime_(0), coarseSolverSetups_(0),
+        preSteps_(criterion.getNoPreSmoothSteps()), 
         postSteps_(criterion.getNoPostSmoothSteps()), buildHierarchy_(true),
 	additive(criterion.getAdditive()), coarsesolverconverged(true),
 	coarseSmoother_(), verbosity_(criterion.debugLevel())
@@ -367,19 +612,36 @@ namespace Dune
       
       // build the necessary smoother hierarchies
       matrices_->coarsenSmoother(smoothers_, smootherArgs_);
+      createCoarseSolver();
 
       if(verbosity_>0 && matrices_->parallelInformation().finest()->communicator().rank()==0)
 	std::cout<<"Building Hierarchy of "<<matrices_->maxlevels()<<" levels took "<<watch.elapsed()<<" seconds."<<std::endl;
     }
     
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::recalculateHierarchy()
+    {
+      Timer watch;
+      matrices_->recalculateGalerkin(NegateSet<typename PI::OwnerSet>());
+
+      // The smoothers may store data computed from the old matrices.
+      smoothers_.clear();
+      matrices_->coarsenSmoother(smoothers_, smootherArgs_);
+      if(buildHierarchy_)
+        refactorCoarseSolver();
+
+      if(verbosity_>0 && matrices_->parallelInformation().finest()->communicator().rank()==0)
+	std::cout<<"Recalculating hierarchy of "<<matrices_->maxlevels()<<" levels took "<<watch.elapsed()<<" seconds."<<std::endl;
+    }
+
     template<class M, class X, class S, class PI, class A>
     AMG<M,X,S,PI,A>::~AMG()
     {
+      deleteVectors();
       if(buildHierarchy_){
+        deleteCoarseSolver();
 	delete matrices_;
       }
-      if(scalarProduct_)
-	delete scalarProduct_;
     }
 
     
@@ -420,15 +682,13 @@ namespace Dune
       else
 	// No smoother to make x consistent! Do it by hand
 	matrices_->parallelInformation().coarsest()->copyOwnerToAll(x,x);
-      Range* copy = new Range(b);
-      rhs_ = new Hierarchy<Range,A>(*copy);
-      Domain* dcopy = new Domain(x);
-      lhs_ = new Hierarchy<Domain,A>(*dcopy);
-      dcopy = new Domain(x);
-      update_ = new Hierarchy<Domain,A>(*dcopy);
-      matrices_->coarsenVector(*rhs_);
-      matrices_->coarsenVector(*lhs_);
-      matrices_->coarsenVector(*update_);
+      if(vectorsFitHierarchy(b)){
+        // Reuse the work vectors of the last solve.
+        resetVectors(*rhs_, b);
+        resetVectors(*lhs_, x);
+        resetVectors(*update_, x);
+      }else
+        allocateVectors(x, b);
       
       // Preprocess all smoothers
       typedef typename Hierarchy<Smoother,A>::Iterator Iterator;
@@ -455,9 +715,13 @@ namespace Dune
       // copy the changes to the original vectors.
       x = *lhs_->finest();
       b = *rhs_->finest();
-      
-      if(buildHierarchy_ && matrices_->levels()==matrices_->maxlevels()){
+    }
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::createCoarseSolver()
+    {
+      if(matrices_->levels()==matrices_->maxlevels()){
 	// We have the carsest level. Create the coarse Solver
+	Timer watch;
 	SmootherArgs sargs(smootherArgs_);
 	sargs.iterations = 1;
 	
@@ -478,25 +742,28 @@ namespace Dune
 	  scalarProduct_ = ScalarProductChooser::construct(*matrices_->parallelInformation().coarsest());
 	}
 #if HAVE_SUPERLU
-      // Use superlu if we are purely sequential or with only one processor on the coarsest level.
+	const char* directSolverName = "superlu";
+#else
+	const char* directSolverName = "the built-in sparse LU";
+#endif
+      // Use a direct solver if we are purely sequential or with only one processor on the coarsest level.
 	if(is_same<ParallelInformation,SequentialInformation>::value // sequential mode 
 	   || matrices_->parallelInformation().coarsest()->communicator().size()==1 //parallel mode and only one processor
 	   || (matrices_->parallelInformation().coarsest().isRedistributed() 
 	       && matrices_->parallelInformation().coarsest().getRedistributed().communicator().size()==1
 	       && matrices_->parallelInformation().coarsest().getRedistributed().communicator().size()>0)){ // redistribute and 1 proc
 	  if(verbosity_>0 && matrices_->parallelInformation().coarsest()->communicator().rank()==0)
-	  std::cout<<"Using superlu"<<std::endl;
+	  std::cout<<"Using "<<directSolverName<<std::endl;
 	  if(matrices_->parallelInformation().coarsest().isRedistributed())
 	    {
 	      if(matrices_->matrices().coarsest().getRedistributed().getmat().N()>0)
 		// We are still participating on this level
-		solver_  = new SuperLU<typename M::matrix_type>(matrices_->matrices().coarsest().getRedistributed().getmat());
+		solver_ = directSolver_ = new DirectSolver(matrices_->matrices().coarsest().getRedistributed().getmat());
 	      else
 		solver_ = 0;
 	    }else
-	      solver_  = new SuperLU<typename M::matrix_type>(matrices_->matrices().coarsest()->getmat());
+	      solver_ = directSolver_ = new DirectSolver(matrices_->matrices().coarsest()->getmat());
 	}else
-#endif
 	  {
 	    if(matrices_->parallelInformation().coarsest().isRedistributed())
 	      {
@@ -512,8 +779,47 @@ namespace Dune
 					      *scalarProduct_, 
 					      *coarseSmoother_, 1E-2, 1000, 0);
 	  }
+	coarseSolverSetupTime_ = watch.elapsed();
+	++coarseSolverSetups_;
+      }
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::refactorCoarseSolver()
+    {
+      if(directSolver_){
+        // The pattern of the coarsest matrix is kept, only the factors change.
+        Timer watch;
+        const typename M::matrix_type& mat = matrices_->parallelInformation().coarsest().isRedistributed()
+          ? matrices_->matrices().coarsest().getRedistributed().getmat()
+          : matrices_->matrices().coarsest()->getmat();
+#if HAVE_SUPERLU
+        directSolver_->setMatrix(mat);
+#else
+        directSolver_->refactor(mat);
+#endif
+        coarseSolverSetupTime_ = watch.elapsed();
+        ++coarseSolverSetups_;
+      }else{
+        // The coarse smoother depends on the old matrix.
+        deleteCoarseSolver();
+        createCoarseSolver();
       }
     }
+
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::deleteCoarseSolver()
+    {
+      delete solver_;
+      solver_ = 0;
+      directSolver_ = 0;
+      if(coarseSmoother_)
+	ConstructionTraits<Smoother>::deconstruct(coarseSmoother_);
+      coarseSmoother_ = 0;
+      delete scalarProduct_;
+      scalarProduct_ = 0;
+    }
+
     template<class M, class X, class S, class PI, class A>
     std::size_t AMG<M,X,S,PI,A>::levels()
     {
@@ -543,7 +849,7 @@ namespace Dune
 	*update=0;
 	level=0;
 		  
-	mgc();
+	mgc(cycle_);
 	
 	if(postSteps_==0||matrices_->maxlevels()==1)
 	  pinfo->copyOwnerToAll(*update, *update);
@@ -565,6 +871,7 @@ namespace Dune
       lhs = lhs_->finest();
       update = update_->finest();
       rhs = rhs_->finest();
+      level = 0;
     }
     
     template<class M, class X, class S, class PI, class A>
@@ -573,6 +880,7 @@ namespace Dune
     {
       
       bool processNextLevel=true;
+      Timer watch;
       
       if(redist->isSetup()){
         redist->redistribute(static_cast<const Range&>(*rhs), rhs.getRedistributed());
@@ -588,9 +896,13 @@ namespace Dune
         //restrict defect to coarse level right hand side.
         typename Hierarchy<Range,A>::Iterator fineRhs = rhs++;
 	  ++pinfo;
-	  Transfer<typename OperatorHierarchy::AggregatesMap::AggregateDescriptor,Range,ParallelInformation>
-	    ::restrict(*(*aggregates), *rhs, static_cast<const Range&>(*fineRhs), *pinfo);
+	  if(const typename OperatorHierarchy::SmoothedTransferType* transfer = matrices_->smoothedTransfer(level))
+	    transfer->restrict(*rhs, static_cast<const Range&>(*fineRhs));
+	  else
+	    Transfer<typename OperatorHierarchy::AggregatesMap::AggregateDescriptor,Range,ParallelInformation>
+	      ::restrict(*(*aggregates), *rhs, static_cast<const Range&>(*fineRhs), *pinfo);
       }
+      work_[level].restrictionTime += watch.elapsed();
       
       if(processNextLevel){
         // prepare coarse system
@@ -630,6 +942,7 @@ namespace Dune
         --lhs;  
         --pinfo;
       }
+      Timer watch;
       if(redist->isSetup()){
         // Need to redistribute during prolongate
         lhs.getRedistributed()=0;
@@ -638,9 +951,13 @@ namespace Dune
                        *pinfo, *redist);
       }else{
         *lhs=0;
-        Transfer<typename OperatorHierarchy::AggregatesMap::AggregateDescriptor,Range,ParallelInformation>
-          ::prolongate(*(*aggregates), *update, *lhs, 
-                       matrices_->getProlongationDampingFactor(), *pinfo);
+        if(const typename OperatorHierarchy::SmoothedTransferType* transfer = matrices_->smoothedTransfer(level))
+          // the smoothed prolongation needs no damping
+          transfer->prolongate(*update, *lhs, 1);
+        else
+          Transfer<typename OperatorHierarchy::AggregatesMap::AggregateDescriptor,Range,ParallelInformation>
+            ::prolongate(*(*aggregates), *update, *lhs, 
+                         matrices_->getProlongationDampingFactor(), *pinfo);
       }
       
       
@@ -650,6 +967,7 @@ namespace Dune
       }
       
       *update += *lhs;
+      work_[level].prolongationTime += watch.elapsed();
     }
     
     
@@ -658,6 +976,9 @@ namespace Dune
     ::presmooth()
     {
       
+      Timer watch;
+      work_[level].smoothingSteps += preSteps_;
+      work_[level].operatorApplications += preSteps_;
       for(std::size_t i=0; i < preSteps_; ++i){
 	    *lhs=0;
 	    SmootherApplier<S>::preSmooth(*smoother, *lhs, *rhs);
@@ -668,6 +989,7 @@ namespace Dune
 	    matrix->applyscaleadd(-1,static_cast<const Domain&>(*lhs), *rhs);
 	    pinfo->project(*rhs);
           }
+      work_[level].smoothingTime += watch.elapsed();
     }
     
      template<class M, class X, class S, class PI, class A>
@@ -675,6 +997,9 @@ namespace Dune
      ::postsmooth()
     { 
       
+	Timer watch;
+	work_[level].smoothingSteps += postSteps_;
+	work_[level].operatorApplications += postSteps_;
 	for(std::size_t i=0; i < postSteps_; ++i){
 	  // update defect
 	  matrix->applyscaleadd(-1,static_cast<const Domain&>(*lhs), *rhs);
@@ -684,6 +1009,7 @@ namespace Dune
 	  // Accumulate update
 	  *update += *lhs;
         }
+	work_[level].smoothingTime += watch.elapsed();
     }
     
     
@@ -694,9 +1020,12 @@ namespace Dune
     }
     
     template<class M, class X, class S, class PI, class A>
-    void AMG<M,X,S,PI,A>::mgc(){
+    void AMG<M,X,S,PI,A>::mgc(CycleType cycle){
+      ++work_[level].visits;
       if(matrix == matrices_->matrices().coarsest() && levels()==maxlevels()){
 	// Solve directly
+	Timer watch;
+	++work_[level].coarseSolves;
 	InverseOperatorResult res;
 	res.converged=true; // If we do not compute this flag will not get updated
 	if(redist->isSetup()){
@@ -712,6 +1041,7 @@ namespace Dune
 	  pinfo->copyOwnerToAll(*rhs, *rhs);
 	  solver_->apply(*update, *rhs, res);
 	}
+	work_[level].coarseSolveTime += watch.elapsed();
 
 	if (!res.converged)
 	  coarsesolverconverged = false;
@@ -722,11 +1052,9 @@ namespace Dune
 #ifndef DUNE_AMG_NO_COARSEGRIDCORRECTION
         bool processNextLevel = moveToCoarseLevel();
         
-        if(processNextLevel){
+        if(processNextLevel)
           // next level
-	  for(std::size_t i=0; i<gamma_; i++)
-	    mgc();
-        }
+          coarseGridCorrection(cycle);
         
         moveToFineLevel(processNextLevel);
 #else
@@ -744,6 +1072,96 @@ namespace Dune
       }
     }
 
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::coarseGridCorrection(CycleType cycle)
+    {
+      if(matrix == matrices_->matrices().coarsest() && levels()==maxlevels()){
+        // repeating the coarse solve does not improve the correction
+        mgc(cycle);
+        return;
+      }
+      switch(cycle){
+      case kCycle:
+        if(level%kCycleInterval_==0 && level<krylovLevels_.size() && krylovLevels_[level])
+          krylovCorrection();
+        else
+          mgc(kCycle);
+        break;
+      case fCycle:
+        mgc(fCycle);
+        updateDefect();
+        mgc(vCycle);
+        break;
+      case vCycle:
+        mgc(vCycle);
+        break;
+      default:
+        for(std::size_t i=0; i<gamma_; i++){
+          if(i>0)
+            updateDefect();
+          mgc(cycle);
+        }
+      }
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::updateDefect()
+    {
+      // Only the correction of the last smoothing step (or the
+      // prolongated one without postsmoothing) is missing in the defect.
+      ++work_[level].operatorApplications;
+      matrix->applyscaleadd(-1,static_cast<const Domain&>(*lhs), *rhs);
+      pinfo->project(*rhs);
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::krylovCorrection()
+    {
+      typedef typename Domain::field_type field_type;
+      KrylovLevel& krylov = *krylovLevels_[level];
+      Domain& r = krylov.defect;
+      Domain& c = krylov.correction;
+      Range& v = krylov.product;
+      ScalarProduct& sp = *krylov.scalarProduct;
+
+      // first step
+      r = *rhs;
+      mgc(kCycle);
+      c = *update;
+      matrix->apply(c, v);
+      pinfo->project(v);
+      work_[level].operatorApplications += 1;
+      const field_type rho1 = sp.dot(c, v), alpha1 = sp.dot(c, r);
+      const double defect = sp.norm(r);
+      if(rho1==field_type(0)){
+        *update = 0;
+        return;
+      }
+      r.axpy(-alpha1/rho1, v);
+      if(sp.norm(r) <= kCycleTolerance_*defect){
+        *update = c;
+        *update *= alpha1/rho1;
+        return;
+      }
+
+      // second step, orthogonalized against the first one
+      *rhs = r;
+      *update = 0;
+      mgc(kCycle);
+      matrix->apply(*update, v);
+      pinfo->project(v);
+      work_[level].operatorApplications += 1;
+      const field_type gamma = sp.dot(c, v), beta = sp.dot(*update, v), alpha2 = sp.dot(*update, r);
+      const field_type rho2 = beta - gamma*gamma/rho1;
+      if(rho2==field_type(0)){
+        *update = c;
+        *update *= alpha1/rho1;
+        return;
+      }
+      *update *= alpha2/rho2;
+      update->axpy(alpha1/rho1 - gamma*alpha2/(rho1*rho2), c);
+    }
+
     template<class M, class X, class S, class PI, class A>
     void AMG<M,X,S,PI,A>::additiveMgc(){
       
@@ -752,11 +1170,18 @@ namespace Dune
       typename Hierarchy<Range,A>::Iterator rhs=rhs_->finest();      
       typename Hierarchy<Domain,A>::Iterator lhs = lhs_->finest();
       typename OperatorHierarchy::AggregatesMapList::const_iterator aggregates=matrices_->aggregatesMaps().begin();
+      std::size_t level=0;
+      Timer watch;
       
-      for(typename Hierarchy<Range,A>::Iterator fineRhs=rhs++; fineRhs != rhs_->coarsest(); fineRhs=rhs++, ++aggregates){
+      for(typename Hierarchy<Range,A>::Iterator fineRhs=rhs++; fineRhs != rhs_->coarsest(); fineRhs=rhs++, ++aggregates, ++level){
+	watch.reset();
 	++pinfo;
-	Transfer<typename OperatorHierarchy::AggregatesMap::AggregateDescriptor,Range,ParallelInformation>
-	  ::restrict(*(*aggregates), *rhs, static_cast<const Range&>(*fineRhs), *pinfo);
+	if(const typename OperatorHierarchy::SmoothedTransferType* transfer = matrices_->smoothedTransfer(level))
+	  transfer->restrict(*rhs, static_cast<const Range&>(*fineRhs));
+	else
+	  Transfer<typename OperatorHierarchy::AggregatesMap::AggregateDescriptor,Range,ParallelInformation>
+	    ::restrict(*(*aggregates), *rhs, static_cast<const Range&>(*fineRhs), *pinfo);
+	work_[level].restrictionTime += watch.elapsed();
       }
       
       // pinfo is invalid, set to coarsest level
@@ -765,17 +1190,28 @@ namespace Dune
       lhs = lhs_->finest();
       typename Hierarchy<Smoother,A>::Iterator smoother = smoothers_.finest();
       
-      for(rhs=rhs_->finest(); rhs != rhs_->coarsest(); ++lhs, ++rhs, ++smoother){
+      for(std::size_t l=0; l < level; ++l){
+	++work_[l].visits;
+	++work_[l].smoothingSteps;
+      }
+      ++work_[level].visits;
+      std::size_t l=0;
+      for(rhs=rhs_->finest(); rhs != rhs_->coarsest(); ++lhs, ++rhs, ++smoother, ++l){
 	// presmoothing
+	watch.reset();
 	*lhs=0;
 	smoother->apply(*lhs, *rhs);
+	work_[l].smoothingTime += watch.elapsed();
       }
       
       // Coarse level solve
 #ifndef DUNE_AMG_NO_COARSEGRIDCORRECTION 
+      watch.reset();
+      ++work_[level].coarseSolves;
       InverseOperatorResult res;
       pinfo->copyOwnerToAll(*rhs, *rhs);
       solver_->apply(*lhs, *rhs, res);
+      work_[level].coarseSolveTime += watch.elapsed();
       
       if(!res.converged)
 	DUNE_THROW(MathError, "Coarse solver did not converge");
@@ -785,10 +1221,16 @@ namespace Dune
       // Prologate and add up corrections from all levels
       --pinfo;
       --aggregates;
+      --level;
       
-      for(typename Hierarchy<Domain,A>::Iterator coarseLhs = lhs--; coarseLhs != lhs_->finest(); coarseLhs = lhs--, --aggregates, --pinfo){
-	Transfer<typename OperatorHierarchy::AggregatesMap::AggregateDescriptor,Range,ParallelInformation>
-	  ::prolongate(*(*aggregates), *coarseLhs, *lhs, 1, *pinfo);
+      for(typename Hierarchy<Domain,A>::Iterator coarseLhs = lhs--; coarseLhs != lhs_->finest(); coarseLhs = lhs--, --aggregates, --pinfo, --level){
+	watch.reset();
+	if(const typename OperatorHierarchy::SmoothedTransferType* transfer = matrices_->smoothedTransfer(level))
+	  transfer->prolongate(*coarseLhs, *lhs, 1);
+	else
+	  Transfer<typename OperatorHierarchy::AggregatesMap::AggregateDescriptor,Range,ParallelInformation>
+	    ::prolongate(*(*aggregates), *coarseLhs, *lhs, 1, *pinfo);
+	work_[level].prolongationTime += watch.elapsed();
       }
     }
 
@@ -797,13 +1239,6 @@ namespace Dune
     template<class M, class X, class S, class PI, class A>
     void AMG<M,X,S,PI,A>::post(Domain& x)
     {
-      if(buildHierarchy_){
-	if(solver_)
-	  delete solver_;
-	if(coarseSmoother_)
-	  ConstructionTraits<Smoother>::deconstruct(coarseSmoother_);
-      }
-      
       // Postprocess all smoothers
       typedef typename Hierarchy<Smoother,A>::Iterator Iterator;
       typedef typename Hierarchy<Range,A>::Iterator RIterator;
@@ -819,13 +1254,240 @@ namespace Dune
 	    smoother->post(*lhs);
 	smoother->post(*lhs);
       }
+    }
 
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::allocateVectors(const Domain& x, const Range& b)
+    {
+      deleteVectors();
+      Range* copy = new Range(b);
+      rhs_ = new Hierarchy<Range,A>(*copy);
+      Domain* dcopy = new Domain(x);
+      lhs_ = new Hierarchy<Domain,A>(*dcopy);
+      dcopy = new Domain(x);
+      update_ = new Hierarchy<Domain,A>(*dcopy);
+      matrices_->coarsenVector(*rhs_);
+      matrices_->coarsenVector(*lhs_);
+      matrices_->coarsenVector(*update_);
+      work_.resize(matrices_->levels());
+
+      if(cycle_==kCycle && !additive){
+        // the Krylov acceleration works on the coarse levels
+        typedef typename Hierarchy<Domain,A>::ConstIterator Iterator;
+        typedef typename ParallelInformationHierarchy::ConstIterator InfoIterator;
+        const ParallelInformationHierarchy& infos = matrices_->parallelInformation();
+        InfoIterator info = infos.finest();
+        Iterator vector = lhs_->finest();
+        krylovLevels_.push_back(0);
+        while(vector != lhs_->coarsest() && info != infos.coarsest()){
+          ++vector;
+          ++info;
+          krylovLevels_.push_back(new KrylovLevel(vector->N(), *info));
+        }
+      }
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::deleteVectors()
+    {
+      if(!rhs_)
+        return;
+      for(typename std::vector<KrylovLevel*>::iterator krylov = krylovLevels_.begin();
+          krylov != krylovLevels_.end(); ++krylov)
+        delete *krylov;
+      krylovLevels_.clear();
+      // The hierarchies do not own the vectors of the finest level.
       delete &(*lhs_->finest());
       delete lhs_;
       delete &(*update_->finest());
       delete update_;
       delete &(*rhs_->finest());
       delete rhs_;
+      rhs_ = 0;
+      lhs_ = update_ = 0;
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    bool AMG<M,X,S,PI,A>::vectorsFitHierarchy(const Range& b) const
+    {
+      if(!rhs_ || rhs_->finest()->N()!=b.N()
+         || rhs_->levels()!=matrices_->matrices().levels())
+        return false;
+      // The hierarchy may have been built anew with other coarse levels.
+      typedef typename OperatorHierarchy::ParallelMatrixHierarchy::ConstIterator MatrixIterator;
+      typedef typename Hierarchy<Range,A>::ConstIterator VectorIterator;
+      MatrixIterator matrix = matrices_->matrices().finest();
+      VectorIterator vector = rhs_->finest();
+      for(;; ++matrix, ++vector){
+        if(vector->N()!=matrix->getmat().N()
+           || matrix.isRedistributed()!=vector.isRedistributed()
+           || (matrix.isRedistributed()
+               && vector.getRedistributed().N()!=matrix.getRedistributed().getmat().N()))
+          return false;
+        if(matrix==matrices_->matrices().coarsest())
+          return true;
+      }
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    template<class V>
+    void AMG<M,X,S,PI,A>::resetVectors(Hierarchy<V,A>& vectors, const V& fine)
+    {
+      typedef typename Hierarchy<V,A>::Iterator Iterator;
+      Iterator coarsest = vectors.coarsest();
+      Iterator level = vectors.finest();
+      *level = fine;
+      for(bool finest=true;; ++level, finest=false){
+        if(!finest)
+          *level = 0;
+        if(level.isRedistributed())
+          level.getRedistributed() = 0;
+        if(level==coarsest)
+          break;
+      }
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    template<class V>
+    std::size_t AMG<M,X,S,PI,A>::memory(const Hierarchy<V,A>& vectors, std::size_t level)
+    {
+      typedef typename Hierarchy<V,A>::ConstIterator Iterator;
+      Iterator vector = vectors.finest();
+      for(std::size_t l=0; l<level; ++l)
+        ++vector;
+      std::size_t size = vector->N();
+      if(vector.isRedistributed())
+        size += vector.getRedistributed().N();
+      return size*sizeof(typename V::block_type);
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    std::vector<typename AMG<M,X,S,PI,A>::LevelStatistics> AMG<M,X,S,PI,A>::levelStatistics() const
+    {
+      typedef typename M::matrix_type Matrix;
+      typedef typename OperatorHierarchy::ParallelMatrixHierarchy::ConstIterator Iterator;
+      typedef typename OperatorHierarchy::LevelSetupTimes SetupTimes;
+      const typename OperatorHierarchy::ParallelMatrixHierarchy& matrices = matrices_->matrices();
+      const std::vector<SetupTimes>& setupTimes = matrices_->setupTimes();
+
+      std::vector<LevelStatistics> statistics(matrices.levels());
+      std::size_t level = 0;
+      for(Iterator matrix = matrices.finest();; ++matrix, ++level){
+        LevelStatistics& stats = statistics[level];
+        const Matrix& mat = matrix->getmat();
+        // nonzeroes() is not set for matrices built row wise
+        stats.nonzeros = 0;
+        for(typename Matrix::ConstRowIterator row=mat.begin(); row!=mat.end(); ++row)
+          stats.nonzeros += row->getsize();
+        stats.unknowns = mat.N();
+        stats.matrixMemory = mat.N()*sizeof(typename Matrix::row_type)
+          + stats.nonzeros*(sizeof(typename Matrix::block_type)+sizeof(typename Matrix::size_type));
+        const typename OperatorHierarchy::SmoothedTransferType* transfer = matrices_->smoothedTransfer(level);
+        // P, R and AP of smoothed aggregation
+        stats.transferMemory = transfer ? transfer->memory() : 0;
+        stats.vectorMemory = 0;
+        if(rhs_ && level<rhs_->levels())
+          stats.vectorMemory = memory(*rhs_, level)+memory(*lhs_, level)+memory(*update_, level);
+
+        const SetupTimes times = level<setupTimes.size() ? setupTimes[level] : SetupTimes();
+        stats.aggregationTime = times.aggregation;
+        stats.galerkinTime = times.galerkin;
+        stats.smootherSetupTime = times.smoother;
+        stats.coarseSolverSetupTime = matrix==matrices.coarsest() ? coarseSolverSetupTime_ : 0;
+        stats.coarseSolverSetups = matrix==matrices.coarsest() ? coarseSolverSetups_ : 0;
+        if(level<work_.size())
+          stats.work = work_[level];
+        if(matrix==matrices.coarsest())
+          break;
+      }
+      return statistics;
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::printMemoryFootprint(std::ostream& os) const
+    {
+      std::vector<LevelStatistics> statistics = levelStatistics();
+      std::size_t totalMatrix = 0, totalVectors = 0;
+      for(std::size_t level=0; level < statistics.size(); ++level){
+        const LevelStatistics& stats = statistics[level];
+        os<<"Level "<<level<<": "<<stats.unknowns<<" unknowns, matrix "<<stats.matrixMemory
+          <<" bytes, vectors "<<stats.vectorMemory<<" bytes";
+        if(stats.transferMemory>0)
+          os<<", transfer "<<stats.transferMemory<<" bytes";
+        os<<std::endl;
+        totalMatrix += stats.matrixMemory+stats.transferMemory;
+        totalVectors += stats.vectorMemory;
+      }
+      os<<"Total: matrices "<<totalMatrix<<" bytes, vectors "<<totalVectors
+        <<" bytes"<<std::endl;
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::printStatistics(std::ostream& os) const
+    {
+      std::vector<LevelStatistics> statistics = levelStatistics();
+      double setup = 0, applied = 0;
+      std::size_t bytes = 0;
+      os<<"{\n  \"levels\": [";
+      for(std::size_t level=0; level < statistics.size(); ++level){
+        const LevelStatistics& stats = statistics[level];
+        const LevelWork& work = stats.work;
+        setup += stats.aggregationTime+stats.galerkinTime+stats.smootherSetupTime
+          +stats.coarseSolverSetupTime;
+        applied += work.smoothingTime+work.restrictionTime+work.prolongationTime
+          +work.coarseSolveTime;
+        bytes += stats.matrixMemory+stats.transferMemory+stats.vectorMemory;
+        os<<(level>0 ? "," : "")<<"\n    {\"level\": "<<level
+          <<", \"unknowns\": "<<stats.unknowns<<", \"nonzeros\": "<<stats.nonzeros
+          <<",\n     \"setup\": {\"aggregation\": "<<stats.aggregationTime
+          <<", \"galerkin\": "<<stats.galerkinTime
+          <<", \"smoother\": "<<stats.smootherSetupTime
+          <<", \"coarseSolver\": "<<stats.coarseSolverSetupTime
+          <<", \"coarseSolverSetups\": "<<stats.coarseSolverSetups<<"}"
+          <<",\n     \"apply\": {\"visits\": "<<work.visits
+          <<", \"smoothingSteps\": "<<work.smoothingSteps
+          <<", \"operatorApplications\": "<<work.operatorApplications
+          <<", \"coarseSolves\": "<<work.coarseSolves
+          <<", \"smoothing\": "<<work.smoothingTime
+          <<", \"restriction\": "<<work.restrictionTime
+          <<", \"prolongation\": "<<work.prolongationTime
+          <<", \"coarseSolve\": "<<work.coarseSolveTime<<"}"
+          <<",\n     \"memory\": {\"matrix\": "<<stats.matrixMemory
+          <<", \"transfer\": "<<stats.transferMemory
+          <<", \"vectors\": "<<stats.vectorMemory<<"}}";
+      }
+      os<<"\n  ],\n  \"total\": {\"setup\": "<<setup<<", \"apply\": "<<applied
+        <<", \"memory\": "<<bytes<<"}\n}"<<std::endl;
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::resetLevelWork()
+    {
+      std::fill(work_.begin(), work_.end(), LevelWork());
+    }
+
+    template<class M, class X, class S, class PI, class A>
+    void AMG<M,X,S,PI,A>::printLevelWork(std::ostream& os) const
+    {
+      typedef typename M::matrix_type Matrix;
+      typedef typename OperatorHierarchy::ParallelMatrixHierarchy::ConstIterator Iterator;
+      Iterator matrix = matrices_->matrices().finest();
+      double fineNonzeros = 0, total = 0;
+      for(std::size_t level=0; level < work_.size(); ++level, ++matrix){
+        const Matrix& mat = matrix->getmat();
+        double nonzeros = 0;
+        for(typename Matrix::ConstRowIterator row=mat.begin(); row!=mat.end(); ++row)
+          nonzeros += row->getsize();
+        if(level==0)
+          fineNonzeros = nonzeros;
+        const LevelWork& work = work_[level];
+        const double sweeps = (work.smoothingSteps+work.operatorApplications)*nonzeros/fineNonzeros;
+        total += sweeps;
+        os<<"Level "<<level<<": "<<work.visits<<" visits, "<<work.smoothingSteps
+          <<" smoothing steps, "<<work.operatorApplications<<" operator applications, "
+          <<work.coarseSolves<<" coarse solves, "<<sweeps<<" fine level sweeps"<<std::endl;
+      }
+      os<<"Total: "<<total<<" fine level sweeps"<<std::endl;
     }
 
     template<class M, class X, class S, class PI, class A>
@@ -8,7 +8,9 @@
 #include"pinfo.hh"
 #include<dune/common/poolallocator.hh>
 #include<dune/common/enumset.hh>
+#include<dune/istl/threading.hh>
 #include<set>
+#include<vector>
 #include<limits>
 #include<algorithm>
 
@@ -94,6 +96,106 @@ namespace Dune
 #endif
       };
 
+    /**
+     * @brief Precomputed mapping of the fine matrix entries onto the
+     * entries of the coarse matrix of a Galerkin product.
+     *
+     * build() records for each fine entry its position within the coarse
+     * row it is added to and groups the fine rows by aggregate. apply()
+     * then computes the coarse values without any searching, each thread
+     * summing the fine rows of a block of coarse rows. The entries are
+     * added in the same order as in BaseGalerkinProduct::calculate, so the
+     * results agree exactly. The plan stays valid as long as the sparsity
+     * patterns and the aggregates do not change.
+     */
+    template<class M>
+    class GalerkinPlan
+    {
+    public:
+      /** @brief The type of the matrices. */
+      typedef M Matrix;
+      /** @brief The type of the indices. */
+      typedef typename M::size_type size_type;
+
+      /**
+       * @brief Record the mapping of the fine onto the coarse entries.
+       * @param fine The fine matrix.
+       * @param aggregates The aggregate mapping.
+       * @param coarse The coarse matrix with its final sparsity pattern.
+       */
+      template<class V>
+      void build(const Matrix& fine, const AggregatesMap<V>& aggregates, const Matrix& coarse);
+
+      /**
+       * @brief Compute the values of the coarse matrix.
+       * @param fine The fine matrix.
+       * @param coarse The coarse matrix.
+       */
+      void apply(const Matrix& fine, Matrix& coarse) const;
+
+      /** @brief The number of bytes allocated by the plan. */
+      std::size_t memory() const;
+
+    private:
+      /** @brief Fills the positions of some fine rows, used with parallelFor(). */
+      template<class V>
+      class BuildKernel
+      {
+      public:
+        BuildKernel(GalerkinPlan<M>& plan, const Matrix& fine, const AggregatesMap<V>& aggregates,
+                    const Matrix& coarse, const RowPartition& partition)
+          : plan_(plan), fine_(fine), aggregates_(aggregates), coarse_(coarse), partition_(partition)
+        {}
+
+        void operator()(int part) const;
+
+      private:
+        GalerkinPlan<M>& plan_;
+        const Matrix& fine_;
+        const AggregatesMap<V>& aggregates_;
+        const Matrix& coarse_;
+        const RowPartition& partition_;
+      };
+
+      /** @brief Computes some coarse rows, used with parallelFor(). */
+      class ApplyKernel
+      {
+      public:
+        ApplyKernel(const GalerkinPlan<M>& plan, const Matrix& fine, Matrix& coarse,
+                    const RowPartition& partition)
+          : plan_(plan), fine_(fine), coarse_(coarse), partition_(partition)
+        {}
+
+        void operator()(int part) const;
+
+      private:
+        const GalerkinPlan<M>& plan_;
+        const Matrix& fine_;
+        Matrix& coarse_;
+        const RowPartition& partition_;
+      };
+
+      template<class V> friend class BuildKernel;
+      friend class ApplyKernel;
+
+      /** @brief The position of entries not added to the coarse matrix. */
+      static unsigned int skip()
+      {
+        return std::numeric_limits<unsigned int>::max();
+      }
+
+      /** @brief The fine rows of each aggregate start at fineRows_[aggregateStart_[a]]. */
+      std::vector<size_type> aggregateStart_;
+      /** @brief The fine rows sorted by aggregate. */
+      std::vector<size_type> fineRows_;
+      /** @brief The number of fine entries added to the coarse rows before each coarse row. */
+      std::vector<size_type> work_;
+      /** @brief The positions of row i start at positions_[rowStart_[i]]. */
+      std::vector<size_type> rowStart_;
+      /** @brief The position of each fine entry in its coarse row. */
+      std::vector<unsigned int> positions_;
+    };
+
     class BaseGalerkinProduct
     {
     public:
@@ -108,7 +210,23 @@ namespace Dune
       template<class M, class V, class I, class O>
       void calculate(const M& fine, const AggregatesMap<V>& aggregates, M& coarse,
 		     const I& pinfo, const O& copy);
-      
+
+      /**
+       * @brief Calculate the galerkin product using a precomputed plan.
+       * @param fine The fine matrix.
+       * @param plan The plan built for the fine and the coarse matrix.
+       * @param coarse The coarse Matrix.
+       * @param pinfo Parallel information about the fine level.
+       * @param copy The attribute set identifying the copy nodes of the graph.
+       */
+      template<class M, class I, class O>
+      void calculate(const M& fine, const GalerkinPlan<M>& plan, M& coarse,
+		     const I& pinfo, const O& copy);
+
+    private:
+      /** @brief Get the diagonal values on copy lines from the owner processes. */
+      template<class M, class I>
+      void copyOwnerDiagonal(M& coarse, const I& pinfo);
     };
     
     template<class T>
@@ -659,7 +777,22 @@ namespace Dune
 	    } 
 	}
 
+      copyOwnerDiagonal(coarse, pinfo);
+    }
+
+    template<class M, class I, class O>
+    void BaseGalerkinProduct::calculate(const M& fine, const GalerkinPlan<M>& plan, M& coarse,
+                                        const I& pinfo, const O& copy)
+    {
+      plan.apply(fine, coarse);
+      copyOwnerDiagonal(coarse, pinfo);
+    }
+
+    template<class M, class I>
+    void BaseGalerkinProduct::copyOwnerDiagonal(M& coarse, const I& pinfo)
+    {
       // get the right diagonal matrix values on copy lines from owner processes  
+      typedef typename M::ConstIterator RowIterator;
       typedef typename M::block_type BlockType;
       std::vector<BlockType> rowsize(coarse.N(),BlockType(0));
       for (RowIterator row = coarse.begin(); row != coarse.end(); ++row)
@@ -676,6 +809,108 @@ namespace Dune
     
     }
 
+    template<class M>
+    template<class V>
+    void GalerkinPlan<M>::BuildKernel<V>::operator()(int part) const
+    {
+      for(size_type i=partition_.first(part); i < partition_.last(part); ++i){
+        unsigned int* position = &plan_.positions_[0]+plan_.rowStart_[i];
+        typedef typename Matrix::ConstColIterator ColIterator;
+        const ColIterator end = fine_[i].end();
+
+        if(aggregates_[i]==AggregatesMap<V>::ISOLATED){
+          for(ColIterator col = fine_[i].begin(); col != end; ++col, ++position)
+            *position = skip();
+          continue;
+        }
+        const typename Matrix::row_type& row = coarse_[aggregates_[i]];
+        const size_type* begin = row.getindexptr(), * last = begin+row.getsize();
+        for(ColIterator col = fine_[i].begin(); col != end; ++col, ++position)
+          if(aggregates_[col.index()]==AggregatesMap<V>::ISOLATED)
+            *position = skip();
+          else{
+            const size_type* index = std::lower_bound(begin, last, size_type(aggregates_[col.index()]));
+            assert(index!=last && *index==size_type(aggregates_[col.index()]));
+            *position = index-begin;
+          }
+      }
+    }
+
+    template<class M>
+    template<class V>
+    void GalerkinPlan<M>::build(const Matrix& fine, const AggregatesMap<V>& aggregates, const Matrix& coarse)
+    {
+      const size_type n = fine.N(), nc = coarse.N();
+
+      // group the fine rows by aggregate, keeping them sorted
+      aggregateStart_.assign(nc+1, 0);
+      work_.assign(nc+1, 0);
+      rowStart_.resize(n+1);
+      rowStart_[0] = 0;
+      for(size_type i=0; i < n; ++i){
+        rowStart_[i+1] = rowStart_[i]+fine[i].getsize();
+        if(aggregates[i]!=AggregatesMap<V>::ISOLATED){
+          assert(aggregates[i]!=AggregatesMap<V>::UNAGGREGATED);
+          ++aggregateStart_[aggregates[i]+1];
+          work_[aggregates[i]+1] += fine[i].getsize();
+        }
+      }
+      for(size_type a=0; a < nc; ++a){
+        aggregateStart_[a+1] += aggregateStart_[a];
+        work_[a+1] += work_[a];
+      }
+      fineRows_.resize(aggregateStart_[nc]);
+      std::vector<size_type> next(aggregateStart_.begin(), aggregateStart_.end()-1);
+      for(size_type i=0; i < n; ++i)
+        if(aggregates[i]!=AggregatesMap<V>::ISOLATED)
+          fineRows_[next[aggregates[i]]++] = i;
+
+      positions_.resize(rowStart_[n]);
+      RowPartition partition;
+      partition.buildFromOffsets(rowStart_, ISTLThreading::threadsFor(rowStart_[n]));
+      BuildKernel<V> kernel(*this, fine, aggregates, coarse, partition);
+      parallelFor(partition.parts(), kernel);
+    }
+
+    template<class M>
+    void GalerkinPlan<M>::ApplyKernel::operator()(int part) const
+    {
+      typedef typename Matrix::block_type Block;
+      for(size_type a=partition_.first(part); a < partition_.last(part); ++a){
+        typename Matrix::row_type& row = coarse_[a];
+        Block* coarse = row.getptr();
+        for(size_type j=0; j < row.getsize(); ++j)
+          coarse[j] = static_cast<typename Matrix::field_type>(0);
+
+        for(size_type r=plan_.aggregateStart_[a]; r < plan_.aggregateStart_[a+1]; ++r){
+          const size_type i = plan_.fineRows_[r];
+          const Block* fine = fine_[i].getptr();
+          const unsigned int* position = &plan_.positions_[0]+plan_.rowStart_[i];
+          for(size_type j=0; j < fine_[i].getsize(); ++j)
+            if(position[j]!=skip())
+              coarse[position[j]] += fine[j];
+        }
+      }
+    }
+
+    template<class M>
+    void GalerkinPlan<M>::apply(const Matrix& fine, Matrix& coarse) const
+    {
+      assert(fine.N()+1==rowStart_.size() && coarse.N()+1==aggregateStart_.size());
+      RowPartition partition;
+      partition.buildFromOffsets(work_, ISTLThreading::threadsFor(positions_.size()));
+      ApplyKernel kernel(*this, fine, coarse, partition);
+      parallelFor(partition.parts(), kernel);
+    }
+
+    template<class M>
+    std::size_t GalerkinPlan<M>::memory() const
+    {
+      return (aggregateStart_.capacity()+fineRows_.capacity()+work_.capacity()
+              +rowStart_.capacity())*sizeof(size_type)
+        + positions_.capacity()*sizeof(unsigned int);
+    }
+
     template<class T>
     template<class M, class O>
     void DirichletBoundarySetter<T>::set(M& coarse, const T& pinfo, const O& copy)
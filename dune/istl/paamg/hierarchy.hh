@@ -5,6 +5,7 @@
 #define DUNE_AMGHIERARCHY_HH
 
 #include<list>
+#include<vector>
 #include<memory>
 #include<limits>
 #include<algorithm>
@@ -276,6 +277,14 @@ namespace Dune
        * @return The number of levels.
        */
       std::size_t levels() const;
+
+      /**
+       * @brief Remove all levels.
+       *
+       * The elements we constructed are destroyed, an element given
+       * to the constructor is not.
+       */
+      void clear();
       
       /** @brief Destructor. */
       ~Hierarchy();
@@ -339,6 +348,37 @@ namespace Dune
       /** @brief The type of the list of redistribute information. */
       typedef std::list<RedistributeInfoType,RILAllocator> RedistributeInfoList;
 
+      /** @brief Allocator for GalerkinPlan. */
+      typedef typename Allocator::template rebind<GalerkinPlan<Matrix> >::other GPAllocator;
+
+      /** @brief The type of the list of plans for the Galerkin products. */
+      typedef std::list<GalerkinPlan<Matrix>,GPAllocator> GalerkinPlanList;
+
+      /** @brief The type of the transfer of smoothed aggregation. */
+      typedef SmoothedTransfer<Matrix> SmoothedTransferType;
+
+      /** @brief Allocator for pointers to SmoothedTransferType. */
+      typedef typename Allocator::template rebind<SmoothedTransferType*>::other STAllocator;
+
+      /** @brief The type of the vector of the smoothed aggregation transfers. */
+      typedef std::vector<SmoothedTransferType*,STAllocator> SmoothedTransferVector;
+
+      /**
+       * @brief The seconds spent on setting up one level.
+       */
+      struct LevelSetupTimes
+      {
+        LevelSetupTimes()
+          : aggregation(0), galerkin(0), smoother(0)
+        {}
+        /** @brief Building the graphs and aggregates and coarsening the index sets. */
+        double aggregation;
+        /** @brief Computing the matrix of the next coarser level (and the transfer of smoothed aggregation). */
+        double galerkin;
+        /** @brief Constructing the smoother of the level. */
+        double smoother;
+      };
+
       /**
        * @brief Constructor
        * @param fineMatrix The matrix to coarsen.
@@ -363,7 +403,9 @@ namespace Dune
        *
        * If the data of the fine matrix changes but not its sparsity pattern
        * this will recalculate all coarser levels without starting the expensive
-       * aggregation process all over again.
+       * aggregation process all over again. The plans of the Galerkin
+       * products recorded during build() are reused. With smoothed
+       * aggregation the transfer operators are recomputed, too.
        */
       template<class F>
       void recalculateGalerkin(const F& copyFlags);
@@ -428,6 +470,28 @@ namespace Dune
        * data to fewer processes.
        */
       const RedistributeInfoList& redistributeInformation() const;
+
+      /**
+       * @brief Get the smoothed aggregation transfer between a level and the next coarser one.
+       * @param level The level, 0 being the finest.
+       * @return The transfer or 0 if the piecewise constant prolongation is used.
+       */
+      const SmoothedTransferType* smoothedTransfer(std::size_t level) const
+      {
+        return level < smoothedTransfers_.size() ? smoothedTransfers_[level] : 0;
+      }
+
+      /**
+       * @brief Get the setup times of the levels, the finest being the first.
+       *
+       * The times of the Galerkin products are those of the last call of
+       * build() or recalculateGalerkin(), the ones of the smoothers those
+       * of the last call of coarsenSmoother().
+       */
+      const std::vector<LevelSetupTimes>& setupTimes() const
+      {
+        return setupTimes_;
+      }
       
 
       typename MatrixOperator::field_type getProlongationDampingFactor() const
@@ -454,6 +518,12 @@ namespace Dune
       AggregatesMapList aggregatesMaps_;
       /** @brief The list of redistributes. */
       RedistributeInfoList redistributes_;
+      /** @brief The plans of the Galerkin products of the coarse levels. */
+      GalerkinPlanList galerkinPlans_;
+      /** @brief The transfers of smoothed aggregation, empty for piecewise constant prolongation. */
+      SmoothedTransferVector smoothedTransfers_;
+      /** @brief The setup times of the levels, updated by the const coarsenSmoother(). */
+      mutable std::vector<LevelSetupTimes> setupTimes_;
       /** @brief The hierarchy of parallel matrices. */
       ParallelMatrixHierarchy matrices_;
       /** @brief The hierarchy of the parallel information. */
@@ -554,6 +624,47 @@ namespace Dune
       
     };
     
+    /**
+     * @brief The number of processes the coarsest level is accumulated onto.
+     * @param criterion The coarsening criterion.
+     * @return coarseSolveProcesses() for geometricAccu and 1 otherwise.
+     */
+    template<class C>
+    int coarseAccumulationDomains(const C& criterion)
+    {
+      if(criterion.accumulate()==geometricAccu)
+        return std::max(1, criterion.coarseSolveProcesses());
+      return 1;
+    }
+
+    /**
+     * @brief The number of processes a level is redistributed to with geometricAccu.
+     *
+     * The level is redistributed if its unknowns fit onto fewer processes
+     * (each with at least minUnknownsPerProcess() unknowns) by a factor
+     * of processShrinkFactor(). The coarsest level, i.e. a level with at
+     * most coarsenTarget() unknowns, is gathered onto coarseSolveProcesses()
+     * processes.
+     * @param criterion The coarsening criterion.
+     * @param unknowns The global number of unknowns of the level.
+     * @param procs The number of processes the level is distributed on.
+     * @return The number of processes or 0 if the level is not redistributed.
+     */
+    template<class C>
+    std::size_t geometricAccumulationDomains(const C& criterion, double unknowns, std::size_t procs)
+    {
+      const std::size_t coarse = coarseAccumulationDomains(criterion);
+      if(procs <= coarse)
+        return 0;
+      if(unknowns <= criterion.coarsenTarget())
+        return coarse;
+      std::size_t domains = (std::size_t)std::ceil(unknowns/std::max(1, criterion.minUnknownsPerProcess()));
+      domains = std::max(domains, coarse);
+      if(domains*criterion.processShrinkFactor() <= procs)
+        return domains;
+      return 0;
+    }
+
     template<typename M, typename C1>
     bool repartitionAndDistributeMatrix(const M& origMatrix, M& newMatrix, 
 					SequentialInformation& origSequentialInformationomm, 
@@ -634,6 +745,28 @@ namespace Dune
     return true;
   }
 
+  /**
+   * @brief Copy the entries of a matrix to its redistributed counterpart
+   * whose sparsity pattern is already set up.
+   */
+  template<typename M, typename C>
+  void redistributeMatrixAmg(M& origMatrix, M& newMatrix, C& origComm, C& newComm,
+                             RedistributeInformation<C>& ri)
+  {
+    origComm.buildGlobalLookup(origComm.indexSet().size());
+    redistributeMatrixEntries(origMatrix, newMatrix, origComm, newComm, ri);
+    origComm.freeGlobalLookup();
+  }
+
+  template<typename M>
+  void redistributeMatrixAmg(M& origMatrix, M& newMatrix,
+                             SequentialInformation& origComm,
+                             SequentialInformation& newComm,
+                             RedistributeInformation<SequentialInformation>& ri)
+  {
+    DUNE_THROW(NotImplemented, "Redistribution does not make sense in sequential code!");
+  }
+
     template<class M, class IS, class A>
     MatrixHierarchy<M,IS,A>::MatrixHierarchy(const MatrixOperator& fineOperator,
 					     const ParallelInformation& pinfo)
@@ -657,6 +790,9 @@ namespace Dune
     void MatrixHierarchy<M,IS,A>::build(const T& criterion)
     {
       prolongDamp_ = criterion.getProlongationDampingFactor();
+      const bool smoothed = criterion.prolongationType()==smoothedProlongation;
+      if(smoothed && parallelInformation_.finest()->getSolverCategory()!=SolverCategory::sequential)
+        DUNE_THROW(NotImplemented, "Smoothed aggregation is only available for sequential problems");
       typedef O OverlapFlags;
       typedef typename ParallelMatrixHierarchy::Iterator MatIterator;
       typedef typename ParallelInformationHierarchy::Iterator PInfoIterator;
@@ -683,6 +819,7 @@ namespace Dune
       double dunknowns=unknowns.todouble();
       infoLevel->buildGlobalLookup(mlevel->getmat().N());
       redistributes_.push_back(RedistributeInfoType());
+      setupTimes_.assign(1, LevelSetupTimes());
 
       for(; level < criterion.maxLevel(); ++level, ++mlevel){
 	assert(matrices_.levels()==redistributes_.size());
@@ -694,7 +831,11 @@ namespace Dune
 	MatrixOperator* matrix=&(*mlevel);
 	ParallelInformation* info =&(*infoLevel);
 
-	if((
+	std::size_t nodomains = 0;
+	if(criterion.accumulate()==geometricAccu)
+	  nodomains = geometricAccumulationDomains(criterion, dunknowns,
+						   infoLevel->communicator().size());
+	else if((
 #if HAVE_PARMETIS
 	      criterion.accumulate()==successiveAccu
 #else
@@ -705,14 +846,18 @@ namespace Dune
 	   && infoLevel->communicator().size()>1 && 
 	   dunknowns/infoLevel->communicator().size() <= criterion.coarsenTarget())
 	  {
-	    // accumulate to fewer processors
-	    Matrix* redistMat= new Matrix();
-	    ParallelInformation* redistComm=0;
-	    std::size_t nodomains = (std::size_t)std::ceil(dunknowns/(criterion.minAggregateSize()
-                                                                  *criterion.coarsenTarget()));
+	    nodomains = (std::size_t)std::ceil(dunknowns/(criterion.minAggregateSize()
+							  *criterion.coarsenTarget()));
 	    if( nodomains<=criterion.minAggregateSize()/2 || 
                 dunknowns <= criterion.coarsenTarget() )
 	      nodomains=1;
+	  }
+
+	if(nodomains>0)
+	  {
+	    // accumulate to fewer processors
+	    Matrix* redistMat= new Matrix();
+	    ParallelInformation* redistComm=0;
 
 	    bool existentOnNextLevel = 
 	      repartitionAndDistributeMatrix(mlevel->getmat(), *redistMat, *infoLevel,
@@ -752,6 +897,7 @@ namespace Dune
 
 	typedef typename PropertiesGraph::VertexDescriptor Vertex;
 	
+	Timer setupWatch;
 	std::vector<bool> excluded(matrix->getmat().N(), false);
 
 	GraphTuple graphs = GraphCreator::create(*matrix, excluded, *info, OverlapFlags());
@@ -826,6 +972,7 @@ namespace Dune
 
 	if(dgnoAggregates==0 || dunknowns/dgnoAggregates<criterion.minCoarsenRate())
     {
+	    setupTimes_[level].aggregation = setupWatch.elapsed();
 	    if(rank==0)
         {
 	      if(dgnoAggregates>0)
@@ -839,8 +986,10 @@ namespace Dune
 	    delete aggregatesMap;
 	    aggregatesMaps_.pop_back();
 
-            if(criterion.accumulate() && mlevel.isRedistributed() && info->communicator().size()>1){
+            if(criterion.accumulate() && mlevel.isRedistributed()
+               && info->communicator().size()>coarseAccumulationDomains(criterion)){
               // coarse level matrix was already redistributed, but to more than 1 process
+              // (or coarseSolveProcesses() with geometricAccu)
               // Therefore need to delete the redistribution. Further down it will
               // then be redistributed to 1 process
               delete &(mlevel.getRedistributed().getmat());
@@ -890,6 +1039,7 @@ namespace Dune
 	  if(rank==0)
 	    std::cout<<"Communicating global aggregate numbers took "<<watch.elapsed()<<" seconds."<<std::endl;
 	}
+	setupTimes_[level].aggregation = setupWatch.elapsed();
 
 	watch.reset();
 	std::vector<bool>& visited=excluded;
@@ -904,17 +1054,29 @@ namespace Dune
 
 	typename MatrixOperator::matrix_type* coarseMatrix;
 
-	coarseMatrix = productBuilder.build(matrix->getmat(), *(get<0>(graphs)), visitedMap2, 
-					    *info, 
-					    *aggregatesMap,
-					    aggregates,
-					    OverlapFlags());
+	if(smoothed){
+	  coarseMatrix = new Matrix();
+	  smoothedTransfers_.push_back(new SmoothedTransferType());
+	  smoothedTransfers_.back()->build(matrix->getmat(), *aggregatesMap, aggregates, *coarseMatrix,
+					   criterion.getProlongationSmoothingFactor());
+	  info->freeGlobalLookup();
+	  delete get<0>(graphs);
+	}else{
+	  coarseMatrix = productBuilder.build(matrix->getmat(), *(get<0>(graphs)), visitedMap2, 
+					      *info, 
+					      *aggregatesMap,
+					      aggregates,
+					      OverlapFlags());
 	
-	info->freeGlobalLookup();
+	  info->freeGlobalLookup();
 	
-	delete get<0>(graphs);
-	productBuilder.calculate(matrix->getmat(), *aggregatesMap, *coarseMatrix, *infoLevel, OverlapFlags());
+	  delete get<0>(graphs);
+	  galerkinPlans_.push_back(GalerkinPlan<Matrix>());
+	  galerkinPlans_.back().build(matrix->getmat(), *aggregatesMap, *coarseMatrix);
+	  productBuilder.calculate(matrix->getmat(), galerkinPlans_.back(), *coarseMatrix, *infoLevel, OverlapFlags());
+	}
 	
+	setupTimes_[level].galerkin = watch.elapsed();
 	if(criterion.debugLevel()>2){
 	  if(rank==0)
 	    std::cout<<"Calculation of Galerkin product took "<<watch.elapsed()<<" seconds."<<std::endl;
@@ -926,6 +1088,7 @@ namespace Dune
 	
 	matrices_.addCoarser(args);
 	redistributes_.push_back(RedistributeInfoType());
+	setupTimes_.push_back(LevelSetupTimes());
       } // end level loop
       
 
@@ -948,7 +1111,7 @@ namespace Dune
       }
 
       if(criterion.accumulate() && !redistributes_.back().isSetup() && 
-	 infoLevel->communicator().size()>1){ 
+	 infoLevel->communicator().size()>coarseAccumulationDomains(criterion)){ 
 #if HAVE_MPI && !HAVE_PARMETIS
 	if(criterion.accumulate()==successiveAccu &&
 	   infoLevel->communicator().rank()==0)
@@ -959,7 +1122,7 @@ namespace Dune
 	// accumulate to fewer processors
 	Matrix* redistMat= new Matrix();
 	ParallelInformation* redistComm=0;
-	int nodomains = 1;
+	int nodomains = coarseAccumulationDomains(criterion);
 	    
 	repartitionAndDistributeMatrix(mlevel->getmat(), *redistMat, *infoLevel,
 				       redistComm, redistributes_.back(), nodomains,criterion);
@@ -1097,6 +1260,9 @@ namespace Dune
 	  delete &(level.getRedistributed().getmat());
       }
       delete *amap;
+      for(typename SmoothedTransferVector::iterator transfer = smoothedTransfers_.begin();
+          transfer != smoothedTransfers_.end(); ++transfer)
+        delete *transfer;
     }
 
     template<class M, class IS, class A>
@@ -1140,18 +1306,23 @@ namespace Dune
       cargs.setArgs(sargs);
       PinfoIterator pinfo = parallelInformation_.finest();
       AggregatesIterator aggregates = aggregatesMaps_.begin();
+      setupTimes_.resize(levels());
       int level=0;
       for(MatrixIterator matrix = matrices_.finest(), coarsest = matrices_.coarsest(); 
 	  matrix != coarsest; ++matrix, ++pinfo, ++aggregates, ++level){
+	Timer watch;
 	cargs.setMatrix(matrix->getmat(), **aggregates);
 	cargs.setComm(*pinfo);
 	smoothers.addCoarser(cargs);
+	setupTimes_[level].smoother = watch.elapsed();
       }
       if(maxlevels()>levels()){
 	// This is not the globally coarsest level and therefore smoothing is needed
+	Timer watch;
 	cargs.setMatrix(matrices_.coarsest()->getmat(), **aggregates);
 	cargs.setComm(*pinfo);
 	smoothers.addCoarser(cargs);
+	setupTimes_[level].smoother = watch.elapsed();
 	++level;
       }
     }
@@ -1165,31 +1336,32 @@ namespace Dune
       typedef typename ParallelInformationHierarchy::Iterator InfoIterator;
       
       AggregatesMapIterator amap = aggregatesMaps_.begin();
+      typename GalerkinPlanList::const_iterator plan = galerkinPlans_.begin();
       BaseGalerkinProduct productBuilder;
       InfoIterator info = parallelInformation_.finest();
       typename RedistributeInfoList::iterator riIter = redistributes_.begin();
       Iterator level = matrices_.finest(), coarsest=matrices_.coarsest();
-      if(level.isRedistributed()){
-        info->buildGlobalLookup(info->indexSet().size());
-        redistributeMatrixEntries(const_cast<Matrix&>(level->getmat()), 
-                                  const_cast<Matrix&>(level.getRedistributed().getmat()),
-                                  *info,info.getRedistributed(), *riIter);
-        info->freeGlobalLookup();
-      }
+      if(level.isRedistributed())
+        redistributeMatrixAmg(const_cast<Matrix&>(level->getmat()),
+                              const_cast<Matrix&>(level.getRedistributed().getmat()),
+                              *info, info.getRedistributed(), *riIter);
       
-      for(; level!=coarsest; ++amap){
+      for(std::size_t l=0; level!=coarsest; ++amap, ++l){
 	const Matrix& fine = (level.isRedistributed()?level.getRedistributed():*level).getmat();
 	++level;
 	++info;
         ++riIter;
-	productBuilder.calculate(fine, *(*amap), const_cast<Matrix&>(level->getmat()), *info, copyFlags);
-	if(level.isRedistributed()){
-        info->buildGlobalLookup(info->indexSet().size());
-          redistributeMatrixEntries(const_cast<Matrix&>(level->getmat()), 
-                                    const_cast<Matrix&>(level.getRedistributed().getmat()), *info,
-                                    info.getRedistributed(), *riIter);
-          info->freeGlobalLookup();
-        }
+	Timer watch;
+	if(l < smoothedTransfers_.size())
+	  smoothedTransfers_[l]->calculate(fine, **amap, const_cast<Matrix&>(level->getmat()));
+	else
+	  productBuilder.calculate(fine, *plan++, const_cast<Matrix&>(level->getmat()), *info, copyFlags);
+	if(l < setupTimes_.size())
+	  setupTimes_[l].galerkin = watch.elapsed();
+	if(level.isRedistributed())
+          redistributeMatrixAmg(const_cast<Matrix&>(level->getmat()),
+                                const_cast<Matrix&>(level.getRedistributed().getmat()),
+                                *info, info.getRedistributed(), *riIter);
       }
     }
 
@@ -1238,6 +1410,12 @@ namespace Dune
 
     template<class T, class A>
     Hierarchy<T,A>::~Hierarchy()
+    {
+      clear();
+    }
+
+    template<class T, class A>
+    void Hierarchy<T,A>::clear()
     {
       while(coarsest_){
 	Element* current = coarsest_;
@@ -1250,6 +1428,8 @@ namespace Dune
 	allocator_.deallocate(current, 1);
 	//coarsest_->coarser_ = 0;
       }
+      finest_ = nonAllocated_ = 0;
+      levels_ = 0;
     }
 
     template<class T, class A>
@@ -108,6 +108,9 @@ namespace Dune
     /**
      * @brief an algebraic multigrid method using a Krylov-cycle.
      *
+     * AMG itself provides a K-cycle with adaptive two step flexible CG
+     * on selected levels, see Parameters::setCycleType and kCycle.
+     *
      * @tparam M The type of the linear operator.
      * @tparam X The type of the range and domain.
      * @tparam PI The parallel information object. Use SequentialInformation (default)
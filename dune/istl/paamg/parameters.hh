@@ -2,6 +2,7 @@
 #define DUNE_AMG_PARAMETERS_HH
 
 #include<cstddef>
+#include<algorithm>
 
 namespace Dune
 {
@@ -72,6 +73,21 @@ namespace Dune
       double alpha_, beta_;
     };
 
+    /**
+     * @brief Identifiers for the algorithms building the aggregates.
+     */
+    enum AggregationAlgorithm{
+      /**
+       * @brief Grow one aggregate after another (Aggregator).
+       */
+      serialAggregation=0,
+      /**
+       * @brief Build the aggregates around a distance two maximal
+       * independent set using all threads (ParallelAggregator).
+       */
+      parallelAggregation=1
+    };
+
     /**
      * @brief Parameters needed for the aggregation process,
      */
@@ -90,7 +106,7 @@ namespace Dune
        */
       AggregationParameters()
 	: maxDistance_(2), minAggregateSize_(4), maxAggregateSize_(6), 
-	  connectivity_(15), skipiso_(false)
+	  connectivity_(15), skipiso_(false), algorithm_(serialAggregation)
       {}
       
       /**
@@ -214,10 +230,26 @@ namespace Dune
        * @param connectivity The maximum number of connections a aggregate is allowed to have.
        */
       void setMaxConnectivity(std::size_t connectivity){ connectivity_ = connectivity;}
+
+      /**
+       * @brief Get the algorithm used for building the aggregates.
+       */
+      AggregationAlgorithm aggregationAlgorithm() const{ return algorithm_;}
+
+      /**
+       * @brief Set the algorithm used for building the aggregates.
+       *
+       * The default is serialAggregation. parallelAggregation is much
+       * faster on large matrices and threads but ignores the size and
+       * distance limits. Its aggregates are larger for isotropic and
+       * smaller for strongly anisotropic problems, see ParallelAggregator.
+       */
+      void setAggregationAlgorithm(AggregationAlgorithm algorithm){ algorithm_ = algorithm;}
       
     private:
       std::size_t maxDistance_, minAggregateSize_, maxAggregateSize_, connectivity_;
       bool skipiso_;
+      AggregationAlgorithm algorithm_;
 
     };
 
@@ -241,10 +273,40 @@ namespace Dune
       /**
        * @brief Successively accumulate to fewer processes.
        */
-      successiveAccu=2
+      successiveAccu=2,
+      /**
+       * @brief Shrink the number of processes geometrically with the unknowns.
+       *
+       * A level is redistributed as soon as its unknowns fit onto fewer
+       * processes (with at least CoarseningParameters::minUnknownsPerProcess()
+       * unknowns each) by a factor of processShrinkFactor(). The coarsest
+       * level is gathered onto coarseSolveProcesses() processes. Without
+       * ParMETIS blocks of consecutive processes are merged.
+       */
+      geometricAccu=3
     };
 
     
+    /**
+     * @brief Identifiers for the transfer operators between the levels.
+     */
+    enum ProlongationType
+    {
+      /**
+       * @brief Inject the coarse value into all vertices of the aggregate.
+       *
+       * The prolongated correction is scaled by the prolongation damping factor.
+       */
+      piecewiseConstantProlongation=0,
+      /**
+       * @brief Smooth the piecewise constant prolongation with a damped Jacobi step.
+       *
+       * Prolongation and restriction are stored as sparse matrices,
+       * the coarse matrix is \f$P^TAP\f$. See SmoothedTransfer.
+       * Only available for sequential problems.
+       */
+      smoothedProlongation=1
+    };
 
 
     /**
@@ -320,6 +382,61 @@ namespace Dune
       void setAccumulate(bool accu){
         accumulate_=accu?successiveAccu:noAccu;
       }
+
+      /**
+       * @brief Set the number of unknowns each process should at least hold with geometricAccu.
+       *
+       * The default is 500.
+       */
+      void setMinUnknownsPerProcess(int unknowns)
+      {
+        minUnknownsPerProcess_ = unknowns;
+      }
+
+      /**
+       * @brief Get the number of unknowns each process should at least hold with geometricAccu.
+       */
+      int minUnknownsPerProcess() const
+      {
+        return minUnknownsPerProcess_;
+      }
+
+      /**
+       * @brief Set the factor by which a redistribution with geometricAccu has to reduce the processes.
+       *
+       * Avoids redistributing on every level. The default is 4.
+       */
+      void setProcessShrinkFactor(double factor)
+      {
+        processShrinkFactor_ = factor;
+      }
+
+      /**
+       * @brief Get the factor by which a redistribution with geometricAccu has to reduce the processes.
+       */
+      double processShrinkFactor() const
+      {
+        return processShrinkFactor_;
+      }
+
+      /**
+       * @brief Set the number of processes the coarsest level is gathered onto with geometricAccu.
+       *
+       * With one process (the default) the coarse system is solved
+       * directly.
+       */
+      void setCoarseSolveProcesses(int processes)
+      {
+        coarseSolveProcesses_ = processes;
+      }
+
+      /**
+       * @brief Get the number of processes the coarsest level is gathered onto with geometricAccu.
+       */
+      int coarseSolveProcesses() const
+      {
+        return coarseSolveProcesses_;
+      }
       /**
        * @brief Set the damping factor for the prolongation.
        *
@@ -339,6 +456,43 @@ namespace Dune
       {
         return dampingFactor_;
       }
+
+      /**
+       * @brief Set the type of the prolongation and restriction.
+       *
+       * The default is piecewiseConstantProlongation.
+       */
+      void setProlongationType(ProlongationType type)
+      {
+        prolongationType_ = type;
+      }
+
+      /**
+       * @brief Get the type of the prolongation and restriction.
+       */
+      ProlongationType prolongationType() const
+      {
+        return prolongationType_;
+      }
+
+      /**
+       * @brief Set the factor of the Jacobi step smoothing the prolongation.
+       *
+       * The damping of the Jacobi step is the factor divided by a bound of
+       * the spectral radius of \f$D^{-1}A\f$. The default is 4/3.
+       */
+      void setProlongationSmoothingFactor(double factor)
+      {
+        smoothingFactor_ = factor;
+      }
+
+      /**
+       * @brief Get the factor of the Jacobi step smoothing the prolongation.
+       */
+      double getProlongationSmoothingFactor() const
+      {
+        return smoothingFactor_;
+      }
       /**
        * @brief Constructor
        * @param maxLevel The maximum number of levels allowed in the matrix hierarchy (default: 100).
@@ -352,7 +506,9 @@ namespace Dune
       CoarseningParameters(int maxLevel=100, int coarsenTarget=1000, double minCoarsenRate=1.2,
                            double prolongDamp=1.6, AccumulationMode accumulate=successiveAccu)
         : maxLevel_(maxLevel), coarsenTarget_(coarsenTarget), minCoarsenRate_(minCoarsenRate),
-          dampingFactor_(prolongDamp), accumulate_( accumulate)
+          dampingFactor_(prolongDamp), accumulate_( accumulate),
+          minUnknownsPerProcess_(500), processShrinkFactor_(4), coarseSolveProcesses_(1),
+          prolongationType_(piecewiseConstantProlongation), smoothingFactor_(4.0/3.0)
       {}
       
     private:
@@ -377,6 +533,50 @@ namespace Dune
        * coarser levels.
        */
       AccumulationMode accumulate_;
+      /**
+       * @brief The minimum number of unknowns per process with geometricAccu.
+       */
+      int minUnknownsPerProcess_;
+      /**
+       * @brief The minimum reduction of the processes of a redistribution with geometricAccu.
+       */
+      double processShrinkFactor_;
+      /**
+       * @brief The number of processes of the coarsest level with geometricAccu.
+       */
+      int coarseSolveProcesses_;
+      /**
+       * @brief The type of the prolongation.
+       */
+      ProlongationType prolongationType_;
+      /**
+       * @brief The factor of the Jacobi step smoothing the prolongation.
+       */
+      double smoothingFactor_;
+    };
+
+    /**
+     * @brief Identifiers for the multigrid cycles of AMG.
+     */
+    enum CycleType
+    {
+      /** @brief One coarse grid correction per level. */
+      vCycle=0,
+      /** @brief gamma (at least two) coarse grid corrections per level. */
+      wCycle=1,
+      /**
+       * @brief An F-cycle on the coarse level followed by a V-cycle.
+       */
+      fCycle=2,
+      /**
+       * @brief Krylov accelerated coarse grid correction.
+       *
+       * The coarse grid correction is computed with up to two steps of
+       * flexible CG preconditioned by the cycle on the coarser level.
+       * The second step is skipped if the first one reduced the defect
+       * enough (see Parameters::setKCycleTolerance).
+       */
+      kCycle=3
     };
 
     /**
@@ -445,10 +645,15 @@ namespace Dune
 
       /**
        * @brief Set the value of gamma; 1 for V-cycle, 2 for W-cycle
+       *
+       * Selects the V- or W-cycle unless the F- or K-cycle was chosen
+       * with setCycleType().
        */
       void setGamma(std::size_t gamma)
       {
         gamma_=gamma;
+        if(cycleType_==vCycle || cycleType_==wCycle)
+          cycleType_ = gamma>1 ? wCycle : vCycle;
       }
       /**
        * @brief Get the value of gamma; 1 for V-cycle, 2 for W-cycle
@@ -457,6 +662,67 @@ namespace Dune
       {
         return gamma_;
       }
+
+      /**
+       * @brief Set the type of the multigrid cycle.
+       *
+       * Choosing the V-cycle sets gamma to 1, choosing the W-cycle
+       * sets it to 2 if it was smaller.
+       */
+      void setCycleType(CycleType type)
+      {
+        cycleType_=type;
+        if(type==vCycle)
+          gamma_=1;
+        if(type==wCycle)
+          gamma_=std::max(gamma_, std::size_t(2));
+      }
+
+      /**
+       * @brief Get the type of the multigrid cycle.
+       */
+      CycleType getCycleType() const
+      {
+        return cycleType_;
+      }
+
+      /**
+       * @brief Set on which levels the K-cycle uses Krylov acceleration.
+       *
+       * The coarse grid correction of every interval-th level is
+       * accelerated, on the other levels a plain recursion is used.
+       * The default is 1, i.e. all levels.
+       */
+      void setKCycleInterval(std::size_t interval)
+      {
+        kCycleInterval_=std::max(interval, std::size_t(1));
+      }
+
+      /**
+       * @brief Get on which levels the K-cycle uses Krylov acceleration.
+       */
+      std::size_t getKCycleInterval() const
+      {
+        return kCycleInterval_;
+      }
+
+      /**
+       * @brief Set the defect reduction of the K-cycle that makes a second Krylov step unnecessary.
+       *
+       * The default is 0.25.
+       */
+      void setKCycleTolerance(double tolerance)
+      {
+        kCycleTolerance_=tolerance;
+      }
+
+      /**
+       * @brief Get the defect reduction of the K-cycle that makes a second Krylov step unnecessary.
+       */
+      double getKCycleTolerance() const
+      {
+        return kCycleTolerance_;
+      }
       
       /**
        * @brief Set whether to use additive multigrid.
@@ -490,7 +756,7 @@ namespace Dune
                  double prolongDamp=1.6, AccumulationMode accumulate=successiveAccu)
         : CoarseningParameters(maxLevel, coarsenTarget, minCoarsenRate, prolongDamp, accumulate)
         , debugLevel_(2), preSmoothSteps_(2), postSmoothSteps_(2), gamma_(1),
-          additive_(false)
+          additive_(false), cycleType_(vCycle), kCycleInterval_(1), kCycleTolerance_(0.25)
       {}
     private:
       int debugLevel_;
@@ -498,6 +764,9 @@ namespace Dune
       std::size_t postSmoothSteps_;
       std::size_t gamma_;
       bool additive_;
+      CycleType cycleType_;
+      std::size_t kCycleInterval_;
+      double kCycleTolerance_;
     };
       
   }//namespace AMG
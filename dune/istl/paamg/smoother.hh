@@ -4,6 +4,7 @@
 #include<dune/istl/paamg/construction.hh>
 #include<dune/istl/paamg/aggregates.hh>
 #include<dune/istl/preconditioners.hh>
+#include<dune/istl/multicolor.hh>
 #include<dune/istl/schwarz.hh>
 #include<dune/istl/novlpschwarz.hh>
 #include<dune/common/propertymap.hh>
@@ -200,6 +201,48 @@ namespace Dune
       }
       
     };
+    /**
+     * @brief Policy for the construction of the SeqMulticolorSOR smoother
+     */
+    template<class M, class X, class Y, int l>
+    struct ConstructionTraits<SeqMulticolorSOR<M,X,Y,l> >
+    {
+      typedef DefaultConstructionArgs<SeqMulticolorSOR<M,X,Y,l> > Arguments;
+      
+      static inline SeqMulticolorSOR<M,X,Y,l>* construct(Arguments& args)
+      {
+	return new SeqMulticolorSOR<M,X,Y,l>(args.getMatrix(), args.getArgs().iterations,
+					      args.getArgs().relaxationFactor);
+      }
+      
+      static inline void deconstruct(SeqMulticolorSOR<M,X,Y,l>* sor)
+      {
+	delete sor;
+      }
+      
+    };
+
+    /**
+     * @brief Policy for the construction of the SeqMulticolorSSOR smoother
+     */
+    template<class M, class X, class Y, int l>
+    struct ConstructionTraits<SeqMulticolorSSOR<M,X,Y,l> >
+    {
+      typedef DefaultConstructionArgs<SeqMulticolorSSOR<M,X,Y,l> > Arguments;
+      
+      static inline SeqMulticolorSSOR<M,X,Y,l>* construct(Arguments& args)
+      {
+	return new SeqMulticolorSSOR<M,X,Y,l>(args.getMatrix(), args.getArgs().iterations,
+					       args.getArgs().relaxationFactor);
+      }
+      
+      static inline void deconstruct(SeqMulticolorSSOR<M,X,Y,l>* ssor)
+      {
+	delete ssor;
+      }
+      
+    };
+
     /**
      * @brief Policy for the construction of the SeqJac smoother
      */
@@ -287,6 +330,60 @@ namespace Dune
       
     };
     
+    template<class M, class X, class Y>
+    class ConstructionArgs<SeqILUT<M,X,Y> >
+      : public DefaultConstructionArgs<SeqILUT<M,X,Y> >
+    {
+    public:
+      ConstructionArgs(double tau=1e-3, int p=10)
+	: tau_(tau), p_(p)
+      {}
+      
+      void setDropTolerance(double tau)
+      {
+	tau_ = tau;
+      }
+      double getDropTolerance()
+      {
+	return tau_;
+      }
+      
+      void setFillPerRow(int p)
+      {
+	p_ = p;
+      }
+      int getFillPerRow()
+      {
+	return p_;
+      }
+      
+    private:
+      double tau_;
+      int p_;
+    };
+    
+    
+    /**
+     * @brief Policy for the construction of the SeqILUT smoother
+     */
+    template<class M, class X, class Y>
+    struct ConstructionTraits<SeqILUT<M,X,Y> >
+    {
+      typedef ConstructionArgs<SeqILUT<M,X,Y> > Arguments;
+      
+      static inline SeqILUT<M,X,Y>* construct(Arguments& args)
+      {
+	return new SeqILUT<M,X,Y>(args.getMatrix(), args.getDropTolerance(),
+				 args.getFillPerRow(), args.getArgs().relaxationFactor);
+      }
+      
+      static void deconstruct(SeqILUT<M,X,Y>* ilu)
+      {
+	delete ilu;
+      }
+      
+    };
+    
     /**
      * @brief Policy for the construction of the ParSSOR smoother
      */
@@ -406,6 +503,25 @@ namespace Dune
       }
     };
 
+    template<class M, class X, class Y, int l>
+    struct SmootherApplier<SeqMulticolorSOR<M,X,Y,l> >
+    {
+      typedef SeqMulticolorSOR<M,X,Y,l> Smoother;
+      typedef typename Smoother::range_type Range;
+      typedef typename Smoother::domain_type Domain;
+      
+      static void preSmooth(Smoother& smoother, Domain& v, Range& d)
+      {
+	smoother.template apply<true>(v,d);
+      }
+
+       
+      static void postSmooth(Smoother& smoother, Domain& v, Range& d)
+      {
+	smoother.template apply<false>(v,d);
+      }
+    };
+
     template<class M, class X, class Y, class C, int l>
     struct SmootherApplier<BlockPreconditioner<X,Y,C,SeqSOR<M,X,Y,l> > >
     {
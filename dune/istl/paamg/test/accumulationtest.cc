@@ -0,0 +1,117 @@
+/** \file
+    \brief Checks the policy of geometricAccu for shrinking the processes
+
+    Simulates the coarsening of a problem with 8000 processes and checks
+    that the processes shrink by at least the shrink factor, keep enough
+    unknowns each and that the coarsest level ends up on the requested
+    number of processes. Each redistribution is checked with the merging
+    of consecutive processes used by graphRepartition without ParMETIS.
+*/
+#include"config.h"
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/paamg/hierarchy.hh>
+#include<dune/istl/paamg/aggregates.hh>
+#include<iostream>
+#include<vector>
+
+typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > BCRSMat;
+typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<BCRSMat,Dune::Amg::FirstDiagonal> >
+  Criterion;
+
+/**
+ * @brief Checks that merging blocks of consecutive processes yields
+ * domains of contiguous, nonempty and balanced blocks, each moved to
+ * one of its own processes.
+ */
+int testMerging(int procs, int domains)
+{
+  std::vector<int> size(domains, 0);
+  int last = 0;
+  for(int rank=0; rank < procs; ++rank){
+    const int domain = Dune::mergedDomain(rank, procs, domains);
+    if(domain < last || domain > last+1 || domain >= domains){
+      std::cerr<<"merging "<<procs<<" processes into "<<domains<<" domains puts process "
+               <<rank<<" into domain "<<domain<<" after "<<last<<std::endl;
+      return 1;
+    }
+    last = domain;
+    ++size[domain];
+  }
+  for(int domain=0; domain < domains; ++domain){
+    const int process = Dune::mergedDomainProcess(domain, procs, domains);
+    if(size[domain] < procs/domains || size[domain] > (procs+domains-1)/domains
+       || process < 0 || process >= procs
+       || Dune::mergedDomain(process, procs, domains)!=domain){
+      std::cerr<<"merging "<<procs<<" processes into "<<domains<<" domains gives domain "
+               <<domain<<" "<<size[domain]<<" processes and moves it to process "<<process
+               <<std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int testShrinking(const Criterion& criterion, double unknowns, std::size_t procs,
+                  double coarseningRate)
+{
+  int ret=0;
+  std::size_t redistributions=0;
+  std::cout<<"procs:";
+  for(int level=0;; ++level, unknowns/=coarseningRate){
+    std::size_t domains = Dune::Amg::geometricAccumulationDomains(criterion, unknowns, procs);
+    if(domains>0){
+      ++redistributions;
+      ret += testMerging(procs, domains);
+      if(domains*criterion.processShrinkFactor()>procs && unknowns>criterion.coarsenTarget()){
+        std::cerr<<"level "<<level<<": "<<procs<<" processes were only reduced to "
+                 <<domains<<std::endl;
+        ++ret;
+      }
+      procs = domains;
+    }
+    std::cout<<" "<<procs;
+    // without a redistribution the processes hold at least about
+    // minUnknownsPerProcess()/processShrinkFactor() unknowns
+    if(procs>1 && 2*unknowns/procs < criterion.minUnknownsPerProcess()/criterion.processShrinkFactor()){
+      std::cerr<<"level "<<level<<": "<<procs<<" processes share only "<<unknowns
+               <<" unknowns"<<std::endl;
+      ++ret;
+    }
+    if(unknowns<=criterion.coarsenTarget())
+      break;
+  }
+  std::cout<<" ("<<redistributions<<" redistributions)"<<std::endl;
+  if(procs!=std::size_t(Dune::Amg::coarseAccumulationDomains(criterion))){
+    std::cerr<<"coarsest level is on "<<procs<<" instead of "
+             <<Dune::Amg::coarseAccumulationDomains(criterion)<<" processes"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int main()
+{
+  Criterion criterion(100, 1000);
+  criterion.setAccumulate(Dune::Amg::geometricAccu);
+
+  int ret=0;
+  ret += testShrinking(criterion, 8e9, 8000, 8);
+  ret += testShrinking(criterion, 8e6, 8000, 4);
+  criterion.setCoarseSolveProcesses(4);
+  criterion.setProcessShrinkFactor(8);
+  ret += testShrinking(criterion, 8e9, 8000, 8);
+  // a single process or one at the coarse target is never redistributed
+  if(Dune::Amg::geometricAccumulationDomains(criterion, 1e6, 4)!=0){
+    std::cerr<<"redistributed the coarse processes"<<std::endl;
+    ++ret;
+  }
+  ret += testMerging(7, 7);
+  ret += testMerging(7, 3);
+  ret += testMerging(5, 1);
+  criterion.setAccumulate(Dune::Amg::successiveAccu);
+  if(Dune::Amg::coarseAccumulationDomains(criterion)!=1){
+    std::cerr<<"successive accumulation does not end on one process"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
@@ -0,0 +1,199 @@
+/** \file
+    \brief Compares the parallel aggregation with the serial one
+
+    Checks that the aggregates of ParallelAggregator are connected,
+    independent of the number of threads, not much smaller than the serial
+    ones and that no coupled vertex stays alone, and reports the setup
+    times and the AMG iterations of both algorithms.
+*/
+#include"config.h"
+#include"anisotropic.hh"
+#include<dune/common/timer.hh>
+#include<dune/common/collectivecommunication.hh>
+#include<dune/common/parallel/indexset.hh>
+#include<dune/istl/paamg/amg.hh>
+#include<dune/istl/paamg/aggregates.hh>
+#include<dune/istl/paamg/graph.hh>
+#include<dune/istl/paamg/pinfo.hh>
+#include<dune/istl/threading.hh>
+#include<dune/istl/solvers.hh>
+#include<cstdlib>
+#include<map>
+#include<vector>
+
+typedef Dune::FieldMatrix<double,1,1> MatrixBlock;
+typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+typedef Dune::Amg::MatrixGraph<const BCRSMat> MatrixGraph;
+typedef Dune::Amg::PropertiesGraph<MatrixGraph,Dune::Amg::VertexProperties,
+                                   Dune::Amg::EdgeProperties,Dune::IdentityMap,
+                                   Dune::IdentityMap> PropertiesGraph;
+typedef PropertiesGraph::VertexDescriptor Vertex;
+typedef Dune::Amg::AggregatesMap<Vertex> AggregatesMap;
+typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<BCRSMat,Dune::Amg::FirstDiagonal> >
+  Criterion;
+
+/** @brief Build the aggregates and return the number of them. */
+int aggregate(const BCRSMat& mat, const Criterion& criterion, AggregatesMap& aggregates,
+              double& time)
+{
+  MatrixGraph graph(mat);
+  PropertiesGraph pgraph(graph);
+  aggregates.allocate(pgraph.maxVertex()+1);
+  std::fill(aggregates.begin(), aggregates.end(), AggregatesMap::UNAGGREGATED);
+
+  Dune::Timer watch;
+  int noAggregates, isoAggregates, oneAggregates, skipped;
+  Dune::tie(noAggregates, isoAggregates, oneAggregates, skipped) =
+    aggregates.buildAggregates(mat, pgraph, criterion, true);
+  time = watch.elapsed();
+  return noAggregates;
+}
+
+/**
+ * @brief Check that all aggregates are connected and that only vertices
+ * without neighbours form an aggregate of their own, return their number.
+ */
+int checkAggregates(const BCRSMat& mat, const AggregatesMap& aggregates, const char* name)
+{
+  std::map<Vertex,std::size_t> sizes;
+  std::vector<bool> visited(mat.N(), false);
+  std::size_t maxSize=0;
+
+  for(std::size_t i=0; i < mat.N(); ++i){
+    if(aggregates[i]==AggregatesMap::UNAGGREGATED){
+      std::cerr<<name<<": vertex "<<i<<" is not aggregated"<<std::endl;
+      return -1;
+    }
+    if(aggregates[i]!=AggregatesMap::ISOLATED)
+      ++sizes[aggregates[i]];
+  }
+  for(std::size_t i=0; i < mat.N(); ++i){
+    if(aggregates[i]==AggregatesMap::ISOLATED || visited[i])
+      continue;
+    // breadth first search within the aggregate of i
+    std::vector<std::size_t> front(1, i);
+    visited[i]=true;
+    for(std::size_t f=0; f < front.size(); ++f){
+      typedef BCRSMat::ConstColIterator ColIterator;
+      for(ColIterator col=mat[front[f]].begin(); col != mat[front[f]].end(); ++col)
+        if(!visited[col.index()] && aggregates[col.index()]==aggregates[i]){
+          visited[col.index()]=true;
+          front.push_back(col.index());
+        }
+    }
+    if(front.size()!=sizes[aggregates[i]]){
+      std::cerr<<name<<": aggregate "<<aggregates[i]<<" is not connected"<<std::endl;
+      return -1;
+    }
+    if(front.size()==1 && mat[i].size()>1){
+      std::cerr<<name<<": coupled vertex "<<i<<" forms an aggregate of its own"<<std::endl;
+      return -1;
+    }
+    maxSize=std::max(maxSize, front.size());
+  }
+  std::cout<<name<<": "<<sizes.size()<<" aggregates, average size "
+           <<double(mat.N())/sizes.size()<<", maximum size "<<maxSize<<std::endl;
+  return sizes.size();
+}
+
+/** @brief Solve with an AMG preconditioned CG and return the iterations. */
+int solve(const BCRSMat& mat, const Criterion& criterion, double& buildtime)
+{
+  typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+  typedef Dune::SeqSSOR<BCRSMat,Vector,Vector> Smoother;
+  typedef Dune::Amg::SmootherTraits<Smoother>::Arguments SmootherArgs;
+  typedef Dune::Amg::AMG<Operator,Vector,Smoother> AMG;
+
+  Operator fop(mat);
+  SmootherArgs smootherArgs;
+  smootherArgs.iterations = 1;
+  smootherArgs.relaxationFactor = 1;
+
+  Dune::Timer watch;
+  AMG amg(fop, criterion, smootherArgs, 1, 1, 1, false);
+  buildtime = watch.elapsed();
+
+  Vector x(mat.N()), b(mat.N());
+  for(std::size_t i=0; i < b.N(); ++i)
+    b[i]=1.0/(i+1);
+  x=0;
+  Dune::CGSolver<Vector> cg(fop, amg, 1e-8, 200, 0);
+  Dune::InverseOperatorResult r;
+  cg.apply(x, b, r);
+  return r.converged ? r.iterations : -1;
+}
+
+int testAggregation(int N, double eps)
+{
+  typedef Dune::ParallelIndexSet<int,LocalIndex,512> ParallelIndexSet;
+  ParallelIndexSet indices;
+  Dune::CollectiveCommunication<void*> c;
+  int n;
+  BCRSMat mat = setupAnisotropic2d<1,double>(N, indices, c, &n, eps);
+
+  std::cout<<"N="<<mat.N()<<" eps="<<eps<<std::endl;
+
+  Criterion criterion(15,100);
+  criterion.setDefaultValuesIsotropic(2);
+  criterion.setDebugLevel(0);
+
+  int ret=0;
+  double serialTime, parallelTime, threadedTime;
+  AggregatesMap serial, parallel, threaded;
+  int noSerial = aggregate(mat, criterion, serial, serialTime);
+  if(checkAggregates(mat, serial, "serial")<0)
+    ++ret;
+
+  criterion.setAggregationAlgorithm(Dune::Amg::parallelAggregation);
+  int noParallel = aggregate(mat, criterion, parallel, parallelTime);
+  // the parallel aggregates are numbered consecutively
+  if(checkAggregates(mat, parallel, "parallel")!=noParallel){
+    std::cerr<<"parallel aggregates are not numbered consecutively"<<std::endl;
+    ++ret;
+  }
+  // the mean size of the aggregates is at least two thirds of the serial one
+  if(2*noParallel>3*noSerial){
+    std::cerr<<"parallel aggregates are too small"<<std::endl;
+    ++ret;
+  }
+
+  int threads = Dune::ISTLThreading::threads();
+  Dune::ISTLThreading::setThreads(4);
+  Dune::ISTLThreading::setMinWorkPerThread(1);
+  int noThreaded = aggregate(mat, criterion, threaded, threadedTime);
+  if(noThreaded!=noParallel || !std::equal(parallel.begin(), parallel.end(), threaded.begin())){
+    std::cerr<<"parallel aggregates depend on the number of threads"<<std::endl;
+    ++ret;
+  }
+  Dune::ISTLThreading::setThreads(threads);
+  std::cout<<"aggregation took "<<serialTime<<"s serially, "<<parallelTime
+           <<"s in parallel and "<<threadedTime<<"s with 4 threads"<<std::endl;
+
+  double serialBuild, parallelBuild;
+  criterion.setAggregationAlgorithm(Dune::Amg::serialAggregation);
+  int serialIterations = solve(mat, criterion, serialBuild);
+  criterion.setAggregationAlgorithm(Dune::Amg::parallelAggregation);
+  int parallelIterations = solve(mat, criterion, parallelBuild);
+  std::cout<<"AMG setup took "<<serialBuild<<"s with serial and "<<parallelBuild
+           <<"s with parallel aggregation, CG needed "<<serialIterations<<" and "
+           <<parallelIterations<<" iterations"<<std::endl;
+  if(serialIterations<0 || parallelIterations<0){
+    std::cerr<<"AMG did not converge"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=200;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testAggregation(N, 1);
+  ret += testAggregation(N, 0.001);
+  return ret;
+}
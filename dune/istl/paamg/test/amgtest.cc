@@ -57,7 +57,7 @@ void randomize(const M& mat, V& b)
 
 
 template <int BS>
-void testAMG(int N, int coarsenTarget, int ml)
+int testAMG(int N, int coarsenTarget, int ml)
 {
     
   std::cout<<"N="<<N<<" coarsenTarget="<<coarsenTarget<<" maxlevel="<<ml<<std::endl;
@@ -86,6 +86,7 @@ void testAMG(int N, int coarsenTarget, int ml)
 
   x=0;
   randomize(mat, b);
+  Vector b0(b);
   
   if(N<6){
     Dune::printmatrix(std::cout, mat, "A", "row");
@@ -148,6 +149,59 @@ void testAMG(int N, int coarsenTarget, int ml)
   
     std::cout<<"AMG building took "<<(buildtime/r.elapsed*r.iterations)<<" iterations"<<std::endl;
   std::cout<<"AMG building together with solving took "<<buildtime+solvetime<<std::endl;
+
+  // Further solves reuse the work vectors of the AMG
+  int ret=0;
+  for(int i=0; i < 3; ++i){
+    Vector x1(mat.M()), b1(b0);
+    x1=0;
+    Dune::InverseOperatorResult r1;
+    watch.reset();
+    amgCG.apply(x1,b1,r1);
+    std::cout<<"Solve "<<i+2<<" took "<<watch.elapsed()<<" seconds"<<std::endl;
+    if(r1.iterations!=r.iterations){
+      std::cerr<<"Solve "<<i+2<<" needed "<<r1.iterations<<" instead of "
+               <<r.iterations<<" iterations"<<std::endl;
+      ++ret;
+    }
+  }
+  amg.printMemoryFootprint(std::cout);
+  // the coarse solver is set up once for all solves
+  if(amg.levelStatistics().back().coarseSolverSetups!=1){
+    std::cerr<<"coarse solver was set up "<<amg.levelStatistics().back().coarseSolverSetups
+             <<" times for 4 solves"<<std::endl;
+    ++ret;
+  }
+
+  // New values with the same pattern only need a numeric setup. The
+  // shift of every other diagonal entry changes the matrix non-uniformly,
+  // a stale hierarchy needs about three times the iterations.
+  typedef typename BCRSMat::RowIterator RowIterator;
+  for(RowIterator row=mat.begin(); row!=mat.end(); ++row)
+    if(row.index()%2==1)
+      for(int k=0; k < BS; ++k)
+        (*row)[row.index()][k][k] += 10.0;
+  watch.reset();
+  amg.recalculateHierarchy();
+  std::cout<<"Recalculating the hierarchy took "<<watch.elapsed()<<" seconds"<<std::endl;
+  {
+    Vector x1(mat.M()), b1(b0);
+    x1=0;
+    Dune::InverseOperatorResult r1;
+    amgCG.apply(x1,b1,r1);
+    // the shift makes the matrix more diagonally dominant
+    if(r1.iterations>r.iterations){
+      std::cerr<<"Solve with the recalculated hierarchy needed "<<r1.iterations
+               <<" instead of at most "<<r.iterations<<" iterations"<<std::endl;
+      ++ret;
+    }
+  }
+  if(amg.levelStatistics().back().coarseSolverSetups!=2){
+    std::cerr<<"coarse solver was not factorized once more for the recalculated hierarchy"
+             <<std::endl;
+    ++ret;
+  }
+  return ret;
   
   /*
   watch.reset();
@@ -174,7 +228,9 @@ int main(int argc, char** argv)
   if(argc>3)
     ml = atoi(argv[3]);
   
-  testAMG<1>(N, coarsenTarget, ml);
-  testAMG<2>(N, coarsenTarget, ml);
+  int ret=0;
+  ret += testAMG<1>(N, coarsenTarget, ml);
+  ret += testAMG<2>(N, coarsenTarget, ml);
+  return ret;
 
 }
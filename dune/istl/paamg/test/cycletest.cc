@@ -0,0 +1,137 @@
+/** \file
+    \brief Checks the V-, W-, F- and K-cycle of AMG
+
+    Solves with AMG preconditioned CG using each cycle and checks the
+    number of visits of the levels counted by AMG. Reports the
+    iterations and the work in fine level sweeps.
+*/
+#include"config.h"
+#include"anisotropic.hh"
+#include<dune/common/timer.hh>
+#include<dune/common/collectivecommunication.hh>
+#include<dune/common/parallel/indexset.hh>
+#include<dune/istl/paamg/amg.hh>
+#include<dune/istl/paamg/pinfo.hh>
+#include<dune/istl/solvers.hh>
+#include<cmath>
+#include<cstdlib>
+#include<iostream>
+#include<sstream>
+#include<vector>
+
+typedef Dune::FieldMatrix<double,1,1> MatrixBlock;
+typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+typedef Dune::SeqSSOR<BCRSMat,Vector,Vector> Smoother;
+typedef Dune::Amg::SmootherTraits<Smoother>::Arguments SmootherArgs;
+typedef Dune::Amg::AMG<Operator,Vector,Smoother> AMG;
+typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<BCRSMat,Dune::Amg::FirstDiagonal> >
+  Criterion;
+
+/** @brief Solve with the cycle and return the number of iterations. */
+int solve(const BCRSMat& mat, Criterion criterion, Dune::Amg::CycleType cycle,
+          const char* name, int& ret)
+{
+  criterion.setCycleType(cycle);
+  Operator fop(mat);
+  SmootherArgs smootherArgs;
+  smootherArgs.iterations = 1;
+  smootherArgs.relaxationFactor = 1;
+  AMG amg(fop, criterion, smootherArgs);
+
+  Vector x(mat.N()), b(mat.N());
+  for(std::size_t i=0; i < b.N(); ++i)
+    b[i]=1.0/(i+1);
+  x=0;
+  Dune::CGSolver<Vector> cg(fop, amg, 1e-8, 200, 0);
+  Dune::InverseOperatorResult r;
+  Dune::Timer watch;
+  cg.apply(x, b, r);
+  double time = watch.elapsed();
+
+  const std::vector<AMG::LevelWork>& work = amg.levelWork();
+  std::ostringstream levels;
+  amg.printLevelWork(levels);
+  std::string total = levels.str();
+  total = total.substr(total.rfind("Total: ")+7);
+  std::cout<<name<<": "<<r.iterations<<" iterations, "<<time<<"s, reduction per iteration "
+           <<r.conv_rate<<", "<<total;
+
+  if(!r.converged){
+    std::cerr<<name<<" did not converge"<<std::endl;
+    ++ret;
+    return -1;
+  }
+  if(work.size()!=amg.levels() || work.back().coarseSolves!=work.back().visits){
+    std::cerr<<name<<": wrong counters on the coarsest level"<<std::endl<<levels.str();
+    ++ret;
+  }
+  // the cycle is applied once per level with V and K, the latter may
+  // visit a coarse level up to twice
+  for(std::size_t l=1; l < work.size(); ++l){
+    std::size_t visits = work[l-1].visits;
+    bool ok;
+    if(cycle==Dune::Amg::vCycle || l+1==work.size())
+      ok = work[l].visits==visits;
+    else if(cycle==Dune::Amg::kCycle)
+      ok = work[l].visits>=visits && work[l].visits<=2*visits;
+    else if(cycle==Dune::Amg::fCycle)
+      // the first level gets an F- and a V-cycle, all others at most twice as many
+      ok = l>1 || work[l].visits==2*visits;
+    else
+      ok = work[l].visits==2*visits;
+    if(!ok){
+      std::cerr<<name<<": level "<<l<<" was visited "<<work[l].visits<<" times"<<std::endl
+               <<levels.str();
+      ++ret;
+      break;
+    }
+  }
+  return r.iterations;
+}
+
+int testCycles(int N, double eps)
+{
+  typedef Dune::ParallelIndexSet<int,LocalIndex,512> ParallelIndexSet;
+  ParallelIndexSet indices;
+  Dune::CollectiveCommunication<void*> c;
+  int n;
+  BCRSMat mat = setupAnisotropic2d<1,double>(N, indices, c, &n, eps);
+
+  std::cout<<"N="<<mat.N()<<" eps="<<eps<<std::endl;
+
+  Criterion criterion(15,50);
+  criterion.setDefaultValuesIsotropic(2);
+  criterion.setDebugLevel(0);
+  criterion.setNoPreSmoothSteps(1);
+  criterion.setNoPostSmoothSteps(1);
+
+  int ret=0;
+  int v = solve(mat, criterion, Dune::Amg::vCycle, "V-cycle", ret);
+  int w = solve(mat, criterion, Dune::Amg::wCycle, "W-cycle", ret);
+  int f = solve(mat, criterion, Dune::Amg::fCycle, "F-cycle", ret);
+  int k = solve(mat, criterion, Dune::Amg::kCycle, "K-cycle", ret);
+  criterion.setKCycleInterval(2);
+  solve(mat, criterion, Dune::Amg::kCycle, "K-cycle on every second level", ret);
+
+  // the stronger cycles have to converge at least as fast as the V-cycle
+  if(w>v || f>v || k>v){
+    std::cerr<<"W-, F- or K-cycle needs more iterations than the V-cycle"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=200;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testCycles(N, 1);
+  ret += testCycles(N, 0.001);
+  return ret;
+}
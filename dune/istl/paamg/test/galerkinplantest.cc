@@ -0,0 +1,139 @@
+/** \file
+    \brief Checks the Galerkin product computed with a GalerkinPlan
+
+    The coarse matrix computed with the plan has to agree exactly with the
+    one of BaseGalerkinProduct::calculate, for any number of threads and
+    after changing the values of the fine matrix.
+*/
+#include"config.h"
+#include"anisotropic.hh"
+#include<dune/common/timer.hh>
+#include<dune/common/collectivecommunication.hh>
+#include<dune/common/parallel/indexset.hh>
+#include<dune/istl/paamg/hierarchy.hh>
+#include<dune/istl/paamg/dependency.hh>
+#include<dune/istl/paamg/galerkin.hh>
+#include<dune/istl/paamg/aggregates.hh>
+#include<dune/istl/paamg/graph.hh>
+#include<dune/istl/paamg/pinfo.hh>
+#include<dune/istl/threading.hh>
+#include<cstdlib>
+#include<vector>
+
+template<class M>
+int compare(const M& A, const M& B, const char* name)
+{
+  for(typename M::size_type i=0; i < A.N(); ++i){
+    if(A[i].getsize()!=B[i].getsize()){
+      std::cerr<<name<<": row "<<i<<" has a different pattern"<<std::endl;
+      return 1;
+    }
+    for(typename M::size_type j=0; j < A[i].getsize(); ++j)
+      if(A[i].getptr()[j]!=B[i].getptr()[j]){
+        std::cerr<<name<<": entry "<<j<<" of row "<<i<<" differs"<<std::endl;
+        return 1;
+      }
+  }
+  return 0;
+}
+
+template<int BS>
+int testGalerkinPlan(int N, double eps)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::Amg::MatrixGraph<const BCRSMat> MatrixGraph;
+  typedef Dune::Amg::PropertiesGraph<MatrixGraph,Dune::Amg::VertexProperties,
+    Dune::Amg::EdgeProperties,Dune::IdentityMap,Dune::IdentityMap> PropertiesGraph;
+  typedef typename PropertiesGraph::VertexDescriptor Vertex;
+  typedef Dune::Amg::AggregatesMap<Vertex> AggregatesMap;
+  typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<BCRSMat,Dune::Amg::FirstDiagonal> >
+    Criterion;
+  typedef Dune::ParallelIndexSet<int,LocalIndex,512> ParallelIndexSet;
+
+  ParallelIndexSet indices;
+  Dune::CollectiveCommunication<void*> c;
+  int n;
+  BCRSMat fine = setupAnisotropic2d<BS,double>(N, indices, c, &n, eps);
+
+  MatrixGraph graph(fine);
+  PropertiesGraph pgraph(graph);
+  AggregatesMap aggregates(pgraph.maxVertex()+1);
+  std::fill(aggregates.begin(), aggregates.end(), AggregatesMap::UNAGGREGATED);
+  Criterion criterion;
+  criterion.setDefaultValuesIsotropic(2);
+  criterion.setSkipIsolated(true);
+  aggregates.buildAggregates(fine, pgraph, criterion, true);
+
+  // number the aggregates consecutively as the hierarchy does
+  std::vector<Vertex> renumber(fine.N(), AggregatesMap::ISOLATED);
+  Vertex noAggregates=0;
+  for(typename AggregatesMap::iterator a = aggregates.begin(); a != aggregates.end(); ++a)
+    if(*a!=AggregatesMap::ISOLATED){
+      if(renumber[*a]==AggregatesMap::ISOLATED)
+        renumber[*a]=noAggregates++;
+      *a=renumber[*a];
+    }
+
+  std::vector<bool> visited(fine.N(), false);
+  typedef Dune::IteratorPropertyMap<std::vector<bool>::iterator,Dune::IdentityMap> VisitedMap;
+  VisitedMap visitedMap(visited.begin(), Dune::IdentityMap());
+  Dune::Amg::SequentialInformation pinfo;
+  Dune::Amg::GalerkinProduct<Dune::Amg::SequentialInformation> productBuilder;
+  BCRSMat* coarse = productBuilder.build(fine, graph, visitedMap, pinfo, aggregates,
+                                         noAggregates, Dune::EnumItem<int,0>());
+  BCRSMat reference(*coarse);
+
+  Dune::Timer watch;
+  productBuilder.calculate(fine, aggregates, reference, pinfo, Dune::EnumItem<int,0>());
+  double calculateTime = watch.elapsed();
+
+  watch.reset();
+  Dune::Amg::GalerkinPlan<BCRSMat> plan;
+  plan.build(fine, aggregates, *coarse);
+  double buildTime = watch.elapsed();
+  watch.reset();
+  productBuilder.calculate(fine, plan, *coarse, pinfo, Dune::EnumItem<int,0>());
+  double applyTime = watch.elapsed();
+
+  std::cout<<"N="<<fine.N()<<" BS="<<BS<<" eps="<<eps<<" coarse N="<<coarse->N()
+           <<": calculate "<<calculateTime<<"s, plan build "<<buildTime<<"s apply "
+           <<applyTime<<"s ("<<plan.memory()<<" bytes)"<<std::endl;
+
+  int ret = compare(reference, *coarse, "plan");
+
+  // same result with several threads and a plan built by several threads
+  int threads = Dune::ISTLThreading::threads();
+  Dune::ISTLThreading::setThreads(4);
+  Dune::ISTLThreading::setMinWorkPerThread(1);
+  Dune::Amg::GalerkinPlan<BCRSMat> threadedPlan;
+  threadedPlan.build(fine, aggregates, *coarse);
+  *coarse = 0.0;
+  threadedPlan.apply(fine, *coarse);
+  ret += compare(reference, *coarse, "threaded plan");
+
+  // new values with the same pattern only need the numeric phase
+  for(typename BCRSMat::size_type i=0; i < fine.N(); ++i)
+    fine[i][i] *= 2.0+i%3;
+  productBuilder.calculate(fine, aggregates, reference, pinfo, Dune::EnumItem<int,0>());
+  plan.apply(fine, *coarse);
+  ret += compare(reference, *coarse, "reused plan");
+  Dune::ISTLThreading::setThreads(threads);
+
+  delete coarse;
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=200;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testGalerkinPlan<1>(N, 1);
+  ret += testGalerkinPlan<1>(N, 0.001);
+  ret += testGalerkinPlan<2>(N/2, 1);
+  return ret;
+}
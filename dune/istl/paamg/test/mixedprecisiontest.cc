@@ -0,0 +1,153 @@
+/** \file
+    \brief Checks AMG in single precision as preconditioner of a double solver
+
+    The CG method in double precision has to reach a reduction below the
+    accuracy of float with an AMG hierarchy in single precision and need
+    about as many iterations as with the hierarchy in double precision,
+    while the hierarchy needs less memory.
+*/
+#include"config.h"
+#include"anisotropic.hh"
+#include<dune/common/timer.hh>
+#include<dune/common/collectivecommunication.hh>
+#include<dune/common/parallel/indexset.hh>
+#include<dune/istl/paamg/amg.hh>
+#include<dune/istl/paamg/pinfo.hh>
+#include<dune/istl/mixedprecision.hh>
+#include<dune/istl/solvers.hh>
+#include<cstdlib>
+#include<iostream>
+#include<vector>
+
+typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > BCRSMat;
+typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+typedef Dune::BCRSMatrix<Dune::FieldMatrix<float,1,1> > FloatMat;
+typedef Dune::BlockVector<Dune::FieldVector<float,1> > FloatVector;
+typedef Dune::MatrixAdapter<FloatMat,FloatVector,FloatVector> FloatOperator;
+
+/** @brief The memory of the matrices of all levels. */
+template<class AMG>
+std::size_t matrixMemory(const AMG& amg)
+{
+  std::vector<typename AMG::LevelStatistics> statistics = amg.levelStatistics();
+  std::size_t memory=0;
+  for(std::size_t l=0; l < statistics.size(); ++l)
+    memory += statistics[l].matrixMemory;
+  return memory;
+}
+
+/** @brief The memory of the matrix entries of all levels without the indices. */
+template<class AMG, class M>
+std::size_t valueMemory(const AMG& amg, const M&)
+{
+  std::vector<typename AMG::LevelStatistics> statistics = amg.levelStatistics();
+  std::size_t memory=0;
+  for(std::size_t l=0; l < statistics.size(); ++l)
+    memory += statistics[l].nonzeros*sizeof(typename M::block_type);
+  return memory;
+}
+
+/** @brief Solve with CG and the preconditioner and return the iterations. */
+template<class P>
+int solve(Operator& fop, P& prec, double& time)
+{
+  Vector x(fop.getmat().N()), b(fop.getmat().N());
+  for(std::size_t i=0; i < b.N(); ++i)
+    b[i]=1.0/(i+1);
+  x=0;
+  Dune::CGSolver<Vector> cg(fop, prec, 1e-10, 200, 0);
+  Dune::InverseOperatorResult r;
+  Dune::Timer watch;
+  cg.apply(x, b, r);
+  time = watch.elapsed();
+  return r.converged ? r.iterations : -1;
+}
+
+int testMixedPrecision(int N, double eps)
+{
+  typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<BCRSMat,Dune::Amg::FirstDiagonal> >
+    Criterion;
+  typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<FloatMat,Dune::Amg::FirstDiagonal> >
+    FloatCriterion;
+  typedef Dune::SeqSSOR<BCRSMat,Vector,Vector> Smoother;
+  typedef Dune::SeqSSOR<FloatMat,FloatVector,FloatVector> FloatSmoother;
+  typedef Dune::Amg::AMG<Operator,Vector,Smoother> AMG;
+  typedef Dune::Amg::AMG<FloatOperator,FloatVector,FloatSmoother> FloatAMG;
+  typedef Dune::ParallelIndexSet<int,LocalIndex,512> ParallelIndexSet;
+
+  ParallelIndexSet indices;
+  Dune::CollectiveCommunication<void*> c;
+  int n;
+  BCRSMat mat = setupAnisotropic2d<1,double>(N, indices, c, &n, eps);
+  Operator fop(mat);
+
+  Criterion criterion(15,50);
+  criterion.setDefaultValuesIsotropic(2);
+  criterion.setDebugLevel(0);
+  FloatCriterion floatCriterion(15,50);
+  floatCriterion.setDefaultValuesIsotropic(2);
+  floatCriterion.setDebugLevel(0);
+
+  Dune::Amg::SmootherTraits<Smoother>::Arguments smootherArgs;
+  smootherArgs.iterations = 1;
+  smootherArgs.relaxationFactor = 1;
+  Dune::Amg::SmootherTraits<FloatSmoother>::Arguments floatSmootherArgs;
+  floatSmootherArgs.iterations = 1;
+  floatSmootherArgs.relaxationFactor = 1;
+
+  AMG amg(fop, criterion, smootherArgs);
+  double time;
+  int iterations = solve(fop, amg, time);
+
+  FloatMat floatMat;
+  Dune::convertMatrix(mat, floatMat);
+  FloatOperator floatOp(floatMat);
+  FloatAMG floatAmg(floatOp, floatCriterion, floatSmootherArgs);
+  Dune::MixedPrecisionPreconditioner<Vector,Vector,FloatAMG> prec(floatAmg);
+  double floatTime;
+  int floatIterations = solve(fop, prec, floatTime);
+
+  std::cout<<"N="<<mat.N()<<" eps="<<eps<<": "<<iterations<<" iterations ("<<time<<"s, "
+           <<matrixMemory(amg)<<" bytes of matrices) in double and "<<floatIterations
+           <<" iterations ("<<floatTime<<"s, "<<matrixMemory(floatAmg)
+           <<" bytes of matrices) in single precision"<<std::endl;
+
+  int ret=0;
+  if(iterations<0 || floatIterations<0){
+    std::cerr<<"CG did not converge"<<std::endl;
+    return 1;
+  }
+  if(floatIterations>iterations+1){
+    std::cerr<<"the single precision hierarchy needs too many iterations"<<std::endl;
+    ++ret;
+  }
+  if(matrixMemory(floatAmg)>=matrixMemory(amg)
+     || 20*valueMemory(floatAmg, floatMat)>11*valueMemory(amg, mat)){
+    std::cerr<<"the single precision hierarchy does not save memory"<<std::endl;
+    ++ret;
+  }
+
+  // new values of the matrix only need a conversion of the values
+  mat *= 2.0;
+  Dune::convertMatrix(mat, floatMat);
+  floatAmg.recalculateHierarchy();
+  if(solve(fop, prec, floatTime)!=floatIterations){
+    std::cerr<<"the recalculated hierarchy needs a different number of iterations"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=200;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testMixedPrecision(N, 1);
+  ret += testMixedPrecision(N, 0.001);
+  return ret;
+}
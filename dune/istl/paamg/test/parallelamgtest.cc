@@ -11,6 +11,8 @@
 #include<dune/istl/owneroverlapcopy.hh>
 #include<dune/common/mpicollectivecommunication.hh>
 #include<string>
+#include<algorithm>
+#include<cmath>
 
 template<class T, class C>
 class DoubleStepPreconditioner 
@@ -67,6 +69,29 @@ void MPI_err_handler(MPI_Comm *comm, int *err_code, ...){
     throw MPIError(s, *err_code);
 }
 
+/**
+ * @brief Checks the non-blocking reduction of several dot products
+ * against the blocking dot products of the scalar product.
+ */
+template<class S, class V>
+void testDots(S& sp, const V& x, const V& b, int rank)
+{
+  const V* left[3] = { &x, &x, &b };
+  const V* right[3] = { &x, &b, &b };
+  double dots[3];
+  sp.startDots(left, right, 3, dots);
+  sp.finishDots();
+
+  for(int k=0; k < 3; ++k){
+    const double dot = sp.dot(*left[k], *right[k]);
+    if(std::abs(dots[k]-dot) > 1e-12*std::max(std::abs(dot),1.0)){
+      std::cerr<<rank<<": dot product "<<k<<" of startDots() is "<<dots[k]
+               <<" instead of "<<dot<<std::endl;
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+  }
+}
+
 template<int BS>
 void testAmg(int N, int coarsenTarget)
 {  
@@ -176,6 +201,8 @@ void testAmg(int N, int coarsenTarget)
   if(!r.converged && rank==0)
     std::cerr<<" AMG Cg solver did not converge!"<<std::endl;
 
+  testDots(sp, x, b, rank);
+
   if(rank==0){
     std::cout<<"AMG solving took "<<solvetime<<" seconds"<<std::endl;
   
@@ -0,0 +1,279 @@
+/** \file
+    \brief Checks the transfer operators of smoothed aggregation
+
+    The restriction has to be the transpose of the prolongation and the
+    coarse matrix has to agree with the product computed by matMultMat.
+    A fine matrix with a missing diagonal entry is rejected.
+    Reports the AMG iterations with piecewise constant and with smoothed
+    prolongation.
+*/
+#include"config.h"
+#include"anisotropic.hh"
+#include<dune/common/timer.hh>
+#include<dune/common/collectivecommunication.hh>
+#include<dune/common/parallel/indexset.hh>
+#include<dune/istl/paamg/amg.hh>
+#include<dune/istl/paamg/aggregates.hh>
+#include<dune/istl/paamg/transfer.hh>
+#include<dune/istl/paamg/graph.hh>
+#include<dune/istl/paamg/pinfo.hh>
+#include<dune/istl/matrixmatrix.hh>
+#include<dune/istl/threading.hh>
+#include<dune/istl/solvers.hh>
+#include<cmath>
+#include<cstdlib>
+#include<vector>
+
+/** @brief The maximum difference of the entries of B to those of A. */
+template<class M>
+double difference(const M& A, const M& B)
+{
+  double diff=0;
+  typedef typename M::ConstRowIterator RowIterator;
+  typedef typename M::ConstColIterator ColIterator;
+  for(RowIterator row=A.begin(); row != A.end(); ++row)
+    for(ColIterator col=row->begin(); col != row->end(); ++col){
+      typename M::block_type d = *col;
+      ColIterator entry = B[row.index()].find(col.index());
+      if(entry != B[row.index()].end())
+        d -= *entry;
+      diff = std::max(diff, double(d.infinity_norm()));
+    }
+  return diff;
+}
+
+template<int BS>
+int testTransfer(int N, double eps)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::Amg::MatrixGraph<const BCRSMat> MatrixGraph;
+  typedef Dune::Amg::PropertiesGraph<MatrixGraph,Dune::Amg::VertexProperties,
+    Dune::Amg::EdgeProperties,Dune::IdentityMap,Dune::IdentityMap> PropertiesGraph;
+  typedef typename PropertiesGraph::VertexDescriptor Vertex;
+  typedef Dune::Amg::AggregatesMap<Vertex> AggregatesMap;
+  typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<BCRSMat,Dune::Amg::FirstDiagonal> >
+    Criterion;
+  typedef Dune::ParallelIndexSet<int,LocalIndex,512> ParallelIndexSet;
+
+  ParallelIndexSet indices;
+  Dune::CollectiveCommunication<void*> c;
+  int n;
+  BCRSMat fine = setupAnisotropic2d<BS,double>(N, indices, c, &n, eps);
+
+  MatrixGraph graph(fine);
+  PropertiesGraph pgraph(graph);
+  AggregatesMap aggregates(pgraph.maxVertex()+1);
+  std::fill(aggregates.begin(), aggregates.end(), AggregatesMap::UNAGGREGATED);
+  Criterion criterion;
+  criterion.setDefaultValuesIsotropic(2);
+  aggregates.buildAggregates(fine, pgraph, criterion, true);
+
+  // number the aggregates consecutively as the hierarchy does
+  std::vector<Vertex> renumber(fine.N(), AggregatesMap::ISOLATED);
+  Vertex noAggregates=0;
+  for(typename AggregatesMap::iterator a = aggregates.begin(); a != aggregates.end(); ++a)
+    if(*a!=AggregatesMap::ISOLATED){
+      if(renumber[*a]==AggregatesMap::ISOLATED)
+        renumber[*a]=noAggregates++;
+      *a=renumber[*a];
+    }
+
+  Dune::Timer watch;
+  BCRSMat coarse;
+  Dune::Amg::SmoothedTransfer<BCRSMat> transfer;
+  transfer.build(fine, aggregates, noAggregates, coarse, 4.0/3.0);
+  double buildTime = watch.elapsed();
+
+  int ret=0;
+  const BCRSMat& P = transfer.prolongation();
+  const BCRSMat& R = transfer.restriction();
+  for(typename BCRSMat::size_type i=0; i < P.N(); ++i)
+    for(typename BCRSMat::ConstColIterator col=P[i].begin(); col != P[i].end(); ++col)
+      for(int k=0; k < BS; ++k)
+        for(int l=0; l < BS; ++l)
+          if(R[col.index()][i][l][k]!=(*col)[k][l]){
+            std::cerr<<"R is not the transpose of P in row "<<i<<std::endl;
+            return 1;
+          }
+
+  BCRSMat AP, RAP;
+  Dune::matMultMat(AP, fine, P);
+  Dune::transposeMatMultMat(RAP, P, AP);
+  const double scale = fine[0][0].infinity_norm();
+  if(difference(RAP, coarse)>1e-12*scale || difference(coarse, RAP)>1e-12*scale){
+    std::cerr<<"coarse matrix differs from the product R*A*P"<<std::endl;
+    ++ret;
+  }
+
+  // the same values with several threads and after changing the fine matrix
+  int threads = Dune::ISTLThreading::threads();
+  Dune::ISTLThreading::setThreads(4);
+  Dune::ISTLThreading::setMinWorkPerThread(1);
+  BCRSMat reference(coarse);
+  transfer.calculate(fine, aggregates, coarse);
+  if(difference(reference, coarse)>1e-12*scale){
+    std::cerr<<"threaded transfer differs"<<std::endl;
+    ++ret;
+  }
+  fine *= 2.0;
+  transfer.calculate(fine, aggregates, coarse);
+  reference *= 2.0;
+  if(difference(reference, coarse)>1e-12*scale){
+    std::cerr<<"recalculated coarse matrix differs"<<std::endl;
+    ++ret;
+  }
+  Dune::ISTLThreading::setThreads(threads);
+
+  std::cout<<"N="<<fine.N()<<" BS="<<BS<<" eps="<<eps<<" coarse N="<<coarse.N()
+           <<": build took "<<buildTime<<"s, transfer uses "<<transfer.memory()
+           <<" bytes"<<std::endl;
+  return ret;
+}
+
+/**
+ * @brief A row without a diagonal entry has to raise an ISTLError, also
+ * if the rows are processed by several threads.
+ */
+int testMissingDiagonal()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > BCRSMat;
+  typedef Dune::Amg::AggregatesMap<std::size_t> AggregatesMap;
+  const int n=6;
+
+  // a 1D Laplacian without the diagonal entry of row 3
+  BCRSMat fine(n, n, BCRSMat::row_wise);
+  for(BCRSMat::CreateIterator row=fine.createbegin(); row!=fine.createend(); ++row){
+    if(row.index()>0)
+      row.insert(row.index()-1);
+    if(row.index()!=3)
+      row.insert(row.index());
+    if(row.index()<n-1)
+      row.insert(row.index()+1);
+  }
+  for(BCRSMat::RowIterator row=fine.begin(); row!=fine.end(); ++row)
+    for(BCRSMat::ColIterator col=row->begin(); col!=row->end(); ++col)
+      *col = col.index()==row.index() ? 2.0 : -1.0;
+
+  AggregatesMap aggregates(n);
+  for(int i=0; i < n; ++i)
+    aggregates[i]=i/2;
+
+  int threads = Dune::ISTLThreading::threads();
+  Dune::ISTLThreading::setThreads(2);
+  Dune::ISTLThreading::setMinWorkPerThread(1);
+  BCRSMat coarse;
+  Dune::Amg::SmoothedTransfer<BCRSMat> transfer;
+  int ret=1;
+  try{
+    transfer.build(fine, aggregates, n/2, coarse, 4.0/3.0);
+  }catch(Dune::ISTLError& e){
+    ret=0;
+  }
+  Dune::ISTLThreading::setThreads(threads);
+  if(ret)
+    std::cerr<<"missing diagonal entry was not detected"<<std::endl;
+  return ret;
+}
+
+/**
+ * @brief Solve with an AMG preconditioned CG and return the iterations.
+ *
+ * Solves again after scaling the matrix and recalculating the hierarchy,
+ * which has to need the same number of iterations.
+ */
+template<class M, class C>
+int solve(M& mat, const C& criterion)
+{
+  typedef Dune::BlockVector<Dune::FieldVector<double,M::block_type::rows> > Vector;
+  typedef Dune::MatrixAdapter<M,Vector,Vector> Operator;
+  typedef Dune::SeqSSOR<M,Vector,Vector> Smoother;
+  typedef typename Dune::Amg::SmootherTraits<Smoother>::Arguments SmootherArgs;
+  typedef Dune::Amg::AMG<Operator,Vector,Smoother> AMG;
+
+  Operator fop(mat);
+  SmootherArgs smootherArgs;
+  smootherArgs.iterations = 1;
+  smootherArgs.relaxationFactor = 1;
+
+  AMG amg(fop, criterion, smootherArgs, 1, 1, 1, false);
+
+  Vector x(mat.N()), b(mat.N());
+  for(std::size_t i=0; i < b.N(); ++i)
+    b[i]=1.0/(i+1);
+  x=0;
+  Dune::CGSolver<Vector> cg(fop, amg, 1e-8, 200, 0);
+  Dune::InverseOperatorResult r, r1;
+  Vector b1(b);
+  cg.apply(x, b1, r);
+
+  mat *= 3.0;
+  amg.recalculateHierarchy();
+  x=0;
+  b1=b;
+  b1*=3.0;
+  cg.apply(x, b1, r1);
+  mat *= 1.0/3.0;
+  if(r1.iterations!=r.iterations){
+    std::cerr<<"Solve with the recalculated hierarchy needed "<<r1.iterations
+             <<" instead of "<<r.iterations<<" iterations"<<std::endl;
+    return -1;
+  }
+  return r.converged ? r.iterations : -1;
+}
+
+int testIterations(int N, double eps)
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > BCRSMat;
+  typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<BCRSMat,Dune::Amg::FirstDiagonal> >
+    Criterion;
+  typedef Dune::ParallelIndexSet<int,LocalIndex,512> ParallelIndexSet;
+
+  ParallelIndexSet indices;
+  Dune::CollectiveCommunication<void*> c;
+  int n;
+  BCRSMat mat = setupAnisotropic2d<1,double>(N, indices, c, &n, eps);
+
+  Criterion criterion(15,100);
+  criterion.setDefaultValuesIsotropic(2);
+  criterion.setDebugLevel(0);
+
+  Dune::Timer watch;
+  int constantIterations = solve(mat, criterion);
+  double constantTime = watch.elapsed();
+  criterion.setProlongationType(Dune::Amg::smoothedProlongation);
+  watch.reset();
+  int smoothedIterations = solve(mat, criterion);
+  double smoothedTime = watch.elapsed();
+
+  std::cout<<"N="<<mat.N()<<" eps="<<eps<<": CG needed "<<constantIterations
+           <<" iterations ("<<constantTime<<"s) with piecewise constant and "
+           <<smoothedIterations<<" iterations ("<<smoothedTime
+           <<"s) with smoothed prolongation"<<std::endl;
+  if(constantIterations<0 || smoothedIterations<0){
+    std::cerr<<"AMG did not converge"<<std::endl;
+    return 1;
+  }
+  if(smoothedIterations>constantIterations){
+    std::cerr<<"smoothed prolongation needs more iterations"<<std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  int N=100;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testTransfer<1>(N, 1);
+  ret += testTransfer<1>(N, 0.001);
+  ret += testTransfer<2>(N/2, 1);
+  ret += testMissingDiagonal();
+  ret += testIterations(2*N, 1);
+  ret += testIterations(2*N, 0.001);
+  return ret;
+}
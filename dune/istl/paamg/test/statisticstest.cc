@@ -0,0 +1,142 @@
+/** \file
+    \brief Checks the per level statistics of AMG
+
+    The statistics have to agree with the hierarchy and the work counters,
+    the times have to be recorded for setup and apply, and the JSON dump
+    has to contain one object per level.
+*/
+#include"config.h"
+#include"anisotropic.hh"
+#include<dune/common/collectivecommunication.hh>
+#include<dune/common/parallel/indexset.hh>
+#include<dune/istl/paamg/amg.hh>
+#include<dune/istl/paamg/pinfo.hh>
+#include<dune/istl/solvers.hh>
+#include<cstdlib>
+#include<iostream>
+#include<sstream>
+#include<string>
+#include<vector>
+
+typedef Dune::FieldMatrix<double,1,1> MatrixBlock;
+typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+typedef Dune::SeqSSOR<BCRSMat,Vector,Vector> Smoother;
+typedef Dune::Amg::SmootherTraits<Smoother>::Arguments SmootherArgs;
+typedef Dune::Amg::AMG<Operator,Vector,Smoother> AMG;
+typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<BCRSMat,Dune::Amg::FirstDiagonal> >
+  Criterion;
+
+/** @brief Count the occurrences of a string. */
+std::size_t count(const std::string& str, const std::string& what)
+{
+  std::size_t n=0;
+  for(std::string::size_type pos=str.find(what); pos!=std::string::npos; pos=str.find(what, pos+1))
+    ++n;
+  return n;
+}
+
+int testStatistics(const BCRSMat& mat, Criterion criterion, const char* name)
+{
+  Operator fop(mat);
+  SmootherArgs smootherArgs;
+  smootherArgs.iterations = 1;
+  smootherArgs.relaxationFactor = 1;
+  AMG amg(fop, criterion, smootherArgs);
+
+  Vector x(mat.N()), b(mat.N());
+  b=1;
+  x=0;
+  Dune::CGSolver<Vector> cg(fop, amg, 1e-8, 200, 0);
+  Dune::InverseOperatorResult r;
+  cg.apply(x, b, r);
+
+  int ret=0;
+  std::vector<AMG::LevelStatistics> statistics = amg.levelStatistics();
+  if(statistics.size()!=amg.levels() || statistics[0].unknowns!=mat.N()){
+    std::cerr<<name<<": statistics do not match the hierarchy"<<std::endl;
+    return 1;
+  }
+
+  double setup=0, smoothing=0, transfer=0, coarseSolve=0;
+  for(std::size_t l=0; l < statistics.size(); ++l){
+    const AMG::LevelStatistics& stats = statistics[l];
+    const AMG::LevelWork& work = amg.levelWork()[l];
+    if(stats.work.visits!=work.visits || stats.work.smoothingSteps!=work.smoothingSteps){
+      std::cerr<<name<<": counters of level "<<l<<" differ"<<std::endl;
+      ++ret;
+    }
+    if(stats.aggregationTime<0 || stats.galerkinTime<0 || stats.smootherSetupTime<0
+       || work.smoothingTime<0 || work.restrictionTime<0 || work.prolongationTime<0){
+      std::cerr<<name<<": negative time on level "<<l<<std::endl;
+      ++ret;
+    }
+    if(l+1<statistics.size() && stats.nonzeros<=statistics[l+1].nonzeros){
+      std::cerr<<name<<": level "<<l+1<<" is not coarser"<<std::endl;
+      ++ret;
+    }
+    if(l+1==statistics.size() && (stats.galerkinTime!=0 || stats.work.restrictionTime!=0)){
+      std::cerr<<name<<": the coarsest level has a transfer"<<std::endl;
+      ++ret;
+    }
+    setup += stats.aggregationTime+stats.galerkinTime+stats.smootherSetupTime;
+    smoothing += work.smoothingTime;
+    transfer += work.restrictionTime+work.prolongationTime;
+    coarseSolve += work.coarseSolveTime;
+  }
+  if(setup<=0 || smoothing<=0 || transfer<=0 || coarseSolve<=0){
+    std::cerr<<name<<": times were not recorded"<<std::endl;
+    ++ret;
+  }
+
+  std::ostringstream json;
+  amg.printStatistics(json);
+  const std::string str = json.str();
+  if(count(str, "{\"level\"")!=statistics.size() || count(str, "{")!=count(str, "}")
+     || count(str, "[")!=1 || count(str, "]")!=1 || count(str, "\"total\"")!=1){
+    std::cerr<<name<<": malformed statistics"<<std::endl<<str;
+    ++ret;
+  }
+
+  amg.resetLevelWork();
+  statistics = amg.levelStatistics();
+  for(std::size_t l=0; l < statistics.size(); ++l)
+    if(statistics[l].work.smoothingTime!=0 || statistics[l].work.coarseSolveTime!=0){
+      std::cerr<<name<<": times were not reset"<<std::endl;
+      ++ret;
+    }
+
+  std::cout<<name<<": "<<r.iterations<<" iterations, setup "<<setup<<"s, smoothing "
+           <<smoothing<<"s, transfer "<<transfer<<"s, coarse solve "<<coarseSolve<<"s"<<std::endl;
+  if(ret)
+    std::cout<<str;
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=200;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  typedef Dune::ParallelIndexSet<int,LocalIndex,512> ParallelIndexSet;
+  ParallelIndexSet indices;
+  Dune::CollectiveCommunication<void*> c;
+  int n;
+  BCRSMat mat = setupAnisotropic2d<1,double>(N, indices, c, &n, 1);
+
+  Criterion criterion(15,50);
+  criterion.setDefaultValuesIsotropic(2);
+  criterion.setDebugLevel(0);
+
+  int ret=0;
+  ret += testStatistics(mat, criterion, "multiplicative");
+  criterion.setProlongationType(Dune::Amg::smoothedProlongation);
+  ret += testStatistics(mat, criterion, "smoothed aggregation");
+  criterion.setProlongationType(Dune::Amg::piecewiseConstantProlongation);
+  criterion.setAdditive(true);
+  ret += testStatistics(mat, criterion, "additive");
+  return ret;
+}
@@ -8,7 +8,12 @@
 #include<dune/istl/paamg/pinfo.hh>
 #include<dune/istl/owneroverlapcopy.hh>
 #include<dune/istl/paamg/aggregates.hh>
+#include<dune/istl/threading.hh>
+#include<dune/istl/istlexception.hh>
 #include<dune/common/exceptions.hh>
+#include<vector>
+#include<algorithm>
+#include<limits>
 
 namespace Dune
 {
@@ -67,6 +72,187 @@ namespace Dune
 			   const SequentialInformation& comm);
     };
 
+    /**
+     * @brief Prolongation and restriction of smoothed aggregation.
+     *
+     * The tentative prolongation \f$P_0\f$ injects the value of an aggregate
+     * into all of its vertices. It is smoothed by one damped Jacobi step,
+     * \f$P=(I-\omega D^{-1}A)P_0\f$ with \f$\omega=f/\rho\f$, where \f$\rho\f$ is
+     * the Gershgorin bound of the spectral radius of \f$D^{-1}A\f$ and f the
+     * smoothing factor (usually 4/3). Isolated vertices are neither prolongated
+     * to nor restricted from.
+     *
+     * P and the restriction \f$R=P^T\f$ are stored explicitly as matrices with
+     * the block type of A, so that both transfers are (threaded) sparse
+     * matrix vector products. The coarse matrix is \f$R(AP)\f$. The sparsity
+     * patterns are set up once by build(), calculate() recomputes all values
+     * for new values of the fine matrix.
+     */
+    template<class M>
+    class SmoothedTransfer
+    {
+    public:
+      /** @brief The type of the matrices. */
+      typedef M Matrix;
+      /** @brief The type of the indices. */
+      typedef typename M::size_type size_type;
+      /** @brief The type of the matrix entries. */
+      typedef typename M::field_type field_type;
+
+      /**
+       * @brief Set up the sparsity patterns and compute the transfer and the coarse matrix.
+       * @param fine The fine matrix.
+       * @param aggregates The aggregates, numbered consecutively.
+       * @param noAggregates The number of aggregates.
+       * @param coarse The coarse matrix, not set up yet.
+       * @param factor The smoothing factor f.
+       */
+      template<class V>
+      void build(const Matrix& fine, const AggregatesMap<V>& aggregates, size_type noAggregates,
+                 Matrix& coarse, double factor);
+
+      /**
+       * @brief Recompute the transfer and the coarse matrix for new values of the fine matrix.
+       * @param fine The fine matrix with the sparsity pattern passed to build().
+       * @param aggregates The aggregates passed to build().
+       * @param coarse The coarse matrix set up by build().
+       */
+      template<class V>
+      void calculate(const Matrix& fine, const AggregatesMap<V>& aggregates, Matrix& coarse);
+
+      /**
+       * @brief Add the prolongated coarse correction to the fine one.
+       *
+       * Computes \f$fine = fine + damp\cdot P\cdot coarse\f$.
+       */
+      template<class X>
+      void prolongate(const X& coarse, X& fine, field_type damp) const
+      {
+        prolongation_.usmv(damp, coarse, fine);
+      }
+
+      /**
+       * @brief Restrict the fine defect.
+       *
+       * Computes \f$coarse = R\cdot fine\f$.
+       */
+      template<class X>
+      void restrict(X& coarse, const X& fine) const
+      {
+        restriction_.mv(fine, coarse);
+      }
+
+      /** @brief Get the prolongation matrix P. */
+      const Matrix& prolongation() const
+      {
+        return prolongation_;
+      }
+
+      /** @brief Get the restriction matrix R. */
+      const Matrix& restriction() const
+      {
+        return restriction_;
+      }
+
+      /** @brief The number of bytes allocated for P, R and AP. */
+      std::size_t memory() const;
+
+    private:
+      typedef typename Matrix::block_type Block;
+
+      /** @brief Computes the Gershgorin bound of some rows of \f$D^{-1}A\f$. */
+      class RadiusKernel
+      {
+      public:
+        RadiusKernel(const Matrix& fine, const RowPartition& partition, std::vector<double>& radius)
+          : fine_(fine), partition_(partition), radius_(radius)
+        {}
+
+        void operator()(int part) const;
+
+      private:
+        const Matrix& fine_;
+        const RowPartition& partition_;
+        std::vector<double>& radius_;
+      };
+
+      /**
+       * @brief Computes some rows of P, used with parallelFor().
+       *
+       * Stores the first row of each part without a diagonal entry in
+       * missing, or the number of rows if there is none.
+       */
+      template<class V>
+      class ProlongationKernel
+      {
+      public:
+        ProlongationKernel(const Matrix& fine, const AggregatesMap<V>& aggregates, Matrix& prolongation,
+                           field_type omega, const RowPartition& partition,
+                           std::vector<size_type>& missing)
+          : fine_(fine), aggregates_(aggregates), prolongation_(prolongation), omega_(omega),
+            partition_(partition), missing_(missing)
+        {}
+
+        void operator()(int part) const;
+
+      private:
+        const Matrix& fine_;
+        const AggregatesMap<V>& aggregates_;
+        Matrix& prolongation_;
+        field_type omega_;
+        const RowPartition& partition_;
+        std::vector<size_type>& missing_;
+      };
+
+      /** @brief Computes some rows of \f$R=P^T\f$, used with parallelFor(). */
+      class TransposeKernel
+      {
+      public:
+        TransposeKernel(const Matrix& prolongation, Matrix& restriction, const RowPartition& partition)
+          : prolongation_(prolongation), restriction_(restriction), partition_(partition)
+        {}
+
+        void operator()(int part) const;
+
+      private:
+        const Matrix& prolongation_;
+        Matrix& restriction_;
+        const RowPartition& partition_;
+      };
+
+      /** @brief Computes some rows of the product \f$C=AB\f$, used with parallelFor(). */
+      class ProductKernel
+      {
+      public:
+        ProductKernel(const Matrix& A, const Matrix& B, Matrix& C, const RowPartition& partition)
+          : A_(A), B_(B), C_(C), partition_(partition)
+        {}
+
+        void operator()(int part) const;
+
+      private:
+        const Matrix& A_;
+        const Matrix& B_;
+        Matrix& C_;
+        const RowPartition& partition_;
+      };
+
+      /** @brief Set up the sparsity pattern of \f$C=AB\f$. */
+      static void multiplyPattern(const Matrix& A, const Matrix& B, Matrix& C);
+
+      /** @brief Compute the values of \f$C=AB\f$ with the pattern set up by multiplyPattern(). */
+      static void multiply(const Matrix& A, const Matrix& B, Matrix& C);
+
+      /** @brief The prolongation P. */
+      Matrix prolongation_;
+      /** @brief The restriction \f$R=P^T\f$. */
+      Matrix restriction_;
+      /** @brief The product AP. */
+      Matrix product_;
+      /** @brief The smoothing factor. */
+      double factor_;
+    };
+
 #if HAVE_MPI
 
     template<class V,class V1, class T1, class T2>
@@ -185,6 +371,260 @@ namespace Dune
       comm.project(coarse);
     }
 #endif
+    template<class M>
+    void SmoothedTransfer<M>::RadiusKernel::operator()(int part) const
+    {
+      double radius=0;
+      for(size_type i=partition_.first(part); i < partition_.last(part); ++i){
+        typedef typename Matrix::ConstColIterator ColIterator;
+        ColIterator diag = fine_[i].find(i);
+        if(diag == fine_[i].end())
+          continue;
+        Block inverse = *diag;
+        inverse.invert();
+        double sum=0;
+        for(ColIterator col = fine_[i].begin(); col != fine_[i].end(); ++col){
+          Block scaled = *col;
+          scaled.leftmultiply(inverse);
+          sum += scaled.infinity_norm();
+        }
+        radius = std::max(radius, sum);
+      }
+      radius_[part] = radius;
+    }
+
+    template<class M>
+    template<class V>
+    void SmoothedTransfer<M>::ProlongationKernel<V>::operator()(int part) const
+    {
+      typedef typename Matrix::ConstColIterator ColIterator;
+      missing_[part] = fine_.N();
+      for(size_type i=partition_.first(part); i < partition_.last(part); ++i){
+        typename Matrix::row_type& row = prolongation_[i];
+        if(row.getsize()==0)
+          // isolated vertex
+          continue;
+        ColIterator diag = fine_[i].find(i);
+        if(diag == fine_[i].end()){
+          // reported by calculate(), the kernel must not throw
+          missing_[part] = i;
+          return;
+        }
+        Block* values = row.getptr();
+        const size_type* begin = row.getindexptr(), * last = begin+row.getsize();
+        for(size_type j=0; j < row.getsize(); ++j)
+          values[j] = static_cast<field_type>(0);
+
+        Block inverse = *diag;
+        inverse.invert();
+        inverse *= -omega_;
+        for(ColIterator col = fine_[i].begin(); col != fine_[i].end(); ++col)
+          if(aggregates_[col.index()]!=AggregatesMap<V>::ISOLATED){
+            const size_type* index = std::lower_bound(begin, last, size_type(aggregates_[col.index()]));
+            assert(index!=last && *index==size_type(aggregates_[col.index()]));
+            Block scaled = *col;
+            scaled.leftmultiply(inverse);
+            values[index-begin] += scaled;
+          }
+        // add the tentative prolongation
+        Block& own = values[std::lower_bound(begin, last, size_type(aggregates_[i]))-begin];
+        for(int k=0; k < Block::rows; ++k)
+          own[k][k] += 1;
+      }
+    }
+
+    template<class M>
+    void SmoothedTransfer<M>::TransposeKernel::operator()(int part) const
+    {
+      for(size_type a=partition_.first(part); a < partition_.last(part); ++a){
+        typename Matrix::row_type& row = restriction_[a];
+        Block* values = row.getptr();
+        const size_type* index = row.getindexptr();
+        for(size_type j=0; j < row.getsize(); ++j){
+          const typename Matrix::row_type& prow = prolongation_[index[j]];
+          const size_type* begin = prow.getindexptr(), * last = begin+prow.getsize();
+          const Block& value = prow.getptr()[std::lower_bound(begin, last, a)-begin];
+          for(int k=0; k < Block::rows; ++k)
+            for(int l=0; l < Block::cols; ++l)
+              values[j][l][k] = value[k][l];
+        }
+      }
+    }
+
+    template<class M>
+    void SmoothedTransfer<M>::ProductKernel::operator()(int part) const
+    {
+      // position of the columns within the current row of C
+      std::vector<size_type> position(C_.M());
+      typedef typename Matrix::ConstColIterator ColIterator;
+
+      for(size_type i=partition_.first(part); i < partition_.last(part); ++i){
+        typename Matrix::row_type& row = C_[i];
+        Block* values = row.getptr();
+        const size_type* index = row.getindexptr();
+        for(size_type j=0; j < row.getsize(); ++j){
+          values[j] = static_cast<field_type>(0);
+          position[index[j]] = j;
+        }
+        for(ColIterator a = A_[i].begin(); a != A_[i].end(); ++a)
+          for(ColIterator b = B_[a.index()].begin(); b != B_[a.index()].end(); ++b){
+            Block product = *b;
+            product.leftmultiply(*a);
+            values[position[b.index()]] += product;
+          }
+      }
+    }
+
+    template<class M>
+    void SmoothedTransfer<M>::multiplyPattern(const Matrix& A, const Matrix& B, Matrix& C)
+    {
+      // the last row that inserted the column
+      std::vector<size_type> marker(B.M(), std::numeric_limits<size_type>::max());
+      typedef typename Matrix::ConstColIterator ColIterator;
+      typedef typename Matrix::CreateIterator CreateIterator;
+      size_type nonzeros=0;
+
+      for(size_type i=0; i < A.N(); ++i)
+        for(ColIterator a = A[i].begin(); a != A[i].end(); ++a)
+          for(ColIterator b = B[a.index()].begin(); b != B[a.index()].end(); ++b)
+            if(marker[b.index()]!=i){
+              marker[b.index()]=i;
+              ++nonzeros;
+            }
+
+      C.setSize(A.N(), B.M(), nonzeros);
+      C.setBuildMode(Matrix::row_wise);
+      std::fill(marker.begin(), marker.end(), std::numeric_limits<size_type>::max());
+      for(CreateIterator row = C.createbegin(); row != C.createend(); ++row){
+        const size_type i = row.index();
+        for(ColIterator a = A[i].begin(); a != A[i].end(); ++a)
+          for(ColIterator b = B[a.index()].begin(); b != B[a.index()].end(); ++b)
+            if(marker[b.index()]!=i){
+              marker[b.index()]=i;
+              row.insert(b.index());
+            }
+      }
+    }
+
+    template<class M>
+    void SmoothedTransfer<M>::multiply(const Matrix& A, const Matrix& B, Matrix& C)
+    {
+      std::vector<size_type> work(A.N()+1);
+      work[0]=0;
+      typedef typename Matrix::ConstColIterator ColIterator;
+      for(size_type i=0; i < A.N(); ++i){
+        work[i+1]=work[i];
+        for(ColIterator a = A[i].begin(); a != A[i].end(); ++a)
+          work[i+1] += B[a.index()].getsize();
+      }
+      RowPartition partition;
+      partition.buildFromOffsets(work, ISTLThreading::threadsFor(work[A.N()]));
+      ProductKernel kernel(A, B, C, partition);
+      parallelFor(partition.parts(), kernel);
+    }
+
+    template<class M>
+    template<class V>
+    void SmoothedTransfer<M>::build(const Matrix& fine, const AggregatesMap<V>& aggregates,
+                                    size_type noAggregates, Matrix& coarse, double factor)
+    {
+      const size_type n = fine.N();
+      factor_ = factor;
+      typedef typename Matrix::ConstColIterator ColIterator;
+      typedef typename Matrix::CreateIterator CreateIterator;
+
+      // P has an entry for each aggregate adjacent to a vertex
+      std::vector<size_type> marker(noAggregates, std::numeric_limits<size_type>::max());
+      std::vector<size_type> counts(noAggregates+1, 0);
+      size_type nonzeros=0;
+      for(size_type i=0; i < n; ++i)
+        if(aggregates[i]!=AggregatesMap<V>::ISOLATED)
+          for(ColIterator col = fine[i].begin(); col != fine[i].end(); ++col){
+            const V& aggregate = aggregates[col.index()];
+            if(aggregate!=AggregatesMap<V>::ISOLATED && marker[aggregate]!=i){
+              assert(aggregate!=AggregatesMap<V>::UNAGGREGATED && size_type(aggregate)<noAggregates);
+              marker[aggregate]=i;
+              ++counts[aggregate+1];
+              ++nonzeros;
+            }
+          }
+
+      prolongation_.setSize(n, noAggregates, nonzeros);
+      prolongation_.setBuildMode(Matrix::row_wise);
+      std::fill(marker.begin(), marker.end(), std::numeric_limits<size_type>::max());
+      for(CreateIterator row = prolongation_.createbegin(); row != prolongation_.createend(); ++row){
+        const size_type i = row.index();
+        if(aggregates[i]!=AggregatesMap<V>::ISOLATED)
+          for(ColIterator col = fine[i].begin(); col != fine[i].end(); ++col){
+            const V& aggregate = aggregates[col.index()];
+            if(aggregate!=AggregatesMap<V>::ISOLATED && marker[aggregate]!=i){
+              marker[aggregate]=i;
+              row.insert(aggregate);
+            }
+          }
+      }
+
+      // R is the transpose of P, its rows are filled in increasing order
+      for(size_type a=0; a < noAggregates; ++a)
+        counts[a+1] += counts[a];
+      std::vector<size_type> columns(nonzeros);
+      std::vector<size_type> next(counts.begin(), counts.end()-1);
+      typedef typename Matrix::ConstRowIterator RowIterator;
+      for(RowIterator row = prolongation_.begin(); row != prolongation_.end(); ++row)
+        for(ColIterator col = row->begin(); col != row->end(); ++col)
+          columns[next[col.index()]++] = row.index();
+
+      restriction_.setSize(noAggregates, n, nonzeros);
+      restriction_.setBuildMode(Matrix::row_wise);
+      for(CreateIterator row = restriction_.createbegin(); row != restriction_.createend(); ++row)
+        for(size_type j=counts[row.index()]; j < counts[row.index()+1]; ++j)
+          row.insert(columns[j]);
+
+      multiplyPattern(fine, prolongation_, product_);
+      multiplyPattern(restriction_, product_, coarse);
+      calculate(fine, aggregates, coarse);
+    }
+
+    template<class M>
+    template<class V>
+    void SmoothedTransfer<M>::calculate(const Matrix& fine, const AggregatesMap<V>& aggregates,
+                                        Matrix& coarse)
+    {
+      const size_type n = fine.N();
+      assert(prolongation_.N()==n && restriction_.N()==coarse.N());
+
+      RowPartition partition;
+      partition.build(fine, ISTLThreading::threadsFor(prolongation_.nonzeroes()));
+      std::vector<double> radius(partition.parts());
+      RadiusKernel radiusKernel(fine, partition, radius);
+      parallelFor(partition.parts(), radiusKernel);
+      const double rho = *std::max_element(radius.begin(), radius.end());
+      const field_type omega = rho>0 ? factor_/rho : 0;
+
+      std::vector<size_type> missing(partition.parts());
+      ProlongationKernel<V> prolongationKernel(fine, aggregates, prolongation_, omega, partition,
+                                               missing);
+      parallelFor(partition.parts(), prolongationKernel);
+      const size_type row = *std::min_element(missing.begin(), missing.end());
+      if(row<n)
+        DUNE_THROW(ISTLError, "Row "<<row<<" of the matrix has no diagonal entry!");
+
+      RowPartition coarsePartition;
+      coarsePartition.build(restriction_, ISTLThreading::threadsFor(restriction_.nonzeroes()));
+      TransposeKernel transposeKernel(prolongation_, restriction_, coarsePartition);
+      parallelFor(coarsePartition.parts(), transposeKernel);
+
+      multiply(fine, prolongation_, product_);
+      multiply(restriction_, product_, coarse);
+    }
+
+    template<class M>
+    std::size_t SmoothedTransfer<M>::memory() const
+    {
+      return (prolongation_.nonzeroes()+restriction_.nonzeroes()+product_.nonzeroes())
+        *(sizeof(Block)+sizeof(size_type));
+    }
+
 	/** @} */
       }// namspace Amg
     } // namspace Dune
@@ -500,6 +500,7 @@ namespace Dune {
     {
       _w =w;
       bilu0_decomposition(ILU);	  
+      schedule.build(ILU);
     }
 
     /*!
@@ -516,7 +517,7 @@ namespace Dune {
     */
     virtual void apply (X& v, const Y& d)
     {
-      bilu_backsolve(ILU,v,d);
+      bilu_backsolve(ILU,v,d,schedule);
       v *= _w;
     }
 
@@ -532,6 +533,8 @@ namespace Dune {
     field_type _w;
     //! \brief The ILU0 decomposition of the matrix.
     matrix_type ILU;
+    //! \brief The level schedule of the triangular solves.
+    ILULevelSchedule schedule;
   };
 
 
@@ -579,6 +582,21 @@ namespace Dune {
       _n = n;
       _w = w;
       bilu_decomposition(A,n,ILU);	  
+      schedule.build(ILU);
+    }
+
+    /*!
+      \brief Recompute the decomposition for new values of the matrix.
+
+      The pattern of the decomposition is reused.
+      \param A The matrix, it has to have the pattern of the matrix
+      given to the constructor.
+    */
+    void refactor (const M& A)
+    {
+      for (std::size_t i=0; i<A.N(); ++i)
+        bilu_copy_row(A,ILU,i);
+      bilu0_decomposition(ILU);
     }
 
     /*!
@@ -595,7 +613,7 @@ namespace Dune {
     */
     virtual void apply (X& v, const Y& d)
     {
-      bilu_backsolve(ILU,v,d);
+      bilu_backsolve(ILU,v,d,schedule);
       v *= _w;
     }
 
@@ -609,6 +627,8 @@ namespace Dune {
   private:
     //! \brief ILU(n) decomposition of the matrix we operate on.
     matrix_type ILU;
+    //! \brief The level schedule of the triangular solves.
+    ILULevelSchedule schedule;
     //! \brief The number of steps to perform in apply.
     int _n;
     //! \brief The relaxation factor to use.
@@ -617,6 +637,220 @@ namespace Dune {
 
 
 
+  /*! 
+    \brief Sequential ILUT preconditioner.
+
+    Wraps the ILU decomposition with threshold bilut_decomposition()
+    into the solver framework. In contrast to SeqILUn the fill is chosen
+    by the size of the entries, which suits convection dominated
+    problems, and the memory is bounded by 2p+1 blocks per row.
+
+    \tparam M The matrix type to operate on
+    \tparam X Type of the update
+    \tparam Y Type of the defect
+    \tparam l Ignored. Just there to have the same number of template arguments
+    as other preconditioners.
+  */
+  template<class M, class X, class Y, int l=1>
+  class SeqILUT : public Preconditioner<X,Y> {
+  public:
+    //! \brief The matrix type the preconditioner is for.
+    typedef typename Dune::remove_const<M>::type matrix_type;
+    //! \brief The domain type of the preconditioner.
+    typedef X domain_type;
+    //! \brief The range type of the preconditioner.
+    typedef Y range_type;
+    //! \brief The field type of the preconditioner.
+    typedef typename X::field_type field_type;
+
+    // define the category
+    enum {
+      //! \brief The category the preconditioner is part of.
+      category=SolverCategory::sequential
+    };
+
+    /*! \brief Constructor.
+      
+    Constructor gets all parameters to operate the prec.
+    \param A The matrix to operate on.
+    \param tau The drop tolerance relative to the norm of the row.
+    \param p The maximum number of entries of L and of U per row.
+    \param w The relaxation factor.
+    */
+    SeqILUT (const M& A, double tau, int p, field_type w)
+      : ILU(A.N(),A.M(),M::row_wise)
+    {
+      _w = w;
+      bilut_decomposition(A,tau,p,ILU);
+      schedule.build(ILU);
+    }
+
+    /*!
+      \brief Prepare the preconditioner.
+      
+      \copydoc Preconditioner::pre(X&,Y&)
+    */
+    virtual void pre (X& x, Y& b) {}
+
+    /*!
+      \brief Apply the precondioner.
+      
+      \copydoc Preconditioner::apply(X&,const Y&)
+    */
+    virtual void apply (X& v, const Y& d)
+    {
+      bilu_backsolve(ILU,v,d,schedule);
+      v *= _w;
+    }
+
+    /*!
+      \brief Clean up.
+      
+      \copydoc Preconditioner::post(X&)
+    */
+    virtual void post (X& x) {}
+
+    //! \brief The number of blocks of the decomposition.
+    std::size_t nonzeroes () const
+    {
+      std::size_t nonzeros=0;
+      for (typename matrix_type::ConstRowIterator i=ILU.begin(); i!=ILU.end(); ++i)
+        nonzeros += i->size();
+      return nonzeros;
+    }
+
+  private:
+    //! \brief ILUT decomposition of the matrix we operate on.
+    matrix_type ILU;
+    //! \brief The level schedule of the triangular solves.
+    ILULevelSchedule schedule;
+    //! \brief The relaxation factor to use.
+    field_type _w;
+  };
+
+
+
+  /*! 
+    \brief Sequential iterative ILU(n) preconditioner.
+
+    The rows are split into one block of consecutive rows per thread,
+    ISTLThreading::threadsFor(nonzeros of the decomposition) of them.
+    The ILU(n) decomposition is computed by a block-row fixed point
+    iteration and the triangular solves are approximated by Jacobi
+    sweeps over the blocks: each thread treats its own block exactly and
+    in order and only takes the entries of the other blocks from the
+    previous sweep. In contrast to SeqILU0 and SeqILUn both the setup
+    and the application run in parallel.
+
+    Therefore the factors and the preconditioner depend on the number of
+    threads. With one thread this is SeqILUn, with t threads the
+    decomposition and the solves are exact after t sweeps. Typically a
+    few sweeps suffice. New values of a matrix with the same pattern only
+    need a call of refactor().
+
+    \tparam M The matrix type to operate on
+    \tparam X Type of the update
+    \tparam Y Type of the defect
+    \tparam l Ignored. Just there to have the same number of template arguments
+    as other preconditioners.
+  */
+  template<class M, class X, class Y, int l=1>
+  class SeqIterativeILU : public Preconditioner<X,Y> {
+  public:
+    //! \brief The matrix type the preconditioner is for.
+    typedef typename Dune::remove_const<M>::type matrix_type;
+    //! \brief The domain type of the preconditioner.
+    typedef X domain_type;
+    //! \brief The range type of the preconditioner.
+    typedef Y range_type;
+    //! \brief The field type of the preconditioner.
+    typedef typename X::field_type field_type;
+
+    // define the category
+    enum {
+      //! \brief The category the preconditioner is part of.
+      category=SolverCategory::sequential
+    };
+
+    /*! \brief Constructor.
+      
+    Constructor gets all parameters to operate the prec.
+    \param A The matrix to operate on.
+    \param n The level of fill-in of the decomposition.
+    \param w The relaxation factor.
+    \param sweeps The number of sweeps of the decomposition.
+    \param solveSweeps The number of Jacobi sweeps of each triangular solve.
+    */
+    SeqIterativeILU (const M& A, int n, field_type w, int sweeps=3, int solveSweeps=3)
+      : ILU(A.N(),A.M(),M::row_wise), _w1(A.N()), _w2(A.N()),
+        _w(w), _sweeps(sweeps), _solveSweeps(solveSweeps)
+    {
+      bilu_pattern(A,n,ILU);
+      tmp = ILU;
+      refactor(A);
+    }
+
+    /*!
+      \brief Recompute the decomposition for new values of the matrix.
+
+      \param A The matrix, it has to have the pattern of the matrix
+      given to the constructor.
+    */
+    void refactor (const M& A)
+    {
+      std::size_t nonzeros=0;
+      for (typename matrix_type::ConstRowIterator i=ILU.begin(); i!=ILU.end(); ++i)
+        nonzeros += i->size();
+      const int threads = ISTLThreading::threadsFor(nonzeros);
+      if (partition.parts()!=threads)
+        partition.build(ILU, threads);
+      bilu_iterative_decomposition(A,ILU,tmp,_sweeps,partition);
+    }
+
+    /*!
+      \brief Prepare the preconditioner.
+      
+      \copydoc Preconditioner::pre(X&,Y&)
+    */
+    virtual void pre (X& x, Y& b) {}
+
+    /*!
+      \brief Apply the precondioner.
+      
+      \copydoc Preconditioner::apply(X&,const Y&)
+    */
+    virtual void apply (X& v, const Y& d)
+    {
+      bilu_jacobi_backsolve(ILU,v,d,_w1,_w2,_solveSweeps,partition);
+      v *= _w;
+    }
+
+    /*!
+      \brief Clean up.
+      
+      \copydoc Preconditioner::post(X&)
+    */
+    virtual void post (X& x) {}
+
+  private:
+    //! \brief The decomposition of the matrix we operate on.
+    matrix_type ILU;
+    //! \brief The previous iterate of the decomposition.
+    matrix_type tmp;
+    //! \brief The partition of the rows to the threads.
+    RowPartition partition;
+    //! \brief The iterates of the triangular solves.
+    X _w1, _w2;
+    //! \brief The relaxation factor to use.
+    field_type _w;
+    //! \brief The number of sweeps of the decomposition.
+    int _sweeps;
+    //! \brief The number of sweeps of the triangular solves.
+    int _solveSweeps;
+  };
+
+
+
   /*! 
     \brief Richardson preconditioner.
 
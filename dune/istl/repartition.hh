@@ -31,6 +31,30 @@
 
 namespace Dune 
 {
+  /**
+   * @brief The domain of a process if blocks of consecutive processes are merged.
+   *
+   * This is the repartitioning of graphRepartition() without ParMETIS.
+   * Process rank of procs processes goes to domain rank*domains/procs,
+   * thus the blocks differ in size by at most one process.
+   * @param rank The rank of the process.
+   * @param procs The number of processes, at least domains.
+   * @param domains The number of domains.
+   */
+  inline int mergedDomain(int rank, int procs, int domains)
+  {
+    return static_cast<int>((static_cast<long>(rank)*domains)/procs);
+  }
+
+  /**
+   * @brief The process a domain of mergedDomain() is moved to, the first
+   * process of its block.
+   */
+  inline int mergedDomainProcess(int domain, int procs, int domains)
+  {
+    return static_cast<int>((static_cast<long>(domain)*procs+domains-1)/domains);
+  }
+
 #if HAVE_MPI
     /**
      * @brief Fills the holes in an index set.
@@ -1198,7 +1222,8 @@ namespace Dune
    * @brief execute a graph repartition for a giving graph and indexset.
    *
    * This function provides repartition functionality using the 
-   * PARMETIS library
+   * PARMETIS library. Without PARMETIS the domains are formed by
+   * blocks of consecutive processes.
    *
    * @param graph The given graph to repartition
    * @param oocomm The parallel information about the graph.
@@ -1271,11 +1296,16 @@ namespace Dune
       part[i]=mype;
 
 #if !HAVE_PARMETIS
-    if(oocomm.communicator().rank()==0 && nparts>1)
-      std::cerr<<"ParMETIS not activated. Will repartition to 1 domain instead of requested "
-	       <<nparts<<" domains."<<std::endl;
-    nparts=1; // No parmetis available, fallback to agglomerating to 1 process
-    
+    if(nparts>1){
+      // No parmetis available, fallback to merging blocks of consecutive
+      // processes. Neighbouring ranks usually hold neighbouring parts.
+      if(verbose && oocomm.communicator().rank()==0)
+	std::cout<<"ParMETIS not activated. Merging blocks of consecutive processes into "
+		 <<nparts<<" domains."<<std::endl;
+      const int npes = oocomm.communicator().size();
+      for(std::size_t i=0; i < indexMap.numOfOwnVtx(); ++i)
+	part[i]=mergedDomain(mype, npes, nparts);
+    }else
 #else
 
     if(nparts>1){
@@ -1388,9 +1418,17 @@ namespace Dune
     //
   
     std::vector<int> domainMapping(nparts);
-    if(nparts>1)
+    if(nparts>1){
+#if HAVE_PARMETIS
       getDomain(comm, part, indexMap.numOfOwnVtx(), nparts, &myDomain, domainMapping);
-    else
+#else
+      // Each block is mapped to its first process.
+      const int npes = oocomm.communicator().size();
+      for(int d=0; d < nparts; ++d)
+	domainMapping[d]=mergedDomainProcess(d, npes, nparts);
+      myDomain=mergedDomain(mype, npes, nparts);
+#endif
+    }else
       domainMapping[0]=0;
     
 #ifdef DEBUG_REPART
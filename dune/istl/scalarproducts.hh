@@ -8,6 +8,7 @@
 #include<string>
 
 #include"solvercategory.hh"
+#include"bvector.hh"
 
 
 namespace Dune {
@@ -55,6 +56,48 @@ sequential case are provided.
 	 */
 	virtual double norm (const X& x) = 0;
 
+	/*! \brief Computes y += a*x and returns the norm of the updated y.
+
+	  The default implementation performs the two operations one after
+	  the other. Implementations may fuse them into a single pass.
+	 */
+	virtual double axpyNorm (X& y, const field_type& a, const X& x)
+	{
+	  y.axpy(a,x);
+	  return norm(y);
+	}
+
+	/*! \brief Computes y += a*x and returns the dot product of the
+	  updated y with z.
+
+	  The default implementation performs the two operations one after
+	  the other. Implementations may fuse them into a single pass.
+	 */
+	virtual field_type axpyDot (X& y, const field_type& a, const X& x, const X& z)
+	{
+	  y.axpy(a,x);
+	  return dot(y,z);
+	}
+
+	/*! \brief Start computing the dot products x[k]*y[k] for k<n.
+
+	  The results are only valid after finishDots() has been called.
+	  Parallel implementations combine all products into one global
+	  reduction that runs in the background, such that the caller can
+	  apply the operator and the preconditioner in the meantime. Only one
+	  batch of dot products may be pending at any time.
+
+	  The default implementation computes the products immediately.
+	 */
+	virtual void startDots (const X* const* x, const X* const* y, int n, field_type* result)
+	{
+	  for (int k=0; k<n; k++)
+		result[k] = dot(*x[k],*y[k]);
+	}
+
+	//! \brief Wait for the dot products started with startDots().
+	virtual void finishDots ()
+	{}
 
 	//! every abstract base class has a virtual destructor
 	virtual ~ScalarProduct () {}
@@ -115,6 +158,18 @@ sequential case are provided.
 	{
 	  return x.two_norm();
 	}
+
+	//! y += a*x and the norm of y in a single pass
+	virtual double axpyNorm (X& y, const field_type& a, const X& x)
+	{
+	  return FusedVectorOps<X>::axpyTwoNorm(y,a,x);
+	}
+
+	//! y += a*x and the dot product of y with z in a single pass
+	virtual field_type axpyDot (X& y, const field_type& a, const X& x, const X& z)
+	{
+	  return FusedVectorOps<X>::axpyDot(y,a,x,z);
+	}
   };
 
   template<class X, class C>
@@ -0,0 +1,381 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_SLICEDELLMATRIX_HH
+#define DUNE_ISTL_SLICEDELLMATRIX_HH
+
+#include<vector>
+#include<map>
+#include<algorithm>
+#include<utility>
+
+#include "istlexception.hh"
+#include "threading.hh"
+
+/** \file
+ * \brief Implementation of the SlicedEllMatrix class
+ */
+
+namespace Dune {
+  /**
+   * @addtogroup ISTL_SPMV
+   * @{
+   */
+
+  /**
+   * @brief A sparse block matrix in sliced ELLPACK (SELL-C-sigma) storage.
+   *
+   * The rows are grouped into chunks of C consecutive rows. Each chunk is
+   * padded to the length of its longest row and stored column major, i.e.
+   * the k-th entries of the C rows of a chunk are adjacent in memory. The
+   * innermost loop of the matrix-vector product thus runs over C
+   * independent rows and vectorizes for scalar blocks.
+   *
+   * To reduce the padding the rows are sorted by descending length within
+   * windows of sigma rows before they are grouped into chunks. The products
+   * take care of the permutation, the vectors keep their original ordering.
+   *
+   * The matrix is constructed from an already assembled matrix, usually a
+   * BCRSMatrix, and cannot be changed afterwards except for assigning new
+   * values of a matrix with the same pattern. It supports the products
+   * needed by MatrixAdapter. Preconditioners still need the original
+   * matrix.
+   *
+   * \code
+   * BCRSMatrix<FieldMatrix<double,1,1> > A;
+   * ...
+   * SlicedEllMatrix<FieldMatrix<double,1,1> > S(A);
+   * MatrixAdapter<SlicedEllMatrix<FieldMatrix<double,1,1> >,Vector,Vector> op(S);
+   * \endcode
+   *
+   * Padding entries are zero blocks referring to the last column of their
+   * row, thus the input vector must not contain infinite values.
+   */
+  template<class B, class A=std::allocator<B> >
+  class SlicedEllMatrix
+  {
+  public:
+    //! export the type representing the field
+    typedef typename B::field_type field_type;
+
+    //! export the type representing the components
+    typedef B block_type;
+
+    //! export the allocator type
+    typedef A allocator_type;
+
+    //! The type for the index access and the size
+    typedef typename A::size_type size_type;
+
+    //! increment block level counter
+    enum {
+      //! The number of blocklevels the matrix contains.
+      blocklevel = B::blocklevel+1
+    };
+
+    //! an empty matrix
+    SlicedEllMatrix()
+      : n(0), m(0), nnz(0), chunkSize_(8), sigma_(1), chunkOffset_(1,0)
+    {}
+
+    /**
+     * @brief Construct from an assembled matrix.
+     * @param mat The matrix to convert, e.g. a BCRSMatrix<B>.
+     * @param chunkSize The number of rows per chunk, C. Should be a multiple
+     * of the SIMD width.
+     * @param sigma The size of the windows the rows are sorted in. Values
+     * smaller than chunkSize disable the sorting.
+     */
+    template<class M>
+    explicit SlicedEllMatrix(const M& mat, size_type chunkSize=8, size_type sigma=128)
+      : chunkSize_(std::max(chunkSize,size_type(1))), sigma_(sigma)
+    {
+      build(mat);
+    }
+
+    /**
+     * @brief Set up the storage and values from an assembled matrix.
+     * @param mat The matrix to convert.
+     */
+    template<class M>
+    void build(const M& mat)
+    {
+      n = mat.N();
+      m = mat.M();
+      nnz = 0;
+
+      typedef typename M::ConstRowIterator RowIterator;
+      typedef typename M::ConstColIterator ColIterator;
+
+      // sort the rows by descending length within windows of sigma rows
+      std::vector<std::pair<size_type,size_type> > rows(n);
+      for(RowIterator i=mat.begin(); i!=mat.end(); ++i)
+        rows[i.index()]=std::make_pair(size_type(i->size()), size_type(i.index()));
+
+      if(sigma_>1 && sigma_>=chunkSize_)
+        for(size_type w=0; w<n; w+=sigma_)
+          std::stable_sort(rows.begin()+w, rows.begin()+std::min(w+sigma_,n),
+                           LongerRow());
+
+      const size_type chunks = (n+chunkSize_-1)/chunkSize_;
+      perm_.assign(chunks*chunkSize_, n);
+      chunkOffset_.resize(chunks+1);
+      chunkOffset_[0] = 0;
+
+      for(size_type c=0; c<chunks; ++c){
+        size_type width=0;
+        for(size_type r=0; r<chunkSize_ && c*chunkSize_+r<n; ++r){
+          perm_[c*chunkSize_+r] = rows[c*chunkSize_+r].second;
+          width = std::max(width, rows[c*chunkSize_+r].first);
+        }
+        chunkOffset_[c+1] = chunkOffset_[c]+width*chunkSize_;
+      }
+
+      values_.assign(chunkOffset_[chunks], B(static_cast<field_type>(0)));
+      cols_.assign(chunkOffset_[chunks], 0);
+
+      for(size_type c=0; c<chunks; ++c){
+        const size_type width = (chunkOffset_[c+1]-chunkOffset_[c])/chunkSize_;
+        for(size_type r=0; r<chunkSize_; ++r){
+          const size_type row = perm_[c*chunkSize_+r];
+          size_type k=0, col=0;
+          if(row<n){
+            ColIterator endj = mat[row].end();
+            for(ColIterator j=mat[row].begin(); j!=endj; ++j, ++k){
+              col = j.index();
+              values_[chunkOffset_[c]+k*chunkSize_+r] = *j;
+              cols_[chunkOffset_[c]+k*chunkSize_+r] = col;
+            }
+            nnz += k;
+          }
+          // pad with zero blocks in the last column of the row
+          for(; k<width; ++k)
+            cols_[chunkOffset_[c]+k*chunkSize_+r] = col;
+        }
+      }
+
+      partitions_.clear();
+    }
+
+    /**
+     * @brief Copy new values from a matrix with the pattern used in build().
+     */
+    template<class M>
+    void updateValues(const M& mat)
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if(mat.N()!=n || mat.M()!=m)
+        DUNE_THROW(ISTLError, "Matrix sizes do not match!");
+#endif
+      typedef typename M::ConstColIterator ColIterator;
+      const size_type chunks = chunkOffset_.size()-1;
+      for(size_type c=0; c<chunks; ++c)
+        for(size_type r=0; r<chunkSize_; ++r){
+          const size_type row = perm_[c*chunkSize_+r];
+          if(row>=n)
+            continue;
+          size_type k=0;
+          ColIterator endj = mat[row].end();
+          for(ColIterator j=mat[row].begin(); j!=endj; ++j, ++k)
+            values_[chunkOffset_[c]+k*chunkSize_+r] = *j;
+        }
+    }
+
+    //===== linear maps
+
+    //! y = A x
+    template<class X, class Y>
+    void mv (const X& x, Y& y) const
+    {
+      apply(ChunkKernel<X,Y>::assign, 1, x, y);
+    }
+
+    //! y += A x
+    template<class X, class Y>
+    void umv (const X& x, Y& y) const
+    {
+      apply(ChunkKernel<X,Y>::add, 1, x, y);
+    }
+
+    //! y -= A x
+    template<class X, class Y>
+    void mmv (const X& x, Y& y) const
+    {
+      apply(ChunkKernel<X,Y>::scaledAdd, -1, x, y);
+    }
+
+    //! y += alpha A x
+    template<class X, class Y>
+    void usmv (const field_type& alpha, const X& x, Y& y) const
+    {
+      apply(ChunkKernel<X,Y>::scaledAdd, alpha, x, y);
+    }
+
+    //===== sizes
+
+    //! number of rows (counted in blocks)
+    size_type N () const
+    {
+      return n;
+    }
+
+    //! number of columns (counted in blocks)
+    size_type M () const
+    {
+      return m;
+    }
+
+    //! number of blocks of the original matrix
+    size_type nonzeroes () const
+    {
+      return nnz;
+    }
+
+    //! number of blocks stored including the padding
+    size_type storedBlocks () const
+    {
+      return values_.size();
+    }
+
+    //! the number of rows per chunk
+    size_type chunkSize () const
+    {
+      return chunkSize_;
+    }
+
+  private:
+    //! Orders rows by descending length
+    struct LongerRow
+    {
+      bool operator()(const std::pair<size_type,size_type>& a,
+                      const std::pair<size_type,size_type>& b) const
+      {
+        return a.first>b.first;
+      }
+    };
+
+    /**
+     * @brief Functor computing the product for the chunks of one
+     * part, used with parallelFor().
+     */
+    template<class X, class Y>
+    class ChunkKernel
+    {
+    public:
+      enum Operation { assign, add, scaledAdd };
+
+      ChunkKernel(const SlicedEllMatrix& mat, const RowPartition& partition,
+                  Operation op, const field_type& alpha, const X& x, Y& y)
+        : A_(mat), partition_(partition), op_(op), alpha_(alpha), x_(x), y_(y)
+      {}
+
+      void operator()(int p) const
+      {
+        A_.applyChunks(op_, alpha_, x_, y_, partition_.first(p), partition_.last(p));
+      }
+
+    private:
+      const SlicedEllMatrix& A_;
+      const RowPartition& partition_;
+      Operation op_;
+      field_type alpha_;
+      const X& x_;
+      Y& y_;
+    };
+
+    template<class X, class Y>
+    void apply (typename ChunkKernel<X,Y>::Operation op, const field_type& alpha,
+                const X& x, Y& y) const
+    {
+#ifdef DUNE_ISTL_WITH_CHECKING
+      if (x.N()!=M()) DUNE_THROW(ISTLError,"index out of range");
+      if (y.N()!=N()) DUNE_THROW(ISTLError,"index out of range");
+#endif
+      const size_type chunks = chunkOffset_.size()-1;
+      const int threads = ISTLThreading::threadsFor(values_.size());
+      if (threads>1)
+        {
+          const RowPartition* partition;
+          {
+            ISTLScopedLock lock(partitionMutex_);
+            RowPartition& chunkPartition = partitions_[threads];
+            if (chunkPartition.parts()!=threads)
+              chunkPartition.buildFromOffsets(chunkOffset_, threads);
+            partition = &chunkPartition;
+          }
+          ChunkKernel<X,Y> kernel(*this, *partition, op, alpha, x, y);
+          parallelFor(threads, kernel);
+        }
+      else
+        applyChunks(op, alpha, x, y, 0, chunks);
+    }
+
+    //! the number of rows of a chunk whose sums are kept on the stack at once
+    enum { rowsPerPass = 32 };
+
+    /**
+     * @brief The product for the chunks [first,last).
+     *
+     * Chunks with more than rowsPerPass rows are processed in several
+     * passes over their columns.
+     */
+    template<class X, class Y>
+    void applyChunks (typename ChunkKernel<X,Y>::Operation op, const field_type& alpha,
+                      const X& x, Y& y, size_type first, size_type last) const
+    {
+      typedef typename Y::block_type YBlock;
+      YBlock tmp[rowsPerPass];
+
+      for (size_type c=first; c<last; ++c)
+        for (size_type r0=0; r0<chunkSize_; r0+=rowsPerPass)
+          {
+            const size_type rows = std::min(size_type(rowsPerPass), chunkSize_-r0);
+            for (size_type r=0; r<rows; ++r)
+              tmp[r] = 0;
+
+            // the innermost loop runs over the independent rows of the chunk
+            for (size_type k=chunkOffset_[c]+r0; k<chunkOffset_[c+1]; k+=chunkSize_)
+              {
+                const B* values = &values_[k];
+                const size_type* cols = &cols_[k];
+                for (size_type r=0; r<rows; ++r)
+                  values[r].umv(x[cols[r]], tmp[r]);
+              }
+
+            const size_type* perm = &perm_[c*chunkSize_+r0];
+            for (size_type r=0; r<rows && perm[r]<n; ++r)
+              switch(op){
+              case ChunkKernel<X,Y>::assign:
+                y[perm[r]] = tmp[r];
+                break;
+              case ChunkKernel<X,Y>::add:
+                y[perm[r]] += tmp[r];
+                break;
+              case ChunkKernel<X,Y>::scaledAdd:
+                y[perm[r]].axpy(alpha, tmp[r]);
+                break;
+              }
+          }
+    }
+
+    size_type n;   // number of rows
+    size_type m;   // number of columns
+    size_type nnz; // number of blocks without padding
+    size_type chunkSize_; // C
+    size_type sigma_;     // window of the row sorting
+
+    std::vector<B,A> values_;            // [chunkOffset_.back()] blocks, chunk-wise column major
+    std::vector<size_type> cols_;        // [chunkOffset_.back()] column index of each block
+    std::vector<size_type> chunkOffset_; // [chunks+1] offset of each chunk into values_
+    std::vector<size_type> perm_;        // [chunks*C] original row of each slot, n for padding
+
+    // partitions of the chunks used by the threaded kernels by number
+    // of parts, each is built once
+    mutable std::map<int,RowPartition> partitions_;
+    mutable ISTLMutex partitionMutex_;
+  };
+
+  /** @} end documentation */
+
+} // end namespace Dune
+
+#endif
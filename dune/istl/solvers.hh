@@ -9,6 +9,9 @@
 #include<iostream>
 #include<iomanip>
 #include<string>
+#include<algorithm>
+#include<limits>
+#include<vector>
 
 #include "istlexception.hh"
 #include "operators.hh"
@@ -572,10 +575,9 @@ namespace Dune {
         alpha = _sp.dot(p,q);       // scalar product
         lambda = rholast/alpha;     // minimization
         x.axpy(lambda,p);           // update solution
-        b.axpy(-lambda,q);          // update defect
 
-        // convergence test
-        double defnew=_sp.norm(b);// comp defect norm
+        // update defect and compute its norm in one pass
+        double defnew=_sp.axpyNorm(b,-lambda,q);
 
         if (_verbose>1)             // print
           this->printOutput(std::cout,i,defnew,def);
@@ -592,8 +594,8 @@ namespace Dune {
         _prec.apply(q,b);           // apply preconditioner
         rho = _sp.dot(q,b);         // orthogonalization
         beta = rho/rholast;         // scaling factor
-        p *= beta;                  // scale old search direction
-        p += q;                     // orthogonalization with correction
+        // scale old search direction and orthogonalize with correction
+        FusedVectorOps<X>::aypx(p,beta,q);
         rholast = rho;              // remember rho for recurrence
       }
 
@@ -639,6 +641,416 @@ namespace Dune {
   };
 
 
+  /*!
+    \brief Pipelined conjugate gradient method
+
+    Preconditioned CG in the formulation of Ghysels and Vanroose
+    (Hiding global synchronization latency in the preconditioned
+    Conjugate Gradient algorithm, Parallel Computing 40, 2014). All dot
+    products of an iteration are combined into a single global reduction
+    that is started with ScalarProduct::startDots() and overlapped with
+    the application of the preconditioner and the operator. With MPI-3
+    the parallel scalar products use a non-blocking allreduce for this.
+
+    Compared to CGSolver the method needs four more vectors, the residual
+    is updated by recurrences only, and the convergence test sees the
+    defect of the previous iteration, i.e. the method performs one
+    preconditioner and operator application more than CG. In exact
+    arithmetic the iterates are the same as those of CG.
+  */
+  template<class X>
+  class PipelinedCGSolver : public InverseOperator<X,X> {
+  public:
+    //! \brief The domain type of the operator to be inverted.
+    typedef X domain_type;
+    //! \brief The range type of the operator to be inverted.
+    typedef X range_type;
+    //! \brief The field type of the operator to be inverted.
+    typedef typename X::field_type field_type;
+
+    /*!
+      \brief Set up pipelined conjugate gradient solver.
+
+      \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
+    */
+    template<class L, class P>
+    PipelinedCGSolver (L& op, P& prec, double reduction, int maxit, int verbose) :
+      ssp(), _op(op), _prec(prec), _sp(ssp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    {
+      dune_static_assert( static_cast<int>(L::category) == static_cast<int>(P::category),
+        "L and P must have the same category!");
+      dune_static_assert( static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
+        "L must be sequential!");
+    }
+    /*!
+      \brief Set up pipelined conjugate gradient solver.
+
+      \copydoc LoopSolver::LoopSolver(L&,S&,P&,double,int,int)
+    */
+    template<class L, class S, class P>
+    PipelinedCGSolver (L& op, S& sp, P& prec, double reduction, int maxit, int verbose) :
+      _op(op), _prec(prec), _sp(sp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    {
+      dune_static_assert( static_cast<int>(L::category) == static_cast<int>(P::category),
+        "L and P must have the same category!");
+      dune_static_assert( static_cast<int>(L::category) == static_cast<int>(S::category),
+        "L and S must have the same category!");
+    }
+
+    /*!
+      \brief Apply inverse operator.
+
+      \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
+    */
+    virtual void apply (X& x, X& b, InverseOperatorResult& res)
+    {
+      res.clear();                  // clear solver statistics
+      Timer watch;                // start a timer
+      _prec.pre(x,b);             // prepare preconditioner
+      _op.applyscaleadd(-1,x,b);  // overwrite b with defect
+
+      X& r=b;              // the defect
+      X u(x), w(x);        // u = M^-1 r, w = A u
+      X m(x), n(x);        // m = M^-1 w, n = A m
+      X p(x), s(x), q(x), z(x); // search direction p and s = A p, q = M^-1 s, z = A q
+
+      p = 0; s = 0; q = 0; z = 0;
+      u = 0;
+      _prec.apply(u,r);
+      _op.apply(u,w);
+
+      // (r,u), (w,u) and (r,r) in one reduction
+      const X* left[3] = { &r, &w, &r };
+      const X* right[3] = { &u, &u, &r };
+      field_type dots[3];
+
+      double def0=0, def=0;
+      field_type gamma, gammalast=0, alpha, alphalast=0, beta;
+
+      int i=0;
+      for ( ; ; i++ )
+      {
+        _sp.startDots(left,right,3,dots);
+
+        // hidden behind the reduction
+        m = 0;
+        _prec.apply(m,w);
+        _op.apply(m,n);
+
+        _sp.finishDots();
+        gamma = dots[0];
+        double defnew = std::sqrt(std::abs(dots[2]));
+
+        if (i==0)
+        {
+          def0 = def = defnew;
+          if (def0<1E-30)    // convergence check
+          {
+            res.converged  = true;
+            break;
+          }
+          if (_verbose>0)             // printing
+          {
+            std::cout << "=== PipelinedCGSolver" << std::endl;
+            if (_verbose>1) {
+              this->printHeader(std::cout);
+              this->printOutput(std::cout,0,def0);
+            }
+          }
+        }
+        else
+        {
+          if (_verbose>1)             // print
+            this->printOutput(std::cout,i,defnew,def);
+
+          def = defnew;               // update norm
+          if (def<def0*_reduction || def<1E-30)    // convergence check
+          {
+            res.converged  = true;
+            break;
+          }
+        }
+        if (i==_maxit)
+          break;
+
+        if (i==0)
+        {
+          beta = 0;
+          alpha = gamma/dots[1];
+        }
+        else
+        {
+          beta = gamma/gammalast;
+          alpha = gamma/(dots[1]-beta*gamma/alphalast);
+        }
+
+        // recurrences for the search directions and their images
+        FusedVectorOps<X>::aypx(z,beta,n);
+        FusedVectorOps<X>::aypx(q,beta,m);
+        FusedVectorOps<X>::aypx(s,beta,w);
+        FusedVectorOps<X>::aypx(p,beta,u);
+
+        x.axpy(alpha,p);            // update solution
+        r.axpy(-alpha,s);           // update defect
+        u.axpy(-alpha,q);
+        w.axpy(-alpha,z);
+
+        gammalast = gamma;
+        alphalast = alpha;
+      }
+
+      if (def0<1E-30)
+      {
+        res.iterations = 0;               // fill statistics
+        res.reduction = 0;
+        res.conv_rate  = 0;
+        res.elapsed=0;
+        _prec.post(x);
+        if (_verbose>0)                 // final print
+          std::cout << "=== rate=" << res.conv_rate
+                    << ", T=" << res.elapsed << ", TIT=" << res.elapsed
+                    << ", IT=0" << std::endl;
+        return;
+      }
+
+      if (_verbose==1)                // printing for non verbose
+        this->printOutput(std::cout,i,def);
+
+      _prec.post(x);                  // postprocess preconditioner
+      res.iterations = i;               // fill statistics
+      res.reduction = def/def0;
+      res.conv_rate  = pow(res.reduction,1.0/std::max(i,1));
+      res.elapsed = watch.elapsed();
+
+      if (_verbose>0)                 // final print
+      {
+        std::cout << "=== rate=" << res.conv_rate
+                  << ", T=" << res.elapsed
+                  << ", TIT=" << res.elapsed/std::max(i,1)
+                  << ", IT=" << i << std::endl;
+      }
+    }
+
+    /*!
+      \brief Apply inverse operator with given reduction factor.
+
+      \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
+    */
+    virtual void apply (X& x, X& b, double reduction,
+      InverseOperatorResult& res)
+    {
+      std::swap(_reduction,reduction);
+      (*this).apply(x,b,res);
+      std::swap(_reduction,reduction);
+    }
+
+  private:
+    SeqScalarProduct<X> ssp;
+    LinearOperator<X,X>& _op;
+    Preconditioner<X,X>& _prec;
+    ScalarProduct<X>& _sp;
+    double _reduction;
+    int _maxit;
+    int _verbose;
+  };
+
+
+  /*!
+    \brief Conjugate gradient method with a single reduction per iteration
+
+    Preconditioned CG as reformulated by Chronopoulos and Gear (s-step
+    iterative methods for symmetric linear systems, J. Comput. Appl. Math.
+    25, 1989). The dot products (r,M^-1 r) and (A M^-1 r,M^-1 r) and the
+    defect norm are computed together in one global reduction instead of
+    the two reductions of CGSolver. The reduction cannot be overlapped
+    with computation, see PipelinedCGSolver for that. The method needs
+    two more vectors than CG and updates the residual by recurrences.
+  */
+  template<class X>
+  class ChronopoulosGearCGSolver : public InverseOperator<X,X> {
+  public:
+    //! \brief The domain type of the operator to be inverted.
+    typedef X domain_type;
+    //! \brief The range type of the operator to be inverted.
+    typedef X range_type;
+    //! \brief The field type of the operator to be inverted.
+    typedef typename X::field_type field_type;
+
+    /*!
+      \brief Set up the single reduction conjugate gradient solver.
+
+      \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
+    */
+    template<class L, class P>
+    ChronopoulosGearCGSolver (L& op, P& prec, double reduction, int maxit, int verbose) :
+      ssp(), _op(op), _prec(prec), _sp(ssp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    {
+      dune_static_assert( static_cast<int>(L::category) == static_cast<int>(P::category),
+        "L and P must have the same category!");
+      dune_static_assert( static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
+        "L must be sequential!");
+    }
+    /*!
+      \brief Set up the single reduction conjugate gradient solver.
+
+      \copydoc LoopSolver::LoopSolver(L&,S&,P&,double,int,int)
+    */
+    template<class L, class S, class P>
+    ChronopoulosGearCGSolver (L& op, S& sp, P& prec, double reduction, int maxit, int verbose) :
+      _op(op), _prec(prec), _sp(sp), _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    {
+      dune_static_assert( static_cast<int>(L::category) == static_cast<int>(P::category),
+        "L and P must have the same category!");
+      dune_static_assert( static_cast<int>(L::category) == static_cast<int>(S::category),
+        "L and S must have the same category!");
+    }
+
+    /*!
+      \brief Apply inverse operator.
+
+      \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
+    */
+    virtual void apply (X& x, X& b, InverseOperatorResult& res)
+    {
+      res.clear();                  // clear solver statistics
+      Timer watch;                // start a timer
+      _prec.pre(x,b);             // prepare preconditioner
+      _op.applyscaleadd(-1,x,b);  // overwrite b with defect
+
+      X& r=b;              // the defect
+      X u(x), w(x);        // u = M^-1 r, w = A u
+      X p(x), s(x);        // the search direction and s = A p
+
+      p = 0; s = 0;
+
+      // (r,u), (w,u) and (r,r) in one reduction
+      const X* left[3] = { &r, &w, &r };
+      const X* right[3] = { &u, &u, &r };
+      field_type dots[3];
+
+      double def0=0, def=0;
+      field_type gamma, gammalast=0, alpha, alphalast=0, beta;
+
+      int i=0;
+      for ( ; ; i++ )
+      {
+        u = 0;
+        _prec.apply(u,r);
+        _op.apply(u,w);
+
+        _sp.startDots(left,right,3,dots);
+        _sp.finishDots();
+        gamma = dots[0];
+        double defnew = std::sqrt(std::abs(dots[2]));
+
+        if (i==0)
+        {
+          def0 = def = defnew;
+          if (def0<1E-30)    // convergence check
+          {
+            res.converged  = true;
+            break;
+          }
+          if (_verbose>0)             // printing
+          {
+            std::cout << "=== ChronopoulosGearCGSolver" << std::endl;
+            if (_verbose>1) {
+              this->printHeader(std::cout);
+              this->printOutput(std::cout,0,def0);
+            }
+          }
+        }
+        else
+        {
+          if (_verbose>1)             // print
+            this->printOutput(std::cout,i,defnew,def);
+
+          def = defnew;               // update norm
+          if (def<def0*_reduction || def<1E-30)    // convergence check
+          {
+            res.converged  = true;
+            break;
+          }
+        }
+        if (i==_maxit)
+          break;
+
+        if (i==0)
+        {
+          beta = 0;
+          alpha = gamma/dots[1];
+        }
+        else
+        {
+          beta = gamma/gammalast;
+          alpha = gamma/(dots[1]-beta*gamma/alphalast);
+        }
+
+        FusedVectorOps<X>::aypx(p,beta,u);  // new search direction
+        FusedVectorOps<X>::aypx(s,beta,w);  // and its image A p
+        x.axpy(alpha,p);            // update solution
+        r.axpy(-alpha,s);           // update defect
+
+        gammalast = gamma;
+        alphalast = alpha;
+      }
+
+      if (def0<1E-30)
+      {
+        res.iterations = 0;               // fill statistics
+        res.reduction = 0;
+        res.conv_rate  = 0;
+        res.elapsed=0;
+        _prec.post(x);
+        if (_verbose>0)                 // final print
+          std::cout << "=== rate=" << res.conv_rate
+                    << ", T=" << res.elapsed << ", TIT=" << res.elapsed
+                    << ", IT=0" << std::endl;
+        return;
+      }
+
+      if (_verbose==1)                // printing for non verbose
+        this->printOutput(std::cout,i,def);
+
+      _prec.post(x);                  // postprocess preconditioner
+      res.iterations = i;               // fill statistics
+      res.reduction = def/def0;
+      res.conv_rate  = pow(res.reduction,1.0/std::max(i,1));
+      res.elapsed = watch.elapsed();
+
+      if (_verbose>0)                 // final print
+      {
+        std::cout << "=== rate=" << res.conv_rate
+                  << ", T=" << res.elapsed
+                  << ", TIT=" << res.elapsed/std::max(i,1)
+                  << ", IT=" << i << std::endl;
+      }
+    }
+
+    /*!
+      \brief Apply inverse operator with given reduction factor.
+
+      \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
+    */
+    virtual void apply (X& x, X& b, double reduction,
+      InverseOperatorResult& res)
+    {
+      std::swap(_reduction,reduction);
+      (*this).apply(x,b,res);
+      std::swap(_reduction,reduction);
+    }
+
+  private:
+    SeqScalarProduct<X> ssp;
+    LinearOperator<X,X>& _op;
+    Preconditioner<X,X>& _prec;
+    ScalarProduct<X>& _sp;
+    double _reduction;
+    int _maxit;
+    int _verbose;
+  };
+
+
   // Ronald Kriemanns BiCG-STAB implementation from Sumo
   //! \brief Bi-conjugate Gradient Stabilized (BiCG-STAB)
   template<class X>
@@ -778,8 +1190,7 @@ namespace Dune {
         {
           beta = ( rho_new / rho ) * ( alpha / omega );
           p.axpy(-omega,v); // p = r + beta (p - omega*v)
-          p *= beta;
-          p += r;
+          FusedVectorOps<X>::aypx(p,beta,r);
         }
 
         // y = W^-1 * p
@@ -802,13 +1213,11 @@ namespace Dune {
         x.axpy(alpha,y);
 
         // r = r - alpha*v
-        r.axpy(-alpha,v);
-
         //
         // test stop criteria
         //
 
-        norm = _sp.norm(r);
+        norm = _sp.axpyNorm(r,-alpha,v);
 
         if (_verbose>1) // print
         {
@@ -838,16 +1247,14 @@ namespace Dune {
         // x <- x + omega y
         x.axpy(omega,y);
 
-        // r = s - omega*t (remember : r = s)
-        r.axpy(-omega,t);
-
         rho = rho_new;
 
+        // r = s - omega*t (remember : r = s)
         //
         // test stop criteria
         //
 
-        norm = _sp.norm(r);
+        norm = _sp.axpyNorm(r,-omega,t);
 
         if (_verbose > 1)             // print
         {
@@ -1037,8 +1444,7 @@ namespace Dune {
 
           // Symmetrically Preconditioned Lanczos (Greenbaum p.121)
           _op.apply(z,q[i2]);             // q[i2] = Az
-          q[i2].axpy(-beta, q[i0]);
-          alpha = _sp.dot(q[i2],z);
+          alpha = _sp.axpyDot(q[i2], -beta, q[i0], z);
           q[i2].axpy(-alpha, q[i1]);
 
           z=0.0;
@@ -1463,6 +1869,434 @@ namespace Dune {
     bool _recalc_defect;
   };
 
+  /**
+     \brief s-step (communication avoiding) restarted GMRes
+
+     Solves the unsymmetric linear system Ax = b like RestartedGMResSolver,
+     but builds the Krylov basis in blocks of s vectors as described by
+     Hoemmen (Communication-avoiding Krylov subspace methods, PhD thesis,
+     UC Berkeley, 2010). For each block the matrix powers kernel applies
+     the preconditioned operator s times to the last basis vector,
+     producing a scaled monomial basis. The s new vectors are then
+     orthogonalized against the previous basis and among themselves by
+     block classical Gram-Schmidt combined with a Cholesky QR of their
+     Gram matrix. All scalar products of one such pass are computed in a
+     single call of ScalarProduct::startDots(), and two passes are made
+     for stability. Thus a block of s iterations needs two global
+     reductions instead of the s+1 reductions per iteration of
+     RestartedGMResSolver. The Hessenberg matrix of the Arnoldi process is
+     recovered from the change of basis and the least squares problem is
+     solved with Givens rotations as usual.
+
+     The monomial basis loses linear independence quickly, so s should
+     be small (about 2 to 8). If the Cholesky factorization breaks down,
+     i.e. a diagonal entry drops below a small multiple of the machine
+     epsilon times the squared norm of its vector, the block is shortened
+     to the vectors that are still independent. If not even the first
+     vector is, a classical Arnoldi step (s=1) with modified Gram-Schmidt
+     is made instead.
+     The defect is measured in the norm of the preconditioned defect
+     M^-1(b-Ax) and the field type has to be real.
+  */
+  template<class X>
+  class SStepGMResSolver : public InverseOperator<X,X>
+  {
+  public:
+    //! \brief The domain type of the operator to be inverted.
+    typedef X domain_type;
+    //! \brief The range type of the operator to be inverted.
+    typedef X range_type;
+    //! \brief The field type of the operator to be inverted
+    typedef typename X::field_type field_type;
+
+    /*!
+      \brief Set up solver.
+
+      \copydoc LoopSolver::LoopSolver(L&,P&,double,int,int)
+      \param restart number of GMRes cycles before restart
+      \param steps the number s of basis vectors computed per block
+    */
+    template<class L, class P>
+    SStepGMResSolver (L& op, P& prec, double reduction, int restart, int steps, int maxit, int verbose) :
+      _op(op), _prec(prec),
+      ssp(), _sp(ssp), _restart(restart), _steps(std::max(1,std::min(steps,restart))),
+      _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    {
+      dune_static_assert(static_cast<int>(P::category) == static_cast<int>(L::category),
+        "P and L must be the same category!");
+      dune_static_assert( static_cast<int>(L::category) == static_cast<int>(SolverCategory::sequential),
+        "L must be sequential!");
+    }
+
+    /*!
+      \brief Set up solver.
+
+      \copydoc LoopSolver::LoopSolver(L&,S&,P&,double,int,int)
+      \param restart number of GMRes cycles before restart
+      \param steps the number s of basis vectors computed per block
+    */
+    template<class L, class S, class P>
+    SStepGMResSolver (L& op, S& sp, P& prec, double reduction, int restart, int steps, int maxit, int verbose) :
+      _op(op), _prec(prec),
+      _sp(sp), _restart(restart), _steps(std::max(1,std::min(steps,restart))),
+      _reduction(reduction), _maxit(maxit), _verbose(verbose)
+    {
+      dune_static_assert(static_cast<int>(P::category) == static_cast<int>(L::category),
+        "P and L must have the same category!");
+      dune_static_assert(static_cast<int>(P::category) == static_cast<int>(S::category),
+        "P and S must have the same category!");
+    }
+
+    //! \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
+    virtual void apply (X& x, X& b, InverseOperatorResult& res)
+    {
+      apply(x,b,_reduction,res);
+    }
+
+    /*!
+      \brief Apply inverse operator.
+
+      \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
+    */
+    virtual void apply (X& x, X& b, double reduction, InverseOperatorResult& res)
+    {
+      typedef std::vector<field_type> Column;
+      typedef std::vector<Column> Dense;
+
+      const int m = _restart;
+      std::vector<X> v(m+1,b);           // the orthonormal basis
+      X w(b);
+      Dense H(m+1,Column(m,0.0));        // Hessenberg matrix of the Arnoldi process
+      Dense Hr(m+1,Column(m,0.0));       // H after the Givens rotations
+      Column s(m+1), cs(m), sn(m);
+      field_type sigma = 1.0;            // scaling of the monomial basis
+
+      // start timer
+      Timer watch;
+
+      // clear solver statistics
+      res.clear();
+      _prec.pre(x,b);
+      _op.applyscaleadd(-1,x, /* => */ b); // b = b - Ax;
+      v[0] = 0.0; _prec.apply(v[0],b);     // r = M^-1 b
+      field_type beta = _sp.norm(v[0]);
+      double norm_0 = beta;
+      double norm = beta, norm_old = beta;
+
+      // avoid division by zero
+      if (norm_0 == 0.0)
+        norm_0 = 1.0;
+
+      // print header
+      if (_verbose > 0)
+      {
+        std::cout << "=== SStepGMResSolver" << std::endl;
+        if (_verbose > 1)
+        {
+          this->printHeader(std::cout);
+          this->printOutput(std::cout,0,norm);
+        }
+      }
+
+      int j = 0;
+      if (norm <= reduction * norm_0)
+        res.converged = true;
+
+      while (j < _maxit && !res.converged) {
+        v[0] *= (1.0 / beta);
+        for (int i=1; i<=m; i++) s[i] = 0.0;
+        s[0] = beta;
+
+        int k = 0;                  // number of columns of H
+        while (k < m && j < _maxit && !res.converged) {
+          int sb = std::min(_steps, std::min(m-k, _maxit-j));
+
+          // matrix powers kernel: v[k+l+1] = (M^-1 A)^(l+1) v[k] / sigma^(l+1)
+          for (int l=0; l<sb; l++) {
+            _op.apply(v[k+l], w);
+            v[k+l+1] = 0.0;
+            _prec.apply(v[k+l+1], w);
+            v[k+l+1] *= (1.0 / sigma);
+          }
+
+          // two passes of block Gram-Schmidt and Cholesky QR,
+          // the new vectors are V C + V_new R afterwards
+          Dense C1, R1, C2, R2;
+          orthogonalize(v, k, sb, C1, R1);
+          orthogonalize(v, k, sb, C2, R2);
+          if (sb == 0) {
+            // not even M^-1 A v_k is independent in the monomial basis
+            arnoldiStep(v, k, H, w, j);
+            sb = 1;
+          }
+          else {
+            // P = [v_k, W] = V Rhat with C = C1 + C2 R1 and R = R2 R1
+            Dense Rhat(k+sb+1,Column(sb+1,0.0));
+            Rhat[k][0] = 1.0;
+            for (int c=0; c<sb; c++) {
+              for (int i=0; i<=k; i++) {
+                Rhat[i][c+1] = C1[i][c];
+                for (int l=0; l<=c; l++)
+                  Rhat[i][c+1] += C2[i][l]*R1[l][c];
+              }
+              for (int i=0; i<=c; i++)
+                for (int l=i; l<=c; l++)
+                  Rhat[k+1+i][c+1] += R2[i][l]*R1[l][c];
+            }
+
+            // M^-1 A P_{0..sb-1} = sigma P_{1..sb}, hence with the upper
+            // triangular S = Rhat(k..k+sb-1,0..sb-1) and T = Rhat(0..k-1,0..sb-1)
+            // the new columns of H are (sigma Rhat(:,1..sb) - H T) S^-1
+            for (int c=0; c<sb; c++) {
+              for (int i=0; i<=k+c+1; i++) {
+                field_type h = sigma * Rhat[i][c+1];
+                for (int l=0; l<k; l++)
+                  h -= H[i][l]*Rhat[l][c];
+                for (int l=0; l<c; l++)
+                  h -= H[i][k+l]*Rhat[k+l][c];
+                H[i][k+c] = h / Rhat[k+c][c];
+              }
+              // zero up to round-off
+              for (int i=k+c+2; i<=m; i++)
+                H[i][k+c] = 0.0;
+            }
+          }
+
+          // least squares problem, one column after the other
+          double colnorms = 0;
+          int c = 0;
+          for ( ; c<sb && !res.converged; c++) {
+            const int i = k+c;
+            double colnorm2 = 0;
+            for (int l=0; l<=i+1; l++) {
+              Hr[l][i] = H[l][i];
+              colnorm2 += std::abs(H[l][i])*std::abs(H[l][i]);
+            }
+            colnorms += std::sqrt(colnorm2);
+            for (int l=0; l<i; l++)
+              applyPlaneRotation(Hr[l][i], Hr[l+1][i], cs[l], sn[l]);
+
+            generatePlaneRotation(Hr[i][i], Hr[i+1][i], cs[i], sn[i]);
+            applyPlaneRotation(Hr[i][i], Hr[i+1][i], cs[i], sn[i]);
+            applyPlaneRotation(s[i], s[i+1], cs[i], sn[i]);
+
+            norm = std::abs(s[i+1]);
+            j++;
+
+            if (_verbose > 1)             // print
+              this->printOutput(std::cout,j,norm,norm_old);
+
+            norm_old = norm;
+            if (norm < reduction * norm_0)
+              res.converged = true;
+          }
+          k += c;
+
+          // the next block grows like the norm of M^-1 A on the basis
+          if (colnorms > 0)
+            sigma = colnorms / c;
+        }
+
+        // calc update vector
+        w = 0;
+        update(w, k - 1, Hr, s, v);
+
+        // update x
+        x += w;
+
+        // update defect
+        _op.applyscaleadd(-1,w, /* => */ b);
+        // r = M^-1 (b - A * x);
+        v[0] = 0.0; _prec.apply(v[0],b);
+        beta = _sp.norm(v[0]);
+        norm = beta;
+
+        if (_verbose > 1)             // print
+          this->printOutput(std::cout,j,norm,norm_old);
+
+        norm_old = norm;
+        res.converged = (norm < reduction * norm_0);
+
+        if (!res.converged && j < _maxit && _verbose > 0)
+          std::cout << "=== SStepGMRes::restart\n";
+      }
+
+      _prec.post(x);                  // postprocess preconditioner
+
+      res.iterations = j;
+      res.reduction = norm / norm_0;
+      res.conv_rate  = pow(res.reduction,1.0/std::max(j,1));
+      res.elapsed = watch.elapsed();
+
+      if (_verbose>0)
+      {
+        std::cout << "=== rate=" << res.conv_rate
+                  << ", T=" << res.elapsed
+                  << ", TIT=" << res.elapsed/std::max(j,1)
+                  << ", IT=" << j
+                  << std::endl;
+      }
+    }
+
+  private:
+
+    /*!
+      \brief One step of the classical Arnoldi process.
+
+      Computes v[k+1] from M^-1 A v[k] by two passes of modified
+      Gram-Schmidt and the column k of H, with one reduction per scalar
+      product like RestartedGMResSolver.
+    */
+    void arnoldiStep (std::vector<X>& v, int k,
+      std::vector<std::vector<field_type> >& H, X& w, int j)
+    {
+      _op.apply(v[k], w);
+      v[k+1] = 0.0;
+      _prec.apply(v[k+1], w);
+      for (std::size_t i=0; i<H.size(); i++)
+        H[i][k] = 0.0;
+      for (int pass=0; pass<2; pass++)
+        for (int i=0; i<=k; i++) {
+          field_type h = _sp.dot(v[k+1], v[i]);
+          H[i][k] += h;
+          v[k+1].axpy(-h, v[i]);
+        }
+      H[k+1][k] = _sp.norm(v[k+1]);
+      if (H[k+1][k] == 0.0)
+        DUNE_THROW(ISTLError,"breakdown in s-step GMRes - |w| == 0.0 after "
+          << j << " iterations");
+      v[k+1] *= (1.0 / H[k+1][k]);
+    }
+
+    /*!
+      \brief One pass of block classical Gram-Schmidt and Cholesky QR.
+
+      Orthogonalizes v[k+1],...,v[k+sb] against v[0],...,v[k] and among
+      themselves, such that afterwards W = V C + V_new R with the vectors
+      W before the call. All scalar products are computed in one
+      reduction. If the Gram matrix is not positive definite sb is
+      reduced to the number of vectors that are linearly independent.
+    */
+    void orthogonalize (std::vector<X>& v, int k, int& sb,
+      std::vector<std::vector<field_type> >& C,
+      std::vector<std::vector<field_type> >& R)
+    {
+      const int n = (k+1)*sb + sb*(sb+1)/2;
+      std::vector<const X*> left(n), right(n);
+      std::vector<field_type> dots(n);
+      int d = 0;
+      for (int c=0; c<sb; c++) {
+        for (int i=0; i<=k; i++, d++) {
+          left[d] = &v[k+1+c]; right[d] = &v[i];
+        }
+        for (int i=0; i<=c; i++, d++) {
+          left[d] = &v[k+1+c]; right[d] = &v[k+1+i];
+        }
+      }
+      if (n > 0) {
+        _sp.startDots(&left[0],&right[0],n,&dots[0]);
+        _sp.finishDots();
+      }
+
+      C.assign(k+1,std::vector<field_type>(sb,0.0));
+      R.assign(sb,std::vector<field_type>(sb,0.0));
+
+      // Cholesky factorization of the Gram matrix of W - V C,
+      // which is W^T W - C^T C as V is orthonormal. The diagonal
+      // entries suffer from cancellation of the order of the rounding
+      // error of the squared norm, anything below it is no independent
+      // direction any more.
+      const field_type tolerance = 100*std::numeric_limits<field_type>::epsilon();
+      d = 0;
+      for (int c=0; c<sb; c++) {
+        for (int i=0; i<=k; i++, d++)
+          C[i][c] = dots[d];
+        for (int i=0; i<=c; i++, d++) {
+          field_type g = dots[d];
+          for (int l=0; l<=k; l++)
+            g -= C[l][i]*C[l][c];
+          for (int l=0; l<i; l++)
+            g -= R[l][i]*R[l][c];
+          if (i<c)
+            R[i][c] = g / R[i][i];
+          else if (g > tolerance * std::abs(dots[d]))
+            R[c][c] = std::sqrt(g);
+          else {
+            // W is (numerically) linearly dependent from column c on
+            sb = c;
+            break;
+          }
+        }
+        if (sb == c)
+          break;
+      }
+
+      // v_new = (W - V C) R^-1, column by column
+      for (int c=0; c<sb; c++) {
+        X& vc = v[k+1+c];
+        for (int i=0; i<=k; i++)
+          vc.axpy(-C[i][c], v[i]);
+        for (int i=0; i<c; i++)
+          vc.axpy(-R[i][c], v[k+1+i]);
+        vc *= (1.0 / R[c][c]);
+      }
+    }
+
+    static void
+    update(X &x, int k,
+      std::vector< std::vector<field_type> > & h,
+      std::vector<field_type> & s, std::vector<X>& v)
+    {
+      std::vector<field_type> y(s);
+
+      // Backsolve:
+      for (int i = k; i >= 0; i--) {
+        y[i] /= h[i][i];
+        for (int j = i - 1; j >= 0; j--)
+          y[j] -= h[j][i] * y[i];
+      }
+
+      for (int j = 0; j <= k; j++)
+        // x += v[j] * y[j];
+        x.axpy(y[j],v[j]);
+    }
+
+    void
+    generatePlaneRotation(field_type &dx, field_type &dy, field_type &cs, field_type &sn)
+    {
+      if (dy == 0.0) {
+        cs = 1.0;
+        sn = 0.0;
+      } else if (std::abs(dy) > std::abs(dx)) {
+        field_type temp = dx / dy;
+        sn = 1.0 / std::sqrt( 1.0 + temp*temp );
+        cs = temp * sn;
+      } else {
+        field_type temp = dy / dx;
+        cs = 1.0 / std::sqrt( 1.0 + temp*temp );
+        sn = temp * cs;
+      }
+    }
+
+    void
+    applyPlaneRotation(field_type &dx, field_type &dy, field_type &cs, field_type &sn)
+    {
+      field_type temp  =  cs * dx + sn * dy;
+      dy = -sn * dx + cs * dy;
+      dx = temp;
+    }
+
+    LinearOperator<X,X>& _op;
+    Preconditioner<X,X>& _prec;
+    SeqScalarProduct<X> ssp;
+    ScalarProduct<X>& _sp;
+    int _restart;
+    int _steps;
+    double _reduction;
+    int _maxit;
+    int _verbose;
+  };
+
   /** @} end documentation */
 
 } // end namespace
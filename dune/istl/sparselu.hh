@@ -0,0 +1,369 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_SPARSELU_HH
+#define DUNE_ISTL_SPARSELU_HH
+
+#include<algorithm>
+#include<cstddef>
+#include<iostream>
+#include<iterator>
+#include<map>
+#include<set>
+#include<utility>
+#include<vector>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/timer.hh>
+#include<dune/common/unused.hh>
+#include"bcrsmatrix.hh"
+#include"bvector.hh"
+#include"ilu.hh"
+#include"istlexception.hh"
+#include"solvers.hh"
+#include"solvertype.hh"
+
+namespace Dune
+{
+  /**
+   * @file
+   * @brief A sparse direct solver that does not depend on external libraries.
+   */
+  /**
+   * @addtogroup ISTL
+   * @{
+   */
+
+  template<class M>
+  class SparseLU
+  {};
+
+  /**
+   * @brief Sparse LU decomposition of a block matrix.
+   *
+   * The unknowns are reordered by a minimum degree ordering of the
+   * symmetrized sparsity pattern. The complete fill of this ordering is
+   * set up symbolically and the factors are computed by the block ILU(0)
+   * decomposition on it, which is then exact. The blocks are inverted
+   * with pivoting but there is no pivoting between the blocks, i.e. the
+   * matrix has to be factorizable in the fill reducing order (e.g. it is
+   * symmetric positive definite or diagonally dominant).
+   *
+   * The matrix is factored once by setMatrix() or setSubMatrix() and each
+   * apply only performs the forward and backward substitutions. It can
+   * replace SuperLU as the coarse solver of AMG and as the subdomain
+   * solver of SeqOverlappingSchwarz.
+   *
+   * @tparam K The field type.
+   * @tparam n The size of the matrix blocks.
+   * @tparam A The allocator of the matrix.
+   */
+  template<class K, int n, class A>
+  class SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> >
+    : public InverseOperator<
+        BlockVector<FieldVector<K,n>,
+                    typename A::template rebind<FieldVector<K,n> >::other>,
+        BlockVector<FieldVector<K,n>,
+                    typename A::template rebind<FieldVector<K,n> >::other> >
+  {
+  public:
+    /** @brief The matrix type. */
+    typedef BCRSMatrix<FieldMatrix<K,n,n>,A> Matrix;
+    /** @brief The type of the domain of the solver. */
+    typedef BlockVector<FieldVector<K,n>,
+                        typename A::template rebind<FieldVector<K,n> >::other> domain_type;
+    /** @brief The type of the range of the solver. */
+    typedef domain_type range_type;
+    /** @brief The type of the indices. */
+    typedef typename Matrix::size_type size_type;
+
+    /**
+     * @brief Constructs the solver and decomposes the matrix.
+     * @param mat The matrix of the system to solve.
+     * @param verbose If true the size of the factors and the time
+     * needed are printed.
+     */
+    explicit SparseLU(const Matrix& mat, bool verbose=false)
+      : verbose_(verbose)
+    {
+      setMatrix(mat);
+    }
+
+    /**
+     * @brief Empty default constructor.
+     *
+     * Use setMatrix or setSubMatrix to tell the solver for what matrix
+     * it solves.
+     */
+    SparseLU()
+      : verbose_(false)
+    {}
+
+    /**
+     *  \copydoc InverseOperator::apply(X&,Y&,InverseOperatorResult&)
+     */
+    void apply(domain_type& x, range_type& b, InverseOperatorResult& res)
+    {
+      Timer watch;
+      solve(x, b);
+      res.iterations=1;
+      res.reduction=0;
+      res.conv_rate=0;
+      res.converged=true;
+      res.elapsed=watch.elapsed();
+    }
+
+    /**
+     *  \copydoc InverseOperator::apply(X&,Y&,double,InverseOperatorResult&)
+     */
+    void apply(domain_type& x, range_type& b, double reduction, InverseOperatorResult& res)
+    {
+      DUNE_UNUSED_PARAMETER(reduction);
+      apply(x,b,res);
+    }
+
+    /**
+     * @brief Apply the solver as the subdomain solver of SeqOverlappingSchwarz.
+     *
+     * Only the first N() entries of the vectors are used, the others
+     * are left untouched.
+     * @param v The vector to store the solution in.
+     * @param d The right hand side.
+     */
+    void apply(domain_type& v, const range_type& d)
+    {
+      solve(v, d);
+    }
+
+    /**
+     * @brief Decompose a matrix.
+     *
+     * Computes the ordering, the sparsity pattern of the factors and
+     * the factors.
+     * @param mat The matrix to decompose.
+     */
+    void setMatrix(const Matrix& mat);
+
+    /**
+     * @brief Decompose the submatrix of some rows and columns.
+     * @param mat The global matrix.
+     * @param rowIndexSet The ordered set of the global indices of the
+     * rows and columns of the submatrix.
+     */
+    template<class S>
+    void setSubMatrix(const Matrix& mat, const S& rowIndexSet);
+
+    /**
+     * @brief Decompose a matrix with the pattern of the last one.
+     *
+     * Reuses the ordering and the sparsity pattern of the factors and
+     * only computes the factors again. Use this if only the values of
+     * the matrix changed.
+     * @param mat The matrix to decompose. It must not have entries
+     * outside the pattern of the matrix passed to setMatrix.
+     */
+    void refactor(const Matrix& mat);
+
+    /** @brief Set whether statistics about the factorization are printed. */
+    void setVerbosity(bool v)
+    {
+      verbose_=v;
+    }
+
+    /** @brief The number of unknowns (blocks). */
+    size_type N() const
+    {
+      return perm_.size();
+    }
+
+    /** @brief The number of nonzero blocks of both factors. */
+    size_type nonzeroes() const
+    {
+      return factor_.nonzeroes();
+    }
+
+    /** @brief The memory used by the factors and the ordering in bytes. */
+    std::size_t memory() const
+    {
+      return nonzeroes()*(sizeof(typename Matrix::block_type)+sizeof(size_type))
+        + N()*(sizeof(typename Matrix::row_type)+2*sizeof(size_type)
+               +sizeof(typename domain_type::block_type));
+    }
+
+  private:
+    /** @brief Compute the minimum degree ordering and the pattern of the factors. */
+    void analyse(const Matrix& mat);
+
+    /** @brief Solve with the factors for the first N() entries of the vectors. */
+    template<class X, class Y>
+    void solve(X& x, const Y& b)
+    {
+      for(size_type i=0; i<N(); ++i)
+        work_[i]=b[perm_[i]];
+      bilu_backsolve(factor_, work_, work_);
+      for(size_type i=0; i<N(); ++i)
+        x[perm_[i]]=work_[i];
+    }
+
+    /** @brief The factors in the permuted order. */
+    Matrix factor_;
+    /** @brief The unknown eliminated in each step. */
+    std::vector<size_type> perm_;
+    /** @brief The elimination step of each unknown. */
+    std::vector<size_type> iperm_;
+    /** @brief The permuted right hand side and solution. */
+    domain_type work_;
+    bool verbose_;
+  };
+
+  template<class K, int n, class A>
+  void SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> >::setMatrix(const Matrix& mat)
+  {
+    if(mat.N()!=mat.M())
+      DUNE_THROW(ISTLError, "SparseLU needs a square matrix");
+    Timer watch;
+    analyse(mat);
+    double analyseTime = watch.elapsed();
+    refactor(mat);
+    if(verbose_)
+      std::cout<<"SparseLU: "<<N()<<" unknowns, "<<nonzeroes()
+               <<" nonzeros in the factors, ordering took "<<analyseTime
+               <<"s, decomposition "<<watch.elapsed()-analyseTime<<"s"<<std::endl;
+  }
+
+  template<class K, int n, class A>
+  template<class S>
+  void SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> >::setSubMatrix(const Matrix& mat,
+                                                                 const S& rowIndexSet)
+  {
+    typedef typename S::const_iterator SIter;
+    std::map<size_type,size_type> indexMap;
+    size_type nnz=0;
+    for(SIter row=rowIndexSet.begin(); row!=rowIndexSet.end(); ++row){
+      indexMap.insert(std::make_pair(size_type(*row), indexMap.size()));
+      nnz+=mat[*row].getsize();
+    }
+
+    Matrix local(indexMap.size(), indexMap.size(), nnz, Matrix::row_wise);
+    typename Matrix::CreateIterator created=local.createbegin();
+    for(SIter row=rowIndexSet.begin(); row!=rowIndexSet.end(); ++row, ++created)
+      for(typename Matrix::ConstColIterator col=mat[*row].begin(); col!=mat[*row].end(); ++col){
+        typename std::map<size_type,size_type>::const_iterator entry=indexMap.find(col.index());
+        if(entry!=indexMap.end())
+          created.insert(entry->second);
+      }
+
+    typename Matrix::RowIterator localRow=local.begin();
+    for(SIter row=rowIndexSet.begin(); row!=rowIndexSet.end(); ++row, ++localRow)
+      for(typename Matrix::ConstColIterator col=mat[*row].begin(); col!=mat[*row].end(); ++col){
+        typename std::map<size_type,size_type>::const_iterator entry=indexMap.find(col.index());
+        if(entry!=indexMap.end())
+          (*localRow)[entry->second]=*col;
+      }
+    setMatrix(local);
+  }
+
+  template<class K, int n, class A>
+  void SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> >::analyse(const Matrix& mat)
+  {
+    typedef std::vector<size_type> Neighbours;
+    const size_type size=mat.N();
+
+    // the graph of the symmetrized pattern without the diagonal
+    std::vector<Neighbours> graph(size);
+    for(typename Matrix::ConstRowIterator row=mat.begin(); row!=mat.end(); ++row)
+      for(typename Matrix::ConstColIterator col=row->begin(); col!=row->end(); ++col)
+        if(col.index()!=row.index()){
+          graph[row.index()].push_back(col.index());
+          graph[col.index()].push_back(row.index());
+        }
+    for(size_type i=0; i<size; ++i){
+      std::sort(graph[i].begin(), graph[i].end());
+      graph[i].erase(std::unique(graph[i].begin(), graph[i].end()), graph[i].end());
+    }
+
+    // Eliminate the vertex of minimum degree (ties broken by the index)
+    // and connect its neighbours in the elimination graph. The neighbours
+    // at the time of elimination form the pattern of the column of L and
+    // the row of U.
+    std::set<std::pair<size_type,size_type> > degrees;
+    for(size_type i=0; i<size; ++i)
+      degrees.insert(std::make_pair(graph[i].size(), i));
+    perm_.resize(size);
+    iperm_.resize(size);
+    std::vector<Neighbours> upper(size);
+    Neighbours merged;
+    for(size_type step=0; step<size; ++step){
+      const size_type pivot=degrees.begin()->second;
+      degrees.erase(degrees.begin());
+      perm_[step]=pivot;
+      iperm_[pivot]=step;
+      Neighbours& clique=graph[pivot];
+      for(typename Neighbours::const_iterator v=clique.begin(); v!=clique.end(); ++v){
+        Neighbours& neighbours=graph[*v];
+        degrees.erase(std::make_pair(neighbours.size(), *v));
+        merged.clear();
+        std::set_union(neighbours.begin(), neighbours.end(), clique.begin(), clique.end(),
+                       std::back_inserter(merged));
+        // drop the pivot and the vertex itself
+        merged.erase(std::remove(merged.begin(), merged.end(), *v), merged.end());
+        merged.erase(std::remove(merged.begin(), merged.end(), pivot), merged.end());
+        neighbours.swap(merged);
+        degrees.insert(std::make_pair(neighbours.size(), *v));
+      }
+      upper[step].swap(clique);
+    }
+
+    // The pattern of the factors in the permuted numbering. By
+    // construction it is symmetric and closed under elimination.
+    std::vector<Neighbours> lower(size);
+    size_type nnz=size;
+    for(size_type step=0; step<size; ++step){
+      for(typename Neighbours::iterator v=upper[step].begin(); v!=upper[step].end(); ++v){
+        *v=iperm_[*v];
+        lower[*v].push_back(step);
+      }
+      nnz+=2*upper[step].size();
+    }
+
+    Matrix pattern(size, size, nnz, Matrix::row_wise);
+    typename Matrix::CreateIterator created=pattern.createbegin();
+    for(size_type step=0; step<size; ++step, ++created){
+      for(typename Neighbours::const_iterator v=lower[step].begin(); v!=lower[step].end(); ++v)
+        created.insert(*v);
+      created.insert(step);
+      for(typename Neighbours::const_iterator v=upper[step].begin(); v!=upper[step].end(); ++v)
+        created.insert(*v);
+    }
+    factor_=pattern;
+    work_.resize(size, false);
+  }
+
+  template<class K, int n, class A>
+  void SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> >::refactor(const Matrix& mat)
+  {
+    if(mat.N()!=N())
+      DUNE_THROW(ISTLError, "SparseLU::refactor needs a matrix with the pattern of the last one");
+    factor_=0;
+    for(typename Matrix::ConstRowIterator row=mat.begin(); row!=mat.end(); ++row){
+      typename Matrix::row_type& factorRow=factor_[iperm_[row.index()]];
+      for(typename Matrix::ConstColIterator col=row->begin(); col!=row->end(); ++col){
+        typename Matrix::ColIterator entry=factorRow.find(iperm_[col.index()]);
+        if(entry==factorRow.end())
+          DUNE_THROW(ISTLError, "SparseLU::refactor: entry ("<<row.index()<<","<<col.index()
+                     <<") is not in the pattern of the factors");
+        *entry=*col;
+      }
+    }
+    bilu0_decomposition(factor_);
+  }
+
+  template<class K, int n, class A>
+  struct IsDirectSolver<SparseLU<BCRSMatrix<FieldMatrix<K,n,n>,A> > >
+  {
+    enum{ value=true};
+  };
+
+  /** @} */
+} // end namespace Dune
+
+#endif
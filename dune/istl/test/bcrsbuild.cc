@@ -1,4 +1,6 @@
 #include"config.h"
+#include<map>
+#include<memory>
 #include<dune/istl/bcrsmatrix.hh>
 #include<dune/common/fmatrix.hh>
 #include<dune/common/exceptions.hh>
@@ -77,6 +79,235 @@ struct Builder<Dune::BCRSMatrix<B,A> >
   }
 };
 
+int testImplicitBuild()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  const int N=20;
+
+  // too few entries per row so that some go into the overflow area
+  Matrix implicit(N, N, 2, 0.5, Matrix::implicit);
+  // insert in reverse column order and add up duplicates
+  for(int i=0; i<N; ++i){
+    if(i+1<N)
+      implicit.entry(i,i+1) = -1;
+    implicit.entry(i,i) = 1;
+    implicit.entry(i,i) += 1;
+    if(i>0)
+      implicit.entry(i,i-1) = -1;
+  }
+  Dune::CompressionStatistics<Matrix::size_type> stats = implicit.compress();
+
+  Matrix random(N, N, Matrix::random);
+  for(int i=0; i<N; ++i)
+    random.setrowsize(i, 1+(i>0)+(i+1<N));
+  random.endrowsizes();
+  for(int i=0; i<N; ++i){
+    random.addindex(i,i);
+    if(i>0)
+      random.addindex(i,i-1);
+    if(i+1<N)
+      random.addindex(i,i+1);
+  }
+  random.endindices();
+  for(int i=0; i<N; ++i){
+    random[i][i] = 2;
+    if(i>0)
+      random[i][i-1] = -1;
+    if(i+1<N)
+      random[i][i+1] = -1;
+  }
+
+  int ret=0;
+  if(stats.maximum!=3 || stats.overflow_total!=N-2
+     || implicit.nonzeroes()!=random.nonzeroes()){
+    std::cerr<<"wrong statistics of the implicit build"<<std::endl;
+    ++ret;
+  }
+
+  typedef Matrix::ConstRowIterator RowIterator;
+  typedef Matrix::ConstColIterator ColIterator;
+  for(RowIterator i=implicit.begin(), ri=random.begin(); i!=implicit.end(); ++i, ++ri){
+    ColIterator rj=ri->begin();
+    for(ColIterator j=i->begin(); j!=i->end(); ++j, ++rj)
+      if(rj==ri->end() || j.index()!=rj.index() || *j!=*rj){
+        std::cerr<<"implicitly built matrix differs in row "<<i.index()<<std::endl;
+        return ret+1;
+      }
+    if(rj!=ri->end()){
+      std::cerr<<"implicitly built matrix misses entries in row "<<i.index()<<std::endl;
+      return ret+1;
+    }
+  }
+
+  // a matrix built by compress() behaves like any other built matrix
+  Matrix copy(implicit);
+  copy -= random;
+  if(copy.frobenius_norm()!=0){
+    std::cerr<<"copy of the implicitly built matrix is wrong"<<std::endl;
+    ++ret;
+  }
+
+  // exhaust the overflow area
+  Matrix small(N, N, 1, 0.0, Matrix::implicit);
+  for(int i=0; i<N; ++i)
+    for(int j=0; j<3; ++j)
+      small.entry(i,j);
+  try{
+    small.compress();
+    std::cerr<<"exhausted overflow area was not detected"<<std::endl;
+    ++ret;
+  }catch(Dune::ImplicitModeOverflowExhausted&){
+  }
+  return ret;
+}
+
+/** @brief An allocator checking that memory is released with the size it was allocated with. */
+template<class T>
+struct CheckingAllocator : public std::allocator<T>
+{
+  template<class U>
+  struct rebind
+  {
+    typedef CheckingAllocator<U> other;
+  };
+
+  CheckingAllocator()
+  {}
+
+  template<class U>
+  CheckingAllocator(const CheckingAllocator<U>&)
+  {}
+
+  T* allocate(std::size_t n)
+  {
+    T* p = std::allocator<T>::allocate(n);
+    sizes()[p] = n;
+    return p;
+  }
+
+  void deallocate(T* p, std::size_t n)
+  {
+    std::map<void*,std::size_t>::iterator s = sizes().find(p);
+    if(s==sizes().end() || s->second!=n)
+      ++mismatches();
+    else
+      sizes().erase(s);
+    std::allocator<T>::deallocate(p, n);
+  }
+
+  static std::map<void*,std::size_t>& sizes()
+  {
+    static std::map<void*,std::size_t> s;
+    return s;
+  }
+
+  static int& mismatches()
+  {
+    static int m = 0;
+    return m;
+  }
+};
+
+int testImplicitEmpty()
+{
+  typedef Dune::FieldMatrix<double,1,1> Block;
+  typedef Dune::BCRSMatrix<Block,CheckingAllocator<Block> > Matrix;
+  const int N=20;
+  {
+    // no entries at all, and fewer entries than reserved
+    Matrix empty(N, N, 3, 0.5, Matrix::implicit);
+    empty.compress();
+    Matrix copy(empty);
+    Matrix sparse(N, N, 3, 0.5, Matrix::implicit);
+    sparse.entry(0,0) = 1;
+    sparse.compress();
+    Matrix sparseCopy(sparse);
+    sparseCopy = empty;
+  }
+  {
+    // fewer entries than reserved in the row-wise build
+    Matrix rowwise(N, N, 3*N, Matrix::row_wise);
+    for(Matrix::CreateIterator row=rowwise.createbegin(); row!=rowwise.createend(); ++row)
+      row.insert(row.index());
+  }
+  if(CheckingAllocator<Block>::mismatches()>0 || !CheckingAllocator<Block>::sizes().empty()
+     || CheckingAllocator<Matrix::size_type>::mismatches()>0
+     || !CheckingAllocator<Matrix::size_type>::sizes().empty()){
+    std::cerr<<"memory of sparse implicitly built matrices was not released correctly"<<std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int testSharedPattern()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > Matrix;
+  const int N=10;
+
+  // reserve more entries per row than used to get gaps between the rows
+  Matrix A(N, N, Matrix::random);
+  for(int i=0; i<N; ++i)
+    A.setrowsize(i,4);
+  A.endrowsizes();
+  for(int i=0; i<N; ++i){
+    A.addindex(i,i);
+    if(i>0)
+      A.addindex(i,i-1);
+  }
+  A.endindices();
+  for(int i=0; i<N; ++i){
+    A[i][i] = 2;
+    if(i>0)
+      A[i][i-1] = -1;
+  }
+
+  int ret=0;
+  Matrix M;
+  M.sharePattern(A);
+  if(!M.sharesPatternWith(A) || M.N()!=A.N() || M[N-1][N-2]!=0){
+    std::cerr<<"sharePattern did not set up the pattern of A"<<std::endl;
+    ++ret;
+  }
+
+  // assigning a matrix with the same pattern keeps the memory
+  const Dune::FieldMatrix<double,1,1>* values = &M[0][0];
+  M = A;
+  if(&M[0][0]!=values || M[N-1][N-2]!=-1.0 || M[3][3]!=2.0){
+    std::cerr<<"assignment with shared pattern reallocated or copied wrong values"<<std::endl;
+    ++ret;
+  }
+
+  // copies share the pattern and leave the original intact
+  Matrix C(A);
+  C *= 3.0;
+  if(!C.sharesPatternWith(A) || C[N-1][N-2]!=-3.0){
+    std::cerr<<"copy does not share the pattern"<<std::endl;
+    ++ret;
+  }
+  for(int i=0; i<N; ++i)
+    if(A[i].size()!=(i>0 ? 2u : 1u) || A[i][i]!=2.0){
+      std::cerr<<"copying destroyed the pattern of row "<<i<<std::endl;
+      ++ret;
+      break;
+    }
+
+  // a different pattern is still reallocated
+  Matrix B(N, N, Matrix::random);
+  for(int i=0; i<N; ++i)
+    B.setrowsize(i,1);
+  B.endrowsizes();
+  for(int i=0; i<N; ++i)
+    B.addindex(i,i);
+  B.endindices();
+  B = 5.0;
+  M = B;
+  if(M.sharesPatternWith(A) || M.nonzeroes()!=B.nonzeroes() || M[4][4]!=5.0){
+    std::cerr<<"assignment of a different pattern failed"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
 void testDoubleSetSize()
 {
     Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > foo;
@@ -91,6 +322,12 @@ int main()
     Builder<Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > > builder;
     builder.randomBuild(5,4);
     testDoubleSetSize();
+    if(testImplicitBuild())
+      return 1;
+    if(testImplicitEmpty())
+      return 1;
+    if(testSharedPattern())
+      return 1;
   }catch(Dune::Exception e){
     std::cerr << e<<std::endl;
     return 1;
@@ -0,0 +1,107 @@
+/** \file
+    \brief Checks the vectorized block row kernels against the generic ones
+
+    The products have to agree and the vectorized kernels used by
+    BCRSMatrix must not be slower than the generic one.
+*/
+#include"config.h"
+#include<algorithm>
+#include<iostream>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/blockkernels.hh>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/timer.hh>
+#include<laplacian.hh>
+
+template<int BS>
+int testBlockKernel(int N, int iter)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::FieldVector<double,BS> VectorBlock;
+  typedef Dune::BlockVector<VectorBlock> Vector;
+  typedef Dune::GenericBlockRowKernel<MatrixBlock,VectorBlock> Generic;
+
+  BCRSMat mat;
+  setupSparsityPattern(mat,N);
+
+  typedef typename BCRSMat::RowIterator RowIterator;
+  typedef typename BCRSMat::ColIterator ColIterator;
+  for(RowIterator i=mat.begin(); i!=mat.end(); ++i)
+    for(ColIterator j=i->begin(); j!=i->end(); ++j)
+      for(int k=0; k < BS; ++k)
+        for(int l=0; l < BS; ++l)
+          (*j)[k][l] = 1.0/(1.0+i.index()+2.0*j.index()+k-l);
+
+  Vector x(N*N), y(N*N), z(N*N);
+  for(typename Vector::size_type i=0; i < x.N(); ++i)
+    for(int k=0; k < BS; ++k)
+      x[i][k] = 1.0/(i+k+1);
+
+  // the best of three runs of iter products each
+  double generic=1e100, kernel=1e100;
+  for(int run=0; run < 3; ++run){
+    Dune::Timer watch;
+    for(int n=0; n < iter; ++n)
+      Generic::mvRows(&*mat.begin(), 0, mat.N(), x, z);
+    generic=std::min(generic, watch.elapsed());
+
+    watch.reset();
+    for(int n=0; n < iter; ++n)
+      mat.mv(x,y);
+    kernel=std::min(kernel, watch.elapsed());
+  }
+
+  std::cout<<"BS="<<BS<<": "<<iter<<" MV with generic kernel "<<generic
+           <<"s, with block row kernel "<<kernel<<"s"<<std::endl;
+
+  int ret=0;
+  // other block sizes use the generic kernel anyway, leave some room for the noise of the timer
+  if(Dune::HasSimdBlockRowKernel<BS>::value && kernel > 1.25*generic+1e-3){
+    std::cerr<<"block row kernel for BS="<<BS<<" is slower than the generic one"<<std::endl;
+    ret=1;
+  }
+
+  y -= z;
+  if(y.infinity_norm() > 1e-12*z.infinity_norm()){
+    std::cerr<<"block row kernel for BS="<<BS<<" differs by "
+             <<y.infinity_norm()<<std::endl;
+    return 1;
+  }
+
+  z = 1.0;
+  y = 1.0;
+  for(RowIterator i=mat.begin(); i!=mat.end(); ++i)
+    Generic::usmv(-0.5,*i,x,z[i.index()]);
+  mat.usmv(-0.5,x,y);
+  y -= z;
+  if(y.infinity_norm() > 1e-12*z.infinity_norm()){
+    std::cerr<<"scaled block row kernel for BS="<<BS<<" differs by "
+             <<y.infinity_norm()<<std::endl;
+    return 1;
+  }
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=50;
+  int iter=20;
+
+  if(argc>1)
+    N = atoi(argv[1]);
+  if(argc>2)
+    iter = atoi(argv[2]);
+
+  int ret=0;
+  ret += testBlockKernel<1>(N, iter);
+  ret += testBlockKernel<2>(N, iter);
+  ret += testBlockKernel<3>(N, iter);
+  ret += testBlockKernel<4>(N, iter);
+  ret += testBlockKernel<5>(N, iter);
+  ret += testBlockKernel<6>(N, iter);
+  ret += testBlockKernel<8>(N, iter);
+  return ret;
+}
@@ -0,0 +1,144 @@
+/** \file
+    \brief Checks the fused vector kernels and the Krylov solvers using them
+*/
+#include"config.h"
+#include<iostream>
+#include<complex>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/operators.hh>
+#include<dune/istl/preconditioners.hh>
+#include<dune/istl/scalarproducts.hh>
+#include<dune/istl/solvers.hh>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<laplacian.hh>
+
+/**
+ * @brief A sequential scalar product without the fused kernels,
+ * i.e. the solvers fall back to separate passes.
+ */
+template<class X>
+class TwoPassScalarProduct : public Dune::ScalarProduct<X>
+{
+public:
+  typedef typename X::field_type field_type;
+  enum {category=Dune::SolverCategory::sequential};
+
+  virtual field_type dot (const X& x, const X& y)
+  {
+    return x*y;
+  }
+
+  virtual double norm (const X& x)
+  {
+    return x.two_norm();
+  }
+};
+
+template<class V>
+int compare(const V& v, const V& w, const char* name)
+{
+  for(typename V::size_type i=0; i < v.N(); ++i)
+    // the fused kernels have to reproduce the separate operations exactly
+    if(v[i]!=w[i]){
+      std::cerr<<name<<" differs in entry "<<i<<std::endl;
+      return 1;
+    }
+  return 0;
+}
+
+template<class K, int BS>
+int testKernels(int n)
+{
+  typedef Dune::FieldVector<K,BS> VectorBlock;
+  typedef Dune::BlockVector<VectorBlock> Vector;
+
+  Vector x(n), y(n), z(n), w(n);
+  for(int i=0; i < n; ++i)
+    for(int k=0; k < BS; ++k){
+      x[i][k] = 1.0/(i+k+1);
+      y[i][k] = 1.0/(2*i+k+3);
+      z[i][k] = i-k+0.5;
+    }
+  K a = 0.7;
+
+  int ret=0;
+  w = y;
+  w.axpy(a,x);
+  double norm2 = w.two_norm2();
+  Vector f(y);
+  if(f.axpy_two_norm2(a,x)!=norm2){
+    std::cerr<<"axpy_two_norm2 returns the wrong norm"<<std::endl;
+    ++ret;
+  }
+  ret += compare(w,f,"axpy_two_norm2");
+
+  K dot = w*z;
+  f = y;
+  if(f.axpy_dot(a,x,z)!=dot){
+    std::cerr<<"axpy_dot returns the wrong scalar product"<<std::endl;
+    ++ret;
+  }
+  ret += compare(w,f,"axpy_dot");
+
+  w = y;
+  w *= a;
+  w += x;
+  f = y;
+  f.aypx(a,x);
+  ret += compare(w,f,"aypx");
+  return ret;
+}
+
+template<class Solver>
+int testSolver(const char* name)
+{
+  typedef Dune::FieldMatrix<double,1,1> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+  typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+
+  const int N=30;
+  BCRSMat mat;
+  setupLaplacian(mat,N);
+  Operator op(mat);
+  Dune::SeqJac<BCRSMat,Vector,Vector> prec(mat,1,1.0);
+
+  Vector b(N*N), x1(N*N), x2(N*N);
+  for(int i=0; i < N*N; ++i)
+    b[i] = 1.0/(i+1);
+  Vector b1(b), b2(b);
+  x1 = 0;
+  x2 = 0;
+
+  Dune::SeqScalarProduct<Vector> fused;
+  TwoPassScalarProduct<Vector> twoPass;
+  Dune::InverseOperatorResult r1, r2;
+  Solver solver1(op, fused, prec, 1e-8, 500, 0);
+  Solver solver2(op, twoPass, prec, 1e-8, 500, 0);
+  solver1.apply(x1,b1,r1);
+  solver2.apply(x2,b2,r2);
+
+  int ret=0;
+  if(!r1.converged || r1.iterations!=r2.iterations){
+    std::cerr<<name<<" with fused kernels took "<<r1.iterations
+             <<" iterations instead of "<<r2.iterations<<std::endl;
+    ++ret;
+  }
+  return ret+compare(x1,x2,name);
+}
+
+int main()
+{
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+  int ret=0;
+  ret += testKernels<double,1>(100);
+  ret += testKernels<double,3>(100);
+  ret += testKernels<std::complex<double>,2>(100);
+  ret += testSolver<Dune::CGSolver<Vector> >("CG");
+  ret += testSolver<Dune::BiCGSTABSolver<Vector> >("BiCGSTAB");
+  ret += testSolver<Dune::MINRESSolver<Vector> >("MINRES");
+  return ret;
+}
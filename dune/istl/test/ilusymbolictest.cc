@@ -0,0 +1,139 @@
+/** \file
+    \brief Checks the symbolic ILU(n) decomposition
+
+    Compares the pattern with the one of an elimination with a map per
+    row for 2d and 3d Laplace problems and checks the refactorization
+    of SeqILUn on the cached pattern.
+*/
+#include"config.h"
+#include<iostream>
+#include<map>
+#include<vector>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/timer.hh>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/ilu.hh>
+#include<dune/istl/preconditioners.hh>
+#include<laplacian.hh>
+
+typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > BCRSMat;
+typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+typedef std::map<std::size_t,int> Row;
+
+/** @brief The pattern of ILU(n) by an elimination with a map per row. */
+void referencePattern(const BCRSMat& A, int n, std::vector<Row>& pattern)
+{
+  pattern.assign(A.N(), Row());
+  for(BCRSMat::ConstRowIterator i=A.begin(); i!=A.end(); ++i){
+    Row& row = pattern[i.index()];
+    for(BCRSMat::ConstColIterator j=i->begin(); j!=i->end(); ++j)
+      row[j.index()] = 0;
+    for(Row::iterator ik=row.begin(); ik->first < i.index(); ++ik)
+      if(ik->second < n)
+        for(Row::const_iterator kj=pattern[ik->first].upper_bound(ik->first);
+            kj!=pattern[ik->first].end(); ++kj)
+          if(kj->second < n && row.find(kj->first)==row.end())
+            row[kj->first] = kj->second+1;
+  }
+}
+
+/** @brief The 7 point stencil on a cube with N^3 unknowns. */
+void setupLaplacian3d(BCRSMat& A, int N)
+{
+  const int n = N*N*N;
+  A.setSize(n, n, 7*n);
+  A.setBuildMode(BCRSMat::row_wise);
+  for(BCRSMat::CreateIterator row=A.createbegin(); row!=A.createend(); ++row){
+    const int i = row.index(), x = i%N, y = (i/N)%N, z = i/(N*N);
+    row.insert(i);
+    if(x>0) row.insert(i-1);
+    if(x<N-1) row.insert(i+1);
+    if(y>0) row.insert(i-N);
+    if(y<N-1) row.insert(i+N);
+    if(z>0) row.insert(i-N*N);
+    if(z<N-1) row.insert(i+N*N);
+  }
+  for(BCRSMat::RowIterator row=A.begin(); row!=A.end(); ++row)
+    for(BCRSMat::ColIterator col=row->begin(); col!=row->end(); ++col)
+      *col = (col.index()==row.index()) ? 6.0 : -1.0;
+}
+
+std::size_t nonzeroes(const BCRSMat& A)
+{
+  std::size_t nnz=0;
+  for(BCRSMat::ConstRowIterator i=A.begin(); i!=A.end(); ++i)
+    nnz += i->size();
+  return nnz;
+}
+
+int testPattern(const BCRSMat& A, int n, const char* name)
+{
+  Dune::Timer watch;
+  std::vector<Row> reference;
+  referencePattern(A, n, reference);
+  double referenceTime = watch.elapsed();
+
+  watch.reset();
+  BCRSMat ILU(A.N(), A.M(), BCRSMat::row_wise);
+  Dune::bilu_symbolic(A, n, ILU);
+  double time = watch.elapsed();
+
+  std::cout<<name<<" ILU("<<n<<"): "<<nonzeroes(ILU)<<" nonzeros, symbolic phase "<<time
+           <<"s, with a map per row "<<referenceTime<<"s"<<std::endl;
+
+  for(BCRSMat::ConstRowIterator i=ILU.begin(); i!=ILU.end(); ++i){
+    const Row& row = reference[i.index()];
+    bool same = i->size()==row.size();
+    Row::const_iterator j=row.begin();
+    for(BCRSMat::ConstColIterator k=i->begin(); same && k!=i->end(); ++k, ++j)
+      same = k.index()==j->first;
+    if(!same){
+      std::cerr<<name<<" ILU("<<n<<"): wrong pattern in row "<<i.index()<<std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int testRefactor(BCRSMat& A, int n)
+{
+  Vector d(A.N()), v(A.N()), w(A.N());
+  for(std::size_t i=0; i < d.N(); ++i)
+    d[i] = 1.0/(i+1);
+
+  Dune::SeqILUn<BCRSMat,Vector,Vector> ilun(A, n, 1.0);
+  A *= 2.0;
+  ilun.refactor(A);
+  ilun.apply(v, d);
+  Dune::SeqILUn<BCRSMat,Vector,Vector> fresh(A, n, 1.0);
+  fresh.apply(w, d);
+  A *= 0.5;
+  for(std::size_t i=0; i < v.N(); ++i)
+    if(v[i]!=w[i]){
+      std::cerr<<"ILU("<<n<<") after refactor differs in row "<<i<<std::endl;
+      return 1;
+    }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  int N=60;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  BCRSMat laplacian2d, laplacian3d;
+  setupLaplacian(laplacian2d, N);
+  setupLaplacian3d(laplacian3d, N/4);
+
+  int ret=0;
+  for(int n=0; n <= 3; ++n){
+    ret += testPattern(laplacian2d, n, "2d");
+    ret += testPattern(laplacian3d, n, "3d");
+    ret += testRefactor(laplacian3d, n);
+  }
+  return ret;
+}
@@ -0,0 +1,148 @@
+/** \file
+    \brief Checks the ILU decomposition with threshold
+
+    Without dropping ILUT is an exact LU decomposition. On a convection
+    dominated problem SeqILUT has to bound the fill and to need fewer
+    iterations than SeqILU0, and it has to work as a subdomain solver of
+    SeqOverlappingSchwarz and as a smoother of AMG.
+*/
+#include"config.h"
+#include<cstdlib>
+#include<iostream>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/ilu.hh>
+#include<dune/istl/operators.hh>
+#include<dune/istl/overlappingschwarz.hh>
+#include<dune/istl/preconditioners.hh>
+#include<dune/istl/solvers.hh>
+#include<dune/istl/paamg/amg.hh>
+#include<laplacian.hh>
+
+/** @brief Add an upwind discretization of a convection in x direction. */
+template<class M>
+void addConvection(M& A, double c)
+{
+  for(typename M::RowIterator row=A.begin(); row!=A.end(); ++row)
+    for(typename M::ColIterator col=row->begin(); col!=row->end(); ++col)
+      if(col.index()+1==row.index())
+        for(int k=0; k < M::block_type::rows; ++k){
+          (*col)[k][k] -= c;
+          A[row.index()][row.index()][k][k] += c;
+        }
+}
+
+/** @brief Solve with BiCGSTAB and the preconditioner and return the iterations. */
+template<class Operator, class Vector, class P>
+int solve(Operator& op, const Vector& b, P& prec)
+{
+  Vector x(b.N()), rhs(b);
+  x=0;
+  Dune::BiCGSTABSolver<Vector> solver(op, prec, 1e-8, 500, 0);
+  Dune::InverseOperatorResult r;
+  solver.apply(x, rhs, r);
+  return r.converged ? int(r.iterations) : -1;
+}
+
+template<int BS>
+int testILUT(int N)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::FieldVector<double,BS> VectorBlock;
+  typedef Dune::BlockVector<VectorBlock> Vector;
+  typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+
+  BCRSMat mat;
+  setupLaplacian(mat,N);
+  addConvection(mat, 20.0);
+  Operator op(mat);
+
+  Vector solution(mat.N()), b(mat.N()), x(mat.N());
+  for(std::size_t i=0; i < solution.N(); ++i)
+    solution[i] = 1.0/(i+1);
+  mat.mv(solution, b);
+
+  int ret = 0;
+
+  // without dropping the decomposition is exact
+  BCRSMat LU(mat.N(), mat.M(), BCRSMat::row_wise);
+  Dune::bilut_decomposition(mat, 0.0, mat.N(), LU);
+  Dune::bilu_backsolve(LU, x, b);
+  x -= solution;
+  if(x.infinity_norm()>1e-10){
+    std::cerr<<"BS="<<BS<<": ILUT without dropping is not exact, error "
+             <<x.infinity_norm()<<std::endl;
+    ++ret;
+  }
+
+  const int p = 5;
+  Dune::SeqILU0<BCRSMat,Vector,Vector> ilu0(mat, 1.0);
+  Dune::SeqILUT<BCRSMat,Vector,Vector> ilut(mat, 1e-3, p, 1.0);
+  int ilu0Iterations = solve(op, b, ilu0);
+  int ilutIterations = solve(op, b, ilut);
+  std::cout<<"N="<<mat.N()<<" BS="<<BS<<": ILU0 "<<ilu0Iterations<<" iterations, ILUT(1e-3,"
+           <<p<<") with "<<ilut.nonzeroes()<<" blocks "<<ilutIterations<<" iterations"<<std::endl;
+  if(ilut.nonzeroes()>(2*p+1)*mat.N()){
+    std::cerr<<"BS="<<BS<<": ILUT exceeds the fill per row"<<std::endl;
+    ++ret;
+  }
+  if(ilu0Iterations<0 || ilutIterations<0 || ilutIterations>ilu0Iterations){
+    std::cerr<<"BS="<<BS<<": ILUT needs more iterations than ILU0"<<std::endl;
+    ++ret;
+  }
+
+  // as subdomain solver of stripes of four rows of the grid overlapping by one row
+  typedef Dune::SeqOverlappingSchwarz<BCRSMat,Vector,Dune::MultiplicativeSchwarzMode,
+    Dune::ILUTSubdomainSolver<BCRSMat,Vector,Vector> > Schwarz;
+  typename Schwarz::subdomain_vector domains((N+2)/3);
+  for(int i=0; i < N*N; ++i){
+    int y=i/N;
+    domains[std::min(y/3, int(domains.size())-1)].insert(i);
+    if(y%3==0 && y>0)
+      domains[y/3-1].insert(i);
+  }
+  for(int onTheFly=0; onTheFly < 2; ++onTheFly){
+    Schwarz schwarz(mat, domains, 1, onTheFly);
+    int iterations = solve(op, b, schwarz);
+    std::cout<<"multiplicative Schwarz with ILUT subdomain solvers"<<(onTheFly ? " (on the fly)" : "")
+             <<": "<<iterations<<" iterations"<<std::endl;
+    if(iterations<0){
+      std::cerr<<"BS="<<BS<<": Schwarz with ILUT subdomain solvers did not converge"<<std::endl;
+      ++ret;
+    }
+  }
+
+  // as smoother of AMG
+  typedef Dune::SeqILUT<BCRSMat,Vector,Vector> Smoother;
+  typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<BCRSMat,Dune::Amg::FirstDiagonal> >
+    Criterion;
+  typedef Dune::Amg::AMG<Operator,Vector,Smoother> AMG;
+  Criterion criterion(15,50);
+  criterion.setDefaultValuesIsotropic(2);
+  criterion.setDebugLevel(0);
+  typename Dune::Amg::SmootherTraits<Smoother>::Arguments smootherArgs;
+  AMG amg(op, criterion, smootherArgs);
+  int amgIterations = solve(op, b, amg);
+  std::cout<<"AMG with ILUT smoother: "<<amgIterations<<" iterations"<<std::endl;
+  if(amgIterations<0){
+    std::cerr<<"BS="<<BS<<": AMG with ILUT smoother did not converge"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=60;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testILUT<1>(N);
+  ret += testILUT<2>(N/2);
+  return ret;
+}
@@ -0,0 +1,154 @@
+/** \file
+    \brief Checks the iterative ILU decomposition and the Jacobi triangular solves
+
+    With as many sweeps as parts of the partition both are exact, with
+    fewer sweeps CG with the iterative ILU has to converge about as fast
+    as with the exact one.
+*/
+#include"config.h"
+#include<iostream>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/timer.hh>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/ilu.hh>
+#include<dune/istl/operators.hh>
+#include<dune/istl/preconditioners.hh>
+#include<dune/istl/solvers.hh>
+#include<dune/istl/threading.hh>
+#include<laplacian.hh>
+
+template<class M>
+int compareMatrices(const M& A, const M& B, int parts, const char* name)
+{
+  typename M::ConstRowIterator j=B.begin();
+  for(typename M::ConstRowIterator i=A.begin(); i!=A.end(); ++i, ++j){
+    typename M::ConstColIterator k=j->begin();
+    for(typename M::ConstColIterator l=i->begin(); l!=i->end(); ++l, ++k)
+      if(*l!=*k){
+        std::cerr<<name<<" with "<<parts<<" parts differs in entry ("<<i.index()
+                 <<","<<l.index()<<")"<<std::endl;
+        return 1;
+      }
+  }
+  return 0;
+}
+
+template<class V>
+int compareVectors(const V& v, const V& w, int parts, const char* name)
+{
+  for(typename V::size_type i=0; i < v.N(); ++i)
+    if(v[i]!=w[i]){
+      std::cerr<<name<<" with "<<parts<<" parts differs in row "<<i<<std::endl;
+      return 1;
+    }
+  return 0;
+}
+
+/** @brief Solve with CG and the preconditioner and return the iterations. */
+template<class Operator, class Vector, class P>
+int solve(Operator& op, const Vector& b, P& prec)
+{
+  Vector x(b.N()), rhs(b);
+  x=0;
+  Dune::CGSolver<Vector> cg(op, prec, 1e-8, 500, 0);
+  Dune::InverseOperatorResult r;
+  cg.apply(x, rhs, r);
+  return r.converged ? r.iterations : -1;
+}
+
+template<int BS>
+int testIterativeILU(int N)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::FieldVector<double,BS> VectorBlock;
+  typedef Dune::BlockVector<VectorBlock> Vector;
+  typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+
+  BCRSMat mat;
+  setupLaplacian(mat,N);
+  Operator op(mat);
+
+  Vector d(N*N);
+  for(typename Vector::size_type i=0; i < d.N(); ++i)
+    d[i] = 1.0/(i+1);
+
+  int ret = 0;
+
+  // the exact decomposition and solve
+  BCRSMat exact(mat.N(), mat.M(), BCRSMat::row_wise);
+  Dune::bilu_decomposition(mat, 1, exact);
+  Vector exactSolution(N*N);
+  Dune::bilu_backsolve(exact, exactSolution, d);
+
+  BCRSMat ILU(mat.N(), mat.M(), BCRSMat::row_wise);
+  Dune::bilu_pattern(mat, 1, ILU);
+  BCRSMat tmp(ILU);
+  Vector v(N*N), w1(N*N), w2(N*N);
+  for(int parts=1; parts <= 4; ++parts){
+    Dune::RowPartition partition;
+    partition.build(ILU, parts);
+    Dune::bilu_iterative_decomposition(mat, ILU, tmp, parts, partition);
+    ret += compareMatrices(exact, ILU, parts, "iterative decomposition");
+    Dune::bilu_jacobi_backsolve(ILU, v, d, w1, w2, parts, partition);
+    ret += compareVectors(exactSolution, v, parts, "Jacobi solve");
+    // v and d may be the same vector
+    v = d;
+    Dune::bilu_jacobi_backsolve(ILU, v, v, w1, w2, parts, partition);
+    ret += compareVectors(exactSolution, v, parts, "Jacobi solve in place");
+  }
+
+  // one thread computes SeqILUn
+  Dune::ISTLThreading::setThreads(1);
+  Dune::SeqILUn<BCRSMat,Vector,Vector> ilun(mat, 1, 1.0);
+  Dune::SeqIterativeILU<BCRSMat,Vector,Vector> serial(mat, 1, 1.0);
+  Vector serialUpdate(N*N);
+  ilun.apply(v, d);
+  serial.apply(serialUpdate, d);
+  ret += compareVectors(v, serialUpdate, 1, "SeqIterativeILU");
+
+  Dune::ISTLThreading::setThreads(4);
+  Dune::ISTLThreading::setMinWorkPerThread(1);
+  Dune::Timer watch;
+  Dune::SeqILUn<BCRSMat,Vector,Vector> reference(mat, 1, 1.0);
+  double exactSetup = watch.elapsed();
+  watch.reset();
+  Dune::SeqIterativeILU<BCRSMat,Vector,Vector> iterative(mat, 1, 1.0, 2, 2);
+  double iterativeSetup = watch.elapsed();
+  int exactIterations = solve(op, d, reference);
+  int iterations = solve(op, d, iterative);
+
+  std::cout<<"N="<<N*N<<" BS="<<BS<<": ILU(1) setup "<<exactSetup<<"s, "<<exactIterations
+           <<" iterations, iterative ILU(1) with 4 threads setup "<<iterativeSetup<<"s, "
+           <<iterations<<" iterations"<<std::endl;
+  if(exactIterations<0 || iterations<0 || 2*iterations>3*exactIterations){
+    std::cerr<<"CG with the iterative ILU needs too many iterations"<<std::endl;
+    ++ret;
+  }
+
+  // new values on the same pattern
+  mat *= 2.0;
+  iterative.refactor(mat);
+  if(solve(op, d, iterative)!=iterations){
+    std::cerr<<"CG needs a different number of iterations after refactor"<<std::endl;
+    ++ret;
+  }
+  Dune::ISTLThreading::setThreads(1);
+  Dune::ISTLThreading::setMinWorkPerThread(2000);
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=100;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testIterativeILU<1>(N);
+  ret += testIterativeILU<2>(N/2);
+  return ret;
+}
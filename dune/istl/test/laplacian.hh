@@ -3,14 +3,14 @@
 #include <dune/istl/bcrsmatrix.hh>
 #include <dune/common/fvector.hh>
 
-template<class B>
-void setupSparsityPattern(Dune::BCRSMatrix<B>& A, int N)
+template<class B, class Alloc>
+void setupSparsityPattern(Dune::BCRSMatrix<B,Alloc>& A, int N)
 {
-  typedef typename Dune::BCRSMatrix<B> Matrix;
+  typedef typename Dune::BCRSMatrix<B,Alloc> Matrix;
   A.setSize(N*N, N*N, N*N*5);
   A.setBuildMode(Matrix::row_wise);
   
-  for (typename Dune::BCRSMatrix<B>::CreateIterator i = A.createbegin(); i != A.createend(); ++i){
+  for (typename Matrix::CreateIterator i = A.createbegin(); i != A.createend(); ++i){
     int x = i.index()%N; // x coordinate in the 2d field
     int y = i.index()/N;  // y coordinate in the 2d field
 
@@ -34,10 +34,10 @@ void setupSparsityPattern(Dune::BCRSMatrix<B>& A, int N)
 }
 
 
-template<class B>
-void setupLaplacian(Dune::BCRSMatrix<B>& A, int N)
+template<class B, class Alloc>
+void setupLaplacian(Dune::BCRSMatrix<B,Alloc>& A, int N)
 { 
-  typedef typename Dune::BCRSMatrix<B>::field_type FieldType;
+  typedef typename Dune::BCRSMatrix<B,Alloc>::field_type FieldType;
   
   setupSparsityPattern(A,N);
   
@@ -51,7 +51,7 @@ void setupLaplacian(Dune::BCRSMatrix<B>& A, int N)
     b->operator[](b.index())=-1.0;
 
   
-  for (typename Dune::BCRSMatrix<B>::RowIterator i = A.begin(); i != A.end(); ++i){
+  for (typename Dune::BCRSMatrix<B,Alloc>::RowIterator i = A.begin(); i != A.end(); ++i){
     int x = i.index()%N; // x coordinate in the 2d field
     int y = i.index()/N;  // y coordinate in the 2d field
     
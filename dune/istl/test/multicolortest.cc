@@ -0,0 +1,209 @@
+/** \file
+    \brief Checks the multicolor SOR and SSOR preconditioners
+
+    The coloring of the five point stencil is red-black, the sweeps do
+    not depend on the number of threads, and as preconditioner of CG and
+    as smoother of AMG the multicolor methods need about as many
+    iterations as the lexicographic ones. Rows coupled only in one
+    direction of a nonsymmetric pattern get different colors, too.
+*/
+#include"config.h"
+#include<cstdlib>
+#include<iostream>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/multicolor.hh>
+#include<dune/istl/operators.hh>
+#include<dune/istl/preconditioners.hh>
+#include<dune/istl/solvers.hh>
+#include<dune/istl/threading.hh>
+#include<dune/istl/paamg/amg.hh>
+#include<laplacian.hh>
+
+/** @brief Solve with CG and the preconditioner and return the iterations. */
+template<class Operator, class Vector, class P>
+int solve(Operator& op, const Vector& b, P& prec)
+{
+  Vector x(b.N()), rhs(b);
+  x=0;
+  Dune::CGSolver<Vector> cg(op, prec, 1e-8, 500, 0);
+  Dune::InverseOperatorResult r;
+  cg.apply(x, rhs, r);
+  return r.converged ? int(r.iterations) : -1;
+}
+
+/** @brief The iterations of AMG with the smoother S as preconditioner of CG. */
+template<class S, class Operator, class Vector>
+int solveAMG(Operator& op, const Vector& b)
+{
+  typedef typename Operator::matrix_type BCRSMat;
+  typedef Dune::Amg::CoarsenCriterion<Dune::Amg::SymmetricCriterion<BCRSMat,Dune::Amg::FirstDiagonal> >
+    Criterion;
+  Criterion criterion(15,50);
+  criterion.setDefaultValuesIsotropic(2);
+  criterion.setDebugLevel(0);
+  typename Dune::Amg::SmootherTraits<S>::Arguments smootherArgs;
+  Dune::Amg::AMG<Operator,Vector,S> amg(op, criterion, smootherArgs);
+  return solve(op, b, amg);
+}
+
+/** @brief Check that no coupled rows have the same color. */
+template<class M>
+int checkColoring(const M& mat, const Dune::MulticolorOrdering& ordering)
+{
+  for(typename M::ConstRowIterator row=mat.begin(); row!=mat.end(); ++row)
+    for(typename M::ConstColIterator col=row->begin(); col!=row->end(); ++col)
+      if(col.index()!=row.index() && ordering.color(col.index())==ordering.color(row.index())){
+        std::cerr<<"N="<<mat.N()<<": coupled rows "<<row.index()<<" and "<<col.index()
+                 <<" have the same color"<<std::endl;
+        return 1;
+      }
+  return 0;
+}
+
+template<int BS>
+int testMulticolor(int N)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::FieldVector<double,BS> VectorBlock;
+  typedef Dune::BlockVector<VectorBlock> Vector;
+  typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+
+  BCRSMat mat;
+  setupLaplacian(mat,N);
+  Operator op(mat);
+
+  Vector b(mat.N());
+  for(typename Vector::size_type i=0; i < b.N(); ++i)
+    b[i] = 1.0/(i+1);
+
+  int ret = 0;
+
+  Dune::SeqMulticolorSOR<BCRSMat,Vector,Vector> sor(mat, 1, 1.2);
+  const Dune::MulticolorOrdering& ordering = sor.ordering();
+  if(ordering.colors()!=2){
+    std::cerr<<"BS="<<BS<<": "<<ordering.colors()<<" colors instead of 2"<<std::endl;
+    ++ret;
+  }
+  if(checkColoring(mat, ordering))
+    return ret+1;
+
+  // the rows of a color are not coupled, thus the sweeps do not depend on the threads
+  Dune::ISTLThreading::setThreads(1);
+  Vector serialForward(mat.N()), serialBackward(mat.N());
+  serialForward = 0;
+  sor.template apply<true>(serialForward, b);
+  serialBackward = serialForward;
+  sor.template apply<false>(serialBackward, b);
+  Dune::ISTLThreading::setMinWorkPerThread(1);
+  for(int threads=2; threads <= 8; ++threads){
+    Dune::ISTLThreading::setThreads(threads);
+    Vector v(mat.N());
+    v = 0;
+    sor.template apply<true>(v, b);
+    for(std::size_t i=0; i < v.N(); ++i)
+      if(v[i]!=serialForward[i]){
+        std::cerr<<"BS="<<BS<<": forward sweep with "<<threads<<" threads differs in row "
+                 <<i<<std::endl;
+        ++ret;
+        break;
+      }
+    sor.template apply<false>(v, b);
+    for(std::size_t i=0; i < v.N(); ++i)
+      if(v[i]!=serialBackward[i]){
+        std::cerr<<"BS="<<BS<<": backward sweep with "<<threads<<" threads differs in row "
+                 <<i<<std::endl;
+        ++ret;
+        break;
+      }
+  }
+
+  // the steps of an apply are done by one team and have to match the single sweeps
+  Dune::ISTLThreading::setThreads(4);
+  Dune::SeqMulticolorSSOR<BCRSMat,Vector,Vector> twoSteps(mat, 2, 1.2);
+  Vector steps(mat.N()), sweeps(mat.N());
+  steps = 0;
+  sweeps = 0;
+  twoSteps.apply(steps, b);
+  for(int k=0; k < 2; ++k){
+    Dune::multicolor_bsor(mat, sweeps, b, 1.2, ordering, true, Dune::BL<1>());
+    Dune::multicolor_bsor(mat, sweeps, b, 1.2, ordering, false, Dune::BL<1>());
+  }
+  for(std::size_t i=0; i < steps.N(); ++i)
+    if(steps[i]!=sweeps[i]){
+      std::cerr<<"BS="<<BS<<": two SSOR steps differ from four sweeps in row "<<i<<std::endl;
+      ++ret;
+      break;
+    }
+
+  Dune::SeqSSOR<BCRSMat,Vector,Vector> ssor(mat, 1, 1.0);
+  Dune::SeqMulticolorSSOR<BCRSMat,Vector,Vector> multicolorSSOR(mat, 1, 1.0);
+  int ssorIterations = solve(op, b, ssor);
+  int multicolorIterations = solve(op, b, multicolorSSOR);
+  int amgIterations = solveAMG<Dune::SeqSOR<BCRSMat,Vector,Vector> >(op, b);
+  int multicolorAMGIterations = solveAMG<Dune::SeqMulticolorSOR<BCRSMat,Vector,Vector> >(op, b);
+  int multicolorSSORAMGIterations = solveAMG<Dune::SeqMulticolorSSOR<BCRSMat,Vector,Vector> >(op, b);
+  Dune::ISTLThreading::setThreads(1);
+  Dune::ISTLThreading::setMinWorkPerThread(2000);
+
+  std::cout<<"N="<<mat.N()<<" BS="<<BS<<": CG with SSOR "<<ssorIterations
+           <<" iterations, with multicolor SSOR "<<multicolorIterations
+           <<"; AMG with SOR "<<amgIterations<<", with multicolor SOR "<<multicolorAMGIterations
+           <<", with multicolor SSOR "<<multicolorSSORAMGIterations<<" iterations"<<std::endl;
+  if(ssorIterations<0 || multicolorIterations<0 || 2*multicolorIterations>3*ssorIterations){
+    std::cerr<<"BS="<<BS<<": CG with multicolor SSOR needs too many iterations"<<std::endl;
+    ++ret;
+  }
+  if(amgIterations<0 || multicolorAMGIterations<0 || multicolorSSORAMGIterations<0
+     || multicolorAMGIterations>amgIterations+2){
+    std::cerr<<"BS="<<BS<<": AMG with multicolor smoothers needs too many iterations"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+/**
+ * @brief A pattern with the diagonal and the upper neighbour of each row.
+ *
+ * Row i+1 does not see its coupling to row i, which only the transposed
+ * pattern reveals.
+ */
+int testNonsymmetric(int N)
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > BCRSMat;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+
+  BCRSMat mat(N, N, BCRSMat::row_wise);
+  for(BCRSMat::CreateIterator row=mat.createbegin(); row!=mat.createend(); ++row){
+    row.insert(row.index());
+    if(row.index()+1<std::size_t(N))
+      row.insert(row.index()+1);
+  }
+  for(BCRSMat::RowIterator row=mat.begin(); row!=mat.end(); ++row)
+    for(BCRSMat::ColIterator col=row->begin(); col!=row->end(); ++col)
+      *col = col.index()==row.index() ? 2.0 : -1.0;
+
+  Dune::SeqMulticolorSOR<BCRSMat,Vector,Vector> sor(mat, 1, 1.0);
+  if(sor.ordering().colors()!=2){
+    std::cerr<<"nonsymmetric: "<<sor.ordering().colors()<<" colors instead of 2"<<std::endl;
+    return 1;
+  }
+  return checkColoring(mat, sor.ordering());
+}
+
+int main(int argc, char** argv)
+{
+  int N=100;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testMulticolor<1>(N);
+  ret += testMulticolor<2>(N/2);
+  ret += testNonsymmetric(N);
+  return ret;
+}
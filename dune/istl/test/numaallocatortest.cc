@@ -0,0 +1,116 @@
+/** \file
+    \brief Checks that BCRSMatrix and BlockVector work with the NumaAllocator
+*/
+#include"config.h"
+#include<iostream>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/numaallocator.hh>
+#include<dune/istl/threading.hh>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/timer.hh>
+#include<laplacian.hh>
+
+template<class V>
+bool aligned(const V& v, std::size_t alignment)
+{
+  return reinterpret_cast<std::size_t>(&v[0])%alignment==0;
+}
+
+template<int BS>
+int testNumaAllocator(int N, int iter)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::FieldVector<double,BS> VectorBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::BlockVector<VectorBlock> Vector;
+  typedef Dune::BCRSMatrix<MatrixBlock,Dune::NumaAllocator<MatrixBlock> > NumaMat;
+  typedef Dune::BlockVector<VectorBlock,Dune::NumaAllocator<VectorBlock> > NumaVector;
+
+  BCRSMat mat;
+  setupLaplacian(mat,N);
+  Vector x(N*N), y(N*N);
+  for(typename Vector::size_type i=0; i < x.N(); ++i)
+    x[i] = 1.0/(i+1);
+
+  Dune::Timer watch;
+  NumaMat numaMat;
+  setupLaplacian(numaMat,N);
+  NumaVector numaX(N*N), numaY(N*N);
+  double setup = watch.elapsed();
+  for(typename Vector::size_type i=0; i < x.N(); ++i)
+    numaX[i] = x[i];
+
+  int ret=0;
+  if(!aligned(numaX, Dune::NumaAllocation::alignment)
+     || !aligned(numaMat[0], Dune::NumaAllocation::alignment)){
+    std::cerr<<"NumaAllocator returned unaligned memory"<<std::endl;
+    ++ret;
+  }
+  Dune::NumaAllocator<double> allocator;
+  const std::size_t hugeSize = Dune::NumaAllocation::hugePageSize/sizeof(double);
+  double* huge = allocator.allocate(hugeSize);
+  if(reinterpret_cast<std::size_t>(huge)%Dune::NumaAllocation::hugePageSize!=0){
+    std::cerr<<"NumaAllocator did not align a huge array to huge pages"<<std::endl;
+    ++ret;
+  }
+  allocator.deallocate(huge, hugeSize);
+
+  watch.reset();
+  for(int i=0; i < iter; ++i)
+    mat.mv(x,y);
+  double plain = watch.elapsed();
+
+  watch.reset();
+  for(int i=0; i < iter; ++i)
+    numaMat.mv(numaX,numaY);
+  double numa = watch.elapsed();
+
+  std::cout<<"N="<<N*N<<" BS="<<BS<<" threads="<<Dune::ISTLThreading::threads()
+           <<" huge pages="<<Dune::NumaAllocation::hugePages()
+           <<": setup "<<setup<<"s, "<<iter<<" MV with std::allocator "<<plain
+           <<"s, with NumaAllocator "<<numa<<"s"<<std::endl;
+
+  for(typename Vector::size_type i=0; i < y.N(); ++i)
+    if(y[i]!=numaY[i]){
+      std::cerr<<"MV with NumaAllocator differs in entry "<<i<<std::endl;
+      return ret+1;
+    }
+
+  // copies and resizing go through the allocator, too
+  NumaMat copy(numaMat);
+  copy = numaMat;
+  numaX.resize(2*N*N);
+  numaX.resize(N*N);
+  copy.mv(numaX,numaY);
+  for(typename Vector::size_type i=0; i < y.N(); ++i)
+    if(y[i]!=numaY[i]){
+      std::cerr<<"MV with copied matrix differs in entry "<<i<<std::endl;
+      return ret+1;
+    }
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=200;
+  int iter=20;
+
+  if(argc>1)
+    N = atoi(argv[1]);
+  if(argc>2)
+    iter = atoi(argv[2]);
+
+  int ret=0;
+  ret += testNumaAllocator<1>(N, iter);
+  ret += testNumaAllocator<3>(N/2, iter);
+
+  // first touch with several threads and huge pages
+  Dune::ISTLThreading::setThreads(4);
+  Dune::ISTLThreading::setMinWorkPerThread(1);
+  Dune::NumaAllocation::setHugePages(true);
+  ret += testNumaAllocator<1>(N, iter);
+  ret += testNumaAllocator<3>(N/2, iter);
+  return ret;
+}
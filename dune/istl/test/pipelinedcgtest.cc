@@ -0,0 +1,103 @@
+/** \file
+    \brief Checks the pipelined and the single reduction CG against CGSolver
+*/
+#include"config.h"
+#include<iostream>
+#include<cmath>
+#include<cstdlib>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/operators.hh>
+#include<dune/istl/preconditioners.hh>
+#include<dune/istl/scalarproducts.hh>
+#include<dune/istl/solvers.hh>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/timer.hh>
+#include<laplacian.hh>
+
+template<class Solver, class Operator, class Prec, class Vector>
+int testSolver(Operator& op, Prec& prec, const Vector& b, const Vector& reference,
+               int referenceIterations, const char* name)
+{
+  Vector x(b.N()), rhs(b);
+  x = 0;
+  Dune::InverseOperatorResult res;
+  Solver solver(op, prec, 1e-10, 1000, 1);
+  solver.apply(x, rhs, res);
+
+  int ret=0;
+  if(!res.converged){
+    std::cerr<<name<<" did not converge"<<std::endl;
+    ++ret;
+  }
+  // in exact arithmetic the iterates equal those of CG
+  if(std::abs(res.iterations-referenceIterations)>2){
+    std::cerr<<name<<" needed "<<res.iterations<<" iterations, CG "
+             <<referenceIterations<<std::endl;
+    ++ret;
+  }
+  x -= reference;
+  if(x.infinity_norm()>1e-7*reference.infinity_norm()){
+    std::cerr<<"solution of "<<name<<" differs from CG by "
+             <<x.infinity_norm()<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+template<int BS>
+int testPipelinedCG(int N)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+  typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+  typedef Dune::SeqSSOR<BCRSMat,Vector,Vector> Prec;
+
+  BCRSMat mat;
+  setupLaplacian(mat,N);
+  Operator op(mat);
+  Prec prec(mat,1,1.0);
+
+  Vector b(N*N), x(N*N);
+  for(int i=0; i < N*N; ++i)
+    b[i] = 1.0/(i+1);
+  Vector rhs(b);
+  x = 0;
+
+  Dune::InverseOperatorResult res;
+  Dune::CGSolver<Vector> cg(op, prec, 1e-10, 1000, 1);
+  cg.apply(x, rhs, res);
+
+  int ret=0;
+  ret += testSolver<Dune::PipelinedCGSolver<Vector> >(op, prec, b, x, res.iterations,
+                                                      "PipelinedCGSolver");
+  ret += testSolver<Dune::ChronopoulosGearCGSolver<Vector> >(op, prec, b, x, res.iterations,
+                                                             "ChronopoulosGearCGSolver");
+
+  // a zero right hand side converges immediately
+  Vector zero(N*N);
+  zero = 0;
+  x = 0;
+  Dune::PipelinedCGSolver<Vector> pcg(op, prec, 1e-10, 1000, 0);
+  pcg.apply(x, zero, res);
+  if(!res.converged || res.iterations!=0){
+    std::cerr<<"PipelinedCGSolver does not stop for a zero defect"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=40;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testPipelinedCG<1>(N);
+  ret += testPipelinedCG<2>(N/2);
+  return ret;
+}
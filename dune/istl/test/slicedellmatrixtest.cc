@@ -0,0 +1,137 @@
+/** \file
+    \brief Checks the SlicedEllMatrix against the BCRSMatrix it was built from
+*/
+#include"config.h"
+#include<iostream>
+#include<cmath>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/slicedellmatrix.hh>
+#include<dune/istl/operators.hh>
+#include<dune/istl/preconditioners.hh>
+#include<dune/istl/solvers.hh>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/timer.hh>
+#include<laplacian.hh>
+
+template<class V>
+int compare(const V& v, const V& w, const char* name)
+{
+  V d(v);
+  d -= w;
+  if(d.infinity_norm() > 1e-12*v.infinity_norm()){
+    std::cerr<<name<<" of SlicedEllMatrix differs from BCRSMatrix by "
+             <<d.infinity_norm()<<std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+template<int BS>
+int testSlicedEll(int N, int chunkSize, int sigma)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::SlicedEllMatrix<MatrixBlock> EllMat;
+  typedef Dune::FieldVector<double,BS> VectorBlock;
+  typedef Dune::BlockVector<VectorBlock> Vector;
+
+  BCRSMat mat;
+  setupLaplacian(mat,N);
+  EllMat ell(mat, chunkSize, sigma);
+
+  if(ell.N()!=mat.N() || ell.M()!=mat.M() || ell.nonzeroes()!=mat.nonzeroes()){
+    std::cerr<<"SlicedEllMatrix has wrong sizes"<<std::endl;
+    return 1;
+  }
+
+  Vector x(N*N), y1(N*N), y2(N*N);
+  for(typename Vector::size_type i=0; i < x.N(); ++i)
+    x[i] = 1.0/(i+1);
+
+  int ret=0;
+  mat.mv(x,y1);
+  ell.mv(x,y2);
+  ret += compare(y1,y2,"mv");
+
+  y1 = 1.0; y2 = 1.0;
+  mat.umv(x,y1);
+  ell.umv(x,y2);
+  ret += compare(y1,y2,"umv");
+
+  y1 = 1.0; y2 = 1.0;
+  mat.mmv(x,y1);
+  ell.mmv(x,y2);
+  ret += compare(y1,y2,"mmv");
+
+  y1 = 1.0; y2 = 1.0;
+  mat.usmv(-0.3,x,y1);
+  ell.usmv(-0.3,x,y2);
+  ret += compare(y1,y2,"usmv");
+
+  // refresh the values
+  mat *= 2.0;
+  ell.updateValues(mat);
+  mat.mv(x,y1);
+  ell.mv(x,y2);
+  ret += compare(y1,y2,"mv after updateValues");
+
+  std::cout<<"N="<<N*N<<" BS="<<BS<<" C="<<chunkSize<<" sigma="<<sigma
+           <<": stored "<<ell.storedBlocks()<<" blocks for "
+           <<ell.nonzeroes()<<" nonzeros"<<std::endl;
+
+  // the Krylov solvers work on the sliced matrix through MatrixAdapter
+  typedef Dune::MatrixAdapter<EllMat,Vector,Vector> Operator;
+  Operator op(ell);
+  Dune::Richardson<Vector,Vector> prec(0.125);
+  Dune::CGSolver<Vector> solver(op, prec, 1e-8, 5000, 0);
+  Dune::InverseOperatorResult res;
+  Vector b(N*N);
+  b = 1.0;
+  y1 = 0.0;
+  solver.apply(y1, b, res);
+  if(!res.converged){
+    std::cerr<<"CG on SlicedEllMatrix did not converge"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+/** @brief The products of empty matrices must not touch the vectors. */
+int testEmpty()
+{
+  typedef Dune::FieldMatrix<double,1,1> MatrixBlock;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+  Dune::BCRSMatrix<MatrixBlock> mat(0, 0, Dune::BCRSMatrix<MatrixBlock>::row_wise);
+  for(Dune::BCRSMatrix<MatrixBlock>::CreateIterator row=mat.createbegin(); row!=mat.createend(); ++row) ;
+  Dune::SlicedEllMatrix<MatrixBlock> empty, converted(mat);
+  Vector x(0), y(0);
+  empty.mv(x,y);
+  empty.umv(x,y);
+  converted.mv(x,y);
+  converted.usmv(2.0,x,y);
+  if(empty.storedBlocks()!=0 || converted.storedBlocks()!=0){
+    std::cerr<<"empty SlicedEllMatrix stores blocks"<<std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  int N=40;
+
+  if(argc>1)
+    N = atoi(argv[1]);
+
+  int ret=0;
+  ret += testSlicedEll<1>(N, 8, 128);
+  ret += testSlicedEll<1>(N, 4, 1);
+  ret += testSlicedEll<1>(N+3, 8, 64);
+  ret += testSlicedEll<2>(N, 4, 32);
+  // more rows per chunk than summed on the stack at once, sigma < C does not sort
+  ret += testSlicedEll<1>(N, 40, 16);
+  ret += testEmpty();
+  return ret;
+}
@@ -0,0 +1,178 @@
+/** \file
+    \brief Checks the built-in sparse LU solver
+
+    Solves Laplace problems with scalar and block entries directly and as
+    the subdomain solver of SeqOverlappingSchwarz and checks the error
+    of the solution.
+*/
+#include"config.h"
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/timer.hh>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/operators.hh>
+#include<dune/istl/overlappingschwarz.hh>
+#include<dune/istl/solvers.hh>
+#include<dune/istl/sparselu.hh>
+#include"laplacian.hh"
+#include<cmath>
+#include<cstdlib>
+#include<iostream>
+#include<set>
+#include<vector>
+
+/** @brief The maximum difference of the entries of two vectors. */
+template<class V>
+double error(const V& x, const V& y)
+{
+  V e(x);
+  e-=y;
+  return e.infinity_norm();
+}
+
+template<int BS>
+int testSolve(int N)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+  typedef Dune::SparseLU<BCRSMat> Solver;
+
+  BCRSMat mat;
+  setupLaplacian(mat,N);
+  // make the matrix unsymmetric
+  for(typename BCRSMat::RowIterator row=mat.begin(); row!=mat.end(); ++row)
+    for(typename BCRSMat::ColIterator col=row->begin(); col!=row->end(); ++col)
+      if(col.index()==row.index()+1)
+        *col*=0.5;
+
+  Vector solution(mat.N()), b(mat.N()), x(mat.N());
+  for(std::size_t i=0; i < solution.N(); ++i)
+    solution[i]=std::sin(double(i));
+  mat.mv(solution, b);
+
+  Dune::Timer watch;
+  Solver solver(mat);
+  double decomposition=watch.elapsed();
+  watch.reset();
+  Dune::InverseOperatorResult res;
+  solver.apply(x, b, res);
+  double solve=watch.elapsed();
+
+  int ret=0;
+  if(error(x, solution)>1e-10 || !res.converged){
+    std::cerr<<"BS="<<BS<<": error "<<error(x, solution)<<" of the solution"<<std::endl;
+    ++ret;
+  }
+  std::cout<<"N="<<mat.N()<<" BS="<<BS<<": "<<solver.nonzeroes()<<" nonzeros in the factors ("
+           <<solver.memory()<<" bytes), decomposition "<<decomposition<<"s, solve "
+           <<solve<<"s"<<std::endl;
+
+  // new values on the same pattern
+  mat*=2.0;
+  solver.refactor(mat);
+  mat.mv(solution, b);
+  x=0;
+  solver.apply(x, b, res);
+  if(error(x, solution)>1e-10){
+    std::cerr<<"BS="<<BS<<": error "<<error(x, solution)<<" after refactor"<<std::endl;
+    ++ret;
+  }
+
+  // a submatrix, the entries of longer vectors after it are untouched
+  std::set<std::size_t> rows;
+  for(std::size_t i=0; i < mat.N(); i+=3)
+    rows.insert(i);
+  solver.setSubMatrix(mat, rows);
+  Vector local(rows.size()), d(rows.size()+1), v(rows.size()+1);
+  for(std::size_t i=0; i < local.N(); ++i)
+    local[i]=1.0/(i+1);
+  d=0;
+  v=42;
+  std::size_t i=0;
+  for(std::set<std::size_t>::const_iterator row=rows.begin(); row!=rows.end(); ++row, ++i){
+    std::size_t j=0;
+    for(std::set<std::size_t>::const_iterator col=rows.begin(); col!=rows.end(); ++col, ++j)
+      if(mat.exists(*row, *col))
+        mat[*row][*col].umv(local[j], d[i]);
+  }
+  solver.apply(v, d);
+  Vector last(1);
+  last[0]=v[rows.size()];
+  v.resize(rows.size());
+  if(error(v, local)>1e-10 || last[0]!=Dune::FieldVector<double,BS>(42)){
+    std::cerr<<"BS="<<BS<<": wrong solution of the submatrix"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int testSchwarz(int N)
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > BCRSMat;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+  typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+  typedef Dune::SeqOverlappingSchwarz<BCRSMat,Vector,Dune::MultiplicativeSchwarzMode,
+    Dune::SparseLU<BCRSMat> > Schwarz;
+
+  BCRSMat mat;
+  setupLaplacian(mat,N);
+  Operator fop(mat);
+
+  // stripes of four rows of the grid overlapping by one row
+  Schwarz::subdomain_vector domains((N+2)/3);
+  for(int i=0; i < N*N; ++i){
+    int y=i/N;
+    domains[std::min(y/3, int(domains.size())-1)].insert(i);
+    if(y%3==0 && y>0)
+      domains[y/3-1].insert(i);
+  }
+
+  int ret=0;
+  for(int onTheFly=0; onTheFly < 2; ++onTheFly){
+    Schwarz schwarz(mat, domains, 1, onTheFly);
+    Vector x(mat.N()), b(mat.N());
+    b=1;
+    x=0;
+    Dune::BiCGSTABSolver<Vector> solver(fop, schwarz, 1e-8, 100, 0);
+    Dune::InverseOperatorResult res;
+    solver.apply(x, b, res);
+    std::cout<<"multiplicative Schwarz with "<<domains.size()<<" subdomains"
+             <<(onTheFly ? " (on the fly)" : "")<<": "<<res.iterations<<" iterations"<<std::endl;
+    if(!res.converged){
+      std::cerr<<"Schwarz with SparseLU subdomain solvers did not converge"<<std::endl;
+      ++ret;
+    }
+  }
+
+  // with a single subdomain Schwarz is a direct solver
+  Schwarz::subdomain_vector all(1);
+  for(int i=0; i < N*N; ++i)
+    all[0].insert(i);
+  Schwarz direct(mat, all, 1, false);
+  Vector x(mat.N()), b(mat.N()), solution(mat.N());
+  for(std::size_t i=0; i < solution.N(); ++i)
+    solution[i]=i%7;
+  mat.mv(solution, b);
+  x=0;
+  direct.apply(x, b);
+  if(error(x, solution)>1e-10){
+    std::cerr<<"Schwarz with one subdomain is not exact"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=60;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testSolve<1>(N);
+  ret += testSolve<2>(N/2);
+  ret += testSchwarz(N/2);
+  return ret;
+}
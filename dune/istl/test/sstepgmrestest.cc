@@ -0,0 +1,199 @@
+/** \file
+    \brief Checks the s-step GMRes against RestartedGMResSolver
+*/
+#include"config.h"
+#include<iostream>
+#include<cmath>
+#include<cstdlib>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/operators.hh>
+#include<dune/istl/preconditioners.hh>
+#include<dune/istl/scalarproducts.hh>
+#include<dune/istl/solvers.hh>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<laplacian.hh>
+
+/**
+ * @brief A sequential scalar product counting the global reductions.
+ */
+template<class X>
+class CountingScalarProduct : public Dune::SeqScalarProduct<X>
+{
+public:
+  typedef typename X::field_type field_type;
+
+  CountingScalarProduct()
+    : reductions(0)
+  {}
+
+  virtual field_type dot (const X& x, const X& y)
+  {
+    ++reductions;
+    return Dune::SeqScalarProduct<X>::dot(x,y);
+  }
+
+  virtual double norm (const X& x)
+  {
+    ++reductions;
+    return Dune::SeqScalarProduct<X>::norm(x);
+  }
+
+  virtual void startDots (const X* const* x, const X* const* y, int n, field_type* result)
+  {
+    ++reductions;
+    for (int k=0; k<n; k++)
+      result[k] = (*x[k])*(*y[k]);
+  }
+
+  int reductions;
+};
+
+/**
+ * @brief Adds an upwinded convection in x direction to the Laplacian.
+ */
+template<class M>
+void setupConvectionDiffusion(M& mat, int N, double convection)
+{
+  setupLaplacian(mat,N);
+  for(typename M::RowIterator i=mat.begin(); i!=mat.end(); ++i)
+    for(int k=0; k < M::block_type::rows; ++k){
+      (*i)[i.index()][k][k] += convection;
+      if(i.index()%N>0)
+        (*i)[i.index()-1][k][k] -= convection;
+    }
+}
+
+template<int BS>
+int testSStepGMRes(int N)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::BlockVector<Dune::FieldVector<double,BS> > Vector;
+  typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+  typedef Dune::SeqJac<BCRSMat,Vector,Vector> Prec;
+
+  BCRSMat mat;
+  setupConvectionDiffusion(mat,N,5.0);
+  Operator op(mat);
+  Prec prec(mat,1,1.0);
+
+  Vector b(N*N), reference(N*N);
+  for(int i=0; i < N*N; ++i)
+    b[i] = 1.0/(i+1);
+  Vector rhs(b);
+  reference = 0;
+
+  Dune::InverseOperatorResult res;
+  Dune::RestartedGMResSolver<Vector> gmres(op, prec, 1e-12, 10, 1000, 1);
+  gmres.apply(reference, rhs, res);
+
+  int ret=0;
+  int iterations=-1;
+  const int restart=10;
+  const int steps[4] = { 1, 3, 5, 8 };
+  for(int k=0; k < 4; ++k){
+    Vector x(N*N);
+    x = 0;
+    rhs = b;
+    CountingScalarProduct<Vector> sp;
+    Dune::SStepGMResSolver<Vector> solver(op, sp, prec, 1e-10, restart, steps[k], 1000, 1);
+    solver.apply(x, rhs, res);
+
+    if(!res.converged){
+      std::cerr<<"SStepGMResSolver with s="<<steps[k]<<" did not converge"<<std::endl;
+      ++ret;
+    }
+    // in exact arithmetic all s yield the same iterates
+    if(iterations<0)
+      iterations = res.iterations;
+    else if(std::abs(res.iterations-iterations)>2){
+      std::cerr<<"SStepGMResSolver with s="<<steps[k]<<" needed "<<res.iterations
+               <<" iterations instead of "<<iterations<<std::endl;
+      ++ret;
+    }
+    // two reductions per block and one per restart
+    int cycles = (res.iterations+restart-1)/restart;
+    int blocks = cycles*((restart+steps[k]-1)/steps[k]);
+    if(sp.reductions>2*blocks+cycles+1){
+      std::cerr<<"SStepGMResSolver with s="<<steps[k]<<" needed "<<sp.reductions
+               <<" reductions for "<<blocks<<" blocks"<<std::endl;
+      ++ret;
+    }
+    std::cout<<"s="<<steps[k]<<": "<<sp.reductions<<" reductions"<<std::endl;
+
+    x -= reference;
+    if(x.infinity_norm()>1e-6*reference.infinity_norm()){
+      std::cerr<<"solution of SStepGMResSolver with s="<<steps[k]
+               <<" differs from GMRes by "<<x.infinity_norm()<<std::endl;
+      ++ret;
+    }
+  }
+
+  // a zero right hand side converges immediately
+  Vector zero(N*N), x(N*N);
+  zero = 0;
+  x = 0;
+  Dune::SStepGMResSolver<Vector> solver(op, prec, 1e-10, restart, 4, 1000, 0);
+  solver.apply(x, zero, res);
+  if(!res.converged || res.iterations!=0){
+    std::cerr<<"SStepGMResSolver does not stop for a zero defect"<<std::endl;
+    ++ret;
+  }
+  return ret;
+}
+
+/**
+ * @brief With three distinct eigenvalues the Krylov space is invariant
+ * after three steps, thus the next monomial basis vector is linearly
+ * dependent and the solver has to make a classical Arnoldi step.
+ */
+int testBreakdown()
+{
+  typedef Dune::BCRSMatrix<Dune::FieldMatrix<double,1,1> > BCRSMat;
+  typedef Dune::BlockVector<Dune::FieldVector<double,1> > Vector;
+  typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+  const int n=60;
+
+  BCRSMat mat(n, n, n, BCRSMat::row_wise);
+  for(BCRSMat::CreateIterator row=mat.createbegin(); row!=mat.createend(); ++row)
+    row.insert(row.index());
+  for(int i=0; i < n; ++i)
+    mat[i][i] = 1.0+i%3;
+  Operator op(mat);
+  Dune::Richardson<Vector,Vector> prec(1.0);
+
+  Vector x(n), b(n);
+  x = 0;
+  b = 1.0;
+  Dune::InverseOperatorResult res;
+  // a reduction below round-off keeps the solver going after the breakdown
+  Dune::SStepGMResSolver<Vector> solver(op, prec, 1e-30, 10, 5, 12, 0);
+  try{
+    solver.apply(x, b, res);
+  }catch(Dune::ISTLError& e){
+    std::cerr<<"SStepGMResSolver did not recover from a breakdown: "<<e<<std::endl;
+    return 1;
+  }
+  for(int i=0; i < n; ++i)
+    if(std::abs(x[i][0]*(1.0+i%3)-1.0)>1e-12){
+      std::cerr<<"SStepGMResSolver after a breakdown is wrong in row "<<i<<std::endl;
+      return 1;
+    }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  int N=30;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testSStepGMRes<1>(N);
+  ret += testSStepGMRes<2>(N/2);
+  ret += testBreakdown();
+  return ret;
+}
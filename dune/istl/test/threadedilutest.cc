@@ -0,0 +1,105 @@
+/** \file
+    \brief Checks that the level scheduled ILU solves agree with the serial ones
+*/
+#include"config.h"
+#include<iostream>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/ilu.hh>
+#include<dune/istl/preconditioners.hh>
+#include<dune/istl/threading.hh>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/timer.hh>
+#include<laplacian.hh>
+
+template<class V>
+int compare(const V& v, const V& w, int threads, const char* name)
+{
+  for(typename V::size_type i=0; i < v.N(); ++i)
+    // every row is computed as in the serial solve
+    if(v[i]!=w[i]){
+      std::cerr<<name<<" with "<<threads<<" threads differs in row "<<i
+               <<": "<<v[i]<<" != "<<w[i]<<std::endl;
+      return 1;
+    }
+  return 0;
+}
+
+template<int BS>
+int testThreadedILU(int N)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::FieldVector<double,BS> VectorBlock;
+  typedef Dune::BlockVector<VectorBlock> Vector;
+
+  BCRSMat mat;
+  setupLaplacian(mat,N);
+
+  Vector d(N*N);
+  for(typename Vector::size_type i=0; i < d.N(); ++i)
+    d[i] = 1.0/(i+1);
+
+  int ret = 0;
+
+  // the rows of an anti-diagonal of the grid form one level
+  BCRSMat ILU(mat);
+  Dune::bilu0_decomposition(ILU);
+  Dune::ILULevelSchedule schedule;
+  schedule.build(ILU);
+  if(schedule.lowerLevels()!=std::size_t(2*N-1) || schedule.upperLevels()!=std::size_t(2*N-1)){
+    std::cerr<<"schedule has "<<schedule.lowerLevels()<<" and "<<schedule.upperLevels()
+             <<" levels instead of "<<2*N-1<<std::endl;
+    ++ret;
+  }
+
+  Dune::ISTLThreading::setThreads(1);
+  Dune::SeqILU0<BCRSMat,Vector,Vector> ilu0(mat, 1.0);
+  Dune::SeqILUn<BCRSMat,Vector,Vector> ilun(mat, 1, 1.0);
+  Vector ilu0Serial(N*N), ilunSerial(N*N);
+  Dune::Timer watch;
+  ilu0.apply(ilu0Serial, d);
+  double serial = watch.elapsed();
+  ilun.apply(ilunSerial, d);
+
+  // v and d may be the same vector
+  Vector inplace(d);
+  Dune::bilu_backsolve(ILU, inplace, inplace, schedule);
+  ret += compare(ilu0Serial, inplace, 1, "in place solve");
+
+  Dune::ISTLThreading::setMinWorkPerThread(1);
+  double threaded = 0;
+  for(int threads=2; threads <= 8; ++threads){
+    Dune::ISTLThreading::setThreads(threads);
+    Vector v(N*N);
+    watch.reset();
+    ilu0.apply(v, d);
+    if(threads==4)
+      threaded = watch.elapsed();
+    ret += compare(ilu0Serial, v, threads, "ILU0");
+    ilun.apply(v, d);
+    ret += compare(ilunSerial, v, threads, "ILU(1)");
+    v = d;
+    Dune::bilu_backsolve(ILU, v, v, schedule);
+    ret += compare(ilu0Serial, v, threads, "in place solve");
+  }
+  Dune::ISTLThreading::setThreads(1);
+
+  std::cout<<"N="<<N*N<<" BS="<<BS<<": "<<schedule.lowerLevels()<<" levels, ILU0 apply took "
+           <<serial<<"s serially and "<<threaded<<"s with 4 threads"<<std::endl;
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=200;
+
+  if(argc>1)
+    N = std::atoi(argv[1]);
+
+  int ret=0;
+  ret += testThreadedILU<1>(N);
+  ret += testThreadedILU<2>(N/2);
+  return ret;
+}
@@ -0,0 +1,121 @@
+/** \file
+    \brief Checks and times the threaded transposed matrix-vector products
+    against the serial ones
+*/
+#include"config.h"
+#include<iostream>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/threading.hh>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/timer.hh>
+#include<laplacian.hh>
+
+template<class V>
+int compare(const V& v, const V& w, int threads, const char* name)
+{
+  for(typename V::size_type i=0; i < v.N(); ++i)
+    // the threaded kernels have to reproduce the serial result exactly
+    if(v[i]!=w[i]){
+      std::cerr<<name<<" with "<<threads<<" threads differs in entry "<<i
+               <<": "<<v[i]<<" != "<<w[i]<<std::endl;
+      return 1;
+    }
+  return 0;
+}
+
+template<int BS>
+int testThreadedMTV(int N, int iter)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::FieldVector<double,BS> VectorBlock;
+  typedef Dune::BlockVector<VectorBlock> Vector;
+
+  BCRSMat mat;
+  setupSparsityPattern(mat,N);
+
+  // make the matrix unsymmetric
+  typedef typename BCRSMat::RowIterator RowIterator;
+  typedef typename BCRSMat::ColIterator ColIterator;
+  for(RowIterator i=mat.begin(); i!=mat.end(); ++i)
+    for(ColIterator j=i->begin(); j!=i->end(); ++j)
+      for(int k=0; k < BS; ++k)
+        for(int l=0; l < BS; ++l)
+          (*j)[k][l] = 1.0/(1.0+i.index()+2.0*j.index()+k-l);
+
+  Vector x(N*N), mtv(N*N), umtv(N*N), mmtv(N*N), usmtv(N*N), usmhv(N*N);
+  for(typename Vector::size_type i=0; i < x.N(); ++i)
+    x[i] = 1.0/(i+1);
+
+  Dune::ISTLThreading::setThreads(1);
+  Dune::Timer watch;
+  for(int i=0; i < iter; ++i)
+    mat.mtv(x,mtv);
+  double serial=watch.elapsed();
+  umtv = 1.0;
+  mat.umtv(x,umtv);
+  mmtv = 1.0;
+  mat.mmtv(x,mmtv);
+  usmtv = 1.0;
+  mat.usmtv(-0.3,x,usmtv);
+  usmhv = 1.0;
+  mat.usmhv(-0.3,x,usmhv);
+
+  std::cout<<"N="<<N<<" BS="<<BS<<": "<<iter<<" serial MTV took "<<serial<<" seconds"<<std::endl;
+
+  int ret = 0;
+  Dune::ISTLThreading::setMinWorkPerThread(1);
+
+  for(int threads=2; threads <= 8; threads*=2){
+    Dune::ISTLThreading::setThreads(threads);
+    Vector y(N*N);
+
+    watch.reset();
+    for(int i=0; i < iter; ++i)
+      mat.mtv(x,y);
+    double elapsed=watch.elapsed();
+    std::cout<<"N="<<N<<" BS="<<BS<<": "<<iter<<" MTV with "<<threads
+             <<" threads took "<<elapsed<<" seconds (speedup "
+             <<serial/elapsed<<")"<<std::endl;
+
+    ret += compare(mtv, y, threads, "mtv");
+    y = 1.0;
+    mat.umtv(x,y);
+    ret += compare(umtv, y, threads, "umtv");
+    y = 1.0;
+    mat.mmtv(x,y);
+    ret += compare(mmtv, y, threads, "mmtv");
+    y = 1.0;
+    mat.usmtv(-0.3,x,y);
+    ret += compare(usmtv, y, threads, "usmtv");
+    y = 1.0;
+    mat.usmhv(-0.3,x,y);
+    ret += compare(usmhv, y, threads, "usmhv");
+  }
+
+  Dune::ISTLThreading::setThreads(1);
+  Dune::ISTLThreading::setMinWorkPerThread(2000);
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=100;
+  int iter=100;
+
+  if(argc>1)
+    N = atoi(argv[1]);
+  if(argc>2)
+    iter = atoi(argv[2]);
+
+  int ret = 0;
+  ret += testThreadedMTV<1>(N, iter);
+  ret += testThreadedMTV<3>(N/2, iter);
+
+  if(!Dune::ISTLThreading::available())
+    std::cout<<"no threading backend configured, only the serial path was tested"
+             <<std::endl;
+  return ret;
+}
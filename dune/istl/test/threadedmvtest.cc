@@ -0,0 +1,145 @@
+/** \file
+    \brief Checks that the threaded matrix-vector products agree with the serial ones
+*/
+#include"config.h"
+#include<iostream>
+#include<dune/istl/bvector.hh>
+#include<dune/istl/bcrsmatrix.hh>
+#include<dune/istl/operators.hh>
+#include<dune/istl/threading.hh>
+#include<dune/common/fmatrix.hh>
+#include<dune/common/fvector.hh>
+#include<dune/common/timer.hh>
+#include<laplacian.hh>
+
+#if HAVE_ISTL_STD_THREAD && !HAVE_ISTL_OPENMP
+#include<thread>
+#include<vector>
+#endif
+
+template<class V>
+int compare(const V& v, const V& w, int threads, const char* name)
+{
+  for(typename V::size_type i=0; i < v.N(); ++i)
+    // the threaded kernels have to reproduce the serial result exactly
+    if(v[i]!=w[i]){
+      std::cerr<<name<<" with "<<threads<<" threads differs in row "<<i
+               <<": "<<v[i]<<" != "<<w[i]<<std::endl;
+      return 1;
+    }
+  return 0;
+}
+
+#if HAVE_ISTL_STD_THREAD && !HAVE_ISTL_OPENMP
+/*
+ * Issues products of the same matrix from a std::thread. Only one of
+ * the concurrent callers gets the worker pool, the others compute
+ * serially, all have to get the serial result.
+ */
+template<class M, class V>
+struct ConcurrentMV
+{
+  ConcurrentMV(const M& mat, const V& x, const V& mv, int& failed)
+    : mat_(&mat), x_(&x), mv_(&mv), failed_(&failed)
+  {}
+
+  void operator()() const
+  {
+    V y(x_->N());
+    for(int k=0; k < 50; ++k){
+      mat_->mv(*x_,y);
+      if(compare(*mv_, y, Dune::ISTLThreading::threads(), "concurrent mv"))
+        *failed_ = 1;
+    }
+  }
+
+  const M* mat_;
+  const V* x_;
+  const V* mv_;
+  int* failed_;
+};
+
+template<class M, class V>
+int testConcurrentMV(const M& mat, const V& x, const V& mv)
+{
+  const int callers = 3;
+  std::vector<int> failed(callers, 0);
+  std::vector<std::thread> threads;
+  for(int c=0; c < callers; ++c)
+    threads.push_back(std::thread(ConcurrentMV<M,V>(mat, x, mv, failed[c])));
+  for(int c=0; c < callers; ++c)
+    threads[c].join();
+
+  int ret = 0;
+  for(int c=0; c < callers; ++c)
+    ret += failed[c];
+  return ret;
+}
+#endif
+
+template<int BS>
+int testThreadedMV(int N)
+{
+  typedef Dune::FieldMatrix<double,BS,BS> MatrixBlock;
+  typedef Dune::BCRSMatrix<MatrixBlock> BCRSMat;
+  typedef Dune::FieldVector<double,BS> VectorBlock;
+  typedef Dune::BlockVector<VectorBlock> Vector;
+  typedef Dune::MatrixAdapter<BCRSMat,Vector,Vector> Operator;
+
+  BCRSMat mat;
+  setupLaplacian(mat,N);
+  Operator fop(mat);
+
+  Vector x(N*N), mv(N*N), umv(N*N), usmv(N*N);
+  for(typename Vector::size_type i=0; i < x.N(); ++i)
+    x[i] = 1.0/(i+1);
+
+  Dune::ISTLThreading::setThreads(1);
+  fop.apply(x,mv);
+  umv = 1.0;
+  mat.umv(x,umv);
+  usmv = 1.0;
+  fop.applyscaleadd(-0.3,x,usmv);
+
+  int ret = 0;
+  Dune::ISTLThreading::setMinWorkPerThread(1);
+
+  for(int threads=2; threads <= 8; ++threads){
+    Dune::ISTLThreading::setThreads(threads);
+    Vector y(N*N);
+    fop.apply(x,y);
+    ret += compare(mv, y, threads, "mv");
+    y = 1.0;
+    mat.umv(x,y);
+    ret += compare(umv, y, threads, "umv");
+    y = 1.0;
+    fop.applyscaleadd(-0.3,x,y);
+    ret += compare(usmv, y, threads, "usmv");
+  }
+
+#if HAVE_ISTL_STD_THREAD && !HAVE_ISTL_OPENMP
+  Dune::ISTLThreading::setThreads(4);
+  ret += testConcurrentMV(mat, x, mv);
+#endif
+
+  Dune::ISTLThreading::setThreads(1);
+  Dune::ISTLThreading::setMinWorkPerThread(2000);
+  return ret;
+}
+
+int main(int argc, char** argv)
+{
+  int N=100;
+
+  if(argc>1)
+    N = atoi(argv[1]);
+
+  int ret = 0;
+  ret += testThreadedMV<1>(N);
+  ret += testThreadedMV<3>(N/2);
+
+  if(!Dune::ISTLThreading::available())
+    std::cout<<"no threading backend configured, only the serial path was tested"
+             <<std::endl;
+  return ret;
+}
@@ -0,0 +1,577 @@
+// -*- tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi: set et ts=4 sw=2 sts=2:
+#ifndef DUNE_ISTL_THREADING_HH
+#define DUNE_ISTL_THREADING_HH
+
+#include<cstddef>
+#include<cstdlib>
+#include<vector>
+#include<algorithm>
+
+#include<dune/common/unused.hh>
+
+#if HAVE_ISTL_OPENMP
+#include<omp.h>
+#endif
+
+#if HAVE_ISTL_STD_THREAD && !HAVE_ISTL_OPENMP
+#include<condition_variable>
+#include<mutex>
+#include<thread>
+#endif
+
+/** \file
+ * \brief Shared-memory parallelisation of the ISTL kernels.
+ *
+ * The backend is selected at configure time with
+ * --enable-istl-threads=openmp or --enable-istl-threads=std. Without
+ * a backend all kernels run serially and the code in this file
+ * collapses to plain loops.
+ */
+
+namespace Dune {
+  /**
+   * @addtogroup ISTL_SPMV
+   * @{
+   */
+
+  /**
+   * @brief Runtime settings of the threaded kernels.
+   *
+   * The number of threads defaults to the value of the environment
+   * variable DUNE_ISTL_NUM_THREADS and to one if it is not set, i.e.
+   * threading is opt-in even if a backend was configured.
+   */
+  struct ISTLThreading
+  {
+    /** @brief Whether a threading backend was compiled in. */
+    static bool available()
+    {
+#if HAVE_ISTL_OPENMP || HAVE_ISTL_STD_THREAD
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    /** @brief The number of threads the kernels may use. */
+    static int threads()
+    {
+      return threads_();
+    }
+
+    /** @brief Set the number of threads the kernels may use. */
+    static void setThreads(int n)
+    {
+      threads_() = std::max(n,1);
+    }
+
+    /**
+     * @brief The minimum amount of work (usually the number of matrix blocks)
+     * a thread has to get before an additional thread is used.
+     */
+    static std::size_t minWorkPerThread()
+    {
+      return minWork_();
+    }
+
+    /** @brief Set the minimum amount of work per thread. */
+    static void setMinWorkPerThread(std::size_t work)
+    {
+      minWork_() = std::max(work,std::size_t(1));
+    }
+
+    /**
+     * @brief Get the number of threads to use for a kernel.
+     * @param work The amount of work of the kernel, e.g. the number of
+     * nonzero blocks of a matrix.
+     * @return 1 if no backend is available or the work is too small.
+     */
+    static int threadsFor(std::size_t work)
+    {
+      if(!available())
+        return 1;
+      std::size_t t = work/minWork_();
+      return static_cast<int>(std::max(std::min(t, std::size_t(threads_())),
+                                       std::size_t(1)));
+    }
+
+  private:
+    static int& threads_()
+    {
+      static int t = initialThreads();
+      return t;
+    }
+
+    static std::size_t& minWork_()
+    {
+      static std::size_t w = 2000;
+      return w;
+    }
+
+    static int initialThreads()
+    {
+      const char* env = std::getenv("DUNE_ISTL_NUM_THREADS");
+      if(env==0)
+        return 1;
+      return std::max(std::atoi(env),1);
+    }
+  };
+
+  /**
+   * @brief A partition of the rows of a matrix into contiguous chunks.
+   *
+   * The chunks are chosen such that each contains roughly the same
+   * number of nonzero blocks. The partition only depends on the
+   * sparsity pattern and the number of parts, therefore kernels
+   * based on it are reproducible for a fixed number of threads.
+   */
+  class RowPartition
+  {
+  public:
+    typedef std::size_t size_type;
+
+    RowPartition()
+      : rows_(0)
+    {}
+
+    /**
+     * @brief Partition the rows of a matrix by their number of nonzeros.
+     * @param A The matrix. Its rows have to provide size().
+     * @param parts The number of parts.
+     */
+    template<class M>
+    void build(const M& A, int parts)
+    {
+      rows_ = A.N();
+      offsets_.assign(parts+1, rows_);
+      offsets_[0] = 0;
+
+      // each row is weighted by its number of blocks plus one
+      // such that empty rows are distributed, too.
+      size_type total = 0;
+      typedef typename M::ConstRowIterator RowIterator;
+      RowIterator endi = A.end();
+      for(RowIterator i = A.begin(); i != endi; ++i)
+        total += i->size()+1;
+
+      size_type sum = 0;
+      int p = 1;
+      for(RowIterator i = A.begin(); i != endi && p < parts; ++i){
+        sum += i->size()+1;
+        while(p < parts && sum*parts >= p*total)
+          offsets_[p++] = i.index()+1;
+      }
+    }
+
+    /**
+     * @brief Partition a range given by compressed offsets.
+     *
+     * Item i owns offsets[i+1]-offsets[i] entries and is weighted
+     * like a matrix row.
+     * @param offsets The offsets of the items, the size is the number
+     * of items plus one.
+     * @param parts The number of parts.
+     */
+    template<class V>
+    void buildFromOffsets(const V& offsets, int parts)
+    {
+      rows_ = offsets.size()-1;
+      offsets_.assign(parts+1, rows_);
+      offsets_[0] = 0;
+
+      const size_type total = offsets[rows_]-offsets[0]+rows_;
+      int p = 1;
+      for(size_type i = 0; i < rows_ && p < parts; ++i){
+        const size_type sum = offsets[i+1]-offsets[0]+i+1;
+        while(p < parts && sum*parts >= p*total)
+          offsets_[p++] = i+1;
+      }
+    }
+
+    /**
+     * @brief Partition a range into parts of equal size.
+     * @param n The size of the range.
+     * @param parts The number of parts.
+     */
+    void buildUniform(size_type n, int parts)
+    {
+      rows_ = n;
+      offsets_.resize(parts+1);
+      for(int p = 0; p <= parts; ++p)
+        offsets_[p] = (n*p)/parts;
+    }
+
+    /** @brief Forget the partition. */
+    void clear()
+    {
+      rows_ = 0;
+      offsets_.clear();
+    }
+
+    /** @brief The number of parts. */
+    int parts() const
+    {
+      return offsets_.empty() ? 0 : static_cast<int>(offsets_.size()-1);
+    }
+
+    /** @brief The number of rows partitioned. */
+    size_type rows() const
+    {
+      return rows_;
+    }
+
+    /** @brief The first row of part p. */
+    size_type first(int p) const
+    {
+      return offsets_[p];
+    }
+
+    /** @brief One past the last row of part p. */
+    size_type last(int p) const
+    {
+      return offsets_[p+1];
+    }
+
+    /** @brief The part containing row i. */
+    int partOf(size_type i) const
+    {
+      return static_cast<int>(std::upper_bound(offsets_.begin(), offsets_.end(), i)
+                              - offsets_.begin()) - 1;
+    }
+
+  private:
+    size_type rows_;
+    std::vector<size_type> offsets_;
+  };
+
+  /**
+   * @brief A mutex of the threading backend.
+   *
+   * Protects data built on demand inside const kernels that may be
+   * called concurrently. Copies are new, unlocked mutexes such that
+   * classes owning one keep their copy semantics.
+   */
+  class ISTLMutex
+  {
+  public:
+    ISTLMutex()
+    {
+      init();
+    }
+
+    ISTLMutex(const ISTLMutex&)
+    {
+      init();
+    }
+
+    ISTLMutex& operator=(const ISTLMutex&)
+    {
+      return *this;
+    }
+
+    ~ISTLMutex()
+    {
+#if HAVE_ISTL_OPENMP
+      omp_destroy_lock(&lock_);
+#endif
+    }
+
+    void lock()
+    {
+#if HAVE_ISTL_OPENMP
+      omp_set_lock(&lock_);
+#elif HAVE_ISTL_STD_THREAD
+      mutex_.lock();
+#endif
+    }
+
+    void unlock()
+    {
+#if HAVE_ISTL_OPENMP
+      omp_unset_lock(&lock_);
+#elif HAVE_ISTL_STD_THREAD
+      mutex_.unlock();
+#endif
+    }
+
+  private:
+    void init()
+    {
+#if HAVE_ISTL_OPENMP
+      omp_init_lock(&lock_);
+#endif
+    }
+
+#if HAVE_ISTL_OPENMP
+    omp_lock_t lock_;
+#elif HAVE_ISTL_STD_THREAD
+    std::mutex mutex_;
+#endif
+  };
+
+  /** @brief Holds the lock of an ISTLMutex for the lifetime of the object. */
+  class ISTLScopedLock
+  {
+  public:
+    explicit ISTLScopedLock(ISTLMutex& mutex)
+      : mutex_(mutex)
+    {
+      mutex_.lock();
+    }
+
+    ~ISTLScopedLock()
+    {
+      mutex_.unlock();
+    }
+
+  private:
+    ISTLScopedLock(const ISTLScopedLock&);
+    ISTLScopedLock& operator=(const ISTLScopedLock&);
+
+    ISTLMutex& mutex_;
+  };
+
+#if HAVE_ISTL_STD_THREAD && !HAVE_ISTL_OPENMP
+  /**
+   * @internal
+   * @brief The persistent worker threads of the std::thread backend.
+   *
+   * Worker w always processes part w+1 and the calling thread part 0,
+   * like the threads of an OpenMP team. The workers are started on
+   * first use, the pool only grows, and they sleep between the calls.
+   * A call issued while the pool is busy, i.e. from within a functor
+   * or concurrently from another thread, is rejected and has to be
+   * processed serially by the caller.
+   */
+  class ISTLThreadPool
+  {
+  public:
+    /** @brief The pool shared by all kernels. */
+    static ISTLThreadPool& instance()
+    {
+      static ISTLThreadPool pool;
+      return pool;
+    }
+
+    /**
+     * @brief Call f(p) for all p in [0,parts) on parts concurrently running threads.
+     * @return false without calling f if the pool is busy.
+     */
+    template<class F>
+    bool run(int parts, F& f)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if(busy_)
+          return false;
+        busy_ = true;
+        while(workers_.size()+1 < std::size_t(parts))
+          workers_.push_back(std::thread(&ISTLThreadPool::work, this,
+                                         int(workers_.size()), generation_));
+        task_ = &ISTLThreadPool::invoke<F>;
+        data_ = &f;
+        parts_ = parts;
+        pending_ = parts-1;
+        ++generation_;
+      }
+      wake_.notify_all();
+
+      f(0);
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      while(pending_ > 0)
+        done_.wait(lock);
+      busy_ = false;
+      return true;
+    }
+
+    ~ISTLThreadPool()
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      wake_.notify_all();
+      for(std::size_t w=0; w < workers_.size(); ++w)
+        workers_[w].join();
+    }
+
+  private:
+    ISTLThreadPool()
+      : task_(0), data_(0), parts_(0), pending_(0), generation_(0),
+        busy_(false), stop_(false)
+    {}
+
+    ISTLThreadPool(const ISTLThreadPool&);
+    ISTLThreadPool& operator=(const ISTLThreadPool&);
+
+    template<class F>
+    static void invoke(void* f, int p)
+    {
+      (*static_cast<F*>(f))(p);
+    }
+
+    void work(int w, std::size_t generation)
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      for(;;){
+        while(generation == generation_ && !stop_)
+          wake_.wait(lock);
+        if(stop_)
+          return;
+        generation = generation_;
+        if(w+1 < parts_){
+          void (*task)(void*, int) = task_;
+          void* data = data_;
+          lock.unlock();
+          task(data, w+1);
+          lock.lock();
+          if(--pending_ == 0)
+            done_.notify_one();
+        }
+      }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    void (*task_)(void*, int);
+    void* data_;
+    int parts_;
+    int pending_;
+    std::size_t generation_;
+    bool busy_;
+    bool stop_;
+  };
+#endif
+
+  /**
+   * @brief Call f(p) for all p in [0,parts), concurrently if possible.
+   *
+   * Part p is always processed by the p-th thread of the team such that
+   * the mapping of data to threads is the same in all kernels using
+   * the same partition. The std::thread backend keeps its threads
+   * alive between the calls, see ISTLThreadPool. Nested calls run
+   * serially. The functor must not throw.
+   */
+  template<class F>
+  void parallelFor(int parts, F& f)
+  {
+#if HAVE_ISTL_OPENMP
+#pragma omp parallel for num_threads(parts) schedule(static,1)
+    for(int p=0; p < parts; ++p)
+      f(p);
+#else
+#if HAVE_ISTL_STD_THREAD
+    if(parts > 1 && ISTLThreadPool::instance().run(parts, f))
+      return;
+#endif
+    for(int p=0; p < parts; ++p)
+      f(p);
+#endif
+  }
+
+  /**
+   * @brief A barrier for the threads of parallelTeam().
+   */
+  class TeamBarrier
+  {
+  public:
+    explicit TeamBarrier(int threads)
+      : threads_(threads), waiting_(0), generation_(0)
+    {}
+
+    /** @brief Block until all threads of the team called wait(). */
+    void wait()
+    {
+#if HAVE_ISTL_OPENMP
+#pragma omp barrier
+#elif HAVE_ISTL_STD_THREAD
+      std::unique_lock<std::mutex> lock(mutex_);
+      const std::size_t generation = generation_;
+      if(++waiting_ == threads_){
+        waiting_ = 0;
+        ++generation_;
+        condition_.notify_all();
+      }else
+        while(generation == generation_)
+          condition_.wait(lock);
+#endif
+    }
+
+  private:
+    int threads_;
+    int waiting_;
+    std::size_t generation_;
+#if HAVE_ISTL_STD_THREAD && !HAVE_ISTL_OPENMP
+    std::mutex mutex_;
+    std::condition_variable condition_;
+#endif
+  };
+
+#if HAVE_ISTL_STD_THREAD && !HAVE_ISTL_OPENMP
+  /**
+   * @internal
+   * @brief Calls a functor for one member of a team, used with ISTLThreadPool.
+   */
+  template<class F>
+  struct TeamInvoker
+  {
+    TeamInvoker(F& f, int threads, TeamBarrier& barrier)
+      : f_(&f), threads_(threads), barrier_(&barrier)
+    {}
+
+    void operator()(int p) const
+    {
+      (*f_)(p, threads_, *barrier_);
+    }
+
+    F* f_;
+    int threads_;
+    TeamBarrier* barrier_;
+  };
+#endif
+
+  /**
+   * @brief Call f(p, threads, barrier) on a team of concurrently running threads.
+   *
+   * In contrast to parallelFor() all threads of the team run at the
+   * same time, such that f may synchronize them by barrier.wait(). Each
+   * thread has to call wait() equally often. The team may be smaller
+   * than requested, threads is the actual size and p the number of the
+   * calling thread within the team. Algorithms with many short steps
+   * thus need a single team separated by barriers instead of one
+   * parallelFor() per step. The std::thread backend takes the team from
+   * ISTLThreadPool and runs serially if the pool is busy. The functor
+   * must not throw.
+   */
+  template<class F>
+  void parallelTeam(int threads, F& f)
+  {
+#if HAVE_ISTL_OPENMP
+    TeamBarrier barrier(threads);
+#pragma omp parallel num_threads(threads)
+    f(omp_get_thread_num(), omp_get_num_threads(), barrier);
+#else
+#if HAVE_ISTL_STD_THREAD
+    if(threads > 1){
+      TeamBarrier barrier(threads);
+      TeamInvoker<F> invoker(f, threads, barrier);
+      if(ISTLThreadPool::instance().run(threads, invoker))
+        return;
+    }
+#else
+    DUNE_UNUSED_PARAMETER(threads);
+#endif
+    TeamBarrier barrier(1);
+    f(0, 1, barrier);
+#endif
+  }
+
+  /** @} end documentation */
+
+} // end namespace Dune
+
+#endif
@@ -7,6 +7,10 @@ AC_DEFUN([DUNE_ISTL_CHECKS],
   AC_REQUIRE([DUNE_PATH_SUPERLU])
   AC_REQUIRE([DUNE_PATH_SUPERLU_DIST])
   AC_REQUIRE([DUNE_PARDISO])
+  AC_REQUIRE([DUNE_ISTL_THREADS])
+  # aligned allocation and huge pages for the NumaAllocator
+  AC_CHECK_HEADERS([sys/mman.h])
+  AC_CHECK_FUNCS([posix_memalign madvise])
   AC_REQUIRE([__AC_FC_NAME_MANGLING])
   AC_REQUIRE([AC_PROG_F77])
   AC_REQUIRE([ACX_BLAS])
@@ -0,0 +1,115 @@
+## -*- autoconf -*-
+# $Id$
+# selects the shared-memory backend used by the threaded ISTL kernels
+
+# DUNE_ISTL_THREADS()
+#
+# Shell variables:
+#   with_istl_threads
+#     "no", "openmp" or "std::thread" depending on the backend selected.
+#   ISTL_THREADS_CPPFLAGS
+#   ISTL_THREADS_LDFLAGS
+#   ISTL_THREADS_LIBS
+#     Flags necessary to compile and link the threaded kernels.  Guaranteed
+#     empty if no backend was selected.
+#
+# Substitutions:
+#   ISTL_THREADS_CPPFLAGS
+#   ISTL_THREADS_LDFLAGS
+#   ISTL_THREADS_LIBS
+#     Substitutes the values of the corresponding shell variables.
+#   ALL_PKG_CPPFLAGS
+#   ALL_PKG_LDFLAGS
+#   ALL_PKG_LIBS
+#     Adds references to the substitutions above.
+#
+# Defines:
+#   HAVE_ISTL_OPENMP
+#     ENABLE_ISTL_OPENMP or undefined.  The correct way to check this is
+#     "#if HAVE_ISTL_OPENMP": the threaded kernels stay disabled unless
+#     ${ISTL_THREADS_CPPFLAGS} was given when compiling.
+#   HAVE_ISTL_STD_THREAD
+#     ENABLE_ISTL_STD_THREAD or undefined.  Same as above for std::thread.
+#
+# Conditionals:
+#   ISTL_THREADS
+AC_DEFUN([DUNE_ISTL_THREADS],[
+    AC_REQUIRE([AC_PROG_CXX])
+
+    AC_ARG_ENABLE([istl-threads],
+        [AC_HELP_STRING([--enable-istl-threads=openmp|std],
+            [use shared-memory threads in the sparse matrix kernels,
+             either through OpenMP or through std::thread (default: no)])],
+        [],
+        [enable_istl_threads=no])
+
+    ISTL_THREADS_CPPFLAGS=
+    ISTL_THREADS_LDFLAGS=
+    ISTL_THREADS_LIBS=
+    with_istl_threads=no
+
+    AC_LANG_PUSH([C++])
+    ac_save_CXXFLAGS="$CXXFLAGS"
+    ac_save_LIBS="$LIBS"
+
+    case "$enable_istl_threads" in
+      yes|openmp)
+        AC_OPENMP
+        if test "x$ac_cv_prog_cxx_openmp" != "xunsupported" ; then
+            ISTL_THREADS_CPPFLAGS="$OPENMP_CXXFLAGS -DENABLE_ISTL_OPENMP"
+            ISTL_THREADS_LDFLAGS="$OPENMP_CXXFLAGS"
+            with_istl_threads=openmp
+        else
+            AC_MSG_WARN([OpenMP requested but not supported by $CXX])
+        fi
+        ;;
+      std|std::thread)
+        AC_MSG_CHECKING([whether std::thread is usable])
+        CXXFLAGS="$CXXFLAGS -pthread"
+        LIBS="$LIBS -pthread"
+        AC_LINK_IFELSE([AC_LANG_PROGRAM([[#include <thread>
+            void work() {}]],
+            [[std::thread t(work); t.join();]])],
+          [
+            AC_MSG_RESULT([yes])
+            ISTL_THREADS_CPPFLAGS="-pthread -DENABLE_ISTL_STD_THREAD"
+            ISTL_THREADS_LIBS="-pthread"
+            with_istl_threads="std::thread"
+          ],
+          [
+            AC_MSG_RESULT([no])
+            AC_MSG_WARN([std::thread requested but not usable, is C++0x enabled?])
+          ])
+        ;;
+      no) ;;
+      *)
+        AC_MSG_ERROR([unknown threading backend "$enable_istl_threads"])
+        ;;
+    esac
+
+    CXXFLAGS="$ac_save_CXXFLAGS"
+    LIBS="$ac_save_LIBS"
+    AC_LANG_POP([C++])
+
+    AC_SUBST([ISTL_THREADS_CPPFLAGS])
+    AC_SUBST([ISTL_THREADS_LDFLAGS])
+    AC_SUBST([ISTL_THREADS_LIBS])
+    DUNE_ADD_ALL_PKG([ISTL_THREADS], [\${ISTL_THREADS_CPPFLAGS}],
+      [\${ISTL_THREADS_LDFLAGS}], [\${ISTL_THREADS_LIBS}])
+
+    # tell automake
+    AM_CONDITIONAL(ISTL_THREADS, test x"$with_istl_threads" != xno)
+
+    # tell the preprocessor
+    if test x"$with_istl_threads" = xopenmp ; then
+        AC_DEFINE([HAVE_ISTL_OPENMP], [ENABLE_ISTL_OPENMP],
+          [Define to ENABLE_ISTL_OPENMP if the ISTL kernels should use OpenMP])
+    fi
+    if test x"$with_istl_threads" = "xstd::thread" ; then
+        AC_DEFINE([HAVE_ISTL_STD_THREAD], [ENABLE_ISTL_STD_THREAD],
+          [Define to ENABLE_ISTL_STD_THREAD if the ISTL kernels should use std::thread])
+    fi
+
+    # summary
+    DUNE_ADD_SUMMARY_ENTRY([ISTL threads],[$with_istl_threads])
+])